@@ -11,6 +11,7 @@
 
 #include <Arduino.h>
 #include <WebServer.h>
+#include <vector>
 
 /***************************************************************************************************
  * CONSTANTS
@@ -80,11 +81,19 @@ void WAN_RED_OFF();
 /*ハンドラ設定*/
 void handleRoot(void);
 void handleWifi(void);
-void handleLed(void);
-void handleRedLedOn(void);
-void handleGreenLedOn(void);
-void handleLedOff(void);
+void handleDashboard(void);
+void handleApiStatus(void);
+void handleApiLed(void);
+void handleApiConfig(void);
+void handleEvents(void);
+void handleDiag(void);
+void handleTrace(void);
+void handleCapture(void);
+void handleLoadgen(void);
 void sendErrorPage(String);
+/*ページ作成*/
+String buildRootPage(void);
+String buildWifiPage(const std::vector<String> &ssids);
 /**
  * @brief LAN赤LED点滅関数
  * @param[in] time ：点滅回数
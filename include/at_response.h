@@ -0,0 +1,197 @@
+/**
+ * @file at_response.h
+ * @version 0.1
+ * @brief BG770 応答行の分類器と宣言的応答文法
+ *
+ * 受信した 1 行を接頭辞のハッシュ表で 1 回だけ分類し、
+ * コマンド毎の応答文法（期待行・最終結果・エラー・キャプチャ）と照合する。
+ * 期待行の途中に URC が割り込んでも失敗扱いにしない。
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef AT_RESPONSE_H
+#define AT_RESPONSE_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include "bg770.h"
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief 文法フラグ：期待行以外の未知の行を無視する（エコー等） */
+#define AT_GRAMMAR_IGNORE_UNKNOWN 0x01
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief 応答行の種別 */
+typedef enum e_at_token
+{
+  /** @brief 種別なし（番兵・未指定） */
+  AT_TOKEN_NONE = 0,
+  /** @brief 未知の行 */
+  AT_TOKEN_UNKNOWN,
+  /** @brief 結果コード OK（「0」または「OK」） */
+  AT_TOKEN_OK,
+  /** @brief 結果コード ERROR（「4」「ERROR」「+CME ERROR」） */
+  AT_TOKEN_ERROR,
+  /** @brief データ入力プロンプト（「> 」） */
+  AT_TOKEN_PROMPT,
+  /** @brief 数字のみの行（IMSI 等） */
+  AT_TOKEN_NUMBER,
+  /** @brief APP RDY */
+  AT_TOKEN_APP_RDY,
+  /** @brief NORMAL POWER DOWN */
+  AT_TOKEN_NORMAL_POWER_DOWN,
+  /** @brief POWERED DOWN */
+  AT_TOKEN_POWERED_DOWN,
+  /** @brief +CPIN */
+  AT_TOKEN_CPIN,
+  /** @brief +CSQ */
+  AT_TOKEN_CSQ,
+  /** @brief +COPS */
+  AT_TOKEN_COPS,
+  /** @brief +QIOPEN */
+  AT_TOKEN_QIOPEN,
+  /** @brief +QNTP */
+  AT_TOKEN_QNTP,
+  /** @brief +QMTOPEN */
+  AT_TOKEN_QMTOPEN,
+  /** @brief +QMTCONN */
+  AT_TOKEN_QMTCONN,
+  /** @brief +QMTSUB */
+  AT_TOKEN_QMTSUB,
+  /** @brief +QMTUNS */
+  AT_TOKEN_QMTUNS,
+  /** @brief SEND OK */
+  AT_TOKEN_SEND_OK,
+  /** @brief SEND FAIL */
+  AT_TOKEN_SEND_FAIL,
+  /** @brief +QIRD */
+  AT_TOKEN_QIRD,
+  /** @brief CONNECT（V0 形式は 1。以降はデータ） */
+  AT_TOKEN_CONNECT,
+  /** @brief +QHTTPGET */
+  AT_TOKEN_QHTTPGET,
+  /** @brief +QHTTPREAD */
+  AT_TOKEN_QHTTPREAD,
+  /** @brief +QFOPEN */
+  AT_TOKEN_QFOPEN,
+  /** @brief +QFWRITE */
+  AT_TOKEN_QFWRITE,
+  /** @brief 以降は URC（非同期通知） */
+  AT_TOKEN_URC_FIRST,
+  /** @brief +QMTRECV（サブスクライブ受信） */
+  AT_TOKEN_QMTRECV = AT_TOKEN_URC_FIRST,
+  /** @brief +QMTPUB（PUBACK。非同期送信では他コマンドの実行中に届く） */
+  AT_TOKEN_QMTPUB,
+  /** @brief +QMTSTAT（MQTT 状態変化） */
+  AT_TOKEN_QMTSTAT,
+  /** @brief +QMTPING */
+  AT_TOKEN_QMTPING,
+  /** @brief +QIURC（ソケット通知） */
+  AT_TOKEN_QIURC,
+  /** @brief +CEREG */
+  AT_TOKEN_CEREG,
+  /** @brief +CGREG */
+  AT_TOKEN_CGREG,
+  /** @brief +QIND */
+  AT_TOKEN_QIND,
+  /** @brief +QHTTPPOSTFILE（HTTP POST の結果。OK の後に届く） */
+  AT_TOKEN_QHTTPPOSTFILE,
+  /** @brief RDY */
+  AT_TOKEN_RDY,
+  /** @brief 種別数 */
+  AT_TOKEN_MAX,
+} at_token_t;
+
+/** @brief 分類済みの応答行 */
+typedef struct st_at_line
+{
+  /** @brief 種別 */
+  at_token_t token;
+  /** @brief 元の行 */
+  const char *content;
+  /** @brief 「: 」以降の引数部分（無い場合は空文字列） */
+  const char *args;
+} at_line_t;
+
+/** @brief 期待行（文法の 1 ステップ） */
+typedef struct st_at_response_step
+{
+  /** @brief 期待する種別 */
+  at_token_t token;
+  /** @brief 引数の完全一致条件（NULL の場合は問わない） */
+  const char *args;
+  /** @brief キャプチャ関数（NULL可。false を返すと失敗） */
+  bool (*capture)(const at_line_t *line);
+} at_response_step_t;
+
+/** @brief コマンド毎の応答文法 */
+typedef struct st_at_response_grammar
+{
+  /** @brief 期待行の並び（最後のステップが最終結果） */
+  const at_response_step_t *steps;
+  /** @brief ステップ数 */
+  uint8_t step_count;
+  /** @brief 追加のエラー種別（AT_TOKEN_NONE で無し） */
+  at_token_t error_token;
+  /** @brief AT_GRAMMAR_* フラグ */
+  uint8_t flags;
+  /** @brief 失敗時の戻り値を決める関数（NULL の場合 API_STATUS_FAIL） */
+  api_status_t (*on_fail)(const at_line_t *line);
+  /** @brief 期待行以外の未知の行（受信データ等）を受け取る関数（NULL可。設定時は無視扱い） */
+  void (*on_other)(const at_line_t *line);
+} at_response_grammar_t;
+
+/** @brief 照合状態 */
+typedef struct st_at_response_state
+{
+  /** @brief 次に期待するステップ */
+  uint8_t step;
+  /** @brief 受信行数 */
+  uint16_t lines;
+} at_response_state_t;
+
+/**************************************************************************************************
+ * GLOBAL FUNCTIONS
+ */
+/**
+ * @brief 分類表の初期化関数（起動時に 1 回）
+ */
+void at_response_init(void);
+/**
+ * @brief 応答行の分類関数
+ * @param[in] content :改行を除いた受信行
+ * @param[out] line :分類結果
+ */
+void at_classify(const char *content, at_line_t *line);
+/**
+ * @brief URC 通知先の登録関数（種別毎に 1 つ）
+ * @param[in] token :URC の種別（AT_TOKEN_URC_FIRST 以降）
+ * @param[in] handler :URC を受け取る関数（NULL で解除）
+ */
+void at_set_urc_handler(at_token_t token, void (*handler)(const at_line_t *line));
+/**
+ * @brief URC の配送関数（応答待ち以外で受信した行用）
+ * @param[in] line :分類済みの行
+ * @return true：URC として処理した
+ */
+bool at_dispatch_urc(const at_line_t *line);
+/**
+ * @brief 応答文法との照合関数
+ * @param[in] grammar :応答文法
+ * @param[in/out] state :照合状態（コマンド送信毎にゼロ初期化）
+ * @param[in] content :改行を除いた受信行
+ * @return API_STATUS_SUCCESS：最終結果まで一致
+ *         API_STATUS_IN_PROGRESS：照合継続中
+ *         API_STATUS_FAIL 等：エラー（on_fail の戻り値）
+ */
+api_status_t at_response_match(const at_response_grammar_t *grammar, at_response_state_t *state, const char *content);
+
+#endif
@@ -0,0 +1,78 @@
+/**
+ * @file bench.h
+ * @version 0.1
+ * @brief 文字列・ペイロード処理のマイクロベンチマーク API
+ *
+ * split()/RxData_Analize()/bg770_RxDataGet()/create_command_*()/publish_payload_build()/
+ * Web ページ・状態 JSON 作成を繰り返し実行し、1 回あたりの時間[ns]・確保バイト数・確保回数を計測する。
+ * 結果は基準値と比較し、許容範囲を超えた項目を FAIL とする。
+ *   ・ホスト：env:bench_native（tools/bench_native）。基準値はリポジトリの tools/bench_native/baseline.txt
+ *   ・実機  ：BENCHMARK を有効にしてビルドすると起動時に計測結果を表示する（基準値との比較は無し）
+ * 確保回数の計測には malloc/realloc のリンク時ラップ（platformio.ini の env:bench・env:bench_native）が必要。
+ * BENCH_NATIVE では Web サーバー（WiFi）に依存する Web ページ・状態 JSON 作成を計測しない。
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef BENCH_H
+#define BENCH_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief 1 項目あたりの繰り返し回数 */
+#define BENCH_ITERATIONS     1000
+/** @brief 1 項目あたりの計測回数（最も速かった回の時間を採る） */
+#define BENCH_ROUNDS         5
+/** @brief 時間の許容悪化率[%]（共有のホストで計るときはビルド時に広げる） */
+#ifndef BENCH_TOLERANCE_PCT
+#define BENCH_TOLERANCE_PCT  20
+#endif
+/** @brief 項目数の上限 */
+#define BENCH_CASE_MAX       16
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief 計測結果 */
+typedef struct st_bench_result
+{
+  /** @brief 1 回あたりの時間[ns] */
+  uint32_t ns_per_op;
+  /** @brief 1 回あたりの確保バイト数 */
+  uint32_t bytes_per_op;
+  /** @brief 1 回あたりの確保回数（x100） */
+  uint32_t allocs_per_op_x100;
+} bench_result_t;
+
+/**************************************************************************************************
+ * GLOBAL FUNCTIONS
+ */
+/**
+ * @brief ベンチマーク実行関数
+ * @param[out] out :結果の出力先
+ * @param[in] baseline :基準値（項目順。NULL：比較しない。ns_per_op が 0 の項目は比較しない）
+ * @param[out] results :計測結果（項目順。NULL：保存しない）
+ * @return 基準値から悪化した項目数
+ */
+uint8_t bench_run(Print &out, const bench_result_t baseline[], bench_result_t results[]);
+/**
+ * @brief 計測項目数の取得関数
+ * @return 計測項目数（BENCH_CASE_MAX 以下）
+ */
+uint8_t bench_case_count(void);
+/**
+ * @brief 計測項目名の取得関数（基準値ファイルとの対応付け）
+ * @param[in] index :項目番号
+ * @return 項目名（範囲外は NULL）
+ */
+const char *bench_case_name(uint8_t index);
+
+#endif
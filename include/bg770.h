@@ -15,6 +15,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include "setup_define.h"
+#include "plmn.h"
 
 /**************************************************************************************************
  * TYPEDEFS
@@ -36,6 +37,10 @@ typedef enum e_api_status
   API_STATUS_COPS_ERROR,
   /** @brief サブスクライブ中 */
   API_STATUS_SUBSCRIBE,
+  /** @brief 引数エラー */
+  API_STATUS_INVALID_PARAMS,
+  /** @brief 送信待ちが一杯 */
+  API_STATUS_QUEUE_FULL,
 } api_status_t;
 
 /** @brief BG770状態の型 */
@@ -55,13 +60,31 @@ typedef enum e_bg770_states
   BG770_STATE_OPERATION_WAIT,
 } bg770_states_t;
 
+/** @brief 通信統計の型 */
+typedef struct st_bg770_stats
+{
+  /** @brief 実行したコマンド数 */
+  uint32_t commands;
+  /** @brief 照合した受信行数 */
+  uint32_t lines;
+  /** @brief 受信行の照合にかかった累計時間[us] */
+  uint32_t line_us;
+  /** @brief リセット回数 */
+  uint32_t resets;
+  /** @brief 直近の初期化シーケンス開始からサブスクライブ完了までの時間[ms] */
+  uint32_t subscribe_ms;
+} bg770_stats_t;
+
+/** @brief 応答文法の型（at_response.h） */
+struct st_at_response_grammar;
+
 /** @brief コマンド実行構造体の型 */
 typedef struct st_command_executor
 {
   /** @brief コマンド文字列作成関数 */
   const char *(*create_command_func)(void);
-  /** @brief コマンド返答関数 */
-  api_status_t (*validate_response_func)(const char *, uint16_t);
+  /** @brief コマンド応答文法 */
+  const struct st_at_response_grammar *response;
   /** @brief タイムアウト */
   uint32_t timeout;
   /** @brief コマンド間のディレイ */
@@ -89,8 +112,8 @@ api_status_t init_command_sequence_task(void);
  */
 api_status_t execute(const command_executor_t *p_executor);
 /**
- * @brief 受信データ取得関数
- * @return 受信データ文字列
+ * @brief 受信データ取得関数（待たない。<CR> が届いていない行は持ち越す。プロンプト「> 」は <CR> 無しで返す）
+ * @return 受信データ文字列（行がそろっていない場合は ""）
  */
 String bg770_RxDataGet();
 /**
@@ -107,11 +130,33 @@ void split(String data, char delimiter, String *dst, uint8_t dst_index);
  * @return：サブスクライブペイロード文字列
  */
 String RxData_Analize(String RxData);
+/**
+ * @brief パブリッシュペイロードの作成関数
+ * @param[in/out] buf:作成したペイロードを入力するバッファ
+ * @param[in] jsonString:ペイロード（JSON）
+ * @return 作成したペイロード長
+ */
+uint16_t publish_payload_build(char buf[], String jsonString);
 /**
  * @brief BG770のリセット関数
  * @return：API_STATUS_IN_PROGRESS（初期化コマンドシーケンスに戻す）
  */
 api_status_t bg770_reset(void);
+/**
+ * @brief BG770の再接続関数（接続先の設定変更の反映。PDP を切断し AT+CGDCONT から接続し直す）
+ * @return：API_STATUS_SUCCESS（初期化コマンドシーケンスに戻す） / 失敗した AT+QIDEACT の結果（bg770_reset で戻す）
+ */
+api_status_t bg770_reconnect(void);
+/**
+ * @brief サブスクライブし直し関数（初期化シーケンスの AT+QMTSUB を全て送る。接続中に呼ぶ）
+ * @return：API_STATUS_SUCCESS / 失敗した AT+QMTSUB の結果
+ */
+api_status_t bg770_resubscribe(void);
+/**
+ * @brief MQTT 設定関数（選択中の client idx に AT+QMTCFG でプロファイルを設定する。AT+QMTOPEN の前に呼ぶ）
+ * @return：API_STATUS_SUCCESS / 失敗した AT+QMTCFG の結果
+ */
+api_status_t bg770_mqtt_configure(void);
 /**
  * @brief ペイロード送信
  * @param payload:送信するペイロード
@@ -119,6 +164,109 @@ api_status_t bg770_reset(void);
  * @return API_STATUS_SUCCESSのみ
  */
 api_status_t bg770_send_payload(const uint8_t payload[], uint16_t length);
+/**
+ * @brief データ送信（AT+QISEND 用、終端無し）
+ * @param payload:送信するデータ
+ * @param length：送信データ長
+ * @return API_STATUS_SUCCESSのみ
+ */
+api_status_t bg770_send_data(const uint8_t payload[], uint16_t length);
+/**
+ * @brief コマンド実行外で届いた URC の処理関数（loop から定期的に呼び出す）
+ */
+void bg770_poll(void);
+/**
+ * @brief UDP ソケット(connect id 0)のオープン確認関数
+ * @return true：オープン中
+ */
+bool bg770_udp_is_open(void);
+/**
+ * @brief UDP 受信データ取得関数（+QIURC: "recv" 通知があれば AT+QIRD で読み出す）
+ * @param[out] buf :受信データ格納先（NULL 終端）
+ * @param[in] size :格納先サイズ
+ * @return 受信データ長（受信データ無しは 0）
+ */
+uint16_t bg770_udp_receive(char *buf, uint16_t size);
+/**
+ * @brief HTTP 範囲要求関数（AT+QHTTPURL・AT+QHTTPGET。本文は bg770_http_read で読み出す）
+ * @param[in] url :http://<host>[:<port>]/<path>（https は未対応。文字列は読み出し完了まで保持すること）
+ * @param[in] start :開始位置
+ * @param[in] length :長さ（Range: bytes=<start>-<start+length-1>）
+ * @param[out] status :HTTP 応答コード
+ * @param[out] content_length :本文長
+ * @return API_STATUS_SUCCESS / API_STATUS_FAIL
+ */
+api_status_t bg770_http_get(const char *url, uint32_t start, uint32_t length, uint16_t *status,
+                            uint32_t *content_length);
+/**
+ * @brief HTTP 本文読み出し関数（AT+QHTTPREAD）
+ * @param[in] reader :本文の読み出し関数（ストリームから本文長を読み、false で失敗）
+ * @return API_STATUS_SUCCESS / API_STATUS_FAIL
+ */
+api_status_t bg770_http_read(bool (*reader)(Stream *stream, uint32_t length));
+/**
+ * @brief ファイル作成関数（AT+QFOPEN。UFS に作り、有れば空にする）
+ * @param[in] name :ファイル名（文字列は bg770_file_close まで保持すること）
+ * @return API_STATUS_SUCCESS / API_STATUS_FAIL
+ */
+api_status_t bg770_file_open(const char *name);
+/**
+ * @brief ファイル書き込み関数（AT+QFWRITE。bg770_file_open で開いたファイルの末尾に追記）
+ * @param[in] data :データ
+ * @param[in] length :データ長
+ * @return API_STATUS_SUCCESS / API_STATUS_FAIL（書き込み長の不一致を含む）
+ */
+api_status_t bg770_file_write(const uint8_t *data, uint16_t length);
+/**
+ * @brief ファイルクローズ関数（AT+QFCLOSE）
+ * @return API_STATUS_SUCCESS / API_STATUS_FAIL
+ */
+api_status_t bg770_file_close(void);
+/**
+ * @brief ファイル削除関数（AT+QFDEL）
+ * @param[in] name :ファイル名
+ * @return API_STATUS_SUCCESS / API_STATUS_FAIL（ファイル無しを含む）
+ */
+api_status_t bg770_file_delete(const char *name);
+/**
+ * @brief HTTP POST 開始関数（AT+QHTTPURL・AT+QHTTPPOSTFILE）
+ *
+ * UFS のファイル（リクエストヘッダ + 本文）をモデムが送る。OK が返った後は他のコマンドを実行でき、
+ * 結果は +QHTTPPOSTFILE: <err>[,<httprspcode>[,<content_length>]] の URC で届く
+ * （at_set_urc_handler(AT_TOKEN_QHTTPPOSTFILE, ..) で受ける）。
+ * @param[in] url :http://<host>[:<port>]/<path>（https は未対応。文字列は URC まで保持すること）
+ * @param[in] name :ファイル名
+ * @return API_STATUS_SUCCESS / API_STATUS_FAIL
+ */
+api_status_t bg770_http_post_file(const char *url, const char *name);
+/**
+ * @brief BG770 との通信ストリーム差し替え関数（記録・再生用）
+ * @param[in] stream :通信ストリーム（NULL で Serial1 に戻す）
+ */
+void bg770_set_stream(Stream *stream);
+/**
+ * @brief BG770 との通信ストリーム取得関数
+ * @return 通信ストリーム
+ */
+Stream *bg770_get_stream(void);
+/**
+ * @brief 通信統計取得関数
+ * @param[out] stats :通信統計
+ */
+void bg770_get_stats(bg770_stats_t *stats);
+/**
+ * @brief MQTT コマンドの client idx・msgID 選択関数
+ *
+ * create_command_qmtopen/qmtconn/qmtpub が使う。BG770 リセットで 0,1 に戻る。
+ * @param[in] client :client idx（0〜5）
+ * @param[in] msgid :AT+QMTPUB の msgID（1〜65535）
+ */
+void bg770_set_mqtt_client(uint8_t client, uint16_t msgid);
+/**
+ * @brief AT+QMTPUB のトピック選択関数
+ * @param[in] topic :トピック（NULL：設定の pub_topic に戻す。文字列は送信完了まで保持すること）
+ */
+void bg770_set_publish_topic(const char *topic);
 /**
  * @brief IMSI 取得関数
  */
@@ -129,6 +277,11 @@ void bg770_get_imsi(char imsi[16]);
  * @return RSSI
  */
 int16_t bg770_get_rssi(void);
+/**
+ * @brief 現在時刻取得関数（ntp_command で取得した時刻に経過時間を足す）
+ * @return UTC 時刻[s]（1970-01-01 から。未取得は 0）
+ */
+uint32_t bg770_get_time(void);
 /**
  * @brief コマンド文字列作成関数
  * @return コマンド文字列
@@ -143,6 +296,8 @@ const char *create_command_cimi(void);
 const char *create_command_cgdcont(void);
 /** @brief 基地局確認コマンド **/
 const char *create_command_cops(void);
+/** @brief ネットワーク検索コマンド **/
+const char *create_command_cops_scan(void);
 /** @brief RSSI取得コマンド **/
 const char *create_command_csq(void);
 /** @brief APN/Username/Password設定コマンド **/
@@ -159,6 +314,12 @@ const char *create_command_qpowd(void);
 const char *create_command_qmtopen(void);
 /** @brief BG770 サブスクライブコマンド **/
 const char *create_command_qmtsub(void);
+/** @brief BG770 デバイスシャドウ差分サブスクライブコマンド **/
+const char *create_command_qmtsub_shadow(void);
+/** @brief BG770 設定更新サブスクライブコマンド **/
+const char *create_command_qmtsub_config(void);
+/** @brief BG770 MQTT 設定コマンド（項目は bg770_mqtt_configure が選ぶ） **/
+const char *create_command_qmtcfg(void);
 /** @brief BG770 MQTTサーバー接続コマンド **/
 const char *create_command_qmtconn(void);
 /** @brief BG770 サブスクライブ中止コマンド **/
@@ -167,69 +328,138 @@ const char *create_command_qmtuns(void);
 const char *create_command_qmtpub(void);
 /** @brief BG770 NTPサーバー接続コマンド **/
 const char *create_command_qntp(void);
+/** @brief UDP 送信コマンド（connect id 0） **/
+const char *create_command_qisend(void);
+/** @brief UDP 受信データ読み出しコマンド（connect id 0） **/
+const char *create_command_qird(void);
+/** @brief HTTP 設定コマンド（PDP context 1・リクエストヘッダ指定） **/
+const char *create_command_qhttpcfg(void);
+/** @brief HTTP URL 設定コマンド **/
+const char *create_command_qhttpurl(void);
+/** @brief HTTP GET コマンド **/
+const char *create_command_qhttpget(void);
+/** @brief HTTP 本文読み出しコマンド **/
+const char *create_command_qhttpread(void);
+/** @brief ファイルオープンコマンド **/
+const char *create_command_qfopen(void);
+/** @brief ファイル書き込みコマンド **/
+const char *create_command_qfwrite(void);
+/** @brief ファイルクローズコマンド **/
+const char *create_command_qfclose(void);
+/** @brief ファイル削除コマンド **/
+const char *create_command_qfdel(void);
+/** @brief HTTP POST（ファイル）コマンド **/
+const char *create_command_qhttppostfile(void);
 
 /**
- * @brief コマンド返答確認関数
- * @param[in] content：BG770からの返答文字列
- * @param[in] times:BG770返答回数
- * @return API_STATUS_FAIL：コマンド実行失敗
- *         API_STATUS_SUCCESS：コマンド実行成功
- *         API_STATUS_PROGRESS：コマンド継続中
- */
-/* 標準返答確認（「0」が返ってくるだけ） */
-api_status_t validate_response_ok(const char *content, uint16_t times);
-/** @brief BG770の準備完了確認 */
-api_status_t validate_response_ready(const char *content, uint16_t times);
-/** @brief BG770初期設定完了確認 */
-api_status_t validate_response_bg770_setup(const char *content, uint16_t times);
-/** @brief SIM確認完了確認 */
-api_status_t validate_response_cpin(const char *content, uint16_t times);
-/** @brief IMSI取得完了確認 */
-api_status_t validate_response_cimi(const char *content, uint16_t times);
-/** @brief RSSI取得確認 */
-api_status_t validate_response_csq(const char *content, uint16_t times);
-/** @brief ソケットオープン完了確認 */
-api_status_t validate_response_qiopen(const char *content, uint16_t times);
-/** @brief パワーダウン完了確認 */
-api_status_t validate_response_qpowd(const char *content, uint16_t times);
-/** @brief 基地局接続完了確認 */
-api_status_t validate_response_cops(const char *content, uint16_t times);
-/** @brief MQTTサーバーオープン完了確認 */
-api_status_t validate_response_qmtopen(const char *content, uint16_t times);
-/** @brief MQTTサーバー接続確認 */
-api_status_t validate_response_qmtconn(const char *content, uint16_t times);
-/** @brief サブスクライブ完了確認 */
-api_status_t validate_response_qmtsub(const char *content, uint16_t times);
-/** @brief サブスクライブ中止完了確認 */
-api_status_t validate_response_qmtuns(const char *content, uint16_t times);
-/** @brief パブリッシュ完了確認 */
-api_status_t validate_response_qmtpub(const char *content, uint16_t times);
-/** @brief NTPサーバー接続完了確認 */
-api_status_t validate_response_qntp(const char *content, uint16_t times);
+ * @brief コマンド応答文法（at_response.h）
+ *
+ * 期待行・最終結果・エラー・キャプチャを宣言的に記述する
+ */
+/** @brief 標準応答（「0」が返ってくるだけ） */
+extern const struct st_at_response_grammar response_ok;
+/** @brief BG770の準備完了 */
+extern const struct st_at_response_grammar response_ready;
+/** @brief BG770初期設定完了（エコーは無視） */
+extern const struct st_at_response_grammar response_bg770_setup;
+/** @brief SIM確認完了 */
+extern const struct st_at_response_grammar response_cpin;
+/** @brief IMSI取得完了 */
+extern const struct st_at_response_grammar response_cimi;
+/** @brief RSSI取得 */
+extern const struct st_at_response_grammar response_csq;
+/** @brief ソケットオープン完了 */
+extern const struct st_at_response_grammar response_qiopen;
+/** @brief パワーダウン完了 */
+extern const struct st_at_response_grammar response_qpowd;
+/** @brief 基地局接続完了 */
+extern const struct st_at_response_grammar response_cops;
+/** @brief ネットワーク検索完了（検索結果を plmn_scan_add へ） */
+extern const struct st_at_response_grammar response_cops_scan;
+/** @brief MQTTサーバーオープン完了 */
+extern const struct st_at_response_grammar response_qmtopen;
+/** @brief MQTTサーバー接続 */
+extern const struct st_at_response_grammar response_qmtconn;
+/** @brief サブスクライブ完了 */
+extern const struct st_at_response_grammar response_qmtsub;
+/** @brief デバイスシャドウ差分サブスクライブ完了 */
+extern const struct st_at_response_grammar response_qmtsub_shadow;
+/** @brief 設定更新サブスクライブ完了 */
+extern const struct st_at_response_grammar response_qmtsub_config;
+/** @brief サブスクライブ中止完了 */
+extern const struct st_at_response_grammar response_qmtuns;
+/** @brief パブリッシュ完了 */
+extern const struct st_at_response_grammar response_qmtpub;
+/** @brief パブリッシュ送信完了（PUBACK は URC で受ける） */
+extern const struct st_at_response_grammar response_qmtpub_async;
+/** @brief NTPサーバー接続完了 */
+extern const struct st_at_response_grammar response_qntp;
+/** @brief UDP 送信完了 */
+extern const struct st_at_response_grammar response_qisend;
+/** @brief UDP 受信データ読み出し */
+extern const struct st_at_response_grammar response_qird;
+/** @brief HTTP URL 設定完了 */
+extern const struct st_at_response_grammar response_qhttpurl;
+/** @brief HTTP GET 完了 */
+extern const struct st_at_response_grammar response_qhttpget;
+/** @brief HTTP 本文読み出し完了 */
+extern const struct st_at_response_grammar response_qhttpread;
+/** @brief ファイルオープン完了 */
+extern const struct st_at_response_grammar response_qfopen;
+/** @brief ファイル書き込み完了 */
+extern const struct st_at_response_grammar response_qfwrite;
 
 /**************************************************************************************************
  * GLOBAL VARIABLES
  */
 /** @brief サブスクライブ中止実行コマンド */
-const command_executor_t unsubscribe_command = {create_command_qmtuns, validate_response_qmtuns,  180000, 0};
+const command_executor_t unsubscribe_command = {create_command_qmtuns, &response_qmtuns,  180000, 0};
 /** @brief パワーオフ実行コマンド */
-const command_executor_t poweroff_command =    {create_command_qpowd,  validate_response_qpowd,   180000, 0};
+const command_executor_t poweroff_command =    {create_command_qpowd,  &response_qpowd,   180000, 0};
 /** @brief パブリッシュ実行コマンド */
-const command_executor_t publish_command =     {create_command_qmtpub, validate_response_qmtpub,  180000, 0};
+const command_executor_t publish_command =     {create_command_qmtpub, &response_qmtpub,  180000, 0};
+/** @brief パブリッシュ実行コマンド（PUBACK を待たない） */
+const command_executor_t publish_async_command = {create_command_qmtpub, &response_qmtpub_async,  10000, 0};
 /** @brief サブスクライブ実行コマンド */
-const command_executor_t subscribe_command =   {create_command_qmtsub, validate_response_qmtsub,  180000, 0};
+const command_executor_t subscribe_command =   {create_command_qmtsub, &response_qmtsub,  180000, 0};
 /** @brief NTPサーバー接続実行コマンド */
-const command_executor_t ntp_command =     {create_command_qntp, validate_response_qntp,  180000, 0};
+const command_executor_t ntp_command =     {create_command_qntp, &response_qntp,  180000, 0};
+/** @brief MQTT 設定実行コマンド */
+const command_executor_t qmtcfg_command = {create_command_qmtcfg, &response_ok,  300, 0};
 /** @brief MQTTサーバーオープン実行コマンド */
-const command_executor_t qmtopen_command = {create_command_qmtopen, validate_response_qmtopen,  180000, 0};
+const command_executor_t qmtopen_command = {create_command_qmtopen, &response_qmtopen,  180000, 0};
 /** @brief PDPアクティブ実行コマンド */
-const command_executor_t qiact_command =   {create_command_qiact, validate_response_ok,  150000, 0};
+const command_executor_t qiact_command =   {create_command_qiact, &response_ok,  150000, 0};
+/** @brief ネットワーク検索実行コマンド（AT+COPS=?。PLMN_SCAN_TIMEOUT_MS で打ち切る） */
+const command_executor_t cops_scan_command = {create_command_cops_scan, &response_cops_scan,  PLMN_SCAN_TIMEOUT_MS, 0};
 /** @brief PDPデアクティブ実行コマンド */
-const command_executor_t qideact_command = {create_command_qideact, validate_response_ok,  40000, 0};
+const command_executor_t qideact_command = {create_command_qideact, &response_ok,  40000, 0};
 /** @brief MQTT接続実行コマンド */
-const command_executor_t qmtconn_command = {create_command_qmtconn, validate_response_qmtconn,  180000, 0};
+const command_executor_t qmtconn_command = {create_command_qmtconn, &response_qmtconn,  180000, 0};
 /** @brief サブスクライブ実行コマンド */
-const command_executor_t qmtsub_command = {create_command_qmtsub, validate_response_qmtsub,  180000, 0};
+const command_executor_t qmtsub_command = {create_command_qmtsub, &response_qmtsub,  180000, 0};
+/** @brief UDP 送信実行コマンド */
+const command_executor_t udp_send_command = {create_command_qisend, &response_qisend,  10000, 0};
+/** @brief UDP 受信データ読み出し実行コマンド */
+const command_executor_t udp_read_command = {create_command_qird, &response_qird,  1000, 0};
+/** @brief HTTP 設定実行コマンド */
+const command_executor_t http_config_command = {create_command_qhttpcfg, &response_ok,  300, 0};
+/** @brief HTTP URL 設定実行コマンド */
+const command_executor_t http_url_command = {create_command_qhttpurl, &response_qhttpurl,  90000, 0};
+/** @brief HTTP GET 実行コマンド */
+const command_executor_t http_get_command = {create_command_qhttpget, &response_qhttpget,  90000, 0};
+/** @brief HTTP 本文読み出し実行コマンド */
+const command_executor_t http_read_command = {create_command_qhttpread, &response_qhttpread,  90000, 0};
+/** @brief ファイルオープン実行コマンド */
+const command_executor_t file_open_command = {create_command_qfopen, &response_qfopen,  3000, 0};
+/** @brief ファイル書き込み実行コマンド */
+const command_executor_t file_write_command = {create_command_qfwrite, &response_qfwrite,  10000, 0};
+/** @brief ファイルクローズ実行コマンド */
+const command_executor_t file_close_command = {create_command_qfclose, &response_ok,  3000, 0};
+/** @brief ファイル削除実行コマンド */
+const command_executor_t file_delete_command = {create_command_qfdel, &response_ok,  3000, 0};
+/** @brief HTTP POST（ファイル）開始実行コマンド（結果は URC） */
+const command_executor_t http_post_file_command = {create_command_qhttppostfile, &response_ok,  5000, 0};
 /** @brief RSSI */
 extern int16_t rssi;
 /** @brief IMSI */
@@ -0,0 +1,112 @@
+/**
+ * @file can_bus.h
+ * @version 0.1
+ * @brief CAN(TWAI) 受信・間引き・送信バッチ API
+ *
+ * 信号表からハードウェアの受信フィルタを設定し、受信フレームを信号毎にデコード、
+ * 間引き（最小周期）と変化検出（不感帯）で絞り込んだ値だけを LTE 送信側へ渡す。
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef CAN_BUS_H
+#define CAN_BUS_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <stdbool.h>
+#include <stdint.h>
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief CAN ビットレート[kbps]（250 or 500） */
+#define CAN_BITRATE_KBPS   500
+/** @brief パブリッシュ周期[ms]（LTE は毎秒数回が上限） */
+#define CAN_PUBLISH_MS     1000
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief 信号定義の型 */
+typedef struct st_can_signal
+{
+  /** @brief 信号名（ペイロードのキー） */
+  const char *name;
+  /** @brief CAN ID */
+  uint32_t id;
+  /** @brief 拡張フレーム(29bit) */
+  bool extended;
+  /** @brief 開始ビット（インテル形式） */
+  uint8_t start_bit;
+  /** @brief ビット長 */
+  uint8_t length;
+  /** @brief 符号付き */
+  bool is_signed;
+  /** @brief 最小送信周期[ms]（間引き） */
+  uint16_t min_interval_ms;
+  /** @brief 不感帯（前回送信値との差がこれ以下なら送らない。0 は変化時のみ） */
+  uint32_t deadband;
+} can_signal_t;
+
+/** @brief 受信統計 */
+typedef struct st_can_stats
+{
+  /** @brief 受信フレーム数 */
+  uint32_t frames;
+  /** @brief 信号表に無い ID（ハードウェアフィルタを抜けたもの） */
+  uint32_t unmatched;
+  /** @brief 間引き・不感帯で捨てた値 */
+  uint32_t suppressed;
+  /** @brief 送信側へ渡した値 */
+  uint32_t events;
+  /** @brief キュー満杯で捨てた値 */
+  uint32_t queue_drops;
+  /** @brief ドライバの受信取りこぼし */
+  uint32_t rx_missed;
+  /** @brief バスエラー */
+  uint32_t bus_errors;
+} can_stats_t;
+
+/**************************************************************************************************
+ * GLOBAL FUNCTIONS
+ */
+/**
+ * @brief CAN 初期化関数（TWAI ドライバと受信タスクを起動）
+ */
+void can_init(void);
+/**
+ * @brief 受信フレーム処理関数（受信タスク、ホスト側 candump 再生から呼び出し）
+ * @param[in] id :CAN ID
+ * @param[in] extended :拡張フレーム
+ * @param[in] data :データ
+ * @param[in] dlc :データ長
+ * @param[in] now :受信時刻[ms]
+ */
+void can_process_frame(uint32_t id, bool extended, const uint8_t *data, uint8_t dlc, uint32_t now);
+/**
+ * @brief candump 形式 1 行の解析関数（「(時刻) can0 123#DEADBEEF」）
+ * @param[in] line :candump の 1 行
+ * @param[out] id :CAN ID
+ * @param[out] extended :拡張フレーム
+ * @param[out] data :データ（8 バイト以上）
+ * @param[out] dlc :データ長
+ * @param[out] time_us :時刻[us]（時刻が無い場合 0）
+ * @return true：解析成功
+ */
+bool can_parse_candump(const char *line, uint32_t *id, bool *extended, uint8_t *data, uint8_t *dlc, uint64_t *time_us);
+/**
+ * @brief パブリッシュペイロード作成関数（送信待ちの最新値をまとめる）
+ * @param[out] buf :ペイロード格納先
+ * @param[in] size :格納先サイズ
+ * @return ペイロード長（送信する値が無い場合は 0）
+ */
+uint16_t can_build_payload(char *buf, uint16_t size);
+/**
+ * @brief 受信統計取得関数
+ * @param[out] stats :受信統計
+ */
+void can_get_stats(can_stats_t *stats);
+
+#endif
@@ -0,0 +1,211 @@
+/**
+ * @file config.h
+ * @version 0.1
+ * @brief 実行時設定（NVS 保存・MQTT/HTTP からの更新）API
+ *
+ * setup_define.h 等の定数を既定値とし、CONFIG_TOPIC または POST /api/config で受けた JSON で上書きする。
+ *   {"version":<n>,"<key>":<値>,...}
+ * version は現在より大きい必要があり（古い・重複した更新は無視）、キーは下記の表のものだけ受け付ける。
+ * 1 つでも不正なキー・値があれば何も変えない。受け付けた設定は 1 つの blob として NVS に書く
+ * （NVS の書き込みは blob 単位で置き換わるので、電源断でも新旧どちらかが残る）。
+ *   ・タイムアウト・送信周期 ：次に使う時から反映
+ *   ・APN・ブローカー・トピック：送信待ちが空になってから（最大 CONFIG_RECONNECT_WAIT_MS 待って）
+ *                              PDP を切断して再接続し、その時に反映
+ *
+ * | キー                  | 既定値                 | 範囲            |
+ * |:----------------------|:-----------------------|:----------------|
+ * | apn / apn_user / apn_pass | soracom.io / sora / sora | 31/15/15 文字 |
+ * | broker / port         | beam.soracom.io / 1883 | 63 文字 / 1〜65535 |
+ * | sub_topic / pub_topic | SUBSCRIBE_TOPIC / PUBLISH_TOPIC | 63 文字 |
+ * | timeout_ready〜timeout_mqtt | 0（init_command_sequence の値） | 0〜600000 ms |
+ * | csq_delay_ms          | 0（init_command_sequence の値） | 0〜60000 ms |
+ * | telemetry_deadline_ms | TELEMETRY_DEADLINE_MS  | 1000〜3600000 ms |
+ * | diag_deadline_ms      | DIAG_DEADLINE_MS       | 1000〜3600000 ms |
+ * | can_publish_ms        | CAN_PUBLISH_MS         | 100〜3600000 ms |
+ * | heartbeat_ms          | DIAG_HEARTBEAT_MS      | 1000〜86400000 ms |
+ * | bulk_url              | ""（HTTP 一括送信しない） | 95 文字（http://） |
+ * | bulk_min_bytes        | TSDB_BULK_MIN_BYTES    | 1024〜16777216 byte |
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef CONFIG_H
+#define CONFIG_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include "at_response.h"
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief NVS の名前空間 */
+#define CONFIG_NVS_NAMESPACE     "config"
+/** @brief 保存形式の番号（config_t を変えたら上げ、config_init に前の形式からの移行を足す。不明な形式は既定値に戻す） */
+#define CONFIG_SCHEMA            2
+/** @brief APN の最大長（終端含む） */
+#define CONFIG_APN_SIZE          32
+/** @brief APN のユーザー名・パスワードの最大長（終端含む） */
+#define CONFIG_CREDENTIAL_SIZE   16
+/** @brief ブローカーのホスト名の最大長（終端含む） */
+#define CONFIG_HOST_SIZE         64
+/** @brief トピックの最大長（終端含む） */
+#define CONFIG_TOPIC_SIZE        64
+/** @brief URL の最大長（終端含む） */
+#define CONFIG_URL_SIZE          96
+/** @brief 更新 JSON の解析サイズ */
+#define CONFIG_DOC_SIZE          1024
+/** @brief 接続先変更の反映で送信待ちが空になるのを待つ最大時間[ms] */
+#define CONFIG_RECONNECT_WAIT_MS 30000
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief 初期化シーケンスのタイムアウト */
+typedef enum e_config_timeout
+{
+  /** @brief 起動（RDY） */
+  CONFIG_TIMEOUT_READY = 0,
+  /** @brief 即時応答のコマンド（ATE0・CPIN・CIMI・CGDCONT・QICSGP） */
+  CONFIG_TIMEOUT_AT,
+  /** @brief 基地局接続（COPS） */
+  CONFIG_TIMEOUT_COPS,
+  /** @brief 電波強度（CSQ） */
+  CONFIG_TIMEOUT_CSQ,
+  /** @brief PDP アクティブ（QIACT） */
+  CONFIG_TIMEOUT_QIACT,
+  /** @brief UDP ソケットオープン（QIOPEN） */
+  CONFIG_TIMEOUT_QIOPEN,
+  /** @brief MQTT（QMTOPEN・QMTCONN・QMTSUB） */
+  CONFIG_TIMEOUT_MQTT,
+  /** @brief タイムアウト数 */
+  CONFIG_TIMEOUT_MAX
+} config_timeout_t;
+
+/** @brief 接続先（再接続で反映） */
+typedef struct st_config_link
+{
+  /** @brief APN */
+  char apn[CONFIG_APN_SIZE];
+  /** @brief APN のユーザー名 */
+  char apn_user[CONFIG_CREDENTIAL_SIZE];
+  /** @brief APN のパスワード */
+  char apn_pass[CONFIG_CREDENTIAL_SIZE];
+  /** @brief ブローカーのホスト名 */
+  char broker[CONFIG_HOST_SIZE];
+  /** @brief ブローカーのポート */
+  uint32_t port;
+  /** @brief サブスクライブTOPIC */
+  char sub_topic[CONFIG_TOPIC_SIZE];
+  /** @brief パブリッシュTOPIC */
+  char pub_topic[CONFIG_TOPIC_SIZE];
+} config_link_t;
+
+/** @brief 設定（NVS に保存する blob） */
+typedef struct st_config
+{
+  /** @brief 保存形式の番号 */
+  uint16_t schema;
+  /** @brief 設定のバージョン（0：既定値） */
+  uint32_t version;
+  /** @brief 接続先 */
+  config_link_t link;
+  /** @brief 初期化シーケンスのタイムアウト[ms]（0：init_command_sequence の値） */
+  uint32_t timeout[CONFIG_TIMEOUT_MAX];
+  /** @brief AT+CSQ 前の待ち時間[ms]（0：init_command_sequence の値） */
+  uint32_t csq_delay_ms;
+  /** @brief テレメトリの送信期限[ms] */
+  uint32_t telemetry_deadline_ms;
+  /** @brief ハートビートの送信期限[ms] */
+  uint32_t diag_deadline_ms;
+  /** @brief CAN 信号の送信周期[ms] */
+  uint32_t can_publish_ms;
+  /** @brief ハートビートの周期[ms] */
+  uint32_t heartbeat_ms;
+  /** @brief 範囲要求の HTTP 一括送信先（空：MQTT だけで送る） */
+  char bulk_url[CONFIG_URL_SIZE];
+  /** @brief 範囲要求を HTTP 一括送信にする未送信データ量[byte] */
+  uint32_t bulk_min_bytes;
+} config_t;
+
+/** @brief 更新結果 */
+typedef enum e_config_result
+{
+  /** @brief 反映した */
+  CONFIG_RESULT_OK = 0,
+  /** @brief version が現在以下 */
+  CONFIG_RESULT_STALE,
+  /** @brief JSON・キー・値が不正 */
+  CONFIG_RESULT_INVALID,
+  /** @brief NVS に書けなかった（反映もしない） */
+  CONFIG_RESULT_NVS_ERROR,
+} config_result_t;
+
+/**************************************************************************************************
+ * GLOBAL FUNCTIONS
+ */
+/**
+ * @brief 初期化関数（NVS から読み込む。無い・形式が違う場合は既定値）
+ */
+void config_init(void);
+/**
+ * @brief 設定取得関数（タイムアウト・送信周期はここから毎回読む）
+ * @return 設定
+ */
+const config_t *config_get(void);
+/**
+ * @brief 使用中の接続先取得関数（再接続までは更新前の値）
+ * @return 接続先
+ */
+const config_link_t *config_link(void);
+/**
+ * @brief 接続先の反映関数（BG770 の再接続・リセット時に呼ぶ）
+ */
+void config_link_apply(void);
+/**
+ * @brief 接続先の反映待ち確認関数
+ * @param[in] outbox_empty :送信待ちが空
+ * @return true：再接続して反映する時
+ */
+bool config_link_due(bool outbox_empty);
+/**
+ * @brief 初期化シーケンスのタイムアウト取得関数
+ * @param[in] id :タイムアウト
+ * @param[in] fallback :設定が 0 の時の値
+ * @return タイムアウト[ms]
+ */
+uint32_t config_timeout(config_timeout_t id, uint32_t fallback);
+/**
+ * @brief 更新関数（全キーを検証してから反映し、NVS に保存する）
+ * @param[in] json :{"version":n,"<key>":<値>,...}
+ * @param[out] key :不正だったキー（CONFIG_RESULT_INVALID の時。NULL 可）
+ * @return 更新結果
+ */
+config_result_t config_update(const char *json, const char **key);
+/**
+ * @brief 設定更新（CONFIG_TOPIC）の判定関数
+ * @param[in] line :+QMTRECV の行
+ * @return true：設定更新
+ */
+bool config_is_update(const at_line_t *line);
+/**
+ * @brief 更新結果 JSON の作成関数
+ * @param[out] buf :出力先
+ * @param[in] size :出力先のサイズ
+ * @param[in] result :更新結果
+ * @param[in] key :不正だったキー（NULL 可）
+ * @return 書き込んだ長さ（{"config":{"version":n,"result":"ok"[,"key":"x"]}}）
+ */
+uint16_t config_build_result(char buf[], uint16_t size, config_result_t result, const char *key);
+/**
+ * @brief 設定 JSON の作成関数（パスワードは伏せる）
+ * @param[out] buf :出力先
+ * @param[in] size :出力先のサイズ
+ * @return 書き込んだ長さ
+ */
+uint16_t config_build_json(char buf[], uint16_t size);
+
+#endif
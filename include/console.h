@@ -0,0 +1,91 @@
+/**
+ * @file console.h
+ * @version 0.1
+ * @brief シリアルコンソールのコマンド処理 API
+ *
+ * Serial から届いた分だけを行バッファに溜め、改行で 1 行を実行する（待ちは発生しない）。
+ * 1 行に「;」区切りで複数コマンドを書くとまとめて実行する（貼り付けたスクリプトも行毎に実行）。
+ * 結果は「key=value」形式、または json on で 1 行 1 オブジェクトの JSON で返す。
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef CONSOLE_H
+#define CONSOLE_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "bg770.h"
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief 1 行の最大長 */
+#define CONSOLE_LINE_SIZE   256
+/** @brief 引数の最大数（コマンド名を含む） */
+#define CONSOLE_ARGS_MAX    8
+/** @brief 結果 1 行の最大長 */
+#define CONSOLE_REPLY_SIZE  512
+/** @brief 残りを 1 つの引数として渡す（pub <json> 等） */
+#define CONSOLE_FLAG_RAW    0x01
+/** @brief 操作系の送信期限[ms]（送信待ちに積んでからの時間） */
+#define CONSOLE_DEADLINE_MS 2000
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief コマンド */
+typedef struct st_console_command
+{
+  /** @brief コマンド名 */
+  const char *name;
+  /** @brief 使い方 */
+  const char *help;
+  /** @brief CONSOLE_FLAG_* */
+  uint8_t flags;
+  /**
+   * @brief 処理関数
+   * @param[in] argc :引数の数（コマンド名を含む）
+   * @param[in] argv :引数
+   * @return API_STATUS_SUCCESS：成功 API_STATUS_FAIL：モデムエラー（リセットが必要）
+   *         その他：引数エラー等
+   */
+  api_status_t (*handler)(uint8_t argc, char *argv[]);
+} console_command_t;
+
+/**************************************************************************************************
+ * GLOBAL FUNCTIONS
+ */
+/**
+ * @brief コンソール処理関数（loop から呼ぶ。届いている分だけ読み、完成した行を実行する）
+ */
+void console_task(void);
+/**
+ * @brief 1 行実行関数（「;」区切りの複数コマンド可）
+ * @param[in,out] line :行（区切り位置が書き換えられる）
+ */
+void console_execute(char *line);
+/**
+ * @brief 結果の文字列項目追加関数（処理関数から呼ぶ）
+ * @param[in] key :項目名
+ * @param[in] value :値
+ */
+void console_field(const char *key, const char *value);
+/**
+ * @brief 結果の数値項目追加関数（処理関数から呼ぶ）
+ * @param[in] key :項目名
+ * @param[in] value :値
+ */
+void console_field_int(const char *key, long value);
+/**
+ * @brief 結果の JSON 項目追加関数（処理関数から呼ぶ。値はそのまま出力する）
+ * @param[in] key :項目名
+ * @param[in] json :JSON の値
+ */
+void console_field_json(const char *key, const char *json);
+
+#endif
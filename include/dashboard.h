@@ -0,0 +1,72 @@
+/**
+ * @file dashboard.h
+ * @version 0.1
+ * @brief ダッシュボード（状態 JSON・Server-Sent Events 配信）API
+ *
+ * /api/status と /events で同じ状態 JSON を返す。
+ *   {"state":n,"rssi":n,"lan":"RED","wan":"OFF","sw":"ON",
+ *    "outbox":{"queued":n,"sent":n,"dropped":n},"bulk":{"open":n,"inflight":n},
+ *    "diag":{"uptime":n,"heap":n}}
+ * /events はレスポンスを閉じずに保持し、状態が変わった時だけ "data: <JSON>\n\n" を送る。
+ * ブラウザはポーリングせずに更新を受け取れる。
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef DASHBOARD_H
+#define DASHBOARD_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <WebServer.h>
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief 同時に配信するブラウザ数 */
+#define DASHBOARD_EVENT_CLIENTS  2
+/** @brief 状態を確認する周期[ms] */
+#define DASHBOARD_EVENT_MS       250
+/** @brief 変化が無い時の生存確認周期[ms]（プロキシ・ブラウザの切断防止） */
+#define DASHBOARD_KEEPALIVE_MS   15000
+/** @brief 状態 JSON の最大長 */
+#define DASHBOARD_STATUS_SIZE    256
+/** @brief ダッシュボードのキャッシュ期間[s] */
+#define DASHBOARD_MAX_AGE        86400
+
+/**************************************************************************************************
+ * GLOBAL FUNCTIONS
+ */
+/**
+ * @brief 状態 JSON の作成関数
+ * @param[out] buf :出力先
+ * @param[in] size :出力先のサイズ
+ * @return 書き込んだ長さ
+ */
+uint16_t dashboard_build_status(char buf[], uint16_t size);
+/**
+ * @brief イベント配信先の追加関数（text/event-stream のヘッダと現在の状態を送る）
+ * @param[in] client :接続中のクライアント（WebServer::client()）
+ * @return true：追加 false：配信先が一杯
+ */
+bool dashboard_add_client(WiFiClient client);
+/**
+ * @brief 配信処理関数（loop から呼ぶ。状態が変わった時だけ配信し、切断した配信先を外す）
+ */
+void dashboard_task(void);
+/**
+ * @brief ダッシュボード取得関数（gzip 済み、フラッシュ上のデータ）
+ * @param[out] length :データ長
+ * @return データ
+ */
+const uint8_t *dashboard_page(size_t *length);
+/**
+ * @brief ダッシュボードの ETag 取得関数（gzip 末尾の CRC32）
+ * @return "\"xxxxxxxx\""
+ */
+const char *dashboard_etag(void);
+
+#endif
@@ -0,0 +1,85 @@
+/**
+ * @file dashboard_html.h
+ * @version 0.1
+ * @brief ダッシュボード（web/dashboard.html を gzip したもの）
+ *
+ * web/dashboard.html を変更したら作り直す。
+ *   gzip -9n < web/dashboard.html | xxd -i
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef DASHBOARD_HTML_H
+#define DASHBOARD_HTML_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief gzip 済み HTML（1792 byte → 928 byte） */
+static const uint8_t dashboard_html_gz[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0xff, 0x9d, 0x55, 0xcd, 0x6e, 0xe3, 0x36,
+  0x10, 0xbe, 0xfb, 0x29, 0x54, 0x05, 0x28, 0x2d, 0x58, 0x96, 0xed, 0x2c, 0x50, 0x2c, 0xac, 0x9f,
+  0x62, 0xb3, 0xeb, 0xb4, 0x5d, 0xa4, 0x49, 0xb0, 0x71, 0x11, 0xf4, 0x48, 0x93, 0x63, 0x8b, 0x1b,
+  0x49, 0x54, 0x49, 0xca, 0x4a, 0xa0, 0xf5, 0xa5, 0xb9, 0xf4, 0x19, 0xfa, 0x04, 0x3d, 0xb4, 0xbd,
+  0x17, 0xe8, 0xdb, 0x04, 0x05, 0xfa, 0x18, 0x1d, 0x4a, 0xb2, 0x93, 0x1e, 0xd2, 0x76, 0x7b, 0x30,
+  0xa8, 0xf9, 0xe6, 0x9b, 0x5f, 0x0e, 0xc7, 0xd1, 0x27, 0x6f, 0x2e, 0x5e, 0x2f, 0xbf, 0xbd, 0x5c,
+  0x38, 0xa9, 0xc9, 0xb3, 0x64, 0x10, 0xd9, 0xc3, 0xc9, 0x68, 0xb1, 0x89, 0xdd, 0xf7, 0xd4, 0xb5,
+  0x00, 0x50, 0x8e, 0x47, 0x0e, 0x86, 0x3a, 0x2c, 0xa5, 0x4a, 0x83, 0x89, 0xdd, 0x6f, 0x96, 0xa7,
+  0xe3, 0x97, 0xee, 0x1e, 0x2e, 0x68, 0x0e, 0xb1, 0xbb, 0x15, 0x50, 0x97, 0x52, 0x19, 0xd7, 0x61,
+  0xb2, 0x30, 0x50, 0x20, 0xad, 0x16, 0xdc, 0xa4, 0x31, 0x87, 0xad, 0x60, 0x30, 0x6e, 0x05, 0x5f,
+  0x14, 0xc2, 0x08, 0x9a, 0x8d, 0x35, 0xa3, 0x19, 0xc4, 0x33, 0xeb, 0xc3, 0x08, 0x93, 0x41, 0x72,
+  0x29, 0x98, 0x7c, 0x11, 0x4d, 0x3a, 0x61, 0x10, 0x69, 0x73, 0x67, 0xcf, 0x95, 0xe4, 0x77, 0xcd,
+  0x1a, 0xfd, 0x8d, 0xd7, 0x34, 0x17, 0xd9, 0xdd, 0x5c, 0xd3, 0x42, 0x8f, 0x35, 0x28, 0xb1, 0x0e,
+  0x73, 0xaa, 0x36, 0xa2, 0x98, 0xcf, 0x20, 0xdf, 0x0d, 0x0c, 0x5d, 0x65, 0xd0, 0xac, 0xa4, 0xe2,
+  0xa0, 0xc6, 0x4c, 0x66, 0x19, 0x2d, 0x35, 0xcc, 0xf7, 0x1f, 0xa8, 0xe7, 0x4d, 0x49, 0x39, 0x17,
+  0xc5, 0x66, 0x7e, 0x5c, 0xde, 0x3a, 0x2f, 0xcb, 0xdb, 0xb0, 0x27, 0xaf, 0xa4, 0x31, 0x32, 0x9f,
+  0xcf, 0x10, 0xd5, 0x32, 0x13, 0xdc, 0x39, 0x62, 0x8c, 0xed, 0x06, 0xab, 0x0a, 0xe1, 0xa2, 0xe9,
+  0x63, 0xa0, 0x4d, 0xb8, 0xb7, 0xff, 0x0c, 0x99, 0x33, 0x04, 0x76, 0x83, 0x23, 0x2c, 0xb4, 0x68,
+  0x30, 0x88, 0x54, 0xf3, 0x23, 0x36, 0x9d, 0xee, 0x06, 0xd1, 0xa4, 0xcf, 0x3b, 0x9a, 0xf4, 0x7d,
+  0xb3, 0x05, 0xd8, 0x2e, 0xce, 0xba, 0x02, 0x9d, 0x48, 0xe7, 0x34, 0xcb, 0x1c, 0xc1, 0x63, 0xd7,
+  0x5a, 0xbb, 0x89, 0x5c, 0xaf, 0x33, 0x51, 0x00, 0x5a, 0x5a, 0x45, 0x82, 0x86, 0x33, 0xdb, 0x13,
+  0x5b, 0x4f, 0xcb, 0xd2, 0xc6, 0x45, 0xb0, 0x95, 0xad, 0x9f, 0xe3, 0xe4, 0x6c, 0xf1, 0x06, 0x49,
+  0xc7, 0x28, 0x94, 0xc9, 0xd9, 0xab, 0x73, 0x0c, 0xd1, 0xa6, 0xea, 0xc8, 0x82, 0x65, 0x82, 0xdd,
+  0xc4, 0x6e, 0x06, 0x7c, 0x48, 0xf0, 0x0a, 0x89, 0x4f, 0x14, 0x70, 0xe2, 0xb9, 0xc9, 0x3b, 0x6b,
+  0xd2, 0xd1, 0x92, 0x7f, 0xe4, 0x6f, 0x14, 0x40, 0x61, 0x2d, 0xbe, 0x78, 0xb7, 0x58, 0x9c, 0xff,
+  0x37, 0x1b, 0x2c, 0xc0, 0x5a, 0x5c, 0x9c, 0x9e, 0x1e, 0xf8, 0xd1, 0xa4, 0x6c, 0xd3, 0xbb, 0x7e,
+  0x36, 0xbd, 0xfa, 0x23, 0xd3, 0xab, 0xff, 0x47, 0x7a, 0xf5, 0xbf, 0xa5, 0x17, 0x51, 0x27, 0x55,
+  0xb0, 0x8e, 0xdd, 0x49, 0x2d, 0xd6, 0xc2, 0x4d, 0xae, 0xc5, 0xa9, 0xf8, 0xf3, 0xa7, 0x5f, 0xfe,
+  0xf8, 0xf5, 0xc7, 0x68, 0x42, 0x13, 0xe7, 0x83, 0xf3, 0x48, 0x30, 0x8a, 0x32, 0x70, 0x93, 0x57,
+  0xcb, 0x87, 0xfb, 0x1f, 0x1e, 0xee, 0x7f, 0x7e, 0xb8, 0xff, 0xfd, 0xe1, 0xfb, 0xdf, 0x2c, 0xab,
+  0xf3, 0xa5, 0x99, 0x12, 0xa5, 0x49, 0x06, 0xeb, 0xaa, 0x60, 0x46, 0x60, 0x26, 0x3a, 0x95, 0xf5,
+  0x50, 0x7b, 0xcd, 0xc0, 0x71, 0xb6, 0x54, 0x39, 0x26, 0xe6, 0x92, 0x55, 0x39, 0x3e, 0x8a, 0x60,
+  0x03, 0x66, 0x91, 0x81, 0xfd, 0x3c, 0xb9, 0xfb, 0x0a, 0xb3, 0xd4, 0x86, 0x78, 0x7e, 0x1a, 0x13,
+  0x12, 0x22, 0xf7, 0x60, 0xaf, 0xd0, 0xfc, 0xc6, 0xdf, 0x7a, 0x4d, 0x3a, 0x8a, 0x49, 0x64, 0x54,
+  0x12, 0x19, 0x9e, 0x90, 0xd1, 0xcd, 0x88, 0xe0, 0x2c, 0xf0, 0x5e, 0xda, 0xee, 0x25, 0x4c, 0x2f,
+  0x21, 0xe1, 0x0e, 0x1d, 0x58, 0x3b, 0x92, 0x4b, 0x0e, 0x39, 0xf1, 0x75, 0xa0, 0x0d, 0x35, 0xe0,
+  0x85, 0x2d, 0xa8, 0xb4, 0x16, 0x16, 0xb3, 0xe7, 0x88, 0x38, 0xfc, 0x24, 0x27, 0xbd, 0x06, 0x87,
+  0xc8, 0x2a, 0xf0, 0x36, 0x7b, 0xe0, 0xba, 0x03, 0xea, 0x03, 0x70, 0x75, 0xdd, 0x7a, 0xab, 0xbd,
+  0x70, 0x1f, 0xe2, 0xbb, 0x0a, 0x2a, 0xb0, 0xa0, 0xac, 0xcc, 0x4a, 0xde, 0x06, 0xad, 0xcc, 0xd1,
+  0xef, 0x50, 0x63, 0x65, 0x0e, 0x19, 0x1d, 0x34, 0x56, 0x1e, 0x11, 0xdf, 0xe1, 0x4a, 0x96, 0x25,
+  0xf0, 0xa7, 0xaa, 0x1e, 0x1a, 0x11, 0x8f, 0x3c, 0x7a, 0x5e, 0x55, 0xd9, 0x8d, 0x23, 0x0a, 0x7c,
+  0x14, 0x9b, 0xd4, 0xd8, 0x08, 0x16, 0x08, 0xf6, 0x40, 0x9f, 0x10, 0x3e, 0xae, 0xd2, 0xea, 0xb8,
+  0xa0, 0x9b, 0xc0, 0x0a, 0x18, 0xf9, 0x64, 0x5f, 0x4f, 0x55, 0x1a, 0x91, 0xc3, 0x41, 0xdd, 0x89,
+  0x48, 0xd0, 0x5d, 0x14, 0x83, 0xce, 0x0a, 0x50, 0x5f, 0x2e, 0xbf, 0x3e, 0x8b, 0xd3, 0x70, 0xb0,
+  0x7b, 0xbc, 0x34, 0x3b, 0x35, 0x99, 0xcf, 0xda, 0x5b, 0x5b, 0x83, 0x61, 0xe9, 0x90, 0x4c, 0x68,
+  0x29, 0x26, 0x88, 0x7f, 0x8e, 0xbf, 0x98, 0x8c, 0xb2, 0x11, 0xf9, 0xb4, 0x7d, 0xef, 0xf8, 0xcd,
+  0xfc, 0x06, 0xb7, 0x5f, 0x2a, 0xf9, 0x9c, 0x5c, 0x5e, 0x5c, 0x2d, 0xc9, 0xce, 0x0b, 0x4c, 0x0a,
+  0xc5, 0x70, 0xef, 0x6e, 0xa8, 0xbc, 0x46, 0x81, 0xa9, 0x14, 0xde, 0x66, 0xf0, 0x5e, 0x23, 0xe0,
+  0x85, 0x7b, 0x8e, 0x1d, 0x0f, 0xef, 0x6f, 0xb1, 0xed, 0x32, 0x00, 0x66, 0x86, 0x87, 0x91, 0x01,
+  0x1d, 0x17, 0x50, 0x3b, 0x8b, 0x2d, 0xf6, 0xef, 0x4a, 0x56, 0x8a, 0x01, 0x66, 0x03, 0x56, 0xc2,
+  0x3a, 0x7c, 0xf6, 0xfc, 0x40, 0x59, 0x4f, 0x5d, 0xa5, 0x80, 0x9d, 0x2e, 0x64, 0x09, 0x45, 0x7c,
+  0xc8, 0xc9, 0x6b, 0x58, 0x60, 0xe0, 0xd6, 0xbc, 0xee, 0x57, 0x34, 0x8e, 0xdd, 0xee, 0x40, 0xcd,
+  0x41, 0x6b, 0xba, 0x81, 0x47, 0x36, 0x78, 0x4d, 0x3b, 0xc8, 0x6f, 0xaf, 0x2e, 0xce, 0x83, 0xd2,
+  0xee, 0xfe, 0x21, 0x04, 0x9c, 0x1a, 0xea, 0x79, 0x4f, 0xcc, 0x40, 0x29, 0x6c, 0xc8, 0xf3, 0x21,
+  0xfa, 0x0d, 0x47, 0x42, 0x64, 0xb3, 0x4c, 0xa2, 0x13, 0x2f, 0xc4, 0x7f, 0x91, 0x25, 0xde, 0x0a,
+  0x0e, 0xc2, 0xb0, 0xaf, 0xdc, 0x7f, 0x31, 0x9d, 0x4e, 0x5b, 0xb7, 0xd8, 0x95, 0x27, 0xcd, 0xb7,
+  0x33, 0x5c, 0x61, 0xc9, 0x1f, 0xdd, 0xdc, 0x43, 0x47, 0x43, 0xbb, 0x96, 0xfb, 0x07, 0x8a, 0x3b,
+  0xa0, 0x5b, 0xc8, 0x93, 0xee, 0xff, 0xee, 0x2f, 0xc6, 0xdc, 0xbd, 0xb2, 0x00, 0x07, 0x00, 0x00,
+};
+
+#endif
@@ -0,0 +1,86 @@
+/**
+ * @file diag.h
+ * @version 0.1
+ * @brief メモリ・スタック診断 API
+ *
+ * 空きヒープ・最大連続空き領域・断片化率・最小空きヒープ・タスク毎のスタック余裕を集計し、
+ * 定期ハートビートとして PUBLISH_TOPIC へ送信する。Web サーバーからも参照できる。
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef DIAG_H
+#define DIAG_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief ハートビート周期[ms] */
+#define DIAG_HEARTBEAT_MS   60000
+/** @brief 監視するタスク数の上限 */
+#define DIAG_TASK_MAX       8
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief 診断値 */
+typedef struct st_diag_snapshot
+{
+  /** @brief 起動からの経過時間[s] */
+  uint32_t uptime;
+  /** @brief 空きヒープ[byte] */
+  uint32_t free_heap;
+  /** @brief 最大連続空き領域[byte] */
+  uint32_t largest_block;
+  /** @brief 起動以降の最小空きヒープ[byte] */
+  uint32_t min_free_heap;
+  /** @brief 断片化率[%]（100 - 最大連続空き領域 / 空きヒープ） */
+  uint8_t fragmentation;
+  /** @brief 監視タスク数 */
+  uint8_t task_count;
+  /** @brief タスク名 */
+  const char *task_name[DIAG_TASK_MAX];
+  /** @brief スタック余裕（起動以降の最小値）[byte] */
+  uint32_t stack_free[DIAG_TASK_MAX];
+} diag_snapshot_t;
+
+/**************************************************************************************************
+ * GLOBAL FUNCTIONS
+ */
+/**
+ * @brief 診断初期化関数（呼び出したタスクを loop として登録）
+ */
+void diag_init(void);
+/**
+ * @brief 監視タスク登録関数
+ * @param[in] task :タスクハンドル
+ * @param[in] name :表示名
+ */
+void diag_register_task(TaskHandle_t task, const char *name);
+/**
+ * @brief 診断値取得関数
+ * @param[out] snapshot :診断値
+ */
+void diag_get_snapshot(diag_snapshot_t *snapshot);
+/**
+ * @brief 診断値の JSON 作成関数
+ * @param[out] buf :格納先
+ * @param[in] size :格納先サイズ
+ * @return 作成した長さ
+ */
+uint16_t diag_build_json(char *buf, uint16_t size);
+/**
+ * @brief ハートビート送信時刻の確認関数
+ * @return true：DIAG_HEARTBEAT_MS を経過した（次回の周期を開始する）
+ */
+bool diag_heartbeat_due(void);
+
+#endif
@@ -0,0 +1,92 @@
+/**
+ * @file inbox.h
+ * @version 0.1
+ * @brief サブスクライブ受信の重複除去・順序整列 API
+ *
+ * QoS1 のサブスクライブは再接続（永続セッション）でブローカーから再配信されるため、
+ * +QMTRECV をレーンの処理関数へ渡す前に固定長の受信ウィンドウで選別する。
+ *   ・重複   ：(client idx, msgID, TOPIC・ペイロードのハッシュ) を msgID で直接引く表に
+ *              INBOX_DEDUP_MS だけ残し、同じものは捨てる（msgID はブローカーが再利用するので
+ *              内容のハッシュも比べる。QoS0 の msgID 0 は対象外）
+ *   ・順序   ：ペイロードに "seq":<n> が有れば TOPIC 毎に最後に渡した seq と比べる
+ *                n <= 最後      ：古いコマンドとして捨てる
+ *                n == 最後 + 1  ：渡し、続きの番号を保留から渡す
+ *                n >  最後 + 1  ：INBOX_HOLD_MS だけ保留して抜けた番号を待つ（保留できなければ渡す）
+ *              最後の seq は RTC メモリに置き、再起動（電源断以外）後も再配信の古いコマンドを捨てる
+ *   ・seq が無いメッセージ、起動後に初めて seq を受けた TOPIC はそのまま渡す
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef INBOX_H
+#define INBOX_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include "at_response.h"
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief 重複判定の表の大きさ（2 のべき乗。msgID の下位ビットで引く） */
+#define INBOX_DEDUP_SLOTS  32
+/** @brief 重複とみなす時間[ms] */
+#define INBOX_DEDUP_MS     (5UL * 60 * 1000)
+/** @brief seq を管理する TOPIC 数 */
+#define INBOX_TOPIC_MAX    4
+/** @brief 保留できるメッセージ数 */
+#define INBOX_HOLD_SLOTS   4
+/** @brief 保留できる行の長さ（終端含む。超える場合は保留せず渡す） */
+#define INBOX_HOLD_SIZE    640
+/** @brief 抜けた seq を待つ時間[ms] */
+#define INBOX_HOLD_MS      2000
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief 統計 */
+typedef struct st_inbox_stats
+{
+  /** @brief 受信数 */
+  uint32_t received;
+  /** @brief 渡した数 */
+  uint32_t delivered;
+  /** @brief 重複で捨てた数 */
+  uint32_t duplicates;
+  /** @brief 古い seq で捨てた数 */
+  uint32_t stale;
+  /** @brief 保留して順番通りに渡した数 */
+  uint32_t reordered;
+  /** @brief 抜けた seq を待たずに渡した数（保留の期限切れ・保留できない） */
+  uint32_t gaps;
+  /** @brief 保留中の数 */
+  uint8_t held;
+} inbox_stats_t;
+
+/**************************************************************************************************
+ * GLOBAL FUNCTIONS
+ */
+/**
+ * @brief 初期化関数
+ */
+void inbox_init(void);
+/**
+ * @brief 受信関数（+QMTRECV の URC から呼ぶ。新しいメッセージだけ順番に handler へ渡す）
+ * @param[in] line :+QMTRECV の行
+ * @param[in] handler :レーンの処理関数
+ */
+void inbox_receive(const at_line_t *line, void (*handler)(const at_line_t *line));
+/**
+ * @brief 定期処理関数（loop から呼ぶ。期限切れの保留を seq 順に渡す）
+ */
+void inbox_task(void);
+/**
+ * @brief 統計取得関数
+ * @param[out] stats :統計
+ */
+void inbox_get_stats(inbox_stats_t *stats);
+
+#endif
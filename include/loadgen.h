@@ -0,0 +1,82 @@
+/**
+ * @file loadgen.h
+ * @version 0.1
+ * @brief 連続パブリッシュ負荷試験 API
+ *
+ * 指定サイズの合成ペイロードを指定レート（または最大速度）でパブリッシュし、
+ * 達成レート・転送量・パブリッシュから PUBACK(+QMTPUB) までの遅延の p50/p95/p99・
+ * 失敗数・BG770 リセット数を集計する。
+ * 遅延が PUBACK までになるのは MQTT(QoS1) で送る種別のみで、UDP の種別は AT+QISEND の完了
+ * （UDP_ACK は確認応答）までの時間になる。既定は MQTT の LOADGEN_CLASS。
+ * コンソール・HTTP(/loadgen)・MQTT({"command":"loadgen",...}) から起動する。
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef LOADGEN_H
+#define LOADGEN_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include "uplink.h"
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief 遅延の保存数（超えた分は置き換えサンプリング） */
+#define LOADGEN_SAMPLES     512
+/** @brief 合成ペイロードの最小長（{"lg":<seq>,"t":<ms>,"p":""}） */
+#define LOADGEN_MIN_SIZE    40
+/** @brief 既定のメッセージ種別（MQTT(QoS1) で送り、+QMTPUB までを測る） */
+#define LOADGEN_CLASS       UPLINK_CLASS_CONTROL
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief 負荷試験の設定 */
+typedef struct st_loadgen_config
+{
+  /** @brief 送信数（0：loadgen_stop まで継続） */
+  uint32_t count;
+  /** @brief ペイロード長[byte]（LOADGEN_MIN_SIZE〜PUBLISH_SIZE） */
+  uint16_t size;
+  /** @brief 目標レート[msg/min]（0：最大速度） */
+  uint16_t rate;
+  /** @brief 送信経路を決めるメッセージ種別（UPLINK_CLASS_SHADOW・範囲外は LOADGEN_CLASS） */
+  uplink_class_t cls;
+} loadgen_config_t;
+
+/**************************************************************************************************
+ * GLOBAL FUNCTIONS
+ */
+/**
+ * @brief 負荷試験開始関数（前回の集計は破棄する）
+ * @param[in] config :設定
+ */
+void loadgen_start(const loadgen_config_t *config);
+/**
+ * @brief 負荷試験停止関数
+ */
+void loadgen_stop(void);
+/**
+ * @brief 実行中確認関数
+ * @return true：実行中
+ */
+bool loadgen_running(void);
+/**
+ * @brief 負荷試験処理関数（loop から呼ぶ。送信時刻なら 1 件送信する）
+ * @return API_STATUS_FAIL：モデムエラー（リセットが必要）
+ */
+api_status_t loadgen_task(void);
+/**
+ * @brief 集計結果の JSON 作成関数
+ * @param[out] buf :格納先
+ * @param[in] size :格納先サイズ
+ * @return 作成した長さ
+ */
+uint16_t loadgen_build_report(char *buf, uint16_t size);
+
+#endif
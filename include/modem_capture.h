@@ -0,0 +1,167 @@
+/**
+ * @file modem_capture.h
+ * @version 0.1
+ * @brief BG770 通信の記録・再生 API
+ *
+ * Serial1 の送受信バイトを時刻付きで RAM に記録し、HTTP(/capture) で取り出す。
+ * 記録したセッションは ModemReplayStream で bg770_set_stream() に差し込むと、
+ * execute()/init_command_sequence_task() を変更せずに実時間または加速して再生できる。
+ * ホスト上の再生ハーネスも同じ形式・同じクラスを使う。
+ *
+ * 記録形式（リトルエンディアン）
+ *   ヘッダ  : "MCAP" | version(1) | 予約(3)
+ *   レコード: flags(1) | 前レコードからの経過時間[ms](LEB128) | データ(1〜128)
+ *             flags bit7 = 方向（1：送信 0：受信）、bit0-6 = データ長 - 1
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef MODEM_CAPTURE_H
+#define MODEM_CAPTURE_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief 形式の版 */
+#define MODEM_CAPTURE_VERSION     1
+/** @brief ヘッダ長 */
+#define MODEM_CAPTURE_HEADER_SIZE 8
+/** @brief 1 レコードの最大データ長 */
+#define MODEM_CAPTURE_RECORD_MAX  128
+/** @brief 方向ビット（送信） */
+#define MODEM_CAPTURE_DIR_TX      0x80
+/** @brief 同じレコードにまとめる間隔[ms] */
+#define MODEM_CAPTURE_MERGE_MS    2
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief 記録ストリーム（通信ストリームを包んで送受信を記録する） */
+class ModemCaptureStream : public Stream
+{
+public:
+  /**
+   * @brief 記録開始関数
+   * @param[in] base :実際の通信ストリーム
+   * @param[in] buffer :記録先
+   * @param[in] size :記録先サイズ
+   */
+  void begin(Stream *base, uint8_t *buffer, uint32_t size);
+  /** @brief 記録長取得関数 */
+  uint32_t length(void) const { return used; }
+  /** @brief 記録先が一杯になって取りこぼしたバイト数 */
+  uint32_t dropped(void) const { return overflow; }
+
+  int available(void);
+  int read(void);
+  int peek(void);
+  size_t write(uint8_t c);
+  size_t write(const uint8_t *buffer, size_t size);
+  void flush(void);
+
+private:
+  void append(uint8_t dir, uint8_t c);
+
+  /** @brief 実際の通信ストリーム */
+  Stream *base = NULL;
+  /** @brief 記録先 */
+  uint8_t *buf = NULL;
+  /** @brief 記録先サイズ */
+  uint32_t capacity = 0;
+  /** @brief 記録長 */
+  uint32_t used = 0;
+  /** @brief 取りこぼしたバイト数 */
+  uint32_t overflow = 0;
+  /** @brief 追記中レコードの flags 位置（0：無し） */
+  uint32_t open = 0;
+  /** @brief 追記中レコードの方向 */
+  uint8_t open_dir = 0;
+  /** @brief 前レコードの時刻[ms] */
+  unsigned long last_ms = 0;
+  /** @brief 最後に記録したバイトの時刻[ms] */
+  unsigned long last_byte_ms = 0;
+};
+
+/** @brief 再生ストリーム（記録の受信バイトを返し、送信バイトは照合して捨てる） */
+class ModemReplayStream : public Stream
+{
+public:
+  /**
+   * @brief 再生開始関数
+   *
+   * 受信レコードは直前の送信レコードからの経過時間で再生する。
+   * ファームウェアの処理時間が記録時と違っても、応答がコマンドより先に届くことは無い。
+   * @param[in] data :記録
+   * @param[in] size :記録長
+   * @param[in] speed :再生倍率（1：実時間 0：待ち無し）
+   * @return true：形式が正しい
+   */
+  bool begin(const uint8_t *data, uint32_t size, uint16_t speed);
+  /** @brief 再生終了確認関数 */
+  bool finished(void) const { return pos >= size; }
+  /** @brief 記録と異なる送信バイト数 */
+  uint32_t mismatches(void) const { return mismatch; }
+
+  int available(void);
+  int read(void);
+  int peek(void);
+  size_t write(uint8_t c);
+  size_t write(const uint8_t *buffer, size_t size);
+  void flush(void) {}
+
+private:
+  void next(void);
+  bool rx_ready(void);
+
+  /** @brief 記録 */
+  const uint8_t *data = NULL;
+  /** @brief 記録長 */
+  uint32_t size = 0;
+  /** @brief 次のレコード位置 */
+  uint32_t pos = 0;
+  /** @brief 再生倍率 */
+  uint16_t speed = 1;
+  /** @brief 現在レコードの方向 */
+  uint8_t dir = 0;
+  /** @brief 現在レコードのデータ */
+  const uint8_t *record = NULL;
+  /** @brief 現在レコードの長さ */
+  uint8_t record_length = 0;
+  /** @brief 現在レコードの消費済み長 */
+  uint8_t record_index = 0;
+  /** @brief 直前の送信レコードからの記録上の経過時間[ms] */
+  uint32_t since_tx_ms = 0;
+  /** @brief 直前の送信を受けた実時刻[ms] */
+  unsigned long anchor_ms = 0;
+  /** @brief 記録と異なる送信バイト数 */
+  uint32_t mismatch = 0;
+};
+
+/**************************************************************************************************
+ * GLOBAL FUNCTIONS
+ */
+/**
+ * @brief 記録開始関数（Serial1 を包んで bg770_set_stream() に設定する）
+ * @param[in] size :記録先サイズ
+ * @return true：成功 false：メモリ確保失敗
+ */
+bool modem_capture_start(uint32_t size);
+/**
+ * @brief 記録停止関数（通信ストリームを Serial1 に戻す。記録は残る）
+ */
+void modem_capture_stop(void);
+/**
+ * @brief 記録取得関数
+ * @param[out] length :記録長
+ * @return 記録（未開始の場合は NULL）
+ */
+const uint8_t *modem_capture_data(uint32_t *length);
+
+#endif
@@ -0,0 +1,100 @@
+/**
+ * @file mqtt_lane.h
+ * @version 0.1
+ * @brief MQTT クライアント（レーン）管理 API
+ *
+ * BG770 の複数の MQTT client idx を優先度別のレーンとして使う。
+ *   MQTT_LANE_CONTROL（client 0）：操作・警報。サブスクライブもここ。PUBACK まで待つ。
+ *   MQTT_LANE_BULK   （client 1）：大量のテレメトリ。PUBACK を待たずに MQTT_BULK_WINDOW 件まで送る。
+ * バルク送信の PUBACK 待ちで制御系の送信が止まらないため、警報の遅延はバルク量に依らない。
+ * バルクレーンが使えない間は制御レーンで送る。
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef MQTT_LANE_H
+#define MQTT_LANE_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include "bg770.h"
+#include "at_response.h"
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief バルクレーンの PUBACK 待ち上限 */
+#define MQTT_BULK_WINDOW       4
+/** @brief PUBACK の待ち時間[ms]（超えたらレーンを閉じたとみなす） */
+#define MQTT_ACK_TIMEOUT_MS    30000
+/** @brief 閉じたレーンの再接続間隔[ms] */
+#define MQTT_REOPEN_MS         60000
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief レーン（= client idx） */
+typedef enum e_mqtt_lane
+{
+  /** @brief 操作・警報 */
+  MQTT_LANE_CONTROL = 0,
+  /** @brief バルクテレメトリ */
+  MQTT_LANE_BULK,
+  /** @brief レーン数 */
+  MQTT_LANE_MAX,
+} mqtt_lane_t;
+
+/** @brief レーン毎の統計 */
+typedef struct st_mqtt_lane_stats
+{
+  /** @brief 接続中 */
+  bool open;
+  /** @brief PUBACK 待ち件数 */
+  uint8_t inflight;
+  /** @brief 送信数 */
+  uint32_t published;
+  /** @brief PUBACK 受信数（非同期送信のみ） */
+  uint32_t acked;
+  /** @brief 送信失敗・PUBACK タイムアウト数 */
+  uint32_t failed;
+} mqtt_lane_stats_t;
+
+/**************************************************************************************************
+ * GLOBAL FUNCTIONS
+ */
+/**
+ * @brief レーン管理の初期化関数（bg770_init の後に呼ぶ。+QMTRECV/+QMTPUB/+QMTSTAT を受ける）
+ */
+void mqtt_lane_init(void);
+/**
+ * @brief サブスクライブ受信の処理関数設定
+ * @param[in] lane :受信したレーン（+QMTRECV の client idx）
+ * @param[in] handler :処理関数
+ */
+void mqtt_lane_set_recv_handler(mqtt_lane_t lane, void (*handler)(const at_line_t *line));
+/**
+ * @brief 追加レーンの接続関数（初期化シーケンス完了後に呼ぶ。失敗したレーンは制御レーンで代替）
+ */
+void mqtt_lane_open(void);
+/**
+ * @brief 定期処理関数（loop から呼ぶ。閉じたレーンを MQTT_REOPEN_MS 毎に再接続）
+ */
+void mqtt_lane_task(void);
+/**
+ * @brief パブリッシュ関数（Publish_payload / Publish_length の内容を送信）
+ * @param[in] lane :レーン
+ * @return API_STATUS_SUCCESS：送信成功（バルクレーンは送信受付）
+ *         API_STATUS_FAIL：モデムエラー（リセットが必要）
+ */
+api_status_t mqtt_lane_publish(mqtt_lane_t lane);
+/**
+ * @brief 統計取得関数
+ * @param[in] lane :レーン
+ * @param[out] stats :統計
+ */
+void mqtt_lane_get_stats(mqtt_lane_t lane, mqtt_lane_stats_t *stats);
+
+#endif
@@ -0,0 +1,166 @@
+/**
+ * @file mqtt_session.h
+ * @version 0.1
+ * @brief MQTT セッション設定（AT+QMTCFG）・永続セッションの管理 API
+ *
+ * AT+QMTOPEN の前に client idx 毎の設定（プロファイル）を AT+QMTCFG で BG770 に設定する。
+ *   ・version   ：MQTT 3.1.1
+ *   ・session   ：制御レーンは永続セッション（clean session = 0）、その他のレーンは毎回新規
+ *   ・keepalive ：MQTT_KEEPALIVE_S（既定の 120 秒より長くして無通信時の PINGREQ を減らす）
+ *   ・timeout   ：パケットの応答待ち・再送回数
+ *   ・will      ：制御レーンが切断されたら MQTT_WILL_MESSAGE を MQTT_WILL_TOPIC<IMSI> へ（QoS1）
+ *                 （AT コマンドの "..." に入れるので引用符を含む JSON は使えない）
+ * client id は IMSI から作り（MQTT_CLIENT_PREFIX<IMSI>[-<client idx>]）、再接続しても同じセッションになる。
+ *
+ * 制御レーンの接続が最後に生きていた時刻から MQTT_SESSION_RESUME_MS 以内で、ブローカー・
+ * サブスクライブTOPIC が変わっていなければ、ブローカーにサブスクライブが残っているので
+ * 初期化シーケンスの AT+QMTSUB を省く（不在中の QoS1 メッセージも接続直後に届く）。
+ * MQTT_SESSION_RESUME_MS はブローカーのセッション保持時間（AWS IoT は既定 1 時間）より短くする。
+ * ブローカーがセッションを捨てていても CONNACK からは分からないため、省いた接続は受信で確認する。
+ * MQTT_SESSION_PROBE_MS 以内に何も届かなければサブスクライブし直し（同じ TOPIC の AT+QMTSUB は
+ * 何度送っても同じ）、確認できていないセッションでは次の接続でも省かない。
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef MQTT_SESSION_H
+#define MQTT_SESSION_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <stdbool.h>
+#include <stdint.h>
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief client id の接頭辞 */
+#define MQTT_CLIENT_PREFIX       "pico-"
+/** @brief client id の最大長（終端含む） */
+#define MQTT_CLIENT_ID_SIZE      32
+/** @brief キープアライブ[s]（AWS IoT の上限は 1200） */
+#define MQTT_KEEPALIVE_S         1200
+/** @brief パケットの応答待ち[s] */
+#define MQTT_PKT_TIMEOUT_S       20
+/** @brief パケットの再送回数 */
+#define MQTT_PKT_RETRIES         3
+/** @brief サブスクライブを省いて再接続できる、切断からの時間[ms] */
+#define MQTT_SESSION_RESUME_MS   (30UL * 60 * 1000)
+/** @brief サブスクライブを省いた接続で、受信が無ければサブスクライブし直すまでの時間[ms] */
+#define MQTT_SESSION_PROBE_MS    (60UL * 1000)
+/** @brief 遺言メッセージの TOPIC（IMSI を付ける） */
+#define MQTT_WILL_TOPIC          "pico/sample/will/"
+/** @brief 遺言メッセージ */
+#define MQTT_WILL_MESSAGE        "offline"
+/** @brief 遺言メッセージの TOPIC の最大長（終端含む） */
+#define MQTT_WILL_TOPIC_SIZE     48
+/** @brief デバイスシャドウの TOPIC の最大長（終端含む） */
+#define MQTT_SHADOW_TOPIC_SIZE   64
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief AT+QMTCFG の設定項目 */
+typedef enum e_mqtt_cfg
+{
+  /** @brief "version" */
+  MQTT_CFG_VERSION = 0,
+  /** @brief "session" */
+  MQTT_CFG_SESSION,
+  /** @brief "keepalive" */
+  MQTT_CFG_KEEPALIVE,
+  /** @brief "timeout" */
+  MQTT_CFG_TIMEOUT,
+  /** @brief "will" */
+  MQTT_CFG_WILL,
+  /** @brief 項目数 */
+  MQTT_CFG_MAX,
+} mqtt_cfg_t;
+
+/** @brief client idx 毎の設定 */
+typedef struct st_mqtt_profile
+{
+  /** @brief キープアライブ[s] */
+  uint16_t keepalive_s;
+  /** @brief true：毎回新しいセッション false：永続セッション */
+  bool clean_session;
+  /** @brief パケットの応答待ち[s] */
+  uint8_t pkt_timeout_s;
+  /** @brief パケットの再送回数 */
+  uint8_t retries;
+  /** @brief 遺言メッセージを使う */
+  bool will;
+} mqtt_profile_t;
+
+/** @brief 統計 */
+typedef struct st_mqtt_session_stats
+{
+  /** @brief サブスクライブして接続した回数 */
+  uint32_t subscribed;
+  /** @brief サブスクライブを省いて接続した回数 */
+  uint32_t resumed;
+  /** @brief 受信が無くサブスクライブし直した回数 */
+  uint32_t resubscribed;
+} mqtt_session_stats_t;
+
+/**************************************************************************************************
+ * GLOBAL FUNCTIONS
+ */
+/**
+ * @brief 設定取得関数
+ * @param[in] client :client idx
+ * @return 設定
+ */
+const mqtt_profile_t *mqtt_session_profile(uint8_t client);
+/**
+ * @brief client id の作成関数
+ * @param[in] client :client idx
+ * @param[out] buf :格納先（MQTT_CLIENT_ID_SIZE 以上）
+ */
+void mqtt_session_client_id(uint8_t client, char buf[MQTT_CLIENT_ID_SIZE]);
+/**
+ * @brief 遺言メッセージの TOPIC の作成関数
+ * @param[out] buf :格納先（MQTT_WILL_TOPIC_SIZE 以上）
+ */
+void mqtt_session_will_topic(char buf[MQTT_WILL_TOPIC_SIZE]);
+/**
+ * @brief デバイスシャドウの TOPIC の作成関数（$aws/things/SHADOW_THING_PREFIX<IMSI><suffix>）
+ * @param[in] suffix :SHADOW_UPDATE_SUFFIX / SHADOW_DELTA_SUFFIX
+ * @param[out] buf :格納先（MQTT_SHADOW_TOPIC_SIZE 以上）
+ */
+void mqtt_session_shadow_topic(const char *suffix, char buf[MQTT_SHADOW_TOPIC_SIZE]);
+/**
+ * @brief サブスクライブ省略の判定関数（制御レーンの AT+QMTOPEN 前に呼ぶ）
+ * @return true：前回のセッションが残っている
+ */
+bool mqtt_session_resumable(void);
+/**
+ * @brief 制御レーンの接続完了関数（初期化シーケンスの完了時に呼ぶ）
+ * @param[in] resumed :true：サブスクライブを省いた
+ */
+void mqtt_session_connected(bool resumed);
+/**
+ * @brief 制御レーンの切断関数（+QMTSTAT・BG770 のリセット・再接続時に呼ぶ）
+ */
+void mqtt_session_closed(void);
+/**
+ * @brief 制御レーンの受信関数（+QMTRECV 毎に呼ぶ。サブスクライブが残っていることの確認）
+ */
+void mqtt_session_received(void);
+/**
+ * @brief サブスクライブし直し完了関数（bg770_resubscribe の成功時に呼ぶ）
+ */
+void mqtt_session_resubscribed(void);
+/**
+ * @brief 定期処理関数（loop から呼ぶ。接続中は最後に生きていた時刻を更新する）
+ * @return true：サブスクライブを省いた接続で受信が無いので、サブスクライブし直す
+ */
+bool mqtt_session_task(void);
+/**
+ * @brief 統計取得関数
+ * @param[out] stats :統計
+ */
+void mqtt_session_get_stats(mqtt_session_stats_t *stats);
+
+#endif
@@ -0,0 +1,114 @@
+/**
+ * @file ota.h
+ * @version 0.1
+ * @brief ファームウェア更新（LTE 経由・中断再開可能）API
+ *
+ * {"command":"ota","url":"http://...","size":<n>,"sha256":"<64桁の16進>"} を受けると、
+ * 使っていない OTA パーティション（app0/app1）へ BG770 の HTTP で OTA_RANGE_SIZE 毎に範囲要求して書き込む。
+ *   ・範囲毎に先にセクタを消去してから要求し、受信中は書き込みだけを行う
+ *   ・Serial1 からの読み出しと書き込みタスク（コア0）のフラッシュ書き込みを 2 面のバッファで重ねる
+ *   ・範囲毎に受信データの CRC32 と書き込み後の読み出しを照合し、照合済みの位置を NVS に保存する
+ *     （切断・リセット・再起動の後は照合済みの位置から再開する）
+ *   ・全体の SHA-256 を書き込み後のフラッシュから計算して一致した時だけ起動パーティションを切り替える
+ * 進捗・結果は {"ota":{"state":"...","offset":n,"size":n}} を送信する。
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef OTA_H
+#define OTA_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include "bg770.h"
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief NVS の名前空間 */
+#define OTA_NVS_NAMESPACE    "ota"
+/** @brief URL の最大長（終端含む） */
+#define OTA_URL_SIZE         128
+/** @brief 1 回の範囲要求の長さ（OTA_BUFFER_SIZE の倍数） */
+#define OTA_RANGE_SIZE       65536
+/** @brief 書き込みバッファ 1 面の長さ（フラッシュのセクタ長） */
+#define OTA_BUFFER_SIZE      4096
+/** @brief 受信が途切れたと判断する時間[ms] */
+#define OTA_READ_TIMEOUT_MS  10000
+/** @brief 失敗後に次の範囲要求まで待つ時間[ms] */
+#define OTA_RETRY_MS         30000
+/** @brief 連続して失敗したら中止する回数 */
+#define OTA_RETRY_MAX        20
+/** @brief 切り替え後に再起動するまでの時間[ms]（結果の送信を待つ） */
+#define OTA_RESTART_MS       10000
+/** @brief 進捗・結果の送信期限[ms] */
+#define OTA_DEADLINE_MS      60000
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief 状態 */
+typedef enum e_ota_state
+{
+  /** @brief 更新無し */
+  OTA_STATE_IDLE = 0,
+  /** @brief ダウンロード中 */
+  OTA_STATE_DOWNLOAD,
+  /** @brief 切り替え済み（再起動待ち） */
+  OTA_STATE_DONE,
+  /** @brief 中止（SHA-256 不一致・連続失敗・HTTP エラー） */
+  OTA_STATE_FAILED,
+} ota_state_t;
+
+/** @brief 統計 */
+typedef struct st_ota_stats
+{
+  /** @brief 状態 */
+  ota_state_t state;
+  /** @brief 照合済みの位置 */
+  uint32_t offset;
+  /** @brief イメージ長 */
+  uint32_t size;
+  /** @brief 照合済みの範囲数 */
+  uint32_t ranges;
+  /** @brief 失敗した範囲要求数 */
+  uint32_t retries;
+  /** @brief 書き込みバッファが空くのを待った累計時間[ms]（書き込みが受信に追いつかない時間） */
+  uint32_t write_wait_ms;
+  /** @brief 最後の範囲の受信速度[byte/s] */
+  uint32_t bytes_per_s;
+} ota_stats_t;
+
+/**************************************************************************************************
+ * GLOBAL FUNCTIONS
+ */
+/**
+ * @brief 初期化関数（NVS に途中の更新があれば再開する）
+ */
+void ota_init(void);
+/**
+ * @brief 更新開始関数（実行中の更新は破棄する）
+ * @param[in] url :イメージの URL（http://）
+ * @param[in] size :イメージ長
+ * @param[in] sha256 :イメージの SHA-256（64 桁の 16 進）
+ * @return API_STATUS_SUCCESS / API_STATUS_FAIL（引数不正・パーティション不足）
+ */
+api_status_t ota_start(const char *url, uint32_t size, const char *sha256);
+/**
+ * @brief 更新中止関数
+ */
+void ota_cancel(void);
+/**
+ * @brief 定期処理関数（loop から呼ぶ。1 回に 1 範囲をダウンロードし、失敗は OTA_RETRY_MS 後に再開する）
+ */
+void ota_task(void);
+/**
+ * @brief 統計取得関数
+ * @param[out] stats :統計
+ */
+void ota_get_stats(ota_stats_t *stats);
+
+#endif
@@ -0,0 +1,151 @@
+/**
+ * @file outbox.h
+ * @version 0.1
+ * @brief 送信スケジューラ API（優先度・期限付きの送信待ち行列）
+ *
+ * 送信データを固定長バッファのプールに積み、優先度順（同じ優先度なら期限の早い順）に送信する。
+ *   ・同じキーの送信待ちは最新の内容に置き換える（シャドウ更新・ハートビート等）
+ *   ・プールが一杯なら、より低い優先度の送信待ちを捨てて受け付ける
+ *   ・期限切れは種別に応じて捨てる、または同じ種別の期限切れとまとめて 1 件にする
+ * 回線が混んでいても重要な状態変化の遅延が送信待ちの量で伸びない。
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef OUTBOX_H
+#define OUTBOX_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include "bg770.h"
+#include "uplink.h"
+#include "setup_define.h"
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief 送信待ちの最大数 */
+#define OUTBOX_SLOTS          8
+/** @brief 送信失敗時の再送回数 */
+#define OUTBOX_RETRY          2
+
+/** @brief 優先度：警報・状態変化 */
+#define OUTBOX_PRIO_CRITICAL  0
+/** @brief 優先度：通常 */
+#define OUTBOX_PRIO_NORMAL    1
+/** @brief 優先度：バルクテレメトリ */
+#define OUTBOX_PRIO_BULK      2
+
+/** @brief 置き換えキー：無し */
+#define OUTBOX_KEY_NONE       0
+/** @brief 置き換えキー：デバイスシャドウの reported 更新 */
+#define OUTBOX_KEY_SHADOW     1
+/** @brief 置き換えキー：ハートビート */
+#define OUTBOX_KEY_HEARTBEAT  2
+/** @brief 置き換えキー：ファームウェア更新の進捗 */
+#define OUTBOX_KEY_OTA        3
+/** @brief 置き換えキーの数 */
+#define OUTBOX_KEY_MAX        4
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief 期限切れの扱い */
+typedef enum e_outbox_expire
+{
+  /** @brief 遅れても送る */
+  OUTBOX_EXPIRE_SEND = 0,
+  /** @brief 捨てる */
+  OUTBOX_EXPIRE_DROP,
+  /** @brief 同じ種別の期限切れと {"batch":[...]} にまとめる */
+  OUTBOX_EXPIRE_MERGE,
+} outbox_expire_t;
+
+/** @brief 送信結果（置き換えキー毎の最後に投入したもの） */
+typedef enum e_outbox_result
+{
+  /** @brief 送信待ち・送信中（または未投入） */
+  OUTBOX_RESULT_NONE = 0,
+  /** @brief 送信できた */
+  OUTBOX_RESULT_SENT,
+  /** @brief 捨てた（期限切れ・押し出し・再送超過） */
+  OUTBOX_RESULT_DROPPED,
+} outbox_result_t;
+
+/** @brief 送信属性 */
+typedef struct st_outbox_attr
+{
+  /** @brief メッセージ種別（送信経路） */
+  uplink_class_t cls;
+  /** @brief 優先度（OUTBOX_PRIO_*、小さいほど優先） */
+  uint8_t priority;
+  /** @brief 置き換えキー（OUTBOX_KEY_*） */
+  uint8_t key;
+  /** @brief 期限切れの扱い */
+  outbox_expire_t expire;
+  /** @brief 期限[ms]（投入からの時間） */
+  uint32_t deadline_ms;
+} outbox_attr_t;
+
+/** @brief 統計 */
+typedef struct st_outbox_stats
+{
+  /** @brief 受付数 */
+  uint32_t posted;
+  /** @brief 送信数 */
+  uint32_t sent;
+  /** @brief 置き換え数 */
+  uint32_t superseded;
+  /** @brief 破棄数（期限切れ・押し出し・再送超過） */
+  uint32_t dropped;
+  /** @brief まとめた数 */
+  uint32_t merged;
+  /** @brief 受付拒否数 */
+  uint32_t rejected;
+  /** @brief 期限を過ぎて送信した数 */
+  uint32_t late;
+  /** @brief 投入から送信までの最大時間[ms] */
+  uint32_t max_latency_ms;
+  /** @brief 現在の送信待ち数 */
+  uint8_t queued;
+} outbox_stats_t;
+
+/**************************************************************************************************
+ * GLOBAL FUNCTIONS
+ */
+/**
+ * @brief 送信待ちへの投入関数（データはコピーする）
+ * @param[in] data :送信データ
+ * @param[in] length :送信データ長（PUBLISH_SIZE 以下）
+ * @param[in] attr :送信属性
+ * @return true：受付 false：プールが一杯で、より低い優先度の送信待ちも無い
+ */
+bool outbox_post(const uint8_t *data, uint16_t length, const outbox_attr_t *attr);
+/**
+ * @brief 送信待ち確認関数
+ * @param[in] key :置き換えキー（OUTBOX_KEY_*）
+ * @return true：同じキーの送信待ちがある（次の投入で置き換わる）
+ */
+bool outbox_pending(uint8_t key);
+/**
+ * @brief 送信結果の取得関数
+ * @param[in] key :置き換えキー（OUTBOX_KEY_*、OUTBOX_KEY_NONE 以外）
+ * @return 最後に投入したものの結果（同じキーの送信待ち・送信中が有る間は OUTBOX_RESULT_NONE）
+ */
+outbox_result_t outbox_result(uint8_t key);
+/**
+ * @brief 送信処理関数（loop から呼ぶ。期限切れを処理し、優先度・期限の順で先頭の 1 件を送信）
+ * @return API_STATUS_SUCCESS：送信した・送信待ち無し
+ *         API_STATUS_FAIL：モデムエラー（リセットが必要。送信待ちは残る）
+ */
+api_status_t outbox_task(void);
+/**
+ * @brief 統計取得関数
+ * @param[out] stats :統計
+ */
+void outbox_get_stats(outbox_stats_t *stats);
+
+#endif
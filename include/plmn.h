@@ -0,0 +1,147 @@
+/**
+ * @file plmn.h
+ * @version 0.1
+ * @brief 基地局オペレータ（PLMN）の選択 API
+ *
+ * 候補の PLMN を過去の接続結果と電波強度で順位付けし、順位の高い順に AT+COPS=1 で接続を試みる。
+ *   ・候補：既定の候補（eSIM のオペレータ・SIM の事業者コード）と、ネットワーク検索（AT+COPS=?）で見つかったもの
+ *   ・順位：score = 200 × (成功数 + 1) / (試行数 + 2)        （実績が無い候補は 100）
+ *                 + (rssi[dBm] + 113) / 2                  （最後に接続した時の AT+CSQ。0〜31）
+ *                 - 100（検索で見つからなかった） / + 10（検索時に接続中だった）
+ *           試行数が PLMN_HISTORY_MAX に達したら成功数と共に半分にする（古い結果の影響を減らす）
+ *   ・検索：接続に成功したことのある候補が無い時と、全候補が失敗した時に 1 回ずつだけ行う
+ *           （PLMN_SCAN_TIMEOUT_MS で打ち切る。禁止（stat 3）の PLMN は試さない）
+ * 接続結果・電波強度は NVS に保存し、再起動後も順位に使う。
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef PLMN_H
+#define PLMN_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <stdbool.h>
+#include <stdint.h>
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief NVS の名前空間 */
+#define PLMN_NVS_NAMESPACE    "plmn"
+/** @brief 保存形式の番号 */
+#define PLMN_SCHEMA           1
+/** @brief 候補数の上限 */
+#define PLMN_MAX              8
+/** @brief PLMN の最大長（MCC + MNC、終端含む） */
+#define PLMN_ID_SIZE          7
+/** @brief 半分にする試行数 */
+#define PLMN_HISTORY_MAX      16
+/** @brief ネットワーク検索のタイムアウト[ms] */
+#define PLMN_SCAN_TIMEOUT_MS  120000
+/** @brief 電波強度が未測定 */
+#define PLMN_RSSI_UNKNOWN     0
+/** @brief 既定のアクセス技術（AT+COPS の <AcT>、8：LTE Cat M1） */
+#define PLMN_ACT_DEFAULT      8
+
+/** @brief 検索結果の状態（AT+COPS=? の <stat>）：不明 */
+#define PLMN_STAT_UNKNOWN     0
+/** @brief 検索結果の状態：使用可 */
+#define PLMN_STAT_AVAILABLE   1
+/** @brief 検索結果の状態：接続中 */
+#define PLMN_STAT_CURRENT     2
+/** @brief 検索結果の状態：禁止 */
+#define PLMN_STAT_FORBIDDEN   3
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief 候補（NVS に保存する） */
+typedef struct st_plmn_entry
+{
+  /** @brief PLMN（"44020" 等） */
+  char id[PLMN_ID_SIZE];
+  /** @brief アクセス技術（AT+COPS の <AcT>） */
+  uint8_t act;
+  /** @brief 最後に接続した時の電波強度[dBm]（PLMN_RSSI_UNKNOWN：未測定） */
+  int8_t rssi;
+  /** @brief 試行数 */
+  uint8_t attempts;
+  /** @brief 成功数 */
+  uint8_t successes;
+  /** @brief 最後に成功した接続の所要時間[ms] */
+  uint32_t attach_ms;
+} plmn_entry_t;
+
+/** @brief 統計 */
+typedef struct st_plmn_stats
+{
+  /** @brief 候補数 */
+  uint8_t count;
+  /** @brief 接続中（最後に選んだ）候補 */
+  plmn_entry_t current;
+  /** @brief ネットワーク検索回数 */
+  uint32_t scans;
+  /** @brief 最初の候補で接続できなかった回数 */
+  uint32_t fallbacks;
+} plmn_stats_t;
+
+/**************************************************************************************************
+ * GLOBAL FUNCTIONS
+ */
+/**
+ * @brief 初期化関数（NVS から接続結果を読み込む）
+ */
+void plmn_init(void);
+/**
+ * @brief 接続の開始関数（既定の候補を加え、全候補を未試行に戻す）
+ * @param[in] seeds :既定の候補（PLMN の配列）
+ * @param[in] count :既定の候補数
+ */
+void plmn_begin(const char *const seeds[], uint8_t count);
+/**
+ * @brief ネットワーク検索の要否確認関数
+ * @return true：AT+COPS=? を実行する
+ */
+bool plmn_scan_due(void);
+/**
+ * @brief 検索結果の追加関数（AT+COPS=? の応答から 1 件毎に呼ぶ）
+ * @param[in] id :PLMN
+ * @param[in] stat :状態（PLMN_STAT_*）
+ * @param[in] act :アクセス技術
+ */
+void plmn_scan_add(const char *id, uint8_t stat, uint8_t act);
+/**
+ * @brief 検索の完了関数
+ * @param[in] ok :true：検索結果を受信した
+ */
+void plmn_scan_done(bool ok);
+/**
+ * @brief 次の候補の選択関数（未試行の中で順位が最も高いもの）
+ * @return true：選択した false：試す候補が無い
+ */
+bool plmn_select(void);
+/**
+ * @brief 選択中の候補取得関数
+ * @return 選択中の候補
+ */
+const plmn_entry_t *plmn_current(void);
+/**
+ * @brief 接続結果の記録関数（NVS に保存する）
+ * @param[in] attached :true：接続した
+ * @param[in] elapsed_ms :所要時間[ms]
+ */
+void plmn_result(bool attached, uint32_t elapsed_ms);
+/**
+ * @brief 電波強度の記録関数（接続後の AT+CSQ で呼ぶ。NVS に保存する）
+ * @param[in] rssi :電波強度[dBm]（99：不明）
+ */
+void plmn_signal(int16_t rssi);
+/**
+ * @brief 統計取得関数
+ * @param[out] stats :統計
+ */
+void plmn_get_stats(plmn_stats_t *stats);
+
+#endif
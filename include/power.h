@@ -0,0 +1,105 @@
+/**
+ * @file power.h
+ * @version 0.1
+ * @brief CPU クロック制御（電力・処理速度の切り替え）API
+ *
+ * 処理の種類毎に状態を切り替え、ESP-IDF の電力管理ロックでクロックを決める。
+ *   ・BURST：送信データの作成・送信待ちの送出・HTTP 応答（240MHz）
+ *   ・IDLE ：loop の巡回（80MHz、APB クロックを保つ）
+ *   ・WAIT ：BG770 の URC 待ち（ロックを離して最低クロック、自動ライトスリープ）
+ *   ・COMMAND：BG770 のコマンドの応答待ち（最低クロック、ライトスリープ禁止）
+ * ライトスリープ中は Serial1 の受信エッジで起床し、起床に使った先頭の数文字は失われる。
+ * URC は <CR><LF> で始まるので影響しないが、V0 の結果コードは「0<CR>」のように先頭から意味があり、
+ * 失うとコマンドがタイムアウトする。そのため execute() の間は COMMAND でライトスリープを禁止する。
+ * 電力管理が使えないビルド（CONFIG_PM_ENABLE 無し）では setCpuFrequencyMhz で BURST だけ 240MHz にする。
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef POWER_H
+#define POWER_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <stdbool.h>
+#include <stdint.h>
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief 最高クロック[MHz] */
+#define POWER_MAX_MHZ         240
+/** @brief 巡回中のクロック[MHz]（電力管理が使えない時の最低クロックも兼ねる） */
+#define POWER_IDLE_MHZ        80
+/** @brief 応答待ちの最低クロック[MHz]（XTAL） */
+#define POWER_MIN_MHZ         40
+/** @brief ライトスリープから起床する Serial1 の受信エッジ数 */
+#define POWER_WAKEUP_EDGES    3
+
+/** @brief 消費電流の目安[mA]：240MHz（無線停止時、ESP32 データシート） */
+#define POWER_MA_BURST        50
+/** @brief 消費電流の目安[mA]：80MHz */
+#define POWER_MA_IDLE         25
+/** @brief 消費電流の目安[mA]：40MHz */
+#define POWER_MA_WAIT         13
+/** @brief 消費電流の目安[mA]：ライトスリープ併用の応答待ち */
+#define POWER_MA_SLEEP        2
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief 状態 */
+typedef enum e_power_state
+{
+  /** @brief loop の巡回 */
+  POWER_STATE_IDLE = 0,
+  /** @brief 集中処理 */
+  POWER_STATE_BURST,
+  /** @brief BG770 の URC 待ち */
+  POWER_STATE_WAIT,
+  /** @brief BG770 のコマンドの応答待ち */
+  POWER_STATE_COMMAND,
+  /** @brief 状態数 */
+  POWER_STATE_MAX
+} power_state_t;
+
+/** @brief 統計 */
+typedef struct st_power_stats
+{
+  /** @brief 電力管理ロックを使用中（false：setCpuFrequencyMhz） */
+  bool pm;
+  /** @brief 自動ライトスリープを使用中 */
+  bool light_sleep;
+  /** @brief 状態毎の切り替え回数 */
+  uint32_t entries[POWER_STATE_MAX];
+  /** @brief 状態毎の累計時間[ms] */
+  uint32_t ms[POWER_STATE_MAX];
+  /** @brief 電荷量の目安[mAs] */
+  uint32_t charge_mas;
+  /** @brief 80MHz 固定の場合の電荷量の目安[mAs] */
+  uint32_t fixed_mas;
+  /** @brief BURST の短縮時間の目安[ms]（80MHz で同じ処理をした場合との差） */
+  uint32_t saved_ms;
+} power_stats_t;
+
+/**************************************************************************************************
+ * GLOBAL FUNCTIONS
+ */
+/**
+ * @brief 初期化関数（電力管理の設定とロックの作成。IDLE で開始）
+ */
+void power_init(void);
+/**
+ * @brief 状態の切り替え関数（入れ子にする場合は戻り値で元に戻す）
+ * @param[in] state :状態
+ * @return 切り替え前の状態
+ */
+power_state_t power_set(power_state_t state);
+/**
+ * @brief 統計取得関数
+ * @param[out] stats :統計
+ */
+void power_get_stats(power_stats_t *stats);
+
+#endif
@@ -0,0 +1,223 @@
+/**
+ * @file rule.h
+ * @version 0.1
+ * @brief ルールエンジン（ローカルの状態・イベントから LED・ブザー・送信を直接駆動）API
+ *
+ * クラウドで判定表に変換したルールを MQTT（サブスクライブTOPIC の {"command":"rules"}）で受け取り、
+ * NVS に保存する。イベント（スイッチ・Sub-GHz のサンプル・CAN 信号）はルールタスク（コア 0）で判定し、
+ * LED・ブザーは回線やモデムの応答待ちに関係なくその場で駆動する。
+ *   ・イベント     ：スイッチは割り込み + RULE_DEBOUNCE_MS、Sub-GHz・CAN は受信タスクのデコード直後。
+ *                    rule_watch で判定表に無い信号はキューに積まない
+ *   ・判定         ：(source, key) で整列した判定表を二分探索し、一致したルールの条件を評価する。
+ *                    条件が成立した時に on、不成立に戻った時に off の動作を実行する（ヒステリシス付き）
+ *   ・動作         ：LED（シャドウへも報告）・ブザー（時間指定）・送信（送信待ち経由で {"rule":{..}}）
+ *
+ * {"command":"rules","version":n,"rules":[[source,key,op,threshold,hysteresis,on,on_arg,off,off_arg],..]}
+ * | 項目 | 値 |
+ * |:--|:--|
+ * | source | rule_source_t（0：スイッチ 1：Sub-GHz 2：CAN） |
+ * | key | スイッチは 0、Sub-GHz は RULE_KEY_SUBGHZ(node, ch)、CAN は信号表の位置 |
+ * | op | rule_op_t（0：== 1：!= 2：> 3：>= 4：< 5：<=） |
+ * | threshold / hysteresis | しきい値・成立後に不成立とみなすまでの幅（>・>= は下げ、<・<= は上げる） |
+ * | on / off | rule_action_t（0：無し 1：LED 2：ブザー 3：送信） |
+ * | on_arg / off_arg | LED は RULE_ARG_LED(led, color)、ブザーは鳴らす時間[ms]（0：停止 65535：連続）、送信はタグ |
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef RULE_H
+#define RULE_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <stdbool.h>
+#include <stdint.h>
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief ルールの最大数 */
+#define RULE_MAX               32
+/** @brief NVS の名前空間 */
+#define RULE_NVS_NAMESPACE     "rule"
+/** @brief 保存形式の番号（rule_t を変えたら上げる） */
+#define RULE_SCHEMA            1
+/** @brief 更新 JSON の解析サイズ */
+#define RULE_DOC_SIZE          6144
+/** @brief イベントキューの容量 */
+#define RULE_EVENT_QUEUE_SIZE  32
+/** @brief 出力（loop へ渡す動作）キューの容量（2 のべき乗） */
+#define RULE_OUTPUT_QUEUE_SIZE 16
+/** @brief ルールタスクのスタックサイズ */
+#define RULE_TASK_STACK        3072
+/** @brief スイッチのチャタリング除去[ms] */
+#define RULE_DEBOUNCE_MS       20
+/** @brief ブザー連続鳴動の指定 */
+#define RULE_BUZZER_CONTINUOUS 0xFFFF
+/** @brief Sub-GHz の key（ノードID・チャンネル） */
+#define RULE_KEY_SUBGHZ(node, ch) (((uint32_t)(node) << 8) | (uint8_t)(ch))
+/** @brief LED 動作の引数（shadow_led_t・shadow_color_t） */
+#define RULE_ARG_LED(led, color)  ((uint16_t)(((led) << 8) | (color)))
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief イベントの発生元 */
+typedef enum e_rule_source
+{
+  /** @brief スイッチ（値 1：押下） */
+  RULE_SOURCE_SWITCH = 0,
+  /** @brief Sub-GHz のサンプル */
+  RULE_SOURCE_SUBGHZ,
+  /** @brief CAN 信号 */
+  RULE_SOURCE_CAN,
+  /** @brief 発生元の数 */
+  RULE_SOURCE_MAX,
+} rule_source_t;
+
+/** @brief 比較 */
+typedef enum e_rule_op
+{
+  /** @brief 値 == しきい値 */
+  RULE_OP_EQ = 0,
+  /** @brief 値 != しきい値 */
+  RULE_OP_NE,
+  /** @brief 値 > しきい値 */
+  RULE_OP_GT,
+  /** @brief 値 >= しきい値 */
+  RULE_OP_GE,
+  /** @brief 値 < しきい値 */
+  RULE_OP_LT,
+  /** @brief 値 <= しきい値 */
+  RULE_OP_LE,
+  /** @brief 比較の数 */
+  RULE_OP_MAX,
+} rule_op_t;
+
+/** @brief 動作 */
+typedef enum e_rule_action
+{
+  /** @brief 無し */
+  RULE_ACTION_NONE = 0,
+  /** @brief LED の点灯（引数 RULE_ARG_LED） */
+  RULE_ACTION_LED,
+  /** @brief ブザー（引数 鳴らす時間[ms]） */
+  RULE_ACTION_BUZZER,
+  /** @brief 送信（引数 タグ） */
+  RULE_ACTION_PUBLISH,
+  /** @brief 動作の数 */
+  RULE_ACTION_MAX,
+} rule_action_t;
+
+/** @brief ルール（判定表の 1 行） */
+typedef struct st_rule
+{
+  /** @brief 発生元（rule_source_t） */
+  uint8_t source;
+  /** @brief 比較（rule_op_t） */
+  uint8_t op;
+  /** @brief 受信した順の番号（送信の "id"） */
+  uint8_t id;
+  /** @brief 成立時の動作（rule_action_t） */
+  uint8_t on_action;
+  /** @brief 不成立に戻った時の動作（rule_action_t） */
+  uint8_t off_action;
+  /** @brief 成立時の動作の引数 */
+  uint16_t on_arg;
+  /** @brief 不成立に戻った時の動作の引数 */
+  uint16_t off_arg;
+  /** @brief 信号 */
+  uint32_t key;
+  /** @brief しきい値 */
+  int32_t threshold;
+  /** @brief ヒステリシス */
+  int32_t hysteresis;
+} rule_t;
+
+/** @brief 更新結果 */
+typedef enum e_rule_result
+{
+  /** @brief 反映した */
+  RULE_RESULT_OK = 0,
+  /** @brief version が現在以下 */
+  RULE_RESULT_STALE,
+  /** @brief JSON・値が不正 */
+  RULE_RESULT_INVALID,
+  /** @brief NVS に書けなかった（反映もしない） */
+  RULE_RESULT_NVS_ERROR,
+  /** @brief 前回の更新をルールタスクが反映していない */
+  RULE_RESULT_BUSY,
+} rule_result_t;
+
+/** @brief 統計 */
+typedef struct st_rule_stats
+{
+  /** @brief 判定表の version */
+  uint32_t version;
+  /** @brief ルール数 */
+  uint8_t count;
+  /** @brief 判定したイベント数 */
+  uint32_t events;
+  /** @brief 実行した動作の数 */
+  uint32_t fired;
+  /** @brief キュー満杯で捨てたイベント・動作の数 */
+  uint32_t drops;
+  /** @brief 1 イベントの判定・動作の最長時間[us] */
+  uint32_t max_us;
+  /** @brief 判定・動作の合計時間[us] */
+  uint32_t total_us;
+} rule_stats_t;
+
+/**************************************************************************************************
+ * GLOBAL FUNCTIONS
+ */
+/**
+ * @brief 初期化関数（NVS の判定表を読み、ルールタスク・スイッチの割り込みを開始する）
+ */
+void rule_init(void);
+/**
+ * @brief 判定対象の確認関数（受信タスクから呼び出し可。偽陽性は有るが偽陰性は無い）
+ * @param[in] source :発生元
+ * @param[in] key :信号
+ * @return true：rule_post する
+ */
+bool rule_watch(rule_source_t source, uint32_t key);
+/**
+ * @brief イベント投入関数（受信タスクから呼び出し可。待たない）
+ * @param[in] source :発生元
+ * @param[in] key :信号
+ * @param[in] value :値
+ */
+void rule_post(rule_source_t source, uint32_t key, int32_t value);
+/**
+ * @brief 判定表の更新の判定関数
+ * @param[in] json :サブスクライブ受信の JSON
+ * @return true：{"command":"rules"}
+ */
+bool rule_is_update(const char *json);
+/**
+ * @brief 判定表の更新関数（全ルールを検証してから NVS に保存し、ルールタスクへ渡す）
+ * @param[in] json :{"command":"rules","version":n,"rules":[..]}
+ * @return 更新結果
+ */
+rule_result_t rule_update(const char *json);
+/**
+ * @brief 更新結果 JSON の作成関数（{"rules":{"version":n,"result":"ok"}}）
+ * @param[out] buf :格納先
+ * @param[in] size :格納先サイズ
+ * @param[in] result :更新結果
+ * @return 長さ（入りきらない場合 0）
+ */
+uint16_t rule_build_result(char buf[], uint16_t size, rule_result_t result);
+/**
+ * @brief 定期処理関数（loop から呼ぶ。LED の変化をシャドウへ反映し、送信動作を送信待ちに積む）
+ */
+void rule_task(void);
+/**
+ * @brief 統計取得関数
+ * @param[out] stats :統計
+ */
+void rule_get_stats(rule_stats_t *stats);
+
+#endif
@@ -13,17 +13,51 @@
 /**************************************************************************************************
  * CONSTANTS
  */
-/** @brief  デバッグ用プリントモード */
+/** @brief  デバッグ用プリントモード（ATトレースをシリアルへ即時出力） */
 //#define DEBUG_PRINT
+/** @brief  BG770 通信の記録モード（Serial1 の送受信を RAM に記録し /capture で取り出す） */
+//#define MODEM_CAPTURE
+/** @brief  記録サイズ[byte] */
+#define MODEM_CAPTURE_SIZE  32768
+/** @brief  ベンチマークモード（起動時に bench_run を実行。確保回数も計測する場合は env:bench でビルド） */
+//#define BENCHMARK
 /** @brief  SIMモードの定義（eSIM or SIM） */
 #define eSIMMODE
 //#define SIMMODE
-/** @brief  サブスクライブTOPIC */
+/** @brief  サブスクライブTOPIC（既定値。実行時は config の sub_topic） */
 #define SUBSCRIBE_TOPIC "pico/sample/sub"
-/** @brief  パブリッシュTOPIC */
+/** @brief  パブリッシュTOPIC（既定値。実行時は config の pub_topic） */
 #define PUBLISH_TOPIC   "pico/sample/pub"
+/** @brief  設定更新TOPIC（接続先を変えても固定） */
+#define CONFIG_TOPIC    "pico/sample/config"
+/** @brief  APN（既定値。以下 BROKER_PORT まで実行時は config の値） */
+#define APN_NAME        "soracom.io"
+/** @brief  APN のユーザー名 */
+#define APN_USER        "sora"
+/** @brief  APN のパスワード */
+#define APN_PASS        "sora"
+/** @brief  MQTT ブローカー */
+#define BROKER_HOST     "beam.soracom.io"
+/** @brief  MQTT ブローカーのポート */
+#define BROKER_PORT     1883
+/** @brief  デバイスシャドウのモノの名前の接頭辞（後ろに IMSI を付けた名前で AWS IoT に登録する） */
+#define SHADOW_THING_PREFIX  "Pico3-"
+/** @brief  デバイスシャドウTOPIC の先頭（後ろにモノの名前） */
+#define SHADOW_TOPIC_ROOT    "$aws/things/"
+/** @brief  デバイスシャドウ更新TOPIC（モノの名前の後ろ） */
+#define SHADOW_UPDATE_SUFFIX "/shadow/update"
+/** @brief  デバイスシャドウ差分TOPIC（モノの名前の後ろ） */
+#define SHADOW_DELTA_SUFFIX  SHADOW_UPDATE_SUFFIX "/delta"
+/** @brief  ファームウェアのバージョン（シャドウに報告） */
+#define FIRMWARE_VERSION    "0.1"
 /** @brief パブリッシュサイズ */
 #define PUBLISH_SIZE     1500
+/** @brief UDP 送信サイズ（AT+QISEND の上限） */
+#define UDP_SEND_SIZE    1460
+/** @brief テレメトリの送信期限[ms]（過ぎたら同じ種別とまとめる。既定値） */
+#define TELEMETRY_DEADLINE_MS 30000
+/** @brief ハートビートの送信期限[ms]（過ぎたら捨てる。既定値） */
+#define DIAG_DEADLINE_MS      60000
 
 
 #endif
@@ -0,0 +1,152 @@
+/**
+ * @file shadow.h
+ * @version 0.1
+ * @brief デバイス状態（AWS IoT デバイスシャドウ同期）API
+ *
+ * LED・スイッチ・RSSI・ファームウェア情報をローカルの状態として持ち、デバイスシャドウと同期する。
+ *   ・reported：前回報告した値から変わった項目だけを {"state":{"reported":{...}}} で送る
+ *   ・desired ：差分TOPIC で届いた差分を LED に反映する（反映後の値が reported で返る）
+ * 接続（Subscribe Start）毎に全項目を 1 回報告し、以降は変化分のみ送信する。
+ * 報告済みとするのは送信できた時点で、送信待ちが捨てられた項目は次の shadow_task で報告し直す。
+ * TOPIC は mqtt_session_shadow_topic で作る（モノの名前は SHADOW_THING_PREFIX<IMSI>）。
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef SHADOW_H
+#define SHADOW_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include "at_response.h"
+#include "setup_define.h"
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief RSSI を報告し直す変化幅[dBm] */
+#define SHADOW_RSSI_STEP      6
+/** @brief reported 更新の送信期限[ms] */
+#define SHADOW_DEADLINE_MS    2000
+/** @brief 差分ドキュメントの解析サイズ（metadata を含む） */
+#define SHADOW_DELTA_DOC_SIZE 512
+
+/** @brief 項目：LAN LED */
+#define SHADOW_FIELD_LAN      0x01
+/** @brief 項目：WAN LED */
+#define SHADOW_FIELD_WAN      0x02
+/** @brief 項目：スイッチ */
+#define SHADOW_FIELD_SW       0x04
+/** @brief 項目：RSSI */
+#define SHADOW_FIELD_RSSI     0x08
+/** @brief 項目：ファームウェア情報 */
+#define SHADOW_FIELD_FW       0x10
+/** @brief 全項目 */
+#define SHADOW_FIELD_ALL      0x1F
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief LED */
+typedef enum e_shadow_led
+{
+  /** @brief LAN LED（"lan"） */
+  SHADOW_LED_LAN = 0,
+  /** @brief WAN LED（"wan"） */
+  SHADOW_LED_WAN,
+  /** @brief LED 数 */
+  SHADOW_LED_MAX,
+} shadow_led_t;
+
+/** @brief LED の色 */
+typedef enum e_shadow_color
+{
+  /** @brief 消灯（"OFF"） */
+  SHADOW_COLOR_OFF = 0,
+  /** @brief 赤（"RED"） */
+  SHADOW_COLOR_RED,
+  /** @brief 緑（"GREEN"） */
+  SHADOW_COLOR_GREEN,
+} shadow_color_t;
+
+/** @brief デバイス状態 */
+typedef struct st_shadow_state
+{
+  /** @brief LED の色 */
+  shadow_color_t led[SHADOW_LED_MAX];
+  /** @brief スイッチ（true：ON） */
+  bool sw;
+  /** @brief RSSI[dBm] */
+  int16_t rssi;
+} shadow_state_t;
+
+/**************************************************************************************************
+ * GLOBAL FUNCTIONS
+ */
+/**
+ * @brief デバイス状態の初期化関数（bg770_init の後に呼ぶ。LAN LED は起動時の赤点灯とする）
+ */
+void shadow_init(void);
+/**
+ * @brief 再同期関数（Subscribe Start 毎に呼ぶ。LED を状態に合わせ、全項目を報告し直す）
+ */
+void shadow_resync(void);
+/**
+ * @brief LED 設定関数（点灯を切り替え、変化があれば次の shadow_task で報告）
+ * @param[in] led :LED
+ * @param[in] color :色
+ */
+void shadow_set_led(shadow_led_t led, shadow_color_t color);
+/**
+ * @brief LED の点灯関数（GPIO のみ。状態は変えないので shadow_set_led で後から反映する。他タスクから呼び出し可）
+ * @param[in] led :LED
+ * @param[in] color :色
+ */
+void shadow_write_led(shadow_led_t led, shadow_color_t color);
+/**
+ * @brief LED の色取得関数
+ * @param[in] led :LED
+ * @return 色
+ */
+shadow_color_t shadow_get_led(shadow_led_t led);
+/**
+ * @brief 色の名前から色への変換関数
+ * @param[in] name :"RED" / "GREEN" / "OFF"（大文字小文字を区別しない）
+ * @param[out] color :色
+ * @return true：変換できた
+ */
+bool shadow_parse_color(const char *name, shadow_color_t *color);
+/**
+ * @brief 色の名前取得関数
+ * @param[in] color :色
+ * @return "RED" / "GREEN" / "OFF"
+ */
+const char *shadow_color_name(shadow_color_t color);
+/**
+ * @brief 定期処理関数（loop から呼ぶ。スイッチ・RSSI を読み、変化した項目を送信待ちに積む）
+ */
+void shadow_task(void);
+/**
+ * @brief 差分トピック確認関数
+ * @param[in] line :+QMTRECV の行
+ * @return true：差分TOPIC の受信
+ */
+bool shadow_is_delta(const at_line_t *line);
+/**
+ * @brief desired 差分の反映関数
+ * @param[in] json :差分ドキュメント（{"version":n,"state":{"lan":"RED",...},...}）
+ */
+void shadow_apply_delta(const char *json);
+/**
+ * @brief reported 更新の作成関数
+ * @param[out] buf :出力先
+ * @param[in] size :出力先のサイズ
+ * @param[in] fields :出力する項目（SHADOW_FIELD_*）
+ * @return 書き込んだ長さ（入りきらない場合は 0）
+ */
+uint16_t shadow_build_reported(char buf[], uint16_t size, uint8_t fields);
+
+#endif
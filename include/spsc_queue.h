@@ -0,0 +1,74 @@
+/**
+ * @file spsc_queue.h
+ * @version 0.1
+ * @brief 単一生産者・単一消費者のロックフリーキュー
+ *
+ * 生産者（受信タスク・ISR）と消費者（loop）が別コアで動作しても
+ * ミューテックス無しで固定長レコードを受け渡す。
+ * 容量は 2 のべき乗とすること。
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <stdbool.h>
+#include <stdint.h>
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief キューの型 */
+typedef struct st_spsc_queue
+{
+  /** @brief レコード格納領域（elem_size * capacity バイト） */
+  uint8_t *buffer;
+  /** @brief 1 レコードのサイズ */
+  uint16_t elem_size;
+  /** @brief レコード数（2 のべき乗） */
+  uint16_t capacity;
+  /** @brief 書き込み位置（生産者のみ更新） */
+  volatile uint32_t head;
+  /** @brief 読み出し位置（消費者のみ更新） */
+  volatile uint32_t tail;
+  /** @brief 満杯で破棄したレコード数 */
+  volatile uint32_t dropped;
+} spsc_queue_t;
+
+/**************************************************************************************************
+ * GLOBAL FUNCTIONS
+ */
+/**
+ * @brief キュー初期化関数
+ * @param[out] q :キュー
+ * @param[in] buffer :格納領域
+ * @param[in] elem_size :1 レコードのサイズ
+ * @param[in] capacity :レコード数（2 のべき乗）
+ */
+void spsc_init(spsc_queue_t *q, void *buffer, uint16_t elem_size, uint16_t capacity);
+/**
+ * @brief レコード追加関数（生産者側、ISR から呼び出し可）
+ * @param[in/out] q :キュー
+ * @param[in] elem :追加するレコード
+ * @return true：追加成功 / false：満杯
+ */
+bool spsc_push(spsc_queue_t *q, const void *elem);
+/**
+ * @brief レコード取り出し関数（消費者側）
+ * @param[in/out] q :キュー
+ * @param[out] elem :取り出したレコード
+ * @return true：取り出し成功 / false：空
+ */
+bool spsc_pop(spsc_queue_t *q, void *elem);
+/**
+ * @brief 格納レコード数取得関数
+ * @param[in] q :キュー
+ * @return 格納レコード数
+ */
+uint16_t spsc_count(const spsc_queue_t *q);
+
+#endif
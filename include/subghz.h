@@ -0,0 +1,157 @@
+/**
+ * @file subghz.h
+ * @version 0.1
+ * @brief Sub-GHz(CC1310) センサーゲートウェイ API
+ *
+ * CC1310 から UART2 で受け取ったフレームを CRC 確認・ノード毎にデコードし、
+ * 重複除去と集計を行った結果をロックフリーキュー経由で LTE 送信側へ渡す。
+ *
+ * フレーム形式（リトルエンディアン）
+ *   SOF(0xA5) | LEN | NODE(2) | SEQ | TYPE | DATA(LEN-4) | CRC16(2)
+ *   CRC16-CCITT(初期値 0xFFFF) は LEN から DATA までを対象とする
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef SUBGHZ_H
+#define SUBGHZ_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief CC1310 UART ボーレート */
+#define SUBGHZ_BAUDRATE         115200
+/** @brief フレーム先頭バイト */
+#define SUBGHZ_SOF              0xA5
+/** @brief LEN の最大値（NODE〜DATA） */
+#define SUBGHZ_MAX_LEN          64
+/** @brief フレームの最大長（SOF + LEN + 本体 + CRC） */
+#define SUBGHZ_FRAME_MAX        (SUBGHZ_MAX_LEN + 4)
+/** @brief 管理するノード数の上限 */
+#define SUBGHZ_NODE_MAX         32
+/** @brief 集計周期[ms] */
+#define SUBGHZ_AGGREGATE_MS     10000
+/** @brief 1 サンプルのチャンネル数の上限 */
+#define SUBGHZ_CHANNEL_MAX      2
+
+/** @brief 温湿度（int16 温度 x0.01℃, uint16 湿度 x0.01%） */
+#define SUBGHZ_TYPE_TEMP_HUMI   0x01
+/** @brief カウンタ（uint32） */
+#define SUBGHZ_TYPE_COUNTER     0x02
+/** @brief アナログ値（int16） */
+#define SUBGHZ_TYPE_ANALOG      0x03
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief ノード毎の集計結果 */
+typedef struct st_subghz_aggregate
+{
+  /** @brief ノードID */
+  uint16_t node;
+  /** @brief フレーム種別 */
+  uint8_t type;
+  /** @brief チャンネル数 */
+  uint8_t channels;
+  /** @brief 集計したサンプル数 */
+  uint16_t count;
+  /** @brief 最小値 */
+  int32_t min[SUBGHZ_CHANNEL_MAX];
+  /** @brief 最大値 */
+  int32_t max[SUBGHZ_CHANNEL_MAX];
+  /** @brief 最新値 */
+  int32_t last[SUBGHZ_CHANNEL_MAX];
+  /** @brief 合計値 */
+  int64_t sum[SUBGHZ_CHANNEL_MAX];
+} subghz_aggregate_t;
+
+/** @brief 受信統計 */
+typedef struct st_subghz_stats
+{
+  /** @brief 正常フレーム数 */
+  uint32_t frames;
+  /** @brief CRC エラー数 */
+  uint32_t crc_errors;
+  /** @brief 長さ異常・未知の種別 */
+  uint32_t bad_frames;
+  /** @brief 重複フレーム数 */
+  uint32_t duplicates;
+  /** @brief ノード表あふれ */
+  uint32_t node_overflows;
+  /** @brief キュー満杯で破棄した集計数 */
+  uint32_t queue_drops;
+} subghz_stats_t;
+
+/**************************************************************************************************
+ * GLOBAL FUNCTIONS
+ */
+/**
+ * @brief Sub-GHz ゲートウェイ初期化関数（UART2 と受信タスクを起動）
+ */
+void subghz_init(void);
+/**
+ * @brief 受信バイト列の投入関数（受信タスク、ホスト側フレームジェネレータから呼び出し）
+ * @param[in] data :受信データ
+ * @param[in] length :受信データ長
+ */
+void subghz_feed(const uint8_t *data, size_t length);
+/**
+ * @brief 集計周期の確認関数（周期を過ぎていれば集計結果をキューへ出力）
+ * @param[in] now :現在時刻[ms]
+ */
+void subghz_flush(uint32_t now);
+/**
+ * @brief 集計結果取り出し関数（LTE 送信側）
+ * @param[out] aggregate :集計結果
+ * @return true：取り出し成功 / false：キューが空
+ */
+bool subghz_pop(subghz_aggregate_t *aggregate);
+/**
+ * @brief 取り出し待ちの集計結果数の取得関数
+ * @return 集計結果数
+ */
+uint16_t subghz_pending(void);
+/**
+ * @brief 集計結果の記録先設定関数（subghz_build_payload で取り出した集計結果を渡す）
+ * @param[in] handler :記録関数（NULL：記録しない）
+ */
+void subghz_set_record_handler(void (*handler)(const subghz_aggregate_t *aggregate));
+/**
+ * @brief パブリッシュペイロード作成関数
+ * @param[out] buf :ペイロード格納先
+ * @param[in] size :格納先サイズ
+ * @return ペイロード長（送信する集計結果が無い場合は 0）
+ */
+uint16_t subghz_build_payload(char *buf, uint16_t size);
+/**
+ * @brief フレーム作成関数（CC1310 への送信、ホスト側フレームジェネレータ用）
+ * @param[out] buf :フレーム格納先（SUBGHZ_FRAME_MAX 以上）
+ * @param[in] node :ノードID
+ * @param[in] seq :シーケンス番号
+ * @param[in] type :フレーム種別
+ * @param[in] data :データ
+ * @param[in] length :データ長
+ * @return フレーム長（長すぎる場合は 0）
+ */
+uint16_t subghz_frame_encode(uint8_t *buf, uint16_t node, uint8_t seq, uint8_t type, const uint8_t *data, uint8_t length);
+/**
+ * @brief CRC16-CCITT 計算関数
+ * @param[in] data :データ
+ * @param[in] length :データ長
+ * @return CRC
+ */
+uint16_t subghz_crc16(const uint8_t *data, size_t length);
+/**
+ * @brief 受信統計取得関数
+ * @param[out] stats :受信統計
+ */
+void subghz_get_stats(subghz_stats_t *stats);
+
+#endif
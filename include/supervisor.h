@@ -0,0 +1,192 @@
+/**
+ * @file supervisor.h
+ * @version 0.1
+ * @brief 処理時間の監視（段階毎の上限・ウォッチドッグ・段階的な復旧）API
+ *
+ * loop タスクの処理を段階（モデムコマンド・送信・HTTP・コンソール）に分け、段階毎の上限時間を監視する。
+ *   ・supervisor_enter / supervisor_leave で段階を入れ子に積む。上限は入れ子の内側の時間を除いた
+ *     自段階の時間に掛かる（送信中の AT コマンドの待ちは送信の時間に数えない）
+ *   ・監視タスク（コア 0）が SUPERVISOR_PERIOD_MS 毎に最も内側の段階を確認し、上限を超えたら段階的に復旧する
+ *       上限超過                          ：記録・中断要求（supervisor_aborted を見る待ちループが抜ける）
+ *       上限 + SUPERVISOR_MODEM_RESET_MS ：BG770 をハードウェアリセット（UART 待ちを終わらせる）、
+ *                                          loop に戻ったら bg770_reset で初期化シーケンスへ
+ *       上限 + SUPERVISOR_RESTART_MS     ：再起動
+ *   ・ESP32 のタスクウォッチドッグ（SUPERVISOR_WDT_S）に loop タスクと監視タスクを登録する。
+ *     supervisor_feed を呼ばずに止まった場合（割り込み禁止・監視タスクの停止等）もリセットされる
+ * 上限超過は段階・入れ子の外側の段階・経過時間・内容（AT コマンド・URI 等）と共に RTC メモリに記録し、
+ * リセット後も残す。ウォッチドッグ・例外によるリセットは直前の段階を記録する。
+ *
+ * | 段階    | 上限                               |
+ * |:--------|:-----------------------------------|
+ * | LOOP    | SUPERVISOR_LOOP_MS（setup は SUPERVISOR_SETUP_MS） |
+ * | MODEM   | コマンドの timeout + command_delay + SUPERVISOR_MODEM_MARGIN_MS |
+ * | PUBLISH | SUPERVISOR_PUBLISH_MS              |
+ * | HTTP    | SUPERVISOR_HTTP_MS（Wi-Fi 接続は SUPERVISOR_WIFI_MS） |
+ * | CONSOLE | SUPERVISOR_CONSOLE_MS              |
+ * | ACK     | 待ち時間 + SUPERVISOR_ACK_MARGIN_MS（UDP の確認応答・バルクレーンの PUBACK 待ち） |
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief タスクウォッチドッグの時間[s] */
+#define SUPERVISOR_WDT_S             20
+/** @brief 監視周期[ms] */
+#define SUPERVISOR_PERIOD_MS         250
+/** @brief 監視タスクのスタックサイズ */
+#define SUPERVISOR_TASK_STACK        3072
+/** @brief 入れ子の最大数 */
+#define SUPERVISOR_DEPTH             6
+/** @brief 記録する内容の長さ（終端含む） */
+#define SUPERVISOR_DETAIL_SIZE       20
+/** @brief RTC メモリに残す上限超過の件数 */
+#define SUPERVISOR_LOG_RECORDS       8
+/** @brief setup の上限[ms] */
+#define SUPERVISOR_SETUP_MS          30000
+/** @brief loop 1 周（他の段階を除く）の上限[ms] */
+#define SUPERVISOR_LOOP_MS           5000
+/** @brief モデムコマンドの上限の余裕[ms]（timeout に足す） */
+#define SUPERVISOR_MODEM_MARGIN_MS   5000
+/** @brief 送信（AT コマンドを除く）の上限[ms] */
+#define SUPERVISOR_PUBLISH_MS        3000
+/** @brief HTTP ハンドラの上限[ms] */
+#define SUPERVISOR_HTTP_MS           5000
+/** @brief Wi-Fi 接続（/wifi の POST）の上限[ms] */
+#define SUPERVISOR_WIFI_MS           30000
+/** @brief コンソールコマンドの上限[ms] */
+#define SUPERVISOR_CONSOLE_MS        2000
+/** @brief 確認応答・PUBACK 待ちの上限の余裕[ms]（待ち時間に足す） */
+#define SUPERVISOR_ACK_MARGIN_MS     2000
+/** @brief 上限超過から BG770 をリセットするまで[ms] */
+#define SUPERVISOR_MODEM_RESET_MS    5000
+/** @brief 上限超過から再起動するまで[ms] */
+#define SUPERVISOR_RESTART_MS        15000
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief 段階 */
+typedef enum e_supervisor_stage
+{
+  /** @brief loop（他の段階の外） */
+  SUPERVISOR_STAGE_LOOP = 0,
+  /** @brief モデムコマンド（execute） */
+  SUPERVISOR_STAGE_MODEM,
+  /** @brief 送信（送信待ち・レーン） */
+  SUPERVISOR_STAGE_PUBLISH,
+  /** @brief HTTP ハンドラ */
+  SUPERVISOR_STAGE_HTTP,
+  /** @brief コンソールコマンド */
+  SUPERVISOR_STAGE_CONSOLE,
+  /** @brief 確認応答・PUBACK 待ち（送信の上限に数えない） */
+  SUPERVISOR_STAGE_ACK,
+  /** @brief 段階数 */
+  SUPERVISOR_STAGE_MAX,
+} supervisor_stage_t;
+
+/** @brief 復旧の段階 */
+typedef enum e_supervisor_level
+{
+  /** @brief 上限内 */
+  SUPERVISOR_LEVEL_NONE = 0,
+  /** @brief 中断要求 */
+  SUPERVISOR_LEVEL_SOFT,
+  /** @brief BG770 リセット */
+  SUPERVISOR_LEVEL_MODEM_RESET,
+  /** @brief 再起動 */
+  SUPERVISOR_LEVEL_RESTART,
+  /** @brief ウォッチドッグ・例外によるリセット（起動時に記録） */
+  SUPERVISOR_LEVEL_WATCHDOG,
+  /** @brief 段階数 */
+  SUPERVISOR_LEVEL_MAX,
+} supervisor_level_t;
+
+/** @brief 上限超過の記録（RTC メモリ） */
+typedef struct st_supervisor_violation
+{
+  /** @brief 起動回数 */
+  uint32_t boot;
+  /** @brief 起動からの時刻[ms] */
+  uint32_t uptime_ms;
+  /** @brief 経過時間[ms]（入れ子の内側を除く） */
+  uint32_t elapsed_ms;
+  /** @brief 上限[ms] */
+  uint32_t budget_ms;
+  /** @brief 段階（supervisor_stage_t） */
+  uint8_t stage;
+  /** @brief 外側の段階（supervisor_stage_t。無ければ自段階） */
+  uint8_t outer;
+  /** @brief 復旧の段階（supervisor_level_t） */
+  uint8_t level;
+  /** @brief 内容（AT コマンド・URI・コンソールの行の先頭） */
+  char detail[SUPERVISOR_DETAIL_SIZE];
+} supervisor_violation_t;
+
+/** @brief 統計 */
+typedef struct st_supervisor_stats
+{
+  /** @brief 復旧の段階毎の回数（起動後） */
+  uint32_t violations[SUPERVISOR_LEVEL_MAX];
+  /** @brief 段階毎の最長時間[ms]（入れ子の内側を除く） */
+  uint32_t max_ms[SUPERVISOR_STAGE_MAX];
+  /** @brief RTC メモリの記録数（累計） */
+  uint32_t logged;
+} supervisor_stats_t;
+
+/**************************************************************************************************
+ * GLOBAL FUNCTIONS
+ */
+/**
+ * @brief 初期化関数（setup の最初に呼ぶ。ウォッチドッグ・監視タスクを開始する）
+ */
+void supervisor_init(void);
+/**
+ * @brief 段階の開始関数
+ * @param[in] stage :段階
+ * @param[in] budget_ms :上限[ms]（0：段階の既定値）
+ * @param[in] detail :内容（NULL可）
+ * @return supervisor_leave に渡す値
+ */
+uint8_t supervisor_enter(supervisor_stage_t stage, uint32_t budget_ms, const char *detail);
+/**
+ * @brief 段階の終了関数
+ * @param[in] token :supervisor_enter の戻り値
+ */
+void supervisor_leave(uint8_t token);
+/**
+ * @brief ウォッチドッグのリセット関数（長い待ちループの中で呼ぶ）
+ */
+void supervisor_feed(void);
+/**
+ * @brief 中断要求の確認関数
+ * @return true：実行中の段階が上限を超えた（待ちループを抜けて失敗として返す）
+ */
+bool supervisor_aborted(void);
+/**
+ * @brief 定期処理関数（loop の最初・接続待ちループの試行毎に呼ぶ。loop 1 周の計時・BG770 リセット要求の処理）
+ */
+void supervisor_task(void);
+/**
+ * @brief 統計取得関数
+ * @param[out] stats :統計
+ */
+void supervisor_get_stats(supervisor_stats_t *stats);
+/**
+ * @brief 記録のテキスト出力関数（シリアル・HTTP 用）
+ * @param[in] out :出力先
+ */
+void supervisor_dump(Print &out);
+
+#endif
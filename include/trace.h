@@ -0,0 +1,116 @@
+/**
+ * @file trace.h
+ * @version 0.1
+ * @brief AT 通信のバイナリトレース API
+ *
+ * 送受信行・状態遷移・結果コードを固定長レコードで RTC メモリ上のリングに記録する。
+ * RTC_NOINIT 領域に置くのでソフトリセット・ウォッチドッグリセット後も残る。
+ * 記録は String を使わず数十サイクルで終わるため、常時有効のまま運用できる。
+ * 内容はシリアル・HTTP(/trace)・MQTT(障害後の再接続時) で取り出す。
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef TRACE_H
+#define TRACE_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief レコード数（RTC メモリ 8KB のうち約 3KB を使用） */
+#define TRACE_RECORDS       96
+/** @brief 1 レコードに保存する行の長さ */
+#define TRACE_TEXT_SIZE     24
+/** @brief MQTT で 1 回に送るレコード数（Base64 後 PUBLISH_SIZE に収まる数） */
+#define TRACE_BLOB_RECORDS  32
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief レコード種別 */
+typedef enum e_trace_type
+{
+  /** @brief 起動（code：リセット要因） */
+  TRACE_BOOT = 0,
+  /** @brief コマンド送信 */
+  TRACE_TX,
+  /** @brief 応答受信 */
+  TRACE_RX,
+  /** @brief URC 受信 */
+  TRACE_URC,
+  /** @brief 初期化シーケンスの遷移（code：インデックス） */
+  TRACE_STEP,
+  /** @brief コマンド結果（code：api_status_t） */
+  TRACE_RESULT,
+  /** @brief BG770 リセット */
+  TRACE_RESET,
+  /** @brief 状態遷移（code：bg770_states_t） */
+  TRACE_STATE,
+  /** @brief 種別数 */
+  TRACE_TYPE_MAX,
+} trace_type_t;
+
+/** @brief レコード（32 バイト固定） */
+typedef struct st_trace_record
+{
+  /** @brief 時刻[us] */
+  uint32_t time;
+  /** @brief 種別 */
+  uint8_t type;
+  /** @brief コード（種別毎の意味） */
+  uint8_t code;
+  /** @brief 元の行の長さ */
+  uint16_t length;
+  /** @brief 行の先頭部分（NULL 終端とは限らない） */
+  char text[TRACE_TEXT_SIZE];
+} trace_record_t;
+
+/**************************************************************************************************
+ * GLOBAL FUNCTIONS
+ */
+/**
+ * @brief トレース初期化関数（リセット前の記録が有効なら引き継ぐ）
+ */
+void trace_init(void);
+/**
+ * @brief レコード追加関数
+ * @param[in] type :種別
+ * @param[in] code :コード
+ * @param[in] text :行（NULL可）
+ */
+void trace_record(trace_type_t type, uint8_t code, const char *text);
+/**
+ * @brief 障害マーク関数（次回接続時に MQTT で送る）
+ */
+void trace_mark_failure(void);
+/**
+ * @brief 障害後の送信待ち確認関数
+ * @return true：送信待ちあり
+ */
+bool trace_failure_pending(void);
+/**
+ * @brief 障害後の送信待ちを解除する関数
+ */
+void trace_clear_failure(void);
+/**
+ * @brief テキスト出力関数（シリアル・HTTP 用）
+ * @param[in] out :出力先
+ */
+void trace_dump(Print &out);
+/**
+ * @brief MQTT 用 Base64 ブロック作成関数
+ * @param[out] buf :格納先
+ * @param[in] size :格納先サイズ
+ * @param[in] block :ブロック番号（0 が最古）
+ * @return 作成した長さ（ブロックが無い場合は 0）
+ */
+uint16_t trace_build_blob(char *buf, uint16_t size, uint8_t block);
+
+#endif
@@ -0,0 +1,140 @@
+/**
+ * @file tsdb.h
+ * @version 0.1
+ * @brief 時系列データの保存（フラッシュ上の追記専用ストア）API
+ *
+ * "tsdb" パーティション（partitions_16MB.csv）を 4KB のブロックに分け、リングとして追記する。
+ * 一杯になったら最も古いブロックを消去して再利用し、TSDB_RETENTION_S を過ぎたブロックも消去する。
+ * ブロック形式（リトルエンディアン）
+ *   ヘッダ（16 byte）: magic "TSDB" | seq(4) | t_first(4) | version(1) | 予約(3)
+ *   レコード       : LEN(1) | series(varint) | dt(varint) | dv(zigzag varint)
+ *                    dt は直前のレコード（先頭は t_first）からの秒、dv は同じブロック内の同じ series の
+ *                    直前値（先頭は 0）からの差分。LEN = 0xFF（消去状態）でデータ終わり。
+ *   フッタ（末尾 8 byte）: t_last(4) | length(2) | 予約(2)（ブロックを閉じた時に書く）
+ * ブロック毎の seq / t_first / t_last は起動時にヘッダ・フッタから RAM に索引として読み込む。
+ *
+ * 範囲要求（tsdb_query_start）は [t0,t1] に掛かるブロックを古い順に、ヘッダを含む生データのまま
+ * TSDB_CHUNK_SIZE 毎に Base64 にして送信待ちに積む。
+ *   {"ts":{"q":<id>,"b":<seq>,"o":<offset>,"n":<length>,"d":"<base64>"}}
+ *   {"ts":{"q":<id>,"end":<blocks>[,"bulk":<batches>]}}
+ *
+ * 範囲に掛かるデータ量が bulk_min_bytes（config.h）以上で bulk_url が設定されていれば、MQTT の代わりに
+ * 最大 TSDB_BULK_BLOCKS ブロックずつモデムの UFS にファイルとして書き（AT+QFOPEN・AT+QFWRITE を
+ * TSDB_BULK_WRITE_SIZE 毎に 1 回の tsdb_task で 1 つ）、AT+QHTTPPOSTFILE で 1 回の POST にする。
+ * POST の結果は URC で受けるので、その間も MQTT の送受信は止まらない。ブロックはそのまま（Base64 無し）送る。
+ *   POST <path>  X-Tsdb-Query: <id>  X-Tsdb-Device: <IMSI>  Content-Type: application/octet-stream
+ *   本文 : ( length(2) | ブロックの生データ[length] ) x ブロック数
+ * 書き込み・POST の失敗、2xx 以外、TSDB_BULK_TIMEOUT_MS 超過の場合は、残りを MQTT で送る。
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef TSDB_H
+#define TSDB_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <stdbool.h>
+#include <stdint.h>
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief パーティション名 */
+#define TSDB_PARTITION_LABEL  "tsdb"
+/** @brief ブロック長（フラッシュの消去単位） */
+#define TSDB_BLOCK_SIZE       4096
+/** @brief ブロックヘッダ長 */
+#define TSDB_HEADER_SIZE      16
+/** @brief ブロックフッタ長 */
+#define TSDB_FOOTER_SIZE      8
+/** @brief ブロック形式のバージョン */
+#define TSDB_VERSION          1
+/** @brief 1 ブロック内の series 数の上限（超えたらブロックを閉じる） */
+#define TSDB_SERIES_MAX       64
+/** @brief 保存期間[s] */
+#define TSDB_RETENTION_S      (30UL * 24 * 3600)
+/** @brief 範囲要求の 1 メッセージあたりの生データ長（Base64 で 4/3 倍） */
+#define TSDB_CHUNK_SIZE       960
+/** @brief 範囲要求の送信中に空けておく送信待ち数 */
+#define TSDB_QUERY_BACKLOG    4
+/** @brief 範囲要求の送信期限[ms] */
+#define TSDB_QUERY_DEADLINE_MS 60000
+/** @brief HTTP 一括送信にする未送信データ量の既定値[byte]（config の bulk_min_bytes） */
+#define TSDB_BULK_MIN_BYTES   16384
+/** @brief HTTP 一括送信の 1 回の POST のブロック数 */
+#define TSDB_BULK_BLOCKS      8
+/** @brief HTTP 一括送信の 1 回のファイル書き込み長 */
+#define TSDB_BULK_WRITE_SIZE  1024
+/** @brief HTTP 一括送信の POST の結果を待つ時間[ms] */
+#define TSDB_BULK_TIMEOUT_MS  120000
+/** @brief HTTP 一括送信のファイル名（UFS） */
+#define TSDB_BULK_FILE        "tsdb_bulk.bin"
+
+/** @brief Sub-GHz ノードのチャンネルの series */
+#define TSDB_SERIES_SUBGHZ(node, ch)  (((uint32_t)(node) << 2) | (ch))
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief 統計 */
+typedef struct st_tsdb_stats
+{
+  /** @brief ブロック数（0：パーティション無し） */
+  uint16_t blocks;
+  /** @brief 使用中のブロック数 */
+  uint16_t used;
+  /** @brief 保存したサンプル数 */
+  uint32_t appended;
+  /** @brief 保存できなかったサンプル数（時刻未取得・パーティション無し） */
+  uint32_t dropped;
+  /** @brief 容量・保存期間で消去したブロック数 */
+  uint32_t erased;
+  /** @brief 最も古いサンプルの時刻 */
+  uint32_t oldest;
+  /** @brief 最も新しいサンプルの時刻 */
+  uint32_t newest;
+  /** @brief HTTP 一括送信した POST 数 */
+  uint32_t bulk_batches;
+  /** @brief HTTP 一括送信したデータ量[byte] */
+  uint32_t bulk_bytes;
+  /** @brief HTTP 一括送信から MQTT に戻した数 */
+  uint32_t bulk_fallbacks;
+} tsdb_stats_t;
+
+/**************************************************************************************************
+ * GLOBAL FUNCTIONS
+ */
+/**
+ * @brief 初期化関数（パーティションを探し、ブロックの索引を読み込む）
+ * @return true：成功 false：パーティション無し
+ */
+bool tsdb_init(void);
+/**
+ * @brief サンプル追加関数
+ * @param[in] series :系列
+ * @param[in] time :UTC 時刻[s]（0 は保存しない）
+ * @param[in] value :値
+ * @return true：保存した
+ */
+bool tsdb_append(uint32_t series, uint32_t time, int32_t value);
+/**
+ * @brief 範囲要求の開始関数（送信中の要求は打ち切る。URC の処理中から呼び出し可）
+ * @param[in] id :要求 ID（応答にそのまま入れる）
+ * @param[in] t0 :開始時刻[s]
+ * @param[in] t1 :終了時刻[s]
+ */
+void tsdb_query_start(uint32_t id, uint32_t t0, uint32_t t1);
+/**
+ * @brief 定期処理関数（loop から呼ぶ。保存期間切れの消去、範囲要求の送信・HTTP 一括送信）
+ * @param[in] now :現在の UTC 時刻[s]（0：未取得）
+ */
+void tsdb_task(uint32_t now);
+/**
+ * @brief 統計取得関数
+ * @param[out] stats :統計
+ */
+void tsdb_get_stats(tsdb_stats_t *stats);
+
+#endif
@@ -0,0 +1,88 @@
+/**
+ * @file uplink.h
+ * @version 0.1
+ * @brief 送信経路の選択 API（MQTT / UDP / 確認応答付き UDP）
+ *
+ * メッセージ種別毎に送信経路を選ぶ。
+ * UDP は初期化シーケンスで AT+QIOPEN 済みの SORACOM Unified Endpoint ソケット（connect id 0）を
+ * そのまま使うため、追加のアタッチ手順は無い。
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef UPLINK_H
+#define UPLINK_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include "bg770.h"
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief 確認応答の待ち時間[ms] */
+#define UPLINK_ACK_TIMEOUT_MS  3000
+/** @brief 確認応答が無い場合の再送回数 */
+#define UPLINK_ACK_RETRY       2
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief メッセージ種別の型 */
+typedef enum e_uplink_class
+{
+  /** @brief 操作・状態通知（コンソール/スイッチ） */
+  UPLINK_CLASS_CONTROL = 0,
+  /** @brief 高頻度で欠損を許容するセンサーデータ（Sub-GHz/CAN） */
+  UPLINK_CLASS_TELEMETRY,
+  /** @brief 欠損を許容しない重要データ */
+  UPLINK_CLASS_IMPORTANT,
+  /** @brief デバイスシャドウ更新（MQTT 固定、モノの名前毎の更新TOPIC に送信） */
+  UPLINK_CLASS_SHADOW,
+  /** @brief 種別数 */
+  UPLINK_CLASS_MAX,
+} uplink_class_t;
+
+/** @brief 送信経路の型 */
+typedef enum e_uplink_transport
+{
+  /** @brief MQTT（AT+QMTPUB、QoS1） */
+  UPLINK_TRANSPORT_MQTT = 0,
+  /** @brief UDP 送りっぱなし（AT+QISEND） */
+  UPLINK_TRANSPORT_UDP,
+  /** @brief UDP + アプリケーション層の確認応答 */
+  UPLINK_TRANSPORT_UDP_ACK,
+} uplink_transport_t;
+
+/**************************************************************************************************
+ * GLOBAL FUNCTIONS
+ */
+/**
+ * @brief 送信経路の設定関数
+ * @param[in] cls :メッセージ種別
+ * @param[in] transport :送信経路
+ */
+void uplink_set_transport(uplink_class_t cls, uplink_transport_t transport);
+/**
+ * @brief 送信経路の取得関数
+ * @param[in] cls :メッセージ種別
+ * @return 送信経路
+ */
+uplink_transport_t uplink_get_transport(uplink_class_t cls);
+/**
+ * @brief パブリッシュ関数（Publish_payload / Publish_length の内容を送信）
+ *
+ * UDP ソケットが閉じている場合は MQTT で送信する。
+ * MQTT はテレメトリをバルクレーン、それ以外を制御レーンで送る（mqtt_lane.h）。
+ * 確認応答付き UDP は {"seq":<n>,"d":<payload>} で送信し、応答に "ack":<n> が含まれるまで
+ * UPLINK_ACK_RETRY 回まで再送、それでも応答が無ければ MQTT(QoS1) で送り直す。
+ * @param[in] cls :メッセージ種別
+ * @return API_STATUS_SUCCESS：送信成功
+ *         API_STATUS_FAIL：モデムエラー（リセットが必要）
+ */
+api_status_t uplink_publish(uplink_class_t cls);
+
+#endif
@@ -18,9 +18,15 @@
 #include "setup_define.h"
 #include <WiFi.h>
 #include <WebServer.h>
-
-bool lan_red_state = false;
-bool lan_green_state = false;
+#include "diag.h"
+#include "trace.h"
+#include "modem_capture.h"
+#include "loadgen.h"
+#include "shadow.h"
+#include "dashboard.h"
+#include "power.h"
+#include "config.h"
+#include "supervisor.h"
 
 void initWifi(){
   /*アクセスポイントとしてESP32を設定*/
@@ -33,23 +39,38 @@ void initWifi(){
   /*ルートパスにアクセスがあったときのハンドラを設定*/
   server.on("/", handleRoot); 
   server.on("/wifi", handleWifi);
-  server.on("/led",handleLed);
-  server.on("/red_led_on", handleRedLedOn);
-  server.on("/green_led_on", handleGreenLedOn);
-  server.on("/led_off", handleLedOff);
+  server.on("/led", handleDashboard);
+  server.on("/api/status", handleApiStatus);
+  server.on("/api/led", handleApiLed);
+  server.on("/api/config", handleApiConfig);
+  server.on("/events", handleEvents);
+  server.on("/diag", handleDiag);
+  server.on("/trace", handleTrace);
+  server.on("/capture", handleCapture);
+  server.on("/loadgen", handleLoadgen);
+  /*ダッシュボードのキャッシュ確認用*/
+  const char *headers[] = {"If-None-Match"};
+  server.collectHeaders(headers, 1);
 
   server.begin();
   Serial.println("Server bigin");
 }
-void handleRoot() {
+/*トップページ作成*/
+String buildRootPage() {
   String html = "<html><body>";
   html += "<p><a href=\"/wifi\"><button>WiFi設定</button></a></p>";
-  html += "<p><a href=\"/led\"><button>LED点灯</button></a></p>";
+  html += "<p><a href=\"/led\"><button>ダッシュボード</button></a></p>";
+  html += "<p><a href=\"/diag\"><button>診断</button></a></p>";
   html += "</body></html>";
-  server.send(200, "text/html; charset=UTF-8", html);
+  return html;
+}
+void handleRoot() {
+  power_set(POWER_STATE_BURST);
+  server.send(200, "text/html; charset=UTF-8", buildRootPage());
 }
 
 void handleWifi(){
+  power_set(POWER_STATE_BURST);
   /*リクエストがPOSTの場合*/
   if (server.method() == HTTP_POST) { 
     /*クライアントから送信されたSSIDとパスワードを取得*/
@@ -59,13 +80,17 @@ void handleWifi(){
     /*新しいSSIDとパスワードが設定されている場合*/
     if (new_ssid != "" && new_password != "") { 
       /*新しいSSIDとパスワードでWiFiに接続*/
+      /* 接続待ちは HTTP の上限より長い */
+      uint8_t stage = supervisor_enter(SUPERVISOR_STAGE_HTTP, SUPERVISOR_WIFI_MS, "/wifi");
       WiFi.begin(new_ssid.c_str(), new_password.c_str()); 
       int attempts = 0;
-      while (WiFi.status() != WL_CONNECTED && attempts < 20) { 
+      while (WiFi.status() != WL_CONNECTED && attempts < 20 && !supervisor_aborted()) { 
         delay(1000); 
+        supervisor_feed();
         Serial.println("Connecting to WiFi..."); 
         attempts++;
       }
+      supervisor_leave(stage);
       if(WiFi.status() == WL_CONNECTED) {
         Serial.println("Connected to the WiFi network");
       } else {
@@ -76,10 +101,6 @@ void handleWifi(){
       }
     }
   }
-  /*HTMLフォームを作成*/
-  String html = "<!DOCTYPE html><html><body><form method=\"post\">"; 
-  /*SSIDを選択するためのセレクトボックスを作成*/
-  html += "SSID:<br><select name=\"ssid\">"; 
   /*利用可能なネットワークをスキャン*/
   int n = WiFi.scanNetworks(); 
   /*SSIDを保存するベクターを作成*/
@@ -89,10 +110,23 @@ void handleWifi(){
     /*重複しないSSIDのみ追加*/
     if (std::find(unique_ssids.begin(), unique_ssids.end(), ssid) == unique_ssids.end()) { 
       unique_ssids.push_back(ssid); 
-      html += "<option value=\"" + ssid + "\">" + ssid + "</option>"; 
     }
   }
 
+  /*HTTPレスポンスとしてHTMLフォームを送信*/
+  server.send(200, "text/html; charset=UTF-8", buildWifiPage(unique_ssids)); 
+  
+}
+/*WiFi設定ページ作成*/
+String buildWifiPage(const std::vector<String> &ssids) {
+  /*HTMLフォームを作成*/
+  String html = "<!DOCTYPE html><html><body><form method=\"post\">"; 
+  /*SSIDを選択するためのセレクトボックスを作成*/
+  html += "SSID:<br><select name=\"ssid\">"; 
+  for (size_t i = 0; i < ssids.size(); ++i) { 
+    html += "<option value=\"" + ssids[i] + "\">" + ssids[i] + "</option>"; 
+  }
+
   /*セレクトボックスの終了タグを追加*/
   html += "</select><br>"; 
   /*パスワードを入力するためのテキストボックスを作成*/
@@ -104,55 +138,133 @@ void handleWifi(){
   /*フォームとHTMLの終了タグを追加*/
   html += "</form></body></html>"; 
 
-  /*HTTPレスポンスとしてHTMLフォームを送信*/
-  server.send(200, "text/html; charset=UTF-8", html); 
-  
+  return html;
 }
-/*LED点灯ボタンが押された場合の処理*/
-void handleLed() {
-  String html = "<html><body>";
-  html += "<h1>LED点灯ページ</h1>";
-  html += "<p><a href=\"/red_led_on\"><button>RED_LED_ON</button></a></p>";
-  html += "<p><a href=\"/green_led_on\"><button>GREEN_LED_ON</button></a></p>";
-  html += "<p><a href=\"/led_off\"><button>LED_OFF</button></a></p>";
-  html += "<p><a href=\"/\"><button>Return to Top Page</button></a></p>";
-  html += "</body></html>";
-  server.send(200, "text/html; charset=UTF-8", html);
+/*ダッシュボード（gzip済み・キャッシュ可）を返す*/
+void handleDashboard() {
+  power_set(POWER_STATE_BURST);
+  const char *etag = dashboard_etag();
+  server.sendHeader("ETag", etag);
+  server.sendHeader("Cache-Control", "max-age=" + String(DASHBOARD_MAX_AGE));
+  if (server.header("If-None-Match") == etag) {
+    server.send(304);
+    return;
+  }
+  size_t length;
+  const uint8_t *page = dashboard_page(&length);
+  server.sendHeader("Content-Encoding", "gzip");
+  server.send_P(200, "text/html; charset=UTF-8", (const char *)page, length);
+}
+/*状態をJSONで返す*/
+void handleApiStatus() {
+  power_set(POWER_STATE_BURST);
+  char json[DASHBOARD_STATUS_SIZE];
+  dashboard_build_status(json, sizeof(json));
+  server.send(200, "application/json", json);
+}
+/*LEDを設定して状態をJSONで返す(POST ?led=lan|wan&color=red|green|off)*/
+void handleApiLed() {
+  power_set(POWER_STATE_BURST);
+  if (server.method() != HTTP_POST) {
+    server.send(405, "application/json", "{\"error\":\"POST only\"}");
+    return;
+  }
+  String led = server.arg("led");
+  shadow_color_t color;
+  if (((led != "lan") && (led != "wan")) || !shadow_parse_color(server.arg("color").c_str(), &color)) {
+    server.send(400, "application/json", "{\"error\":\"led=lan|wan&color=red|green|off\"}");
+    return;
+  }
+  shadow_set_led((led == "wan") ? SHADOW_LED_WAN : SHADOW_LED_LAN, color);
+  handleApiStatus();
+}
+/*実行時設定を返す・更新する(POST 本文 {"version":n,"<key>":<値>,...})*/
+void handleApiConfig() {
+  power_set(POWER_STATE_BURST);
+  char json[PUBLISH_SIZE];
+  if (server.method() != HTTP_POST) {
+    config_build_json(json, sizeof(json));
+    server.send(200, "application/json", json);
+    return;
+  }
+  const char *key;
+  config_result_t result = config_update(server.arg("plain").c_str(), &key);
+  config_build_result(json, sizeof(json), result, key);
+  int code = 200;
+  if (result == CONFIG_RESULT_STALE) { code = 409; }
+  if (result == CONFIG_RESULT_INVALID) { code = 400; }
+  if (result == CONFIG_RESULT_NVS_ERROR) { code = 500; }
+  server.send(code, "application/json", json);
 }
-/*LAN_RED_ONが押された場合の処理*/
-void handleRedLedOn() {
-  LAN_RED_ON();
-  lan_red_state = true;
-  if (lan_green_state) {
-    LAN_GREEN_OFF();
-    lan_green_state = false;
+/*状態の変化をServer-Sent Eventsで配信（応答は閉じずにdashboard_taskが送る）*/
+void handleEvents() {
+  if (!dashboard_add_client(server.client())) {
+    server.send(503, "text/plain", "too many clients");
   }
-  server.sendHeader("Location", "/led");
-  server.send(303);
 }
-/*LAN_RED_OFFが押された場合の処理*/
-void handleGreenLedOn() {
-  LAN_GREEN_ON();
-  lan_green_state = true;
-  if (lan_red_state) {
-    LAN_RED_OFF();
-    lan_red_state = false;
+/*診断値（ヒープ・スタック）をJSONで返す*/
+void handleDiag() {
+  power_set(POWER_STATE_BURST);
+  char json[256];
+  diag_build_json(json, sizeof(json));
+  server.send(200, "application/json", json);
+}
+/*HTTPのチャンク送信用出力先*/
+class ChunkPrint : public Print {
+public:
+  size_t write(uint8_t c) {
+    buf[len++] = (char)c;
+    if (len == sizeof(buf)) { flush(); }
+    return 1;
+  }
+  void flush() {
+    if (len != 0) { server.sendContent(buf, len); len = 0; }
   }
-  server.sendHeader("Location", "/led");
-  server.send(303);
+private:
+  char buf[256];
+  size_t len = 0;
+};
+/*ATトレースをテキストで返す*/
+void handleTrace() {
+  power_set(POWER_STATE_BURST);
+  ChunkPrint out;
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "text/plain", "");
+  trace_dump(out);
+  supervisor_dump(out);
+  out.flush();
+  server.sendContent("");
 }
-/*LAN_OFFが押された場合の処理*/
-void handleLedOff() {
-  if (lan_red_state) {
-    LAN_RED_OFF();
-    lan_red_state = false;
+/*BG770通信の記録をバイナリで返す*/
+void handleCapture() {
+  uint32_t length;
+  const uint8_t *data = modem_capture_data(&length);
+  if (data == NULL) {
+    server.send(404, "text/plain", "capture disabled");
+    return;
   }
-  if (lan_green_state) {
-    LAN_GREEN_OFF();
-    lan_green_state = false;
+  server.setContentLength(length);
+  server.send(200, "application/octet-stream", "");
+  for (uint32_t ptr = 0; ptr < length; ptr += 1024) {
+    server.sendContent((const char *)&data[ptr], (length - ptr < 1024) ? (length - ptr) : 1024);
+  }
+}
+/*負荷試験の開始(?count=&size=&rate=&class=)・停止(?stop)・結果取得*/
+void handleLoadgen() {
+  power_set(POWER_STATE_BURST);
+  if (server.hasArg("stop")) {
+    loadgen_stop();
+  } else if (server.hasArg("count")) {
+    loadgen_config_t config = {0, 256, 0, LOADGEN_CLASS};
+    config.count = server.arg("count").toInt();
+    if (server.hasArg("size")) { config.size = server.arg("size").toInt(); }
+    if (server.hasArg("rate")) { config.rate = server.arg("rate").toInt(); }
+    if (server.hasArg("class")) { config.cls = (uplink_class_t)server.arg("class").toInt(); }
+    loadgen_start(&config);
   }
-  server.sendHeader("Location", "/led");
-  server.send(303);
+  char json[200];
+  loadgen_build_report(json, sizeof(json));
+  server.send(200, "application/json", json);
 }
 /*エラーページ送信*/
 void sendErrorPage(String message) {
@@ -0,0 +1,265 @@
+/**
+ * @file at_response.cpp
+ * @version 0.1
+ * @brief BG770 応答行の分類器と宣言的応答文法の照合
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <string.h>
+#include "at_response.h"
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief 分類表のサイズ（2 のべき乗。キー数の 2 倍以上） */
+#define AT_KEY_TABLE_SIZE 128
+/** @brief キーの最大長（接頭辞は「:」まで） */
+#define AT_KEY_MAX_LENGTH 24
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief 分類表のエントリ */
+typedef struct st_at_key
+{
+  /** @brief 接頭辞（「:」より前）または行全体 */
+  const char *key;
+  /** @brief 種別 */
+  at_token_t token;
+} at_key_t;
+
+/**************************************************************************************************
+ * LOCAL VARIABLES
+ */
+/** @brief 分類キー一覧 */
+static const at_key_t at_keys[] = {
+    {"0", AT_TOKEN_OK},
+    {"OK", AT_TOKEN_OK},
+    {"4", AT_TOKEN_ERROR},
+    {"ERROR", AT_TOKEN_ERROR},
+    {"+CME ERROR", AT_TOKEN_ERROR},
+    {"> ", AT_TOKEN_PROMPT},
+    {">", AT_TOKEN_PROMPT},
+    {"APP RDY", AT_TOKEN_APP_RDY},
+    {"NORMAL POWER DOWN", AT_TOKEN_NORMAL_POWER_DOWN},
+    {"POWERED DOWN", AT_TOKEN_POWERED_DOWN},
+    {"+CPIN", AT_TOKEN_CPIN},
+    {"+CSQ", AT_TOKEN_CSQ},
+    {"+COPS", AT_TOKEN_COPS},
+    {"+QIOPEN", AT_TOKEN_QIOPEN},
+    {"+QNTP", AT_TOKEN_QNTP},
+    {"+QMTOPEN", AT_TOKEN_QMTOPEN},
+    {"+QMTCONN", AT_TOKEN_QMTCONN},
+    {"+QMTSUB", AT_TOKEN_QMTSUB},
+    {"+QMTUNS", AT_TOKEN_QMTUNS},
+    {"+QMTPUB", AT_TOKEN_QMTPUB},
+    {"SEND OK", AT_TOKEN_SEND_OK},
+    {"SEND FAIL", AT_TOKEN_SEND_FAIL},
+    {"+QIRD", AT_TOKEN_QIRD},
+    {"1", AT_TOKEN_CONNECT},
+    {"CONNECT", AT_TOKEN_CONNECT},
+    {"+QHTTPGET", AT_TOKEN_QHTTPGET},
+    {"+QHTTPREAD", AT_TOKEN_QHTTPREAD},
+    {"+QFOPEN", AT_TOKEN_QFOPEN},
+    {"+QFWRITE", AT_TOKEN_QFWRITE},
+    {"+QMTRECV", AT_TOKEN_QMTRECV},
+    {"+QMTSTAT", AT_TOKEN_QMTSTAT},
+    {"+QMTPING", AT_TOKEN_QMTPING},
+    {"+QIURC", AT_TOKEN_QIURC},
+    {"+CEREG", AT_TOKEN_CEREG},
+    {"+CGREG", AT_TOKEN_CGREG},
+    {"+QIND", AT_TOKEN_QIND},
+    {"+QHTTPPOSTFILE", AT_TOKEN_QHTTPPOSTFILE},
+    {"RDY", AT_TOKEN_RDY},
+};
+/** @brief 分類表（ハッシュ値→at_keys のインデックス+1、0 は空き） */
+static uint8_t at_key_table[AT_KEY_TABLE_SIZE];
+/** @brief 分類表の初期化済みフラグ */
+static bool at_key_table_ready = false;
+/** @brief URC 通知先（種別毎） */
+static void (*urc_handlers[AT_TOKEN_MAX - AT_TOKEN_URC_FIRST])(const at_line_t *line);
+
+/**************************************************************************************************
+ * LOCAL FUNCTIONS
+ */
+/**
+ * @brief キーのハッシュ関数（FNV-1a）
+ * @param[in] key :キー
+ * @param[in] length :キー長
+ * @return ハッシュ値
+ */
+static uint32_t at_key_hash(const char *key, size_t length)
+{
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= (uint8_t)key[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+/**
+ * @brief キーの検索関数
+ * @param[in] key :キー
+ * @param[in] length :キー長
+ * @return 種別（未登録の場合 AT_TOKEN_UNKNOWN）
+ */
+static at_token_t at_key_lookup(const char *key, size_t length)
+{
+  uint32_t slot = at_key_hash(key, length) & (AT_KEY_TABLE_SIZE - 1);
+
+  /* 線形探索（表は疎なので平均 1 回で止まる） */
+  for (uint8_t probe = 0; probe < AT_KEY_TABLE_SIZE; probe++) {
+    uint8_t entry = at_key_table[slot];
+    if (0 == entry) {
+      break;
+    }
+    const at_key_t *p = &at_keys[entry - 1];
+    if ((0 == strncmp(p->key, key, length)) && ('\0' == p->key[length])) {
+      return p->token;
+    }
+    slot = (slot + 1) & (AT_KEY_TABLE_SIZE - 1);
+  }
+
+  return AT_TOKEN_UNKNOWN;
+}
+
+/*************************************************************************************************/
+void at_response_init(void)
+{
+  if (at_key_table_ready) {
+    return;
+  }
+  memset(at_key_table, 0, sizeof(at_key_table));
+  for (uint8_t i = 0; i < sizeof(at_keys) / sizeof(at_keys[0]); i++) {
+    uint32_t slot = at_key_hash(at_keys[i].key, strlen(at_keys[i].key)) & (AT_KEY_TABLE_SIZE - 1);
+    while (0 != at_key_table[slot]) {
+      slot = (slot + 1) & (AT_KEY_TABLE_SIZE - 1);
+    }
+    at_key_table[slot] = i + 1;
+  }
+  at_key_table_ready = true;
+}
+
+/*************************************************************************************************/
+void at_classify(const char *content, at_line_t *line)
+{
+  at_response_init();
+
+  line->content = content;
+  line->args = "";
+
+  /* 接頭辞の長さ（「:」まで）と数字のみかどうかを 1 回の走査で求める */
+  size_t length = 0;
+  size_t key_length = 0;
+  bool digits = true;
+  while ('\0' != content[length]) {
+    char c = content[length];
+    if ((0 == key_length) && (':' == c)) {
+      key_length = length;
+    }
+    if ((c < '0') || ('9' < c)) {
+      digits = false;
+    }
+    ++length;
+  }
+
+  if (0 == length) {
+    line->token = AT_TOKEN_UNKNOWN;
+    return;
+  }
+  /* 1 桁の数字は V0 形式の結果コード、2 桁以上は数値行（IMSI 等） */
+  if (digits && (1 < length)) {
+    line->token = AT_TOKEN_NUMBER;
+    line->args = content;
+    return;
+  }
+
+  if (0 != key_length) {
+    line->args = &content[key_length + 1];
+    if (' ' == *line->args) {
+      ++line->args;
+    }
+  } else {
+    key_length = length;
+  }
+
+  if (AT_KEY_MAX_LENGTH < key_length) {
+    line->token = AT_TOKEN_UNKNOWN;
+    return;
+  }
+  line->token = at_key_lookup(content, key_length);
+}
+
+/*************************************************************************************************/
+void at_set_urc_handler(at_token_t token, void (*handler)(const at_line_t *line))
+{
+  if ((AT_TOKEN_URC_FIRST <= token) && (token < AT_TOKEN_MAX)) {
+    urc_handlers[token - AT_TOKEN_URC_FIRST] = handler;
+  }
+}
+
+/*************************************************************************************************/
+bool at_dispatch_urc(const at_line_t *line)
+{
+  if (line->token < AT_TOKEN_URC_FIRST) {
+    return false;
+  }
+  void (*handler)(const at_line_t *line) = urc_handlers[line->token - AT_TOKEN_URC_FIRST];
+  if (NULL != handler) {
+    handler(line);
+  }
+  return true;
+}
+
+/*************************************************************************************************/
+api_status_t at_response_match(const at_response_grammar_t *grammar, at_response_state_t *state, const char *content)
+{
+  at_line_t line;
+  at_classify(content, &line);
+  ++state->lines;
+
+  if (state->step < grammar->step_count) {
+    const at_response_step_t *p_step = &grammar->steps[state->step];
+
+    if (p_step->token == line.token) {
+      /* 期待行と一致（引数条件・キャプチャも確認） */
+      bool ok = (NULL == p_step->args) || (0 == strcmp(p_step->args, line.args));
+      if (ok && (NULL != p_step->capture)) {
+        ok = p_step->capture(&line);
+      }
+      if (ok) {
+        ++state->step;
+        return (state->step >= grammar->step_count) ? API_STATUS_SUCCESS : API_STATUS_IN_PROGRESS;
+      }
+      return (NULL != grammar->on_fail) ? grammar->on_fail(&line) : API_STATUS_FAIL;
+    }
+  }
+
+  /* エラー行 */
+  if ((AT_TOKEN_ERROR == line.token) ||
+      ((AT_TOKEN_NONE != grammar->error_token) && (grammar->error_token == line.token))) {
+    return (NULL != grammar->on_fail) ? grammar->on_fail(&line) : API_STATUS_FAIL;
+  }
+
+  /* 割り込んだ URC は失敗扱いにせず配送する */
+  if (at_dispatch_urc(&line)) {
+    return API_STATUS_IN_PROGRESS;
+  }
+
+  if (NULL != grammar->on_other) {
+    grammar->on_other(&line);
+    return API_STATUS_IN_PROGRESS;
+  }
+  if (0 != (grammar->flags & AT_GRAMMAR_IGNORE_UNKNOWN)) {
+    return API_STATUS_IN_PROGRESS;
+  }
+
+  return (NULL != grammar->on_fail) ? grammar->on_fail(&line) : API_STATUS_FAIL;
+}
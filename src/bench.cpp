@@ -0,0 +1,250 @@
+/**
+ * @file bench.cpp
+ * @version 0.1
+ * @brief 文字列・ペイロード処理のマイクロベンチマーク
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "bench.h"
+#include "bg770.h"
+#include "setup_define.h"
+#ifndef BENCH_NATIVE
+#include <vector>
+#include "CK_1540_01.h"
+#include "dashboard.h"
+#endif
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief 計測対象の受信行（サブスクライブ） */
+#define BENCH_QMTRECV_LINE  "+QMTRECV: 0,1,\"" SUBSCRIBE_TOPIC "\",\"{\"command\":\"000\",\"color\":\"RED\"}\""
+/** @brief 受信行の区切り数（bg770.cpp の BG770_SUB_PAYLOAD_INDEX と同じ） */
+#define BENCH_SPLIT_INDEX   4
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief 計測項目 */
+typedef struct st_bench_case
+{
+  /** @brief 項目名 */
+  const char *name;
+  /** @brief 計測対象（1 回分） */
+  void (*run)(void);
+} bench_case_t;
+
+/** @brief 受信行を繰り返し返すストリーム（bg770_RxDataGet 計測用） */
+class BenchStream : public Stream
+{
+public:
+  int available(void) { return 1; }
+  int read(void)
+  {
+    uint8_t c = (uint8_t)line[index];
+    index = (index + 1) % (sizeof(line) - 1);
+    return c;
+  }
+  int peek(void) { return (uint8_t)line[index]; }
+  size_t write(uint8_t c) { return 1; }
+  void flush(void) {}
+
+private:
+  const char line[sizeof("\r\n" BENCH_QMTRECV_LINE "\r")] = "\r\n" BENCH_QMTRECV_LINE "\r";
+  size_t index = 0;
+};
+
+/**************************************************************************************************
+ * LOCAL VARIABLES
+ */
+/** @brief 確保回数（リンク時ラップで加算） */
+static volatile uint32_t alloc_count = 0;
+/** @brief 確保バイト数（リンク時ラップで加算） */
+static volatile uint32_t alloc_bytes = 0;
+/** @brief 最適化で計測対象が消えないよう結果を受ける変数 */
+static volatile uint32_t sink = 0;
+/** @brief 受信行ストリーム */
+static BenchStream bench_stream;
+
+/*************************************************************************************************/
+#ifdef BENCH_WRAP_ALLOC
+/* -Wl,--wrap=malloc -Wl,--wrap=realloc で全ての確保をここに通す */
+extern "C" void *__real_malloc(size_t size);
+extern "C" void *__real_realloc(void *ptr, size_t size);
+
+extern "C" void *__wrap_malloc(size_t size)
+{
+  ++alloc_count;
+  alloc_bytes += size;
+  return __real_malloc(size);
+}
+
+extern "C" void *__wrap_realloc(void *ptr, size_t size)
+{
+  if (0 != size) {
+    ++alloc_count;
+    alloc_bytes += size;
+  }
+  return __real_realloc(ptr, size);
+}
+#endif
+
+/*************************************************************************************************/
+static void bench_split(void)
+{
+  String dst[BENCH_SPLIT_INDEX];
+  split(BENCH_QMTRECV_LINE, ',', dst, BENCH_SPLIT_INDEX);
+  sink += dst[BENCH_SPLIT_INDEX - 1].length();
+}
+
+/*************************************************************************************************/
+static void bench_rxdata_analize(void)
+{
+  sink += RxData_Analize(BENCH_QMTRECV_LINE).length();
+}
+
+/*************************************************************************************************/
+static void bench_rxdata_get(void)
+{
+  /* 空行と受信行を 1 回ずつ読む */
+  sink += bg770_RxDataGet().length();
+  sink += bg770_RxDataGet().length();
+}
+
+/*************************************************************************************************/
+static void bench_create_command(void)
+{
+  sink += (uint32_t)(uintptr_t)create_command_cops();
+  sink += (uint32_t)(uintptr_t)create_command_qmtopen();
+  sink += (uint32_t)(uintptr_t)create_command_qmtconn();
+  sink += (uint32_t)(uintptr_t)create_command_qmtsub();
+  sink += (uint32_t)(uintptr_t)create_command_qmtpub();
+}
+
+/*************************************************************************************************/
+static void bench_publish_build(void)
+{
+  StaticJsonDocument<200> doc;
+  String jsonString;
+  doc["command"] = "000";
+  doc["color"] = "RED";
+  serializeJson(doc, jsonString);
+  sink += publish_payload_build((char *)Publish_payload, jsonString);
+}
+
+/*************************************************************************************************/
+#ifndef BENCH_NATIVE
+static void bench_pages(void)
+{
+  static const std::vector<String> ssids = {"Pico3_AP_Sample", "office-2g", "office-5g"};
+  sink += buildRootPage().length();
+  sink += buildWifiPage(ssids).length();
+  char json[DASHBOARD_STATUS_SIZE];
+  sink += dashboard_build_status(json, sizeof(json));
+}
+#endif
+
+/** @brief 計測項目（基準値とは項目名で対応させる） */
+static const bench_case_t cases[] = {
+    {"split", bench_split},
+    {"RxData_Analize", bench_rxdata_analize},
+    {"bg770_RxDataGet", bench_rxdata_get},
+    {"create_command", bench_create_command},
+    {"publish_build", bench_publish_build},
+#ifndef BENCH_NATIVE
+    /* Web サーバー（WiFi）に依存するため実機のみ */
+    {"web_pages", bench_pages},
+#endif
+};
+/** @brief 計測項目数 */
+#define BENCH_CASE_COUNT  (sizeof(cases) / sizeof(cases[0]))
+
+/**
+ * @brief 1 項目の計測関数
+ * @param[in] c :計測項目
+ * @param[out] result :計測結果
+ */
+static void bench_measure(const bench_case_t *c, bench_result_t *result)
+{
+  /* 初回の静的確保を計測から外す */
+  c->run();
+
+  uint32_t count = alloc_count;
+  uint32_t bytes = alloc_bytes;
+  uint32_t best = UINT32_MAX;
+  /* 割り込み・他タスクの影響を除くため、最も速かった回の時間を採る */
+  for (uint8_t round = 0; round < BENCH_ROUNDS; round++) {
+    uint32_t start = ESP.getCycleCount();
+    for (uint16_t i = 0; i < BENCH_ITERATIONS; i++) {
+      c->run();
+    }
+    uint32_t cycles = ESP.getCycleCount() - start;
+    if (cycles < best) {
+      best = cycles;
+    }
+  }
+
+  result->ns_per_op = (uint32_t)((uint64_t)best * 1000 / ESP.getCpuFreqMHz() / BENCH_ITERATIONS);
+  result->bytes_per_op = (alloc_bytes - bytes) / BENCH_ITERATIONS / BENCH_ROUNDS;
+  result->allocs_per_op_x100 = (alloc_count - count) * 100 / BENCH_ITERATIONS / BENCH_ROUNDS;
+}
+
+/*************************************************************************************************/
+uint8_t bench_case_count(void) { return (uint8_t)BENCH_CASE_COUNT; }
+
+/*************************************************************************************************/
+const char *bench_case_name(uint8_t index) { return (index < BENCH_CASE_COUNT) ? cases[index].name : NULL; }
+
+/*************************************************************************************************/
+uint8_t bench_run(Print &out, const bench_result_t baseline[], bench_result_t results[])
+{
+  static_assert(BENCH_CASE_COUNT <= BENCH_CASE_MAX, "BENCH_CASE_MAX");
+  bench_result_t local[BENCH_CASE_MAX];
+  uint8_t failures = 0;
+
+  if (NULL == results) {
+    results = local;
+  }
+
+#ifndef BENCH_WRAP_ALLOC
+  out.println("bench: allocation counters disabled (build env:bench)");
+#endif
+  out.printf("%-16s %10s %8s %8s %10s\n", "case", "ns/op", "B/op", "alloc/op", "base ns");
+
+  /* 計測中は受信行を BenchStream から読む */
+  Stream *modem = bg770_get_stream();
+  bg770_set_stream(&bench_stream);
+
+  for (uint8_t i = 0; i < BENCH_CASE_COUNT; i++) {
+    bench_result_t *r = &results[i];
+    bench_measure(&cases[i], r);
+
+    /* 基準値の無い項目（ns_per_op が 0）は比較しない */
+    const bench_result_t *b = ((NULL != baseline) && (0 != baseline[i].ns_per_op)) ? &baseline[i] : NULL;
+    const char *verdict = "";
+    if (NULL != b) {
+      bool slower = ((uint64_t)r->ns_per_op * 100) > ((uint64_t)b->ns_per_op * (100 + BENCH_TOLERANCE_PCT));
+      bool more_alloc = (r->allocs_per_op_x100 > b->allocs_per_op_x100) || (r->bytes_per_op > b->bytes_per_op);
+      if (slower || more_alloc) {
+        verdict = " FAIL";
+        ++failures;
+      }
+    }
+    out.printf("%-16s %10lu %8lu %5lu.%02lu %10lu%s\n", cases[i].name, (unsigned long)r->ns_per_op,
+               (unsigned long)r->bytes_per_op, (unsigned long)(r->allocs_per_op_x100 / 100),
+               (unsigned long)(r->allocs_per_op_x100 % 100), (NULL != b) ? (unsigned long)b->ns_per_op : 0UL,
+               verdict);
+  }
+
+  bg770_set_stream(modem);
+
+  out.printf("bench: %s (%u regressions)\n", (0 == failures) ? "PASS" : "FAIL", failures);
+  return failures;
+}
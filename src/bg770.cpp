@@ -14,6 +14,13 @@
 #include <string.h>
 #include "CK_1540_01.h"
 #include "bg770.h"
+#include "at_response.h"
+#include "trace.h"
+#include "power.h"
+#include "config.h"
+#include "plmn.h"
+#include "mqtt_session.h"
+#include "supervisor.h"
 #include "ArduinoJson.h"
 #include "setup_define.h"
 
@@ -23,53 +30,133 @@
 /** @brief BG770のサブスクライブペイロード位置（+QMTRECV: <client_idx>,<msg_id>,<topic>,<payload>） */
 #define BG770_SUB_PAYLOAD_INDEX 4
 /** @brief コマンドの最大サイズ */
-#define COMMAND_SIZE 64
-
-/**************************************************************************************************
- * TYPEDEFS
- */
-/** @brief 基地局オペレータの型(eSIMの場合、IMSIの事業者コードと異なる) */
-typedef enum e_operator_states
-{
-  /** @brief ソフトバンク（事業者コード：44020） */
-  OPERATOR_SOFTBANK = 0,
-  /** @brief NTTドコモ（事業者コード：44010） */
-  OPERATOR_NTTDOCOMO,
-} operator_states_t;
+#define COMMAND_SIZE 96
+/** @brief UDP 受信データの最大サイズ */
+#define UDP_RX_SIZE 256
+/** @brief HTTP リクエスト（AT+QHTTPGET で送るヘッダ）の最大サイズ */
+#define HTTP_REQUEST_SIZE 256
+/** @brief AT+QHTTPPOSTFILE の応答待ち時間[s]（結果は +QHTTPPOSTFILE の URC で届く） */
+#define HTTP_POST_RSPTIME_S 80
+/** @brief Serial1 の受信バッファ[byte]（HTTP 読み出し中のフラッシュ書き込みで止まる間を受ける） */
+#define UART_RX_BUFFER 8192
 
 /**************************************************************************************************
  * LOCAL VARIABLES
  */
-/** @brief ゼロ */
-static const char *zero = "0";
 /**
  * @brief 初期化コマンドシーケンス
  *
  * この順序でコマンドを実行していく
  */
 static const command_executor_t init_command_sequence[] = {
-    {NULL, validate_response_ready,  10000, 0},
-    {create_command_bg770_setup, validate_response_bg770_setup,  300, 0},
-    {create_command_cpin, validate_response_cpin,  300, 0},
-    {create_command_cimi, validate_response_cimi,  300, 0},
-    {create_command_cgdcont, validate_response_ok,  300, 0},
-    {create_command_cops, validate_response_cops,  180000, 0},
-    {create_command_csq, validate_response_csq,  1000, 5000},
-    {create_command_qicsgp, validate_response_ok,  300, 0},
-    {create_command_qiact, validate_response_ok,  150000, 0},
-    {create_command_qiopen, validate_response_qiopen,  180000, 0},
-    {create_command_qmtopen, validate_response_qmtopen,  180000, 0},
-    {create_command_qmtconn, validate_response_qmtconn,  180000, 0},
-    {create_command_qmtsub, validate_response_qmtsub,  180000, 0},
+    {NULL, &response_ready,  10000, 0},
+    {create_command_bg770_setup, &response_bg770_setup,  300, 0},
+    {create_command_cpin, &response_cpin,  300, 0},
+    {create_command_cimi, &response_cimi,  300, 0},
+    {create_command_cgdcont, &response_ok,  300, 0},
+    {create_command_cops, &response_cops,  180000, 0},
+    {create_command_csq, &response_csq,  1000, 5000},
+    {create_command_qicsgp, &response_ok,  300, 0},
+    {create_command_qiact, &response_ok,  150000, 0},
+    {create_command_qiopen, &response_qiopen,  180000, 0},
+    {create_command_qmtopen, &response_qmtopen,  180000, 0},
+    {create_command_qmtconn, &response_qmtconn,  180000, 0},
+    {create_command_qmtsub, &response_qmtsub,  180000, 0},
+    {create_command_qmtsub_shadow, &response_qmtsub_shadow,  180000, 0},
+    {create_command_qmtsub_config, &response_qmtsub_config,  180000, 0},
     {NULL, NULL, 0}, /* 番兵 */
 };
+/** @brief 初期化シーケンスのタイムアウトの設定（init_command_sequence と同じ順序） */
+static const config_timeout_t init_command_timeout[] = {
+    CONFIG_TIMEOUT_READY,
+    CONFIG_TIMEOUT_AT,
+    CONFIG_TIMEOUT_AT,
+    CONFIG_TIMEOUT_AT,
+    CONFIG_TIMEOUT_AT,
+    CONFIG_TIMEOUT_COPS,
+    CONFIG_TIMEOUT_CSQ,
+    CONFIG_TIMEOUT_AT,
+    CONFIG_TIMEOUT_QIACT,
+    CONFIG_TIMEOUT_QIOPEN,
+    CONFIG_TIMEOUT_MQTT,
+    CONFIG_TIMEOUT_MQTT,
+    CONFIG_TIMEOUT_MQTT,
+    CONFIG_TIMEOUT_MQTT,
+    CONFIG_TIMEOUT_MQTT,
+    CONFIG_TIMEOUT_MAX, /* 番兵 */
+};
+static_assert(sizeof(init_command_timeout) / sizeof(init_command_timeout[0]) ==
+                  sizeof(init_command_sequence) / sizeof(init_command_sequence[0]),
+              "init_command_timeout");
 /** @brief 実行しているコマンドのインデックス */
 static uint16_t init_command_sequence_index;
 
-/** @brief 基地局オペレータ情報 */
-static operator_states_t saved_operator = OPERATOR_SOFTBANK;
-/** @brief 基地局オペレータ接続失敗フラグ */
-static uint8_t cops_err = false;
+#ifdef eSIMMODE
+/** @brief 基地局オペレータの既定の候補（eSIMの場合、IMSIの事業者コードと異なる。ソフトバンク・NTTドコモ） */
+static const char *const esim_operators[] = {"44020", "44010"};
+#endif
+/** @brief 基地局オペレータの選択中（plmn_begin 済み） */
+static bool plmn_cycle = false;
+/** @brief 基地局オペレータへの接続開始時刻 */
+static unsigned long cops_start;
+/** @brief 設定中の AT+QMTCFG の項目 */
+static mqtt_cfg_t mqtt_cfg_item = MQTT_CFG_VERSION;
+/** @brief 前回のセッションを使う（初期化シーケンスの AT+QMTSUB を省く） */
+static bool session_resumed = false;
+
+/** @brief MQTT コマンドの client idx */
+static uint8_t mqtt_client = 0;
+/** @brief AT+QMTPUB の msgID */
+static uint16_t mqtt_msgid = 1;
+/** @brief AT+QMTPUB のトピック（NULL：設定の pub_topic） */
+static const char *publish_topic = NULL;
+/** @brief NTP で取得した UTC 時刻[s]（0：未取得） */
+static uint32_t ntp_epoch = 0;
+/** @brief NTP で取得した時の millis() */
+static unsigned long ntp_millis = 0;
+
+/** @brief BG770 との通信ストリーム（通常は Serial1、記録・再生時は差し替え） */
+static Stream *modem = &Serial1;
+/** @brief 受信途中の行（<CR> が届くまで持ち越す） */
+static String rx_partial;
+/** @brief 「>」だけのプロンプトを返した（続く空白を読み捨てる） */
+static bool rx_prompt_space = false;
+/** @brief 通信統計 */
+static bg770_stats_t stats;
+/** @brief 初期化シーケンス開始時刻 */
+static unsigned long sequence_start;
+
+/** @brief UDP ソケット(connect id 0)のオープン状態 */
+static bool udp_socket_open = false;
+/** @brief UDP 受信通知（+QIURC: "recv",0）フラグ */
+static bool udp_recv_pending = false;
+/** @brief UDP 受信データ（AT+QIRD で読み出したもの） */
+static char udp_rx_data[UDP_RX_SIZE];
+/** @brief UDP 受信データ長 */
+static uint16_t udp_rx_length;
+/** @brief AT+QIRD で通知された読み出し長 */
+static uint16_t udp_rx_expected;
+
+/** @brief AT+QHTTPURL で送る URL */
+static const char *http_url = "";
+/** @brief AT+QHTTPGET で送るリクエスト */
+static char http_request[HTTP_REQUEST_SIZE];
+/** @brief AT+QHTTPGET で送るリクエスト長 */
+static uint16_t http_request_length = 0;
+/** @brief HTTP 応答コード（+QHTTPGET） */
+static uint16_t http_status = 0;
+/** @brief HTTP 応答の本文長（+QHTTPGET） */
+static uint32_t http_length = 0;
+/** @brief AT+QHTTPREAD の本文の読み出し関数 */
+static bool (*http_reader)(Stream *stream, uint32_t length) = NULL;
+/** @brief AT+QFOPEN・AT+QFDEL・AT+QHTTPPOSTFILE のファイル名（UFS:） */
+static const char *file_name = "";
+/** @brief AT+QFOPEN で開いたファイルハンドル */
+static uint32_t file_handle = 0;
+/** @brief AT+QFWRITE で書くデータ */
+static const uint8_t *file_data = NULL;
+/** @brief AT+QFWRITE で書くデータ長 */
+static uint16_t file_length = 0;
 
 /**************************************************************************************************
  * GLOBAL VARIABLES
@@ -85,6 +172,20 @@ uint16_t Publish_length;
 /** @brief BG770 の状態 */
 bg770_states_t bg_state;
 
+/**
+ * @brief ソケット通知（+QIURC）の処理関数
+ * @param[in] line :分類済みの行
+ */
+static void urc_qiurc(const at_line_t *line)
+{
+  /* +QIURC: "recv",<connectID> / +QIURC: "closed",<connectID> */
+  if (0 == strcmp(line->args, "\"recv\",0")) {
+    udp_recv_pending = true;
+  } else if (0 == strcmp(line->args, "\"closed\",0")) {
+    udp_socket_open = false;
+  }
+}
+
 /*************************************************************************************************/
 void bg770_init(void)
 {
@@ -92,6 +193,7 @@ void bg770_init(void)
   LAN_RED_ON();
   
   /* シリアル設定 */
+  Serial1.setRxBufferSize(UART_RX_BUFFER);
   Serial1.begin(115200, SERIAL_8N1, PORT_LTEUART_RXD, PORT_LTEUART_TXD);
   while (!Serial);  
   /* パワーオンシーケンス */
@@ -99,10 +201,19 @@ void bg770_init(void)
   delay(750);
   BG770_RESET_OFF();
 
+  /* 応答分類表の作成 */
+  at_response_init();
+  /* ソケット通知（UDP 受信・切断） */
+  at_set_urc_handler(AT_TOKEN_QIURC, urc_qiurc);
+  /* 基地局オペレータの接続結果（NVS） */
+  plmn_init();
+
   /* 各変数の初期化 */
   init_command_sequence_index = 0;
   rssi = 99;
   bg_state = BG770_STATE_INIT_COMMAND_SEQUENCE;
+  trace_record(TRACE_STATE, bg_state, NULL);
+  sequence_start = millis();
 
   Serial.println("BG770 Power on");
 }
@@ -115,22 +226,122 @@ api_status_t bg770_reset(void)
     LAN_RED_FLA(5,100);
     LAN_RED_ON();
 
+    /* 変更された接続先はリセット後の接続から使う */
+    config_link_apply();
     /* GPIO */
+    power_state_t power = power_set(POWER_STATE_WAIT);
     delay(1000);
     BG770_RESET_ON();
     delay(1000);
     BG770_RESET_OFF();
+    power_set(power);
     
-    /* 変数の初期化 */
+    /* 変数の初期化（初期化シーケンスは client idx 0 で接続する） */
+    ++stats.resets;
+    mqtt_client = 0;
+    mqtt_msgid = 1;
+    sequence_start = millis();
     init_command_sequence_index = 0;
+    plmn_cycle = false;
+    mqtt_session_closed();
+    udp_socket_open = false;
+    udp_recv_pending = false;
+    rx_partial = "";
+    rx_prompt_space = false;
     rssi = 99;
     bg_state = BG770_STATE_INIT_COMMAND_SEQUENCE;
   }
+  /* 次回接続時にトレースを送信する */
+  trace_record(TRACE_RESET, init_command_sequence_index, NULL);
+  trace_mark_failure();
   Serial.println("BG770 Reset");
 
   return API_STATUS_IN_PROGRESS;
 }
 
+/**
+ * @brief 再接続で再開する初期化シーケンスの位置の検索関数
+ * @return AT+CGDCONT の位置（見つからない場合は 0：最初から）
+ */
+static uint16_t reconnect_sequence_index(void)
+{
+  for (uint16_t i = 0; (NULL != init_command_sequence[i].response); i++) {
+    if (create_command_cgdcont == init_command_sequence[i].create_command_func) {
+      return i;
+    }
+  }
+  return 0;
+}
+
+/*************************************************************************************************/
+api_status_t bg770_reconnect(void)
+{
+  config_link_apply();
+  /* PDP の切断で MQTT・UDP の接続も閉じる（+QMTSTAT・+QIURC が届く） */
+  api_status_t result = execute(&qideact_command);
+  if (API_STATUS_SUCCESS != result) {
+    /* 切断できない場合は状態が分からないので、呼び出し側でリセットする */
+    Serial.println("BG770 Reconnect failed");
+    return result;
+  }
+
+  mqtt_client = 0;
+  mqtt_msgid = 1;
+  mqtt_session_closed();
+  udp_socket_open = false;
+  udp_recv_pending = false;
+  sequence_start = millis();
+  init_command_sequence_index = reconnect_sequence_index();
+  bg_state = BG770_STATE_INIT_COMMAND_SEQUENCE;
+  trace_record(TRACE_STATE, bg_state, NULL);
+  Serial.println("BG770 Reconnect");
+
+  return result;
+}
+
+/**
+ * @brief 初期化シーケンスの AT+QMTSUB の判定関数
+ * @param[in] p_executor :コマンド
+ * @return true：AT+QMTSUB
+ */
+static bool bg770_is_subscribe(const command_executor_t *p_executor)
+{
+  return (&response_qmtsub == p_executor->response) || (&response_qmtsub_shadow == p_executor->response) ||
+         (&response_qmtsub_config == p_executor->response);
+}
+
+/*************************************************************************************************/
+api_status_t bg770_resubscribe(void)
+{
+  for (uint16_t i = 0; (NULL != init_command_sequence[i].response); i++) {
+    if (!bg770_is_subscribe(&init_command_sequence[i])) {
+      continue;
+    }
+    command_executor_t executor = init_command_sequence[i];
+    executor.timeout = config_timeout(init_command_timeout[i], executor.timeout);
+    api_status_t result = execute(&executor);
+    if (API_STATUS_SUCCESS != result) {
+      return result;
+    }
+  }
+  mqtt_session_resubscribed();
+  Serial.println("BG770 Resubscribe");
+
+  return API_STATUS_SUCCESS;
+}
+
+/*************************************************************************************************/
+api_status_t bg770_mqtt_configure(void)
+{
+  api_status_t result = API_STATUS_SUCCESS;
+
+  for (uint8_t i = 0; (i < MQTT_CFG_MAX) && (API_STATUS_SUCCESS == result); i++) {
+    mqtt_cfg_item = (mqtt_cfg_t)i;
+    result = execute(&qmtcfg_command);
+  }
+  return result;
+}
+
 /*************************************************************************************************/
 api_status_t bg770_send_payload(const uint8_t payload[], uint16_t length)
 {
@@ -138,21 +349,229 @@ api_status_t bg770_send_payload(const uint8_t payload[], uint16_t length)
 
   uint16_t ptr = 0;
   while (ptr < length) {
-    Serial1.write(payload[ptr]);
+    modem->write(payload[ptr]);
     ++ptr;
   }
-  Serial1.write('\x1a');
+  modem->write('\x1a');
   result = API_STATUS_SUCCESS;
 
   return result;
 }
 
+/*************************************************************************************************/
+api_status_t bg770_send_data(const uint8_t payload[], uint16_t length)
+{
+  /* AT+QISEND は長さ指定なので終端(Ctrl+Z)を付けない */
+  modem->write(payload, length);
+
+  return API_STATUS_SUCCESS;
+}
+
+/*************************************************************************************************/
+void bg770_poll(void)
+{
+  /* コマンド実行外で届いた URC を配送する */
+  while (modem->available()) {
+    String content = bg770_RxDataGet();
+    if (content != "") {
+      at_line_t line;
+      at_classify(content.c_str(), &line);
+      at_dispatch_urc(&line);
+    }
+  }
+}
+
+/*************************************************************************************************/
+bool bg770_udp_is_open(void) { return udp_socket_open; }
+
+/*************************************************************************************************/
+void bg770_set_stream(Stream *stream)
+{
+  modem = (NULL != stream) ? stream : &Serial1;
+  rx_partial = "";
+  rx_prompt_space = false;
+}
+
+/*************************************************************************************************/
+Stream *bg770_get_stream(void) { return modem; }
+
+/*************************************************************************************************/
+void bg770_get_stats(bg770_stats_t *p_stats) { *p_stats = stats; }
+
+/*************************************************************************************************/
+void bg770_set_mqtt_client(uint8_t client, uint16_t msgid)
+{
+  mqtt_client = client;
+  mqtt_msgid = msgid;
+}
+
+/*************************************************************************************************/
+void bg770_set_publish_topic(const char *topic)
+{
+  publish_topic = topic;
+}
+
+/*************************************************************************************************/
+uint16_t bg770_udp_receive(char *buf, uint16_t size)
+{
+  if (!udp_recv_pending) {
+    return 0;
+  }
+  udp_recv_pending = false;
+  udp_rx_length = 0;
+  udp_rx_expected = 0;
+  if (API_STATUS_SUCCESS != execute(&udp_read_command)) {
+    return 0;
+  }
+
+  uint16_t length = (udp_rx_length < size) ? udp_rx_length : (uint16_t)(size - 1);
+  memcpy(buf, udp_rx_data, length);
+  buf[length] = '\0';
+
+  return length;
+}
+
+/*************************************************************************************************/
+api_status_t bg770_http_get(const char *url, uint32_t start, uint32_t length, uint16_t *status,
+                            uint32_t *content_length)
+{
+  /* http://<host>[:<port>]/<path>（https は未対応） */
+  static const char scheme[] = "http://";
+  if (0 != strncmp(url, scheme, sizeof(scheme) - 1)) {
+    return API_STATUS_FAIL;
+  }
+  const char *host = url + sizeof(scheme) - 1;
+  const char *path = strchr(host, '/');
+  int host_length = (NULL != path) ? (int)(path - host) : (int)strlen(host);
+  int n = snprintf(http_request, sizeof(http_request),
+                   "GET %s HTTP/1.1\r\nHost: %.*s\r\nRange: bytes=%lu-%lu\r\nConnection: close\r\n\r\n",
+                   (NULL != path) ? path : "/", host_length, host, (unsigned long)start,
+                   (unsigned long)(start + length - 1));
+  if ((n < 0) || (n >= (int)sizeof(http_request))) {
+    return API_STATUS_FAIL;
+  }
+  http_request_length = (uint16_t)n;
+  http_url = url;
+  http_status = 0;
+  http_length = 0;
+
+  api_status_t result = execute(&http_config_command);
+  if (API_STATUS_SUCCESS == result) {
+    result = execute(&http_url_command);
+  }
+  if (API_STATUS_SUCCESS == result) {
+    result = execute(&http_get_command);
+  }
+  *status = http_status;
+  *content_length = http_length;
+
+  return result;
+}
+
+/*************************************************************************************************/
+api_status_t bg770_http_read(bool (*reader)(Stream *stream, uint32_t length))
+{
+  http_reader = reader;
+  api_status_t result = execute(&http_read_command);
+  http_reader = NULL;
+
+  return result;
+}
+
+/*************************************************************************************************/
+api_status_t bg770_file_open(const char *name)
+{
+  file_name = name;
+  return execute(&file_open_command);
+}
+
+/*************************************************************************************************/
+api_status_t bg770_file_write(const uint8_t *data, uint16_t length)
+{
+  file_data = data;
+  file_length = length;
+  api_status_t result = execute(&file_write_command);
+  file_data = NULL;
+
+  return result;
+}
+
+/*************************************************************************************************/
+api_status_t bg770_file_close(void) { return execute(&file_close_command); }
+
+/*************************************************************************************************/
+api_status_t bg770_file_delete(const char *name)
+{
+  file_name = name;
+  return execute(&file_delete_command);
+}
+
+/*************************************************************************************************/
+api_status_t bg770_http_post_file(const char *url, const char *name)
+{
+  /* http://<host>[:<port>]/<path>（https は未対応。リクエストはファイルに書いてある） */
+  static const char scheme[] = "http://";
+  if (0 != strncmp(url, scheme, sizeof(scheme) - 1)) {
+    return API_STATUS_FAIL;
+  }
+  http_url = url;
+  file_name = name;
+
+  api_status_t result = execute(&http_config_command);
+  if (API_STATUS_SUCCESS == result) {
+    result = execute(&http_url_command);
+  }
+  if (API_STATUS_SUCCESS == result) {
+    result = execute(&http_post_file_command);
+  }
+
+  return result;
+}
+
 /*************************************************************************************************/
 int16_t bg770_get_rssi(void) { return rssi; }
 
+/*************************************************************************************************/
+uint32_t bg770_get_time(void)
+{
+  return (0 == ntp_epoch) ? 0 : (uint32_t)(ntp_epoch + (millis() - ntp_millis) / 1000);
+}
+
 /*************************************************************************************************/
 void bg770_get_imsi(char getimsi[16]) { strcpy(getimsi,imsi); }
 
+/**
+ * @brief 基地局オペレータの選択関数（AT+COPS の前に呼ぶ）
+ *
+ * 接続の最初に候補を用意し、必要ならネットワーク検索してから、未試行の中で順位が最も高い候補を選ぶ。
+ * @return true：選択した false：全候補が失敗（初期化シーケンスは失敗としてリセットする）
+ */
+static bool plmn_select_next(void)
+{
+  if (!plmn_cycle) {
+#ifdef eSIMMODE
+    plmn_begin(esim_operators, sizeof(esim_operators) / sizeof(esim_operators[0]));
+#else
+    /* SIM の事業者コード（IMSI の MCC + MNC） */
+    char home[6];
+    strncpy(home, imsi, 5);
+    home[5] = '\0';
+    const char *const seeds[] = {home};
+    plmn_begin(seeds, 1);
+#endif
+    plmn_cycle = true;
+  }
+  if (plmn_scan_due()) {
+    plmn_scan_done(API_STATUS_SUCCESS == execute(&cops_scan_command));
+  }
+  if (!plmn_select()) {
+    plmn_cycle = false;
+    return false;
+  }
+  cops_start = millis();
+  return true;
+}
+
 /*************************************************************************************************/
 api_status_t init_command_sequence_task(void)
 {
@@ -160,28 +579,62 @@ api_status_t init_command_sequence_task(void)
 
   const command_executor_t *p_executor = &init_command_sequence[init_command_sequence_index];
 
-  if ((NULL != p_executor->validate_response_func) || (NULL != p_executor->create_command_func)) {
+  if ((NULL != p_executor->response) || (NULL != p_executor->create_command_func)) {
+    bool cops = (CONFIG_TIMEOUT_COPS == init_command_timeout[init_command_sequence_index]);
+    if (cops && !plmn_select_next()) {
+      return API_STATUS_FAIL;
+    }
+    if (&response_qmtopen == p_executor->response) {
+      /* オープン前に client idx 0 の設定を送り、前回のセッションが使えるか決める */
+      if (API_STATUS_SUCCESS != bg770_mqtt_configure()) {
+        return API_STATUS_FAIL;
+      }
+      session_resumed = mqtt_session_resumable();
+    }
+    if (session_resumed && bg770_is_subscribe(p_executor)) {
+      /* ブローカーにサブスクライブが残っている */
+      ++init_command_sequence_index;
+      trace_record(TRACE_STEP, init_command_sequence_index, NULL);
+      return API_STATUS_IN_PROGRESS;
+    }
+    /* タイムアウト・ディレイは設定があれば置き換える */
+    command_executor_t executor = *p_executor;
+    executor.timeout = config_timeout(init_command_timeout[init_command_sequence_index], executor.timeout);
+    if ((CONFIG_TIMEOUT_CSQ == init_command_timeout[init_command_sequence_index]) &&
+        (0 != config_get()->csq_delay_ms)) {
+      executor.command_delay = config_get()->csq_delay_ms;
+    }
     /* コマンド実行 */
-    api_status_t result = execute(p_executor);
+    api_status_t result = execute(&executor);
 
     if ( result == API_STATUS_SUCCESS) {
+      if (cops) {
+        plmn_result(true, millis() - cops_start);
+        plmn_cycle = false;
+      } else if (CONFIG_TIMEOUT_CSQ == init_command_timeout[init_command_sequence_index]) {
+        plmn_signal(rssi);
+      }
       ++init_command_sequence_index;
+      trace_record(TRACE_STEP, init_command_sequence_index, NULL);
     }
     else if ( result == API_STATUS_COPS_ERROR ){
-        if ( false == cops_err ){
-            status = API_STATUS_IN_PROGRESS;
-            cops_err = true;
-        } else {
-            status = API_STATUS_FAIL;
-        }
+      /* 次の候補で再実行（候補が無くなったら次の呼び出しで失敗） */
+      plmn_result(false, millis() - cops_start);
     }
     else {
+      if (cops) {
+        /* タイムアウトも接続できなかった PLMN として記録する（リセット後に同じ PLMN から試さない） */
+        plmn_result(false, millis() - cops_start);
+      }
       status = API_STATUS_FAIL;
     }
   } else {
     /* 番兵に到達(処理終わり) */
     init_command_sequence_index = 0;
     bg_state = BG770_STATE_SUBSCRIBE;
+    trace_record(TRACE_STATE, bg_state, NULL);
+    stats.subscribe_ms = millis() - sequence_start;
+    mqtt_session_connected(session_resumed);
     status = API_STATUS_SUBSCRIBE;
   }
 
@@ -191,87 +644,88 @@ api_status_t init_command_sequence_task(void)
 /*************************************************************************************************/
 api_status_t execute(const command_executor_t *p_executor)
 {
+  /* 応答待ちの間はクロックを落とす（結果コードを失わないようにライトスリープはしない） */
+  power_state_t power = power_set(POWER_STATE_COMMAND);
+  const char *command = (NULL != p_executor->create_command_func) ? p_executor->create_command_func() : NULL;
+  /* 上限は応答待ちの timeout に余裕を足した時間（超えたら supervisor が中断・リセットする） */
+  uint8_t stage = supervisor_enter(SUPERVISOR_STAGE_MODEM,
+                                   p_executor->timeout + p_executor->command_delay + SUPERVISOR_MODEM_MARGIN_MS,
+                                   command);
+
   /* コマンド送信 */
-  if (NULL != p_executor->create_command_func) {
-    const char *p = p_executor->create_command_func();
+  if (NULL != command) {
+    const char *p = command;
 
-#ifdef DEBUG_PRINT
-    Serial.println("command:" + String(p));
-#endif
+    trace_record(TRACE_TX, 0, p);
 
     if (p_executor->command_delay != 0) {
       /*
        * コマンドディレイ処理
        * AT+CSQ
        * など、ネットワークコマンドを実行してから3秒以上は空けないと正しい情報が取得できない。
+       * 待ちはウォッチドッグ（SUPERVISOR_WDT_S）より長くなり得るので 1 秒毎にリセットする。
        */
-      delay(p_executor->command_delay);
+      for (uint32_t waited = 0; waited < p_executor->command_delay; waited += 1000) {
+        uint32_t rest = p_executor->command_delay - waited;
+        supervisor_feed();
+        delay((rest < 1000) ? rest : 1000);
+      }
     }
 
     while ('\0' != *p) {
       uint8_t data = *p;
-      Serial1.write(data);
+      modem->write(data);
       ++p;
     }
   }
 
   /* レスポンス受信 */
   api_status_t result = API_STATUS_IN_PROGRESS;
-  /* 受信カウント */
-  uint16_t times = 0;
+  /* 応答文法の照合状態 */
+  at_response_state_t state = {0, 0};
   /* タイムアウトカウント*/
   uint32_t timeout_count = 0;
 
   while (API_STATUS_IN_PROGRESS == result) {
-    if(Serial1.available()) {
+    if(modem->available()) {
       String content = bg770_RxDataGet();
       /* NULLを無視 */
       if(content != ""){
-        /* 受信カウントのインクリメント */
-        ++times;
-        /* String型からChar型へ変換(関数流用のため) */
-        const char *content_char = content.c_str();
-        /* 受信データ取得 */
-        result = p_executor->validate_response_func(content_char, times);
+        /* 応答文法と照合（割り込んだ URC は無視される） */
+        unsigned long line_start = micros();
+        result = at_response_match(p_executor->response, &state, content.c_str());
+        stats.line_us += micros() - line_start;
+        ++stats.lines;
       }
     }
-    if(timeout_count > p_executor->timeout){
+    if((timeout_count > p_executor->timeout) || supervisor_aborted()){
       result = API_STATUS_FAIL;
     }
     timeout_count++;
+    supervisor_feed();
     delay(1);
   }
+  trace_record(TRACE_RESULT, (uint8_t)result, NULL);
+  ++stats.commands;
+  supervisor_leave(stage);
+  power_set(power);
 
   return result;
 }
 
 /*************************************************************************************************/
-api_status_t validate_response_ok(const char *content, uint16_t times)
-{
-  api_status_t result = API_STATUS_FAIL;
-
-  if ((1 == times) && (0 == strcmp(content, zero))) {
-    result = API_STATUS_SUCCESS;
-  }
-
-  return result;
-}
+/** @brief 標準応答：<CR><LF>0<CR> */
+static const at_response_step_t steps_ok[] = {
+    {AT_TOKEN_OK, NULL, NULL},
+};
+const at_response_grammar_t response_ok = {steps_ok, 1, AT_TOKEN_NONE, 0, NULL, NULL};
 
 /*************************************************************************************************/
-api_status_t validate_response_ready(const char *content, uint16_t times)
-{
-  api_status_t result = API_STATUS_FAIL;
-
-  if(0 == strcmp(content, "APP RDY")){
-    result = API_STATUS_SUCCESS;    
-  } else if(0 == strcmp(content, "NORMAL POWER DOWN")){
-    result = API_STATUS_FAIL;
-  } else {
-    result = API_STATUS_IN_PROGRESS;
-  }
-
-  return result;
-}
+/** @brief 起動完了：APP RDY（NORMAL POWER DOWN は失敗、その他は無視） */
+static const at_response_step_t steps_ready[] = {
+    {AT_TOKEN_APP_RDY, NULL, NULL},
+};
+const at_response_grammar_t response_ready = {steps_ready, 1, AT_TOKEN_NORMAL_POWER_DOWN, AT_GRAMMAR_IGNORE_UNKNOWN, NULL, NULL};
 
 /*************************************************************************************************/
 const char *create_command_bg770_setup(void)
@@ -286,22 +740,8 @@ const char *create_command_bg770_setup(void)
 }
 
 /*************************************************************************************************/
-api_status_t validate_response_bg770_setup(const char *content, uint16_t times)
-{
-  api_status_t result = API_STATUS_FAIL;
-
-  /* デフォルト設定では1回目に Echo が返ってくる。 */
-  if (times <= 2) {
-    if (0 == strcmp(content, zero)) {
-      result = API_STATUS_SUCCESS;
-    } else {
-      /* Echo の内容は無視 */
-      result = API_STATUS_IN_PROGRESS;
-    }
-  }
-
-  return result;
-}
+/** @brief 初期設定：デフォルト設定では最初に Echo が返ってくるので未知の行は無視 */
+const at_response_grammar_t response_bg770_setup = {steps_ok, 1, AT_TOKEN_NONE, AT_GRAMMAR_IGNORE_UNKNOWN, NULL, NULL};
 
 /*************************************************************************************************/
 const char *create_command_cpin(void)
@@ -312,22 +752,17 @@ const char *create_command_cpin(void)
 }
 
 /*************************************************************************************************/
-api_status_t validate_response_cpin(const char *content, uint16_t times)
-{
-  api_status_t result = API_STATUS_FAIL;
-  /*
-   * <CR><LF>+CPIN: READY<CR><LF>0<CR>
-   * OR
-   * <CR><LF>ERROR<CR><LF>
-   */
-  if ((1 == times) && (0 == strcmp(content, "+CPIN: READY"))) {
-    result = API_STATUS_IN_PROGRESS;
-  } else if ((2 == times) && (0 == strcmp(content, zero))) {
-    result = API_STATUS_SUCCESS;
-  }
-
-  return result;
-}
+/**
+ * @brief SIM確認
+ * <CR><LF>+CPIN: READY<CR><LF>0<CR>
+ * OR
+ * <CR><LF>ERROR<CR><LF>
+ */
+static const at_response_step_t steps_cpin[] = {
+    {AT_TOKEN_CPIN, "READY", NULL},
+    {AT_TOKEN_OK, NULL, NULL},
+};
+const at_response_grammar_t response_cpin = {steps_cpin, 2, AT_TOKEN_NONE, 0, NULL, NULL};
 
 /*************************************************************************************************/
 const char *create_command_cimi(void)
@@ -344,85 +779,131 @@ const char *create_command_csq(void)
 }
 
 /*************************************************************************************************/
-api_status_t validate_response_csq(const char *content, uint16_t times)
+/**
+ * @brief RSSI キャプチャ
+ * <CR><LF>+CSQ: <rssi>,<ber><CR><LF>0<CR>
+ * rssi
+ *  0-31: -113 to -51 dbm
+ *    99: Not known or not detectable
+ * ber
+ *  0- 7: As RxQual values in the table in 3GPP TS 45.008 subclause 8.2.4
+ *    99: Not known or not detectable
+ */
+static bool capture_csq(const at_line_t *line)
 {
-  api_status_t result = API_STATUS_FAIL;
-  /*
-   * <CR><LF>+CSQ: <rssi>,<ber><CR><LF>0<CR>
-   * rssi
-   *  0-31: -113 to -51 dbm
-   *    99: Not known or not detectable
-   * ber
-   *  0- 7: As RxQual values in the table in 3GPP TS 45.008 subclause 8.2.4
-   *    99: Not known or not detectable
-   */
-
-  if ((1 == times) && (0 == strncmp(content, "+CSQ:", 5))) {
-    char *endptr;
-    long csq = (int16_t)strtol(&content[6], &endptr, 10);
-    if ((',' == *endptr) && ((99 == csq) || ((0 <= csq) && (csq <= 30)))) {
-      if (99 == csq) {
-        rssi = (int16_t)csq;
-      } else {
-        rssi = (int16_t)(2 * csq - 113);
-      }
-      result = API_STATUS_IN_PROGRESS;
-    }
-  } else if ((2 == times) && (0 == strcmp(content, zero))) {
-    result = API_STATUS_SUCCESS;
+  char *endptr;
+  long csq = (int16_t)strtol(line->args, &endptr, 10);
+  if ((',' != *endptr) || ((99 != csq) && ((csq < 0) || (30 < csq)))) {
+    return false;
   }
-
-  return result;
+  if (99 == csq) {
+    rssi = (int16_t)csq;
+  } else {
+    rssi = (int16_t)(2 * csq - 113);
+  }
+  return true;
 }
+static const at_response_step_t steps_csq[] = {
+    {AT_TOKEN_CSQ, NULL, capture_csq},
+    {AT_TOKEN_OK, NULL, NULL},
+};
+const at_response_grammar_t response_csq = {steps_csq, 2, AT_TOKEN_NONE, 0, NULL, NULL};
 
 /*************************************************************************************************/
-api_status_t validate_response_cimi(const char *content, uint16_t times)
+/**
+ * @brief IMSI キャプチャ
+ * <CR><LF><IMSI><CR><LF>0<CR>
+ */
+static bool capture_cimi(const at_line_t *line)
 {
-  api_status_t result = API_STATUS_FAIL;
-  /*
-   * <CR><LF><IMSI><CR><LF>0<CR>
-   */
-  if ((1 == times) && (15 == strlen(content))) {
-    /* IMSI */
-    strcpy(imsi, content);
-    Serial.println("IMSI:[" + String(imsi) + "]");
-    result = API_STATUS_IN_PROGRESS;
-  } else if ((2 == times) && (0 == strcmp(content, zero))) {
-    result = API_STATUS_SUCCESS;
+  if (15 != strlen(line->content)) {
+    return false;
   }
-
-  return result;
+  strcpy(imsi, line->content);
+  Serial.println("IMSI:[" + String(imsi) + "]");
+  return true;
 }
+static const at_response_step_t steps_cimi[] = {
+    {AT_TOKEN_NUMBER, NULL, capture_cimi},
+    {AT_TOKEN_OK, NULL, NULL},
+};
+const at_response_grammar_t response_cimi = {steps_cimi, 2, AT_TOKEN_NONE, 0, NULL, NULL};
 
 /*************************************************************************************************/
 const char *create_command_cgdcont(void)
 {
-  static const char *command = "AT+CGDCONT=1,\"IP\",\"soracom.io\"\r";
+  static char command[COMMAND_SIZE];
+  snprintf(command, COMMAND_SIZE, "AT+CGDCONT=1,\"IP\",\"%s\"\r", config_link()->apn);
   return command;
 }
 
 /*************************************************************************************************/
 const char *create_command_cops(void)
 {
-  static char command[] = "AT+COPS=1,2,\"00000\",8\r";
-#ifdef SIMMODE 
-  strncpy(&command[13], imsi, 5);
-#endif
-#ifdef eSIMMODE
-  if(saved_operator == OPERATOR_SOFTBANK){
-      strcpy(command,"AT+COPS=1,2,\"44020\",8\r");
-  }else{
-      strcpy(command,"AT+COPS=1,2,\"44010\",8\r");
-  }
-#endif
+  static char command[COMMAND_SIZE];
+  const plmn_entry_t *plmn = plmn_current();
+  snprintf(command, COMMAND_SIZE, "AT+COPS=1,2,\"%s\",%u\r", plmn->id, plmn->act);
+  return command;
+}
 
+/*************************************************************************************************/
+const char *create_command_cops_scan(void)
+{
+  static const char *command = "AT+COPS=?\r";
   return command;
 }
 
+/*************************************************************************************************/
+/**
+ * @brief ネットワーク検索結果キャプチャ
+ * <CR><LF>+COPS: (<stat>,"<long>","<short>","<numeric>",<AcT>),...,,(0,1,2,3,4),(0,1,2)<CR><LF>0<CR>
+ * 空の要素（,,）以降は対応モードの一覧なので読まない
+ */
+static bool capture_cops_scan(const at_line_t *line)
+{
+  const char *p = line->args;
+  while ('(' == *p) {
+    char *endptr;
+    long stat = strtol(p + 1, &endptr, 10);
+    /* 名前 2 つを飛ばして数字の PLMN を読む */
+    const char *q = endptr;
+    for (uint8_t i = 0; (i < 5) && (NULL != q); i++) {
+      q = strchr(q + 1, '"');
+    }
+    if ((',' != *endptr) || (NULL == q)) {
+      break;
+    }
+    const char *end = strchr(q + 1, '"');
+    if ((NULL == end) || ((end - q - 1) >= PLMN_ID_SIZE) || (',' != end[1])) {
+      break;
+    }
+    char id[PLMN_ID_SIZE];
+    memcpy(id, q + 1, end - q - 1);
+    id[end - q - 1] = '\0';
+    long act = strtol(end + 2, &endptr, 10);
+    plmn_scan_add(id, (uint8_t)stat, (uint8_t)act);
+
+    p = strchr(endptr, ')');
+    if ((NULL == p) || (',' != p[1])) {
+      break;
+    }
+    p += 2;
+  }
+  return true;
+}
+static const at_response_step_t steps_cops_scan[] = {
+    {AT_TOKEN_COPS, NULL, capture_cops_scan},
+    {AT_TOKEN_OK, NULL, NULL},
+};
+const at_response_grammar_t response_cops_scan = {steps_cops_scan, 2, AT_TOKEN_NONE, 0, NULL, NULL};
+
 /*************************************************************************************************/
 const char *create_command_qicsgp(void)
 {
-  static const char *command = "AT+QICSGP=1,1,\"soracom.io\",\"sora\",\"sora\",2\r";
+  static char command[COMMAND_SIZE];
+  const config_link_t *link = config_link();
+  snprintf(command, COMMAND_SIZE, "AT+QICSGP=1,1,\"%s\",\"%s\",\"%s\",2\r", link->apn, link->apn_user,
+           link->apn_pass);
   return command;
 }
 
@@ -448,21 +929,21 @@ const char *create_command_qiopen(void)
 }
 
 /*************************************************************************************************/
-api_status_t validate_response_qiopen(const char *content, uint16_t times)
+/**
+ * @brief ソケットオープン
+ * <CR><LF>0<CR><LF>+QIOPEN: 0,0<CR><LF>
+ * connect id は 0 固定とする
+ */
+static bool capture_qiopen(const at_line_t *line)
 {
-  api_status_t result = API_STATUS_FAIL;
-  /*
-   * <CR><LF>0<CR><LF>+QIOPEN: 0,0<CR><LF>
-   * connect id は 0 固定とする
-   */
-  if ((1 == times) && (0 == strcmp(content, zero))) {
-    result = API_STATUS_IN_PROGRESS;
-  } else if ((2 == times) && (0 == strcmp(content, "+QIOPEN: 0,0"))) {
-    result = API_STATUS_SUCCESS;
-  }
-
-  return result;
+  udp_socket_open = true;
+  return true;
 }
+static const at_response_step_t steps_qiopen[] = {
+    {AT_TOKEN_OK, NULL, NULL},
+    {AT_TOKEN_QIOPEN, "0,0", capture_qiopen},
+};
+const at_response_grammar_t response_qiopen = {steps_qiopen, 2, AT_TOKEN_NONE, 0, NULL, NULL};
 
 /*************************************************************************************************/
 const char *create_command_qpowd(void)
@@ -472,88 +953,126 @@ const char *create_command_qpowd(void)
 }
 
 /*************************************************************************************************/
-api_status_t validate_response_qpowd(const char *content, uint16_t times)
-{
-  api_status_t result = API_STATUS_FAIL;
-
-  if (1 == times) {
-    /* <CR><LF>OK<CR><LF> */
-    if (0 == strcmp(content, "OK")) {
-      result = API_STATUS_IN_PROGRESS;
-    }
-  } else if (2 == times) {
-    /* POWERED DOWN */
-    if (0 == strcmp(content, "POWERED DOWN")) {
-      result = API_STATUS_SUCCESS;
-    }
-  }
-  return result;
-}
+/** @brief パワーダウン：<CR><LF>OK<CR><LF> の後に POWERED DOWN */
+static const at_response_step_t steps_qpowd[] = {
+    {AT_TOKEN_OK, NULL, NULL},
+    {AT_TOKEN_POWERED_DOWN, NULL, NULL},
+};
+const at_response_grammar_t response_qpowd = {steps_qpowd, 2, AT_TOKEN_NONE, 0, NULL, NULL};
 
 
 /*************************************************************************************************/
-api_status_t validate_response_cops(const char *content, uint16_t times)
+/**
+ * @brief 基地局接続失敗時の処理
+ * 次回は次の順位のオペレータで接続を試みる（plmn.h）
+ */
+static api_status_t fail_cops(const at_line_t *line)
 {
-  api_status_t result = API_STATUS_FAIL;
+  return API_STATUS_COPS_ERROR;
+}
+const at_response_grammar_t response_cops = {steps_ok, 1, AT_TOKEN_NONE, 0, fail_cops, NULL};
 
-  if ((1 == times) && (0 == strcmp(content, zero))) {
-      result = API_STATUS_SUCCESS;
-  } else {
-      if ( saved_operator == OPERATOR_SOFTBANK ){ saved_operator = OPERATOR_NTTDOCOMO; }
-      else                                      { saved_operator = OPERATOR_SOFTBANK;  }
-      result = API_STATUS_COPS_ERROR;
+/*************************************************************************************************/
+const char *create_command_qmtcfg(void)
+{
+  static char command[COMMAND_SIZE + MQTT_WILL_TOPIC_SIZE];
+  const mqtt_profile_t *profile = mqtt_session_profile(mqtt_client);
+  char topic[MQTT_WILL_TOPIC_SIZE];
+
+  switch (mqtt_cfg_item) {
+  case MQTT_CFG_VERSION:
+    /* 4：MQTT 3.1.1 */
+    snprintf(command, sizeof(command), "AT+QMTCFG=\"version\",%u,4\r", mqtt_client);
+    break;
+  case MQTT_CFG_SESSION:
+    snprintf(command, sizeof(command), "AT+QMTCFG=\"session\",%u,%u\r", mqtt_client, profile->clean_session ? 1 : 0);
+    break;
+  case MQTT_CFG_KEEPALIVE:
+    snprintf(command, sizeof(command), "AT+QMTCFG=\"keepalive\",%u,%u\r", mqtt_client, profile->keepalive_s);
+    break;
+  case MQTT_CFG_TIMEOUT:
+    /* 再送を使い切っても +QMTSTAT は出さない（PUBACK 待ちのタイムアウトで扱う） */
+    snprintf(command, sizeof(command), "AT+QMTCFG=\"timeout\",%u,%u,%u,0\r", mqtt_client, profile->pkt_timeout_s,
+             profile->retries);
+    break;
+  default:
+    /* will_fg,will_qos,will_retain */
+    mqtt_session_will_topic(topic);
+    if (profile->will) {
+      snprintf(command, sizeof(command), "AT+QMTCFG=\"will\",%u,1,1,0,\"%s\",\"" MQTT_WILL_MESSAGE "\"\r",
+               mqtt_client, topic);
+    } else {
+      snprintf(command, sizeof(command), "AT+QMTCFG=\"will\",%u,0\r", mqtt_client);
+    }
+    break;
   }
-
-  return result;
+  return command;
 }
 
 /*************************************************************************************************/
 const char *create_command_qmtopen(void)
 {
-  static const char *command = "AT+QMTOPEN=0,\"beam.soracom.io\",1883\r";
+  static char command[COMMAND_SIZE];
+  snprintf(command, COMMAND_SIZE, "AT+QMTOPEN=%u,\"%s\",%lu\r", mqtt_client, config_link()->broker,
+           (unsigned long)config_link()->port);
   return command;
 }
 
-/*************************************************************************************************/
-api_status_t validate_response_qmtopen(const char *content, uint16_t times)
+/**
+ * @brief MQTT 結果の確認関数
+ * @param[in] line :分類済みの行
+ * @param[in] result :client idx に続く期待値
+ * @return true：実行中の client idx 宛てで期待値と一致
+ */
+static bool mqtt_result_is(const at_line_t *line, const char *result)
 {
-  api_status_t result = API_STATUS_FAIL;
-  /*
-   * <CR><LF>0<CR><LF>+QMTOPEN: 0,0<CR><LF>
-   * client idx は 0 固定とする
-   */
-  if ((1 == times) && (0 == strcmp(content, zero))) {
-    result = API_STATUS_IN_PROGRESS;
-  } else if ((2 == times) && (0 == strcmp(content, "+QMTOPEN: 0,0"))) {
-    result = API_STATUS_SUCCESS;
-  }
+  char expect[24];
+  snprintf(expect, sizeof(expect), "%u,%s", mqtt_client, result);
+  return (0 == strcmp(line->args, expect));
+}
 
-  return result;
+/*************************************************************************************************/
+/**
+ * @brief オープン結果確認（<result> が 0 なら成功）
+ * 追加レーン（client idx 1〜）の再接続では 2（オープン済み）も成功とする
+ */
+static bool capture_qmtopen(const at_line_t *line)
+{
+  return mqtt_result_is(line, "0") || ((0 != mqtt_client) && mqtt_result_is(line, "2"));
 }
+/**
+ * @brief MQTTサーバーオープン
+ * <CR><LF>0<CR><LF>+QMTOPEN: <client_idx>,0<CR><LF>
+ * client idx は bg770_set_mqtt_client で選択する（初期化シーケンスは 0）
+ */
+static const at_response_step_t steps_qmtopen[] = {
+    {AT_TOKEN_OK, NULL, NULL},
+    {AT_TOKEN_QMTOPEN, NULL, capture_qmtopen},
+};
+const at_response_grammar_t response_qmtopen = {steps_qmtopen, 2, AT_TOKEN_NONE, 0, NULL, NULL};
 
 /*************************************************************************************************/
 const char *create_command_qmtconn(void)
 {
-  static const char *command = "AT+QMTCONN=0,\"SampleClient\"\r";
+  static char command[COMMAND_SIZE];
+  char client_id[MQTT_CLIENT_ID_SIZE];
+  mqtt_session_client_id(mqtt_client, client_id);
+  snprintf(command, COMMAND_SIZE, "AT+QMTCONN=%u,\"%s\"\r", mqtt_client, client_id);
   return command;
 }
 
 /*************************************************************************************************/
-api_status_t validate_response_qmtconn(const char *content, uint16_t times)
-{
-  api_status_t result = API_STATUS_FAIL;
-  /*
-   * <CR><LF>0<CR><LF>+QMTCONN: 0,0,0<CR><LF>
-   * client idx は 0 固定とする
-   */
-  if ((1 == times) && (0 == strcmp(content, zero))) {
-    result = API_STATUS_IN_PROGRESS;
-  } else if ((2 == times) && (0 == strcmp(content, "+QMTCONN: 0,0,0"))) {
-    result = API_STATUS_SUCCESS;
-  }
-
-  return result;
-}
+/** @brief 接続結果確認（<result>,<ret_code> が 0,0 なら成功） */
+static bool capture_qmtconn(const at_line_t *line) { return mqtt_result_is(line, "0,0"); }
+/**
+ * @brief MQTTサーバー接続
+ * <CR><LF>0<CR><LF>+QMTCONN: <client_idx>,0,0<CR><LF>
+ */
+static const at_response_step_t steps_qmtconn[] = {
+    {AT_TOKEN_OK, NULL, NULL},
+    {AT_TOKEN_QMTCONN, NULL, capture_qmtconn},
+};
+const at_response_grammar_t response_qmtconn = {steps_qmtconn, 2, AT_TOKEN_NONE, 0, NULL, NULL};
 
 /*************************************************************************************************/
 const char *create_command_qmtsub(void)
@@ -562,28 +1081,65 @@ const char *create_command_qmtsub(void)
   static char command[COMMAND_SIZE];
   strncpy(command,"",COMMAND_SIZE);
   strcpy(command,"AT+QMTSUB=0,1,\"");
-  strcat(command,SUBSCRIBE_TOPIC);
+  strcat(command,config_link()->sub_topic);
   strcat(command,"\",1\r");
   return command;
 }
 
 /*************************************************************************************************/
-api_status_t validate_response_qmtsub(const char *content, uint16_t times)
+/**
+ * @brief サブスクライブ
+ * <CR><LF>0<CR><LF>+QMTSUB: 0,1,0,1<CR><LF>
+ * client idx は 0 ,msgID は 1, 固定とする
+ */
+static const at_response_step_t steps_qmtsub[] = {
+    {AT_TOKEN_OK, NULL, NULL},
+    {AT_TOKEN_QMTSUB, "0,1,0,1", NULL},
+};
+const at_response_grammar_t response_qmtsub = {steps_qmtsub, 2, AT_TOKEN_NONE, 0, NULL, NULL};
+
+/*************************************************************************************************/
+const char *create_command_qmtsub_shadow(void)
 {
-  api_status_t result = API_STATUS_FAIL;
-  /*
-   * <CR><LF>0<CR><LF>+QMTSUB: 0,1,0,1<CR><LF>
-   * client idx は 0 ,msgID は 1, 固定とする
-   */
-  if ((1 == times) && (0 == strcmp(content, zero))) {
-    result = API_STATUS_IN_PROGRESS;
-  } else if ((2 == times) && (0 == strcmp(content, "+QMTSUB: 0,1,0,1"))) {
-    result = API_STATUS_SUCCESS;
-  }
+  static char command[COMMAND_SIZE];
+  char topic[MQTT_SHADOW_TOPIC_SIZE];
+  mqtt_session_shadow_topic(SHADOW_DELTA_SUFFIX, topic);
+  snprintf(command, COMMAND_SIZE, "AT+QMTSUB=0,2,\"%s\",1\r", topic);
+  return command;
+}
 
-  return result;
+/*************************************************************************************************/
+/**
+ * @brief デバイスシャドウ差分のサブスクライブ
+ * <CR><LF>0<CR><LF>+QMTSUB: 0,2,0,1<CR><LF>
+ * client idx は 0 ,msgID は 2, 固定とする
+ */
+static const at_response_step_t steps_qmtsub_shadow[] = {
+    {AT_TOKEN_OK, NULL, NULL},
+    {AT_TOKEN_QMTSUB, "0,2,0,1", NULL},
+};
+const at_response_grammar_t response_qmtsub_shadow = {steps_qmtsub_shadow, 2, AT_TOKEN_NONE, 0, NULL, NULL};
+
+/*************************************************************************************************/
+const char *create_command_qmtsub_config(void)
+{
+  static char command[COMMAND_SIZE];
+  snprintf(command, COMMAND_SIZE, "AT+QMTSUB=0,3,\"%s\",1\r", CONFIG_TOPIC);
+  return command;
 }
 
+/*************************************************************************************************/
+/**
+ * @brief 設定更新のサブスクライブ
+ * <CR><LF>0<CR><LF>+QMTSUB: 0,3,0,1<CR><LF>
+ * client idx は 0 ,msgID は 3, 固定とする
+ */
+static const at_response_step_t steps_qmtsub_config[] = {
+    {AT_TOKEN_OK, NULL, NULL},
+    {AT_TOKEN_QMTSUB, "0,3,0,1", NULL},
+};
+const at_response_grammar_t response_qmtsub_config = {steps_qmtsub_config, 2, AT_TOKEN_NONE, 0, NULL, NULL};
+
 /*************************************************************************************************/
 const char *create_command_qmtuns(void)
 {
@@ -591,45 +1147,74 @@ const char *create_command_qmtuns(void)
   static char command[COMMAND_SIZE];
   strncpy(command,"",COMMAND_SIZE);
   strcpy(command,"AT+QMTUNS=0,1,\"");
-  strcat(command,SUBSCRIBE_TOPIC);
+  strcat(command,config_link()->sub_topic);
   strcat(command,"\"\r");
 
   return command;
 }
 
 /*************************************************************************************************/
-api_status_t validate_response_qmtuns(const char *content, uint16_t times)
+/**
+ * @brief サブスクライブ中止
+ * <CR><LF>0<CR><LF>+QMTUNS: 0,1,0<CR><LF>
+ * コマンド実行中にサブスクライブされた場合、「0」と「+QMTUNS: 0,1,0」の間に
+ * +QMTRECV が入力されるが、URC として配送されるので失敗にはならない
+ */
+static const at_response_step_t steps_qmtuns[] = {
+    {AT_TOKEN_OK, NULL, NULL},
+    {AT_TOKEN_QMTUNS, "0,1,0", NULL},
+};
+const at_response_grammar_t response_qmtuns = {steps_qmtuns, 2, AT_TOKEN_NONE, 0, NULL, NULL};
+
+/**
+ * @brief 受信途中の行の取り出し関数
+ * @return 行（受信途中の行は空にする）
+ */
+static String rx_take_line(void)
 {
-  api_status_t result = API_STATUS_FAIL;
-  /*
-   * <CR><LF>0<CR><LF>+QMTUNS: 0,1,0<CR><LF>
-   * 但し、コマンド実行中にサブスクライブされた場合、「0」と「+QMTUNS: 0,1,0」の間にデータが入力されるので、
-   * エラー処理はタイムアウトのみとする
-   */
-  if(0 == strcmp(content, "+QMTUNS: 0,1,0")){
-    result = API_STATUS_SUCCESS;
-  } else {
-    result = API_STATUS_IN_PROGRESS;
+  String content = rx_partial;
+  rx_partial = "";
+  /* NULLを無視 */
+  if(content != ""){
+    trace_record(TRACE_RX, 0, content.c_str());
   }
-
-  return result;
+  return content;
 }
 
 /*************************************************************************************************/
 String bg770_RxDataGet(){
-  String content = Serial1.readStringUntil('\r');
-  /* 改行の削除 */
-  content.replace("\r",""); content.replace("\0",""); content.replace("\n","");
-
-#ifdef DEBUG_PRINT
-  /* NULLを無視 */
-  if(content != ""){
-    /* 返答確認 */
-    Serial.println("content:[" + String(content) + "]");
+  /*
+   * 届いている分だけ読み、<CR> までそろった行を返す（途中までの行は次の呼び出しへ持ち越す）
+   * readStringUntil は行の途中で止まると Stream のタイムアウト(1 秒)まで待つので使わない
+   * <CR> の次は読まないので、行の後の生データ（AT+QIRD 等）はそのままストリームに残る
+   * データ入力のプロンプト「> 」は <CR> 無しで届くので、そろった時点で 1 行として返す
+   */
+  while (modem->available()) {
+    int c = modem->read();
+    if (rx_prompt_space) {
+      rx_prompt_space = false;
+      if (' ' == c) {
+        continue;
+      }
+    }
+    if ('\r' == c) {
+      return rx_take_line();
+    }
+    /* 改行の削除 */
+    if ((c > 0) && ('\n' != c)) {
+      rx_partial += (char)c;
+      if (rx_partial == "> ") {
+        return rx_take_line();
+      }
+    }
+  }
+  /* 「>」の後の空白がまだ届いていない */
+  if (rx_partial == ">") {
+    rx_prompt_space = true;
+    return rx_take_line();
   }
-#endif
 
-  return content;
+  return "";
 }
 
 /*************************************************************************************************/
@@ -662,34 +1247,382 @@ String RxData_Analize(String RxData){
     return payload;
 }
 
+/*************************************************************************************************/
+uint16_t publish_payload_build(char* buf,String jsonString)
+{
+  uint16_t len = 0;
+  /* message */
+  len += sprintf(buf,"%s",jsonString.c_str());
+
+  return len;
+}
+
 /*************************************************************************************************/
 const char *create_command_qmtpub(void)
 {
   static char command[COMMAND_SIZE];
-  strncpy(command,"",COMMAND_SIZE);
-  strcpy(command,"AT+QMTPUB=0,1,1,0,\"");
-  strcat(command,PUBLISH_TOPIC);
-  strcat(command,"\"\r");
+  snprintf(command, COMMAND_SIZE, "AT+QMTPUB=%u,%u,1,0,\"%s\"\r", mqtt_client, mqtt_msgid,
+           (NULL != publish_topic) ? publish_topic : config_link()->pub_topic);
 
   return command;
 }
 
 /*************************************************************************************************/
-api_status_t validate_response_qmtpub(const char *content, uint16_t times)
+/** @brief プロンプト受信でペイロードを送信 */
+static bool capture_qmtpub_prompt(const at_line_t *line)
 {
-  api_status_t result = API_STATUS_FAIL;
-  /*
-   * <CR><LF>0<CR><LF>+QIOPEN: 0,0<CR><LF>
-   * connect id は 0 固定とする
-   */
-  if ((1 == times) && (0 == strcmp(content, "> "))) {
-    bg770_send_payload(Publish_payload,Publish_length);
-    result = API_STATUS_IN_PROGRESS;
-  } else if ((2 == times) && (0 == strcmp(content, zero))) {
-    result = API_STATUS_IN_PROGRESS;
-  } else if ((3 == times) && (0 == strcmp(content, "+QMTPUB: 0,1,0"))) {
-    result = API_STATUS_SUCCESS;
+  bg770_send_payload(Publish_payload,Publish_length);
+  return true;
+}
+/** @brief PUBACK 確認（実行中の client idx・msgID で <result> が 0 なら成功） */
+static bool capture_qmtpub(const at_line_t *line)
+{
+  char result[16];
+  snprintf(result, sizeof(result), "%u,0", mqtt_msgid);
+  return mqtt_result_is(line, result);
+}
+/**
+ * @brief PUBACK 以外の +QMTPUB の処理
+ * 他の client idx 宛て（非同期送信の PUBACK）は URC として配送し、
+ * <result> 1（再送中）は最終結果を待つ
+ */
+static api_status_t fail_qmtpub(const at_line_t *line)
+{
+  if (AT_TOKEN_QMTPUB == line->token) {
+    char prefix[16];
+    int length = snprintf(prefix, sizeof(prefix), "%u,%u,", mqtt_client, mqtt_msgid);
+    if (0 != strncmp(line->args, prefix, length)) {
+      at_dispatch_urc(line);
+      return API_STATUS_IN_PROGRESS;
+    }
+    if ('1' == line->args[length]) {
+      return API_STATUS_IN_PROGRESS;
+    }
   }
+  return API_STATUS_FAIL;
+}
+/**
+ * @brief パブリッシュ
+ * <CR><LF>> <CR><LF>0<CR><LF>+QMTPUB: <client_idx>,<msgID>,0<CR><LF>
+ */
+static const at_response_step_t steps_qmtpub[] = {
+    {AT_TOKEN_PROMPT, NULL, capture_qmtpub_prompt},
+    {AT_TOKEN_OK, NULL, NULL},
+    {AT_TOKEN_QMTPUB, NULL, capture_qmtpub},
+};
+const at_response_grammar_t response_qmtpub = {steps_qmtpub, 3, AT_TOKEN_NONE, 0, fail_qmtpub, NULL};
 
-  return result;
+/**
+ * @brief パブリッシュ（PUBACK を待たない）
+ * <CR><LF>> <CR><LF>0<CR><LF>
+ * +QMTPUB: <client_idx>,<msgID>,<result> は後から URC として届く
+ */
+static const at_response_step_t steps_qmtpub_async[] = {
+    {AT_TOKEN_PROMPT, NULL, capture_qmtpub_prompt},
+    {AT_TOKEN_OK, NULL, NULL},
+};
+const at_response_grammar_t response_qmtpub_async = {steps_qmtpub_async, 2, AT_TOKEN_NONE, 0, NULL, NULL};
+
+/*************************************************************************************************/
+const char *create_command_qntp(void)
+{
+  static const char *command = "AT+QNTP=1,\"ntp.nict.jp\",123\r";
+  return command;
+}
+
+/*************************************************************************************************/
+/**
+ * @brief 暦日から 1970-01-01 からの日数への変換関数
+ * @param[in] y :年
+ * @param[in] m :月（1〜12）
+ * @param[in] d :日（1〜31）
+ * @return 日数
+ */
+static int32_t days_from_civil(int32_t y, uint32_t m, uint32_t d)
+{
+  y -= (m <= 2);
+  const int32_t era = ((y >= 0) ? y : (y - 399)) / 400;
+  const uint32_t yoe = (uint32_t)(y - era * 400);
+  const uint32_t doy = (153 * (m + ((m > 2) ? -3 : 9)) + 2) / 5 + d - 1;
+  const uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (int32_t)doe - 719468;
+}
+/** @brief NTP 結果確認（<err> が 0 なら "YYYY/MM/DD,hh:mm:ss±zz" を UTC で保持） */
+static bool capture_qntp(const at_line_t *line)
+{
+  unsigned int y, mo, d, h, mi, sec;
+  int tz = 0;
+  if (0 != strncmp(line->args, "0,", 2)) {
+    return false;
+  }
+  if (6 <= sscanf(&line->args[2], "\"%u/%u/%u,%u:%u:%u%d", &y, &mo, &d, &h, &mi, &sec, &tz)) {
+    /* <zz> は 15 分単位の時差 */
+    int32_t local = days_from_civil((int32_t)y, mo, d) * 86400 + (int32_t)(h * 3600 + mi * 60 + sec);
+    ntp_epoch = (uint32_t)(local - tz * 900);
+    ntp_millis = millis();
+  }
+  return true;
+}
+/**
+ * @brief NTPサーバー接続
+ * <CR><LF>0<CR><LF>+QNTP: <err>,<time><CR><LF>
+ */
+static const at_response_step_t steps_qntp[] = {
+    {AT_TOKEN_OK, NULL, NULL},
+    {AT_TOKEN_QNTP, NULL, capture_qntp},
+};
+const at_response_grammar_t response_qntp = {steps_qntp, 2, AT_TOKEN_NONE, 0, NULL, NULL};
+
+/*************************************************************************************************/
+const char *create_command_qisend(void)
+{
+  static char command[COMMAND_SIZE];
+  /* connect id 0（AT+QIOPEN で開いた SORACOM Unified Endpoint 向け UDP ソケット） */
+  snprintf(command, COMMAND_SIZE, "AT+QISEND=0,%u\r", Publish_length);
+  return command;
+}
+
+/*************************************************************************************************/
+/** @brief プロンプト受信でデータを送信（長さ指定のため終端無し） */
+static bool capture_qisend_prompt(const at_line_t *line)
+{
+  bg770_send_data(Publish_payload, Publish_length);
+  return true;
+}
+/**
+ * @brief UDP 送信
+ * <CR><LF>> <CR><LF>SEND OK<CR><LF>
+ * OR
+ * <CR><LF>SEND FAIL<CR><LF>
+ */
+static const at_response_step_t steps_qisend[] = {
+    {AT_TOKEN_PROMPT, NULL, capture_qisend_prompt},
+    {AT_TOKEN_SEND_OK, NULL, NULL},
+};
+const at_response_grammar_t response_qisend = {steps_qisend, 2, AT_TOKEN_SEND_FAIL, 0, NULL, NULL};
+
+/*************************************************************************************************/
+const char *create_command_qird(void)
+{
+  static char command[COMMAND_SIZE];
+  snprintf(command, COMMAND_SIZE, "AT+QIRD=0,%u\r", (unsigned)(UDP_RX_SIZE - 1));
+  return command;
+}
+
+/*************************************************************************************************/
+/**
+ * @brief 読み出し長キャプチャ・データの読み出し（+QIRD: <len>[,<remote IP>,<remote port>]）
+ * データは改行や「0」「OK」だけの行を含み得るので行単位では読まず、<len> バイトをそのまま読み出す
+ */
+static bool capture_qird(const at_line_t *line)
+{
+  udp_rx_expected = (uint16_t)strtoul(line->args, NULL, 10);
+  if (0 == udp_rx_expected) {
+    return true;
+  }
+  if (udp_rx_expected > (UDP_RX_SIZE - 1)) {
+    return false;
+  }
+  /* 行の <CR> の後に残っている <LF> は読み捨てる */
+  uint16_t got = 0;
+  if (1 != modem->readBytes(&udp_rx_data[0], 1)) {
+    return false;
+  }
+  if ('\n' != udp_rx_data[0]) {
+    got = 1;
+  }
+  got += (uint16_t)modem->readBytes(&udp_rx_data[got], udp_rx_expected - got);
+  udp_rx_length = got;
+  return (got == udp_rx_expected);
+}
+/**
+ * @brief UDP 受信データ読み出し
+ * <CR><LF>+QIRD: <len>,<ip>,<port><CR><LF><data><CR><LF>0<CR>
+ */
+static const at_response_step_t steps_qird[] = {
+    {AT_TOKEN_QIRD, NULL, capture_qird},
+    {AT_TOKEN_OK, NULL, NULL},
+};
+const at_response_grammar_t response_qird = {steps_qird, 2, AT_TOKEN_NONE, 0, NULL, NULL};
+
+/*************************************************************************************************/
+const char *create_command_qhttpcfg(void)
+{
+  /* 応答ヘッダは出力せず、リクエストヘッダ（Range）は自分で送る */
+  static const char *command =
+      "AT+QHTTPCFG=\"contextid\",1;+QHTTPCFG=\"requestheader\",1;+QHTTPCFG=\"responseheader\",0\r";
+  return command;
+}
+
+/*************************************************************************************************/
+const char *create_command_qhttpurl(void)
+{
+  static char command[COMMAND_SIZE];
+  snprintf(command, COMMAND_SIZE, "AT+QHTTPURL=%u,80\r", (unsigned)strlen(http_url));
+  return command;
+}
+
+/*************************************************************************************************/
+/** @brief CONNECT 受信で URL を送信 */
+static bool capture_qhttpurl_connect(const at_line_t *line)
+{
+  bg770_send_data((const uint8_t *)http_url, (uint16_t)strlen(http_url));
+  return true;
+}
+/**
+ * @brief URL 設定
+ * <CR><LF>1<CR>（CONNECT）<URL> <CR><LF>0<CR>
+ */
+static const at_response_step_t steps_qhttpurl[] = {
+    {AT_TOKEN_CONNECT, NULL, capture_qhttpurl_connect},
+    {AT_TOKEN_OK, NULL, NULL},
+};
+const at_response_grammar_t response_qhttpurl = {steps_qhttpurl, 2, AT_TOKEN_NONE, 0, NULL, NULL};
+
+/*************************************************************************************************/
+const char *create_command_qhttpget(void)
+{
+  static char command[COMMAND_SIZE];
+  snprintf(command, COMMAND_SIZE, "AT+QHTTPGET=80,%u\r", http_request_length);
+  return command;
+}
+
+/*************************************************************************************************/
+/** @brief CONNECT 受信でリクエストを送信 */
+static bool capture_qhttpget_connect(const at_line_t *line)
+{
+  bg770_send_data((const uint8_t *)http_request, http_request_length);
+  return true;
+}
+/** @brief 結果キャプチャ（+QHTTPGET: <err>[,<httprspcode>[,<content_length>]]、<err> が 0 なら成功） */
+static bool capture_qhttpget(const at_line_t *line)
+{
+  char *p;
+  if ((0 != strtoul(line->args, &p, 10)) || (',' != *p)) {
+    return false;
+  }
+  http_status = (uint16_t)strtoul(p + 1, &p, 10);
+  http_length = (',' == *p) ? strtoul(p + 1, NULL, 10) : 0;
+  return true;
+}
+/**
+ * @brief HTTP GET
+ * <CR><LF>1<CR>（CONNECT）<request> <CR><LF>0<CR><LF>+QHTTPGET: 0,206,<length><CR><LF>
+ */
+static const at_response_step_t steps_qhttpget[] = {
+    {AT_TOKEN_CONNECT, NULL, capture_qhttpget_connect},
+    {AT_TOKEN_OK, NULL, NULL},
+    {AT_TOKEN_QHTTPGET, NULL, capture_qhttpget},
+};
+const at_response_grammar_t response_qhttpget = {steps_qhttpget, 3, AT_TOKEN_NONE, 0, NULL, NULL};
+
+/*************************************************************************************************/
+const char *create_command_qhttpread(void)
+{
+  static const char *command = "AT+QHTTPREAD=80\r";
+  return command;
+}
+
+/*************************************************************************************************/
+/**
+ * @brief CONNECT 受信で本文を読み出す
+ * 本文は改行を含むバイナリなので行単位では読まず、+QHTTPGET の本文長だけ読み出し関数に渡す
+ */
+static bool capture_qhttpread_connect(const at_line_t *line)
+{
+  /* 詳細形式（CONNECT<CR><LF>）は LF まで読み捨てる。V0 形式（1<CR>）は直後から本文 */
+  if ((0 == strcmp(line->content, "CONNECT")) && ('\n' == modem->peek())) {
+    modem->read();
+  }
+  return (NULL != http_reader) && http_reader(modem, http_length);
+}
+/** @brief 読み出し結果確認（+QHTTPREAD: <err>、<err> が 0 なら成功） */
+static bool capture_qhttpread(const at_line_t *line) { return (0 == strcmp(line->args, "0")); }
+/**
+ * @brief HTTP 本文読み出し
+ * <CR><LF>1<CR>（CONNECT）<body><CR><LF>0<CR><LF>+QHTTPREAD: 0<CR><LF>
+ */
+static const at_response_step_t steps_qhttpread[] = {
+    {AT_TOKEN_CONNECT, NULL, capture_qhttpread_connect},
+    {AT_TOKEN_OK, NULL, NULL},
+    {AT_TOKEN_QHTTPREAD, NULL, capture_qhttpread},
+};
+const at_response_grammar_t response_qhttpread = {steps_qhttpread, 3, AT_TOKEN_NONE, 0, NULL, NULL};
+
+/*************************************************************************************************/
+const char *create_command_qfopen(void)
+{
+  /* モード 1：無ければ作り、有れば空にする */
+  static char command[COMMAND_SIZE];
+  snprintf(command, COMMAND_SIZE, "AT+QFOPEN=\"UFS:%s\",1\r", file_name);
+  return command;
+}
+
+/*************************************************************************************************/
+/** @brief ファイルハンドルキャプチャ（+QFOPEN: <filehandle>） */
+static bool capture_qfopen(const at_line_t *line)
+{
+  file_handle = strtoul(line->args, NULL, 10);
+  return true;
+}
+/**
+ * @brief ファイルオープン
+ * <CR><LF>+QFOPEN: <filehandle><CR><LF>0<CR>
+ */
+static const at_response_step_t steps_qfopen[] = {
+    {AT_TOKEN_QFOPEN, NULL, capture_qfopen},
+    {AT_TOKEN_OK, NULL, NULL},
+};
+const at_response_grammar_t response_qfopen = {steps_qfopen, 2, AT_TOKEN_NONE, 0, NULL, NULL};
+
+/*************************************************************************************************/
+const char *create_command_qfwrite(void)
+{
+  static char command[COMMAND_SIZE];
+  snprintf(command, COMMAND_SIZE, "AT+QFWRITE=%lu,%u\r", (unsigned long)file_handle, file_length);
+  return command;
+}
+
+/*************************************************************************************************/
+/** @brief CONNECT 受信でデータを送信 */
+static bool capture_qfwrite_connect(const at_line_t *line)
+{
+  bg770_send_data(file_data, file_length);
+  return true;
+}
+/** @brief 書き込み長確認（+QFWRITE: <written_length>,<total_length>） */
+static bool capture_qfwrite(const at_line_t *line) { return (file_length == strtoul(line->args, NULL, 10)); }
+/**
+ * @brief ファイル書き込み
+ * <CR><LF>1<CR>（CONNECT）<data><CR><LF>+QFWRITE: <written>,<total><CR><LF>0<CR>
+ */
+static const at_response_step_t steps_qfwrite[] = {
+    {AT_TOKEN_CONNECT, NULL, capture_qfwrite_connect},
+    {AT_TOKEN_QFWRITE, NULL, capture_qfwrite},
+    {AT_TOKEN_OK, NULL, NULL},
+};
+const at_response_grammar_t response_qfwrite = {steps_qfwrite, 3, AT_TOKEN_NONE, 0, NULL, NULL};
+
+/*************************************************************************************************/
+const char *create_command_qfclose(void)
+{
+  static char command[COMMAND_SIZE];
+  snprintf(command, COMMAND_SIZE, "AT+QFCLOSE=%lu\r", (unsigned long)file_handle);
+  return command;
+}
+
+/*************************************************************************************************/
+const char *create_command_qfdel(void)
+{
+  static char command[COMMAND_SIZE];
+  snprintf(command, COMMAND_SIZE, "AT+QFDEL=\"UFS:%s\"\r", file_name);
+  return command;
+}
+
+/*************************************************************************************************/
+const char *create_command_qhttppostfile(void)
+{
+  static char command[COMMAND_SIZE];
+  snprintf(command, COMMAND_SIZE, "AT+QHTTPPOSTFILE=\"UFS:%s\",%u\r", file_name, HTTP_POST_RSPTIME_S);
+  return command;
 }
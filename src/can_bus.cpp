@@ -0,0 +1,455 @@
+/**
+ * @file can_bus.cpp
+ * @version 0.1
+ * @brief CAN(TWAI) 受信・間引き・送信バッチ
+ *
+ * TWAI 割り込み → ドライバ受信キュー → 受信タスク（コア0）
+ *   → ID 表引き → 信号デコード → 間引き/変化検出 → ロックフリーキュー
+ *   → loop（コア1）で最新値にまとめて Publish_payload へ格納
+ * 数千フレーム/秒のバスでも LTE へは CAN_PUBLISH_MS 毎の差分だけを送る。
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <ctype.h>
+#include <string.h>
+#include <stdlib.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <driver/twai.h>
+#include "CK_1540_01.h"
+#include "spsc_queue.h"
+#include "rule.h"
+#include "can_bus.h"
+#include "diag.h"
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief ドライバ受信キュー長（割り込み→タスク） */
+#define CAN_DRIVER_RX_QUEUE     64
+/** @brief 値イベントキューの容量（2 のべき乗） */
+#define CAN_EVENT_QUEUE_SIZE    256
+/** @brief ID 表のサイズ（2 のべき乗） */
+#define CAN_ID_TABLE_SIZE       32
+/** @brief 受信タスクの待ち時間[ms] */
+#define CAN_POLL_MS             100
+/** @brief 受信タスクのスタックサイズ */
+#define CAN_TASK_STACK          4096
+/** @brief ID 表キーの拡張フレームビット */
+#define CAN_KEY_EXTENDED        0x80000000UL
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief ID 表のエントリ */
+typedef struct st_can_id_slot
+{
+  /** @brief 使用中フラグ */
+  bool used;
+  /** @brief キー（ID | 拡張ビット） */
+  uint32_t key;
+  /** @brief 信号表の先頭インデックス */
+  uint8_t first;
+  /** @brief 同じ ID の信号数 */
+  uint8_t count;
+} can_id_slot_t;
+
+/** @brief 信号毎の送信判定状態（受信タスク側） */
+typedef struct st_can_signal_state
+{
+  /** @brief 送信済みフラグ */
+  bool sent;
+  /** @brief 前回送信値 */
+  int32_t value;
+  /** @brief 前回送信時刻[ms] */
+  uint32_t time;
+} can_signal_state_t;
+
+/** @brief 値イベント */
+typedef struct st_can_event
+{
+  /** @brief 信号インデックス */
+  uint8_t signal;
+  /** @brief 値 */
+  int32_t value;
+} can_event_t;
+
+/**************************************************************************************************
+ * LOCAL VARIABLES
+ */
+/**
+ * @brief 信号表
+ *
+ * 同じ ID の信号は並べて定義すること（ID 表は連続した範囲を指す）
+ */
+static const can_signal_t can_signals[] = {
+    /* name,     id,    ext,   start, len, signed, interval, deadband */
+    {"rpm",      0x100, false, 0,     16,  false,  200,      10},
+    {"speed",    0x100, false, 16,    16,  false,  200,      1},
+    {"coolant",  0x200, false, 0,     8,   true,   1000,     1},
+    {"fault",    0x300, false, 0,     8,   false,  0,        0},
+};
+/** @brief 信号数 */
+#define CAN_SIGNAL_COUNT (sizeof(can_signals) / sizeof(can_signals[0]))
+
+/** @brief ID 表 */
+static can_id_slot_t id_table[CAN_ID_TABLE_SIZE];
+/** @brief 信号毎の送信判定状態 */
+static can_signal_state_t signal_state[CAN_SIGNAL_COUNT];
+/** @brief 値イベントキューの格納領域 */
+static can_event_t event_buffer[CAN_EVENT_QUEUE_SIZE];
+/** @brief 値イベントキュー */
+static spsc_queue_t event_queue;
+/** @brief 送信待ちの最新値（loop 側） */
+static int32_t latest_value[CAN_SIGNAL_COUNT];
+/** @brief 送信待ちフラグ（loop 側） */
+static bool latest_pending[CAN_SIGNAL_COUNT];
+/** @brief 受信統計 */
+static can_stats_t stats;
+/** @brief 初期化完了フラグ */
+static bool can_started = false;
+/** @brief 受信タスク */
+static TaskHandle_t rx_task = NULL;
+
+/**
+ * @brief ID 表のスロット計算関数
+ * @param[in] key :キー
+ * @return スロット
+ */
+static uint16_t id_hash(uint32_t key)
+{
+  key ^= key >> 16;
+  key *= 0x45d9f3bUL;
+  key ^= key >> 16;
+  return (uint16_t)(key & (CAN_ID_TABLE_SIZE - 1));
+}
+
+/**
+ * @brief ID 表検索関数
+ * @param[in] key :キー
+ * @return エントリ（未登録の場合 NULL）
+ */
+static can_id_slot_t *id_lookup(uint32_t key)
+{
+  uint16_t slot = id_hash(key);
+  for (uint16_t probe = 0; probe < CAN_ID_TABLE_SIZE; probe++) {
+    can_id_slot_t *p = &id_table[slot];
+    if (!p->used) {
+      return NULL;
+    }
+    if (p->key == key) {
+      return p;
+    }
+    slot = (slot + 1) & (CAN_ID_TABLE_SIZE - 1);
+  }
+  return NULL;
+}
+
+/**
+ * @brief ID 表作成関数
+ */
+static void id_table_build(void)
+{
+  memset(id_table, 0, sizeof(id_table));
+  for (uint8_t i = 0; i < CAN_SIGNAL_COUNT; i++) {
+    uint32_t key = can_signals[i].id | (can_signals[i].extended ? CAN_KEY_EXTENDED : 0);
+    can_id_slot_t *p = id_lookup(key);
+    if (NULL != p) {
+      ++p->count;
+      continue;
+    }
+    uint16_t slot = id_hash(key);
+    while (id_table[slot].used) {
+      slot = (slot + 1) & (CAN_ID_TABLE_SIZE - 1);
+    }
+    id_table[slot].used = true;
+    id_table[slot].key = key;
+    id_table[slot].first = i;
+    id_table[slot].count = 1;
+  }
+}
+
+/**
+ * @brief 信号表から受信フィルタを作成する関数
+ *
+ * 全 ID の共通ビットだけを比較する単一フィルタとする。
+ * 標準と拡張が混在する場合は全受信（ソフトウェアで選別）。
+ * @param[out] filter :受信フィルタ
+ */
+static void filter_build(twai_filter_config_t *filter)
+{
+  uint32_t id_and = 0xFFFFFFFFUL;
+  uint32_t id_or = 0;
+  bool has_std = false;
+  bool has_ext = false;
+
+  for (uint8_t i = 0; i < CAN_SIGNAL_COUNT; i++) {
+    id_and &= can_signals[i].id;
+    id_or |= can_signals[i].id;
+    if (can_signals[i].extended) { has_ext = true; }
+    else                         { has_std = true; }
+  }
+
+  filter->single_filter = true;
+  if (has_std && !has_ext) {
+    /* ID[31:21] RTR[20] DATA[19:0]、マスクの 1 は比較しない */
+    filter->acceptance_code = (id_and & 0x7FF) << 21;
+    filter->acceptance_mask = (((id_and ^ id_or) & 0x7FF) << 21) | 0x001FFFFFUL;
+  } else if (has_ext && !has_std) {
+    /* ID[31:3] RTR[2] */
+    filter->acceptance_code = (id_and & 0x1FFFFFFFUL) << 3;
+    filter->acceptance_mask = (((id_and ^ id_or) & 0x1FFFFFFFUL) << 3) | 0x7UL;
+  } else {
+    filter->acceptance_code = 0;
+    filter->acceptance_mask = 0xFFFFFFFFUL;
+  }
+}
+
+/**
+ * @brief 信号値の取り出し関数（インテル形式）
+ * @param[in] signal :信号定義
+ * @param[in] data :データ
+ * @param[in] dlc :データ長
+ * @param[out] value :値
+ * @return true：取り出し成功（データ長不足は false）
+ */
+static bool signal_decode(const can_signal_t *signal, const uint8_t *data, uint8_t dlc, int32_t *value)
+{
+  if ((uint16_t)(signal->start_bit + signal->length) > (uint16_t)(dlc * 8)) {
+    return false;
+  }
+  uint64_t raw = 0;
+  for (uint8_t i = 0; i < dlc; i++) {
+    raw |= (uint64_t)data[i] << (8 * i);
+  }
+  raw >>= signal->start_bit;
+  uint32_t mask = (signal->length >= 32) ? 0xFFFFFFFFUL : ((1UL << signal->length) - 1);
+  uint32_t v = (uint32_t)raw & mask;
+  if (signal->is_signed && (signal->length < 32) && (0 != (v & (1UL << (signal->length - 1))))) {
+    v |= ~mask;
+  }
+  *value = (int32_t)v;
+  return true;
+}
+
+/*************************************************************************************************/
+void can_process_frame(uint32_t id, bool extended, const uint8_t *data, uint8_t dlc, uint32_t now)
+{
+  ++stats.frames;
+
+  const can_id_slot_t *slot = id_lookup(id | (extended ? CAN_KEY_EXTENDED : 0));
+  if (NULL == slot) {
+    ++stats.unmatched;
+    return;
+  }
+
+  for (uint8_t i = slot->first; i < (uint8_t)(slot->first + slot->count); i++) {
+    const can_signal_t *signal = &can_signals[i];
+    can_signal_state_t *state = &signal_state[i];
+    int32_t value;
+
+    if (!signal_decode(signal, data, dlc, &value)) {
+      continue;
+    }
+    /* ルールは間引き前の値で判定する */
+    if (rule_watch(RULE_SOURCE_CAN, i)) {
+      rule_post(RULE_SOURCE_CAN, i, value);
+    }
+    if (state->sent) {
+      /* 間引き（最小周期） */
+      if ((uint32_t)(now - state->time) < signal->min_interval_ms) {
+        ++stats.suppressed;
+        continue;
+      }
+      /* 変化検出（不感帯） */
+      uint32_t delta = (uint32_t)abs(value - state->value);
+      if ((0 == delta) || ((0 != signal->deadband) && (delta <= signal->deadband))) {
+        ++stats.suppressed;
+        continue;
+      }
+    }
+
+    can_event_t event = {i, value};
+    if (!spsc_push(&event_queue, &event)) {
+      ++stats.queue_drops;
+      continue;
+    }
+    state->sent = true;
+    state->value = value;
+    state->time = now;
+    ++stats.events;
+  }
+}
+
+/*************************************************************************************************/
+bool can_parse_candump(const char *line, uint32_t *id, bool *extended, uint8_t *data, uint8_t *dlc, uint64_t *time_us)
+{
+  const char *p = line;
+  char *endptr;
+
+  *time_us = 0;
+  /* (1436509052.249713) */
+  if ('(' == *p) {
+    uint64_t sec = strtoull(p + 1, &endptr, 10);
+    uint64_t usec = 0;
+    if ('.' == *endptr) {
+      usec = strtoull(endptr + 1, &endptr, 10);
+    }
+    *time_us = sec * 1000000ULL + usec;
+    p = strchr(endptr, ')');
+    if (NULL == p) {
+      return false;
+    }
+    ++p;
+  }
+  /* インタフェース名を読み飛ばす */
+  while (' ' == *p) { ++p; }
+  while (('\0' != *p) && (' ' != *p)) { ++p; }
+  while (' ' == *p) { ++p; }
+
+  /* 123#DEADBEEF / 12345678#... */
+  const char *hash = strchr(p, '#');
+  if (NULL == hash) {
+    return false;
+  }
+  *id = (uint32_t)strtoul(p, &endptr, 16);
+  if (endptr != hash) {
+    return false;
+  }
+  *extended = ((hash - p) > 3);
+  if ('R' == hash[1]) {
+    /* リモートフレームは対象外 */
+    return false;
+  }
+
+  uint8_t n = 0;
+  p = hash + 1;
+  while ((n < 8) && isxdigit((uint8_t)p[0]) && isxdigit((uint8_t)p[1])) {
+    char byte[3] = {p[0], p[1], '\0'};
+    data[n++] = (uint8_t)strtoul(byte, NULL, 16);
+    p += 2;
+    if ('.' == *p) { ++p; }
+  }
+  *dlc = n;
+
+  return true;
+}
+
+/*************************************************************************************************/
+uint16_t can_build_payload(char *buf, uint16_t size)
+{
+  can_event_t event;
+  uint16_t len = 0;
+  uint8_t entries = 0;
+
+  /* 受信タスクからの値を信号毎の最新値にまとめる */
+  while (spsc_pop(&event_queue, &event)) {
+    latest_value[event.signal] = event.value;
+    latest_pending[event.signal] = true;
+  }
+
+  for (uint8_t i = 0; i < CAN_SIGNAL_COUNT; i++) {
+    if (!latest_pending[i]) {
+      continue;
+    }
+    /* 「{"can":{」+ エントリ + 「}}」が収まる場合のみ追加 */
+    char entry[48];
+    int n = snprintf(entry, sizeof(entry), "%s\"%s\":%ld", (0 == entries) ? "{\"can\":{" : ",",
+                     can_signals[i].name, (long)latest_value[i]);
+    if ((uint16_t)(len + n + 2) >= size) {
+      break;
+    }
+    memcpy(&buf[len], entry, n);
+    len += n;
+    latest_pending[i] = false;
+    ++entries;
+  }
+  if (0 == entries) {
+    return 0;
+  }
+  buf[len++] = '}';
+  buf[len++] = '}';
+  buf[len] = '\0';
+
+  return len;
+}
+
+/*************************************************************************************************/
+void can_get_stats(can_stats_t *p_stats)
+{
+  if (can_started) {
+    twai_status_info_t info;
+    if (ESP_OK == twai_get_status_info(&info)) {
+      stats.rx_missed = info.rx_missed_count + info.rx_overrun_count;
+      stats.bus_errors = info.bus_error_count;
+    }
+  }
+  *p_stats = stats;
+}
+
+/**
+ * @brief 受信タスク
+ * @param[in] arg :未使用
+ */
+static void can_task(void *arg)
+{
+  twai_message_t message;
+
+  for (;;) {
+    if (ESP_OK == twai_receive(&message, pdMS_TO_TICKS(CAN_POLL_MS))) {
+      if (!message.rtr) {
+        can_process_frame(message.identifier, message.extd, message.data, message.data_length_code, millis());
+      }
+      continue;
+    }
+    /* バスオフからの復帰 */
+    twai_status_info_t info;
+    if (ESP_OK != twai_get_status_info(&info)) {
+      continue;
+    }
+    if (TWAI_STATE_BUS_OFF == info.state) {
+      twai_initiate_recovery();
+    } else if (TWAI_STATE_STOPPED == info.state) {
+      /* 復帰完了後は停止状態になるので再開する */
+      twai_start();
+    }
+  }
+}
+
+/*************************************************************************************************/
+void can_init(void)
+{
+  memset(signal_state, 0, sizeof(signal_state));
+  memset(latest_pending, 0, sizeof(latest_pending));
+  memset(&stats, 0, sizeof(stats));
+  spsc_init(&event_queue, event_buffer, sizeof(can_event_t), CAN_EVENT_QUEUE_SIZE);
+  id_table_build();
+
+  twai_general_config_t general = TWAI_GENERAL_CONFIG_DEFAULT((gpio_num_t)PORT_CAN_TXD, (gpio_num_t)PORT_CAN_RXD, TWAI_MODE_NORMAL);
+  general.rx_queue_len = CAN_DRIVER_RX_QUEUE;
+#if (CAN_BITRATE_KBPS == 250)
+  twai_timing_config_t timing = TWAI_TIMING_CONFIG_250KBITS();
+#else
+  twai_timing_config_t timing = TWAI_TIMING_CONFIG_500KBITS();
+#endif
+  twai_filter_config_t filter;
+  filter_build(&filter);
+
+  if ((ESP_OK != twai_driver_install(&general, &timing, &filter)) || (ESP_OK != twai_start())) {
+    Serial.println("CAN start failed");
+    return;
+  }
+  can_started = true;
+
+  /* 受信タスクは loop(コア1) と別のコア0 で動かす */
+  xTaskCreatePinnedToCore(can_task, "can", CAN_TASK_STACK, NULL, 3, &rx_task, 0);
+  diag_register_task(rx_task, "can");
+
+  Serial.println("CAN start");
+}
@@ -0,0 +1,351 @@
+/**
+ * @file config.cpp
+ * @version 0.1
+ * @brief 実行時設定（NVS 保存・MQTT/HTTP からの更新）
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <Preferences.h>
+#include <stddef.h>
+#include <string.h>
+#include "config.h"
+#include "bg770.h"
+#include "can_bus.h"
+#include "diag.h"
+#include "tsdb.h"
+#include "setup_define.h"
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief 値の型 */
+typedef enum e_config_type
+{
+  /** @brief 整数（uint32_t） */
+  CONFIG_TYPE_U32 = 0,
+  /** @brief 文字列（char[]） */
+  CONFIG_TYPE_STR,
+} config_type_t;
+
+/** @brief キーの定義 */
+typedef struct st_config_field
+{
+  /** @brief キー */
+  const char *key;
+  /** @brief 型 */
+  config_type_t type;
+  /** @brief config_t 内の位置 */
+  uint16_t offset;
+  /** @brief 文字列の最大長（終端含む） */
+  uint16_t size;
+  /** @brief 整数の最小値（文字列は最小長） */
+  uint32_t min;
+  /** @brief 整数の最大値 */
+  uint32_t max;
+} config_field_t;
+
+/** @brief 保存形式 1 の設定（bulk_url・bulk_min_bytes が無い） */
+typedef struct st_config_v1
+{
+  /** @brief 保存形式の番号（1） */
+  uint16_t schema;
+  /** @brief 設定のバージョン */
+  uint32_t version;
+  /** @brief 接続先 */
+  config_link_t link;
+  /** @brief 初期化シーケンスのタイムアウト[ms] */
+  uint32_t timeout[CONFIG_TIMEOUT_MAX];
+  /** @brief AT+CSQ 前の待ち時間[ms] */
+  uint32_t csq_delay_ms;
+  /** @brief テレメトリの送信期限[ms] */
+  uint32_t telemetry_deadline_ms;
+  /** @brief ハートビートの送信期限[ms] */
+  uint32_t diag_deadline_ms;
+  /** @brief CAN 信号の送信周期[ms] */
+  uint32_t can_publish_ms;
+  /** @brief ハートビートの周期[ms] */
+  uint32_t heartbeat_ms;
+} config_v1_t;
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief 文字列のキー */
+#define CONFIG_STR(key, member, min) \
+  {key, CONFIG_TYPE_STR, offsetof(config_t, member), sizeof(((config_t *)0)->member), min, 0}
+/** @brief 整数のキー */
+#define CONFIG_U32(key, member, min, max) {key, CONFIG_TYPE_U32, offsetof(config_t, member), 0, min, max}
+
+/** @brief 更新できるキー */
+static const config_field_t fields[] = {
+    CONFIG_STR("apn", link.apn, 1),
+    CONFIG_STR("apn_user", link.apn_user, 0),
+    CONFIG_STR("apn_pass", link.apn_pass, 0),
+    CONFIG_STR("broker", link.broker, 1),
+    CONFIG_U32("port", link.port, 1, 65535),
+    CONFIG_STR("sub_topic", link.sub_topic, 1),
+    CONFIG_STR("pub_topic", link.pub_topic, 1),
+    CONFIG_U32("timeout_ready", timeout[CONFIG_TIMEOUT_READY], 0, 600000),
+    CONFIG_U32("timeout_at", timeout[CONFIG_TIMEOUT_AT], 0, 600000),
+    CONFIG_U32("timeout_cops", timeout[CONFIG_TIMEOUT_COPS], 0, 600000),
+    CONFIG_U32("timeout_csq", timeout[CONFIG_TIMEOUT_CSQ], 0, 600000),
+    CONFIG_U32("timeout_qiact", timeout[CONFIG_TIMEOUT_QIACT], 0, 600000),
+    CONFIG_U32("timeout_qiopen", timeout[CONFIG_TIMEOUT_QIOPEN], 0, 600000),
+    CONFIG_U32("timeout_mqtt", timeout[CONFIG_TIMEOUT_MQTT], 0, 600000),
+    CONFIG_U32("csq_delay_ms", csq_delay_ms, 0, 60000),
+    CONFIG_U32("telemetry_deadline_ms", telemetry_deadline_ms, 1000, 3600000),
+    CONFIG_U32("diag_deadline_ms", diag_deadline_ms, 1000, 3600000),
+    CONFIG_U32("can_publish_ms", can_publish_ms, 100, 3600000),
+    CONFIG_U32("heartbeat_ms", heartbeat_ms, 1000, 86400000),
+    CONFIG_STR("bulk_url", bulk_url, 0),
+    CONFIG_U32("bulk_min_bytes", bulk_min_bytes, 1024, 16777216),
+};
+/** @brief キー数 */
+#define CONFIG_FIELDS  (sizeof(fields) / sizeof(fields[0]))
+
+/** @brief 更新結果の名前（config_result_t 順） */
+static const char *const result_names[] = {"ok", "stale", "invalid", "nvs"};
+
+/**************************************************************************************************
+ * LOCAL VARIABLES
+ */
+/** @brief 設定（保存済みの最新） */
+static config_t config;
+/** @brief 使用中の接続先 */
+static config_link_t link_in_use;
+/** @brief 接続先が変わった時刻（0：反映済み） */
+static unsigned long link_changed_ms = 0;
+
+/**
+ * @brief 既定値の設定関数
+ * @param[out] c :設定
+ */
+static void config_defaults(config_t *c)
+{
+  memset(c, 0, sizeof(*c));
+  c->schema = CONFIG_SCHEMA;
+  strncpy(c->link.apn, APN_NAME, sizeof(c->link.apn) - 1);
+  strncpy(c->link.apn_user, APN_USER, sizeof(c->link.apn_user) - 1);
+  strncpy(c->link.apn_pass, APN_PASS, sizeof(c->link.apn_pass) - 1);
+  strncpy(c->link.broker, BROKER_HOST, sizeof(c->link.broker) - 1);
+  c->link.port = BROKER_PORT;
+  strncpy(c->link.sub_topic, SUBSCRIBE_TOPIC, sizeof(c->link.sub_topic) - 1);
+  strncpy(c->link.pub_topic, PUBLISH_TOPIC, sizeof(c->link.pub_topic) - 1);
+  c->telemetry_deadline_ms = TELEMETRY_DEADLINE_MS;
+  c->diag_deadline_ms = DIAG_DEADLINE_MS;
+  c->can_publish_ms = CAN_PUBLISH_MS;
+  c->heartbeat_ms = DIAG_HEARTBEAT_MS;
+  c->bulk_min_bytes = TSDB_BULK_MIN_BYTES;
+}
+
+/**
+ * @brief 保存形式 1 からの移行関数（追加された項目は既定値のまま）
+ * @param[in] old :保存形式 1 の設定
+ * @param[in,out] c :設定（既定値を入れておく）
+ */
+static void config_migrate_v1(const config_v1_t *old, config_t *c)
+{
+  c->version = old->version;
+  c->link = old->link;
+  memcpy(c->timeout, old->timeout, sizeof(c->timeout));
+  c->csq_delay_ms = old->csq_delay_ms;
+  c->telemetry_deadline_ms = old->telemetry_deadline_ms;
+  c->diag_deadline_ms = old->diag_deadline_ms;
+  c->can_publish_ms = old->can_publish_ms;
+  c->heartbeat_ms = old->heartbeat_ms;
+}
+
+/*************************************************************************************************/
+void config_init(void)
+{
+  Preferences prefs;
+
+  config_defaults(&config);
+  prefs.begin(CONFIG_NVS_NAMESPACE, true);
+  config_t saved;
+  size_t length = prefs.getBytes("cfg", &saved, sizeof(saved));
+  if ((sizeof(saved) == length) && (CONFIG_SCHEMA == saved.schema)) {
+    config = saved;
+  } else if ((sizeof(config_v1_t) == length) && (1 == saved.schema)) {
+    /* 次の更新で現在の形式で保存される */
+    config_v1_t old;
+    memcpy(&old, &saved, sizeof(old));
+    config_migrate_v1(&old, &config);
+  }
+  prefs.end();
+
+  link_in_use = config.link;
+  link_changed_ms = 0;
+}
+
+/*************************************************************************************************/
+const config_t *config_get(void) { return &config; }
+
+/*************************************************************************************************/
+const config_link_t *config_link(void) { return &link_in_use; }
+
+/*************************************************************************************************/
+void config_link_apply(void)
+{
+  link_in_use = config.link;
+  link_changed_ms = 0;
+}
+
+/*************************************************************************************************/
+bool config_link_due(bool outbox_empty)
+{
+  if ((0 == link_changed_ms) || (BG770_STATE_SUBSCRIBE != bg_state)) {
+    return false;
+  }
+  return outbox_empty || ((millis() - link_changed_ms) >= CONFIG_RECONNECT_WAIT_MS);
+}
+
+/*************************************************************************************************/
+uint32_t config_timeout(config_timeout_t id, uint32_t fallback)
+{
+  return ((id < CONFIG_TIMEOUT_MAX) && (0 != config.timeout[id])) ? config.timeout[id] : fallback;
+}
+
+/**
+ * @brief 1 キーの検証・設定関数
+ * @param[in,out] c :設定
+ * @param[in] field :キーの定義
+ * @param[in] value :値
+ * @return true：正しい値
+ */
+static bool config_set_field(config_t *c, const config_field_t *field, JsonVariantConst value)
+{
+  uint8_t *p = (uint8_t *)c + field->offset;
+
+  if (CONFIG_TYPE_U32 == field->type) {
+    if (!value.is<uint32_t>()) {
+      return false;
+    }
+    uint32_t v = value.as<uint32_t>();
+    if ((v < field->min) || (v > field->max)) {
+      return false;
+    }
+    memcpy(p, &v, sizeof(v));
+    return true;
+  }
+
+  if (!value.is<const char *>()) {
+    return false;
+  }
+  const char *s = value.as<const char *>();
+  size_t len = strlen(s);
+  /* AT コマンドの "..." に入れるので引用符は受け付けない */
+  if ((len < field->min) || (len >= field->size) || (NULL != strchr(s, '"'))) {
+    return false;
+  }
+  memset(p, 0, field->size);
+  memcpy(p, s, len);
+  return true;
+}
+
+/*************************************************************************************************/
+config_result_t config_update(const char *json, const char **key)
+{
+  StaticJsonDocument<CONFIG_DOC_SIZE> doc;
+  const char *bad = NULL;
+
+  if (NULL == key) {
+    key = &bad;
+  }
+  *key = NULL;
+  if (deserializeJson(doc, json) || !doc.is<JsonObject>() || !doc["version"].is<uint32_t>()) {
+    *key = "version";
+    return CONFIG_RESULT_INVALID;
+  }
+  uint32_t version = doc["version"];
+  if (version <= config.version) {
+    return CONFIG_RESULT_STALE;
+  }
+
+  /* 全キーを写しに適用してから置き換える */
+  config_t next = config;
+  next.version = version;
+  for (JsonPairConst kv : doc.as<JsonObjectConst>()) {
+    if (0 == strcmp(kv.key().c_str(), "version")) {
+      continue;
+    }
+    const config_field_t *field = NULL;
+    for (uint8_t i = 0; i < CONFIG_FIELDS; i++) {
+      if (0 == strcmp(kv.key().c_str(), fields[i].key)) {
+        field = &fields[i];
+        break;
+      }
+    }
+    if ((NULL == field) || !config_set_field(&next, field, kv.value())) {
+      *key = (NULL != field) ? field->key : "unknown";
+      return CONFIG_RESULT_INVALID;
+    }
+  }
+
+  Preferences prefs;
+  prefs.begin(CONFIG_NVS_NAMESPACE, false);
+  bool saved = (sizeof(next) == prefs.putBytes("cfg", &next, sizeof(next)));
+  prefs.end();
+  if (!saved) {
+    return CONFIG_RESULT_NVS_ERROR;
+  }
+
+  config = next;
+  if (0 != memcmp(&config.link, &link_in_use, sizeof(link_in_use))) {
+    link_changed_ms = millis() | 1;
+  } else {
+    link_changed_ms = 0;
+  }
+  return CONFIG_RESULT_OK;
+}
+
+/*************************************************************************************************/
+bool config_is_update(const at_line_t *line)
+{
+  /* +QMTRECV: <client_idx>,<msgID>,"<topic>","<payload>" */
+  const char *topic = strchr(line->args, '"');
+  return (NULL != topic) && (0 == strncmp(topic + 1, CONFIG_TOPIC "\"", sizeof(CONFIG_TOPIC)));
+}
+
+/*************************************************************************************************/
+uint16_t config_build_result(char buf[], uint16_t size, config_result_t result, const char *key)
+{
+  int len = snprintf(buf, size, "{\"config\":{\"version\":%lu,\"result\":\"%s\"", (unsigned long)config.version,
+                     result_names[result]);
+  if ((len >= 0) && (len < size) && (NULL != key)) {
+    len += snprintf(&buf[len], size - len, ",\"key\":\"%s\"", key);
+  }
+  if ((len >= 0) && (len < size)) {
+    len += snprintf(&buf[len], size - len, "}}");
+  }
+  return ((len >= 0) && (len < size)) ? (uint16_t)len : 0;
+}
+
+/*************************************************************************************************/
+uint16_t config_build_json(char buf[], uint16_t size)
+{
+  int len = snprintf(buf, size, "{\"version\":%lu", (unsigned long)config.version);
+
+  for (uint8_t i = 0; (i < CONFIG_FIELDS) && (len >= 0) && (len < size); i++) {
+    const uint8_t *p = (const uint8_t *)&config + fields[i].offset;
+    if (CONFIG_TYPE_U32 == fields[i].type) {
+      uint32_t v;
+      memcpy(&v, p, sizeof(v));
+      len += snprintf(&buf[len], size - len, ",\"%s\":%lu", fields[i].key, (unsigned long)v);
+    } else {
+      bool secret = (0 == strcmp(fields[i].key, "apn_pass"));
+      len += snprintf(&buf[len], size - len, ",\"%s\":\"%s\"", fields[i].key, secret ? "***" : (const char *)p);
+    }
+  }
+  if ((len >= 0) && (len < size)) {
+    len += snprintf(&buf[len], size - len, ",\"pending\":%u}", (0 != link_changed_ms) ? 1 : 0);
+  }
+  return ((len >= 0) && (len < size)) ? (uint16_t)len : 0;
+}
@@ -0,0 +1,457 @@
+/**
+ * @file console.cpp
+ * @version 0.1
+ * @brief シリアルコンソールのコマンド処理
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <stdarg.h>
+#include <string.h>
+#include "console.h"
+#include "bg770.h"
+#include "CK_1540_01.h"
+#include "setup_define.h"
+#include "uplink.h"
+#include "loadgen.h"
+#include "diag.h"
+#include "trace.h"
+#include "mqtt_lane.h"
+#include "outbox.h"
+#include "shadow.h"
+#include "power.h"
+#include "ota.h"
+#include "plmn.h"
+#include "mqtt_session.h"
+#include "supervisor.h"
+#include "rule.h"
+#include "inbox.h"
+#include "tsdb.h"
+
+/**************************************************************************************************
+ * LOCAL VARIABLES
+ */
+/** @brief 行バッファ */
+static char line[CONSOLE_LINE_SIZE];
+/** @brief 行バッファの長さ */
+static uint16_t line_length = 0;
+/** @brief 行が長すぎて破棄中 */
+static bool line_overflow = false;
+/** @brief JSON 出力 */
+static bool json_output = false;
+/** @brief 結果 */
+static char reply[CONSOLE_REPLY_SIZE];
+/** @brief 結果の長さ */
+static uint16_t reply_length = 0;
+
+/**
+ * @brief 結果への追記関数（溢れた分は捨てる）
+ */
+static void console_append(const char *format, ...)
+{
+  va_list ap;
+  va_start(ap, format);
+  int len = vsnprintf(&reply[reply_length], sizeof(reply) - reply_length, format, ap);
+  va_end(ap);
+  if (len > 0) {
+    reply_length += ((size_t)(reply_length + len) < sizeof(reply)) ? len : (sizeof(reply) - 1 - reply_length);
+  }
+}
+
+/**
+ * @brief 結果の項目区切り・項目名追加関数
+ * @param[in] key :項目名
+ */
+static void console_key(const char *key)
+{
+  if (json_output) {
+    console_append(",\"%s\":", key);
+  } else {
+    console_append(" %s=", key);
+  }
+}
+
+/*************************************************************************************************/
+void console_field(const char *key, const char *value)
+{
+  console_key(key);
+  if (json_output) {
+    console_append("\"%s\"", value);
+  } else {
+    console_append("%s", value);
+  }
+}
+
+/*************************************************************************************************/
+void console_field_int(const char *key, long value)
+{
+  console_key(key);
+  console_append("%ld", value);
+}
+
+/*************************************************************************************************/
+void console_field_json(const char *key, const char *json)
+{
+  console_key(key);
+  console_append("%s", json);
+}
+
+/**
+ * @brief led lan|wan red|green|off
+ */
+static api_status_t cmd_led(uint8_t argc, char *argv[])
+{
+  if (argc < 3) {
+    return API_STATUS_INVALID_PARAMS;
+  }
+  bool wan = (0 == strcasecmp(argv[1], "wan"));
+  if (!wan && (0 != strcasecmp(argv[1], "lan"))) {
+    return API_STATUS_INVALID_PARAMS;
+  }
+
+  /* 従来通り RED/GREEN 以外は消灯。通知はデバイスシャドウの reported 更新で送る */
+  shadow_color_t color;
+  if (!shadow_parse_color(argv[2], &color)) {
+    color = SHADOW_COLOR_OFF;
+  }
+  shadow_set_led(wan ? SHADOW_LED_WAN : SHADOW_LED_LAN, color);
+  console_field("led", argv[1]);
+  console_field("color", shadow_color_name(color));
+  return API_STATUS_SUCCESS;
+}
+
+/**
+ * @brief 000 <color> / 001 <color>（従来のコマンド番号）
+ */
+static api_status_t cmd_legacy_led(uint8_t argc, char *argv[])
+{
+  char *args[3] = {argv[0], (char *)((0 == strcmp(argv[0], "001")) ? "wan" : "lan"), (char *)""};
+  if (argc > 1) {
+    args[2] = argv[1];
+  }
+  return cmd_led(3, args);
+}
+
+/**
+ * @brief sw? / 002
+ */
+static api_status_t cmd_sw(uint8_t argc, char *argv[])
+{
+  /* 変化はデバイスシャドウの reported 更新で送る */
+  console_field("SW", (digitalRead(PORT_INP_SW) == 0) ? "ON" : "OFF");
+  return API_STATUS_SUCCESS;
+}
+
+/**
+ * @brief pub <json>
+ */
+static api_status_t cmd_pub(uint8_t argc, char *argv[])
+{
+  if (argc < 2) {
+    return API_STATUS_INVALID_PARAMS;
+  }
+  char payload[PUBLISH_SIZE];
+  uint16_t len = publish_payload_build(payload, argv[1]);
+  console_field_int("len", len);
+  const outbox_attr_t attr = {UPLINK_CLASS_CONTROL, OUTBOX_PRIO_NORMAL, OUTBOX_KEY_NONE, OUTBOX_EXPIRE_SEND,
+                              CONSOLE_DEADLINE_MS};
+  return outbox_post((const uint8_t *)payload, len, &attr) ? API_STATUS_SUCCESS : API_STATUS_QUEUE_FULL;
+}
+
+/**
+ * @brief stats
+ */
+static api_status_t cmd_stats(uint8_t argc, char *argv[])
+{
+  bg770_stats_t stats;
+  char json[256];
+
+  bg770_get_stats(&stats);
+  console_field_int("state", bg_state);
+  console_field_int("rssi", bg770_get_rssi());
+  console_field_int("commands", stats.commands);
+  console_field_int("lines", stats.lines);
+  console_field_int("us_per_line", stats.line_us / (stats.lines ? stats.lines : 1));
+  console_field_int("resets", stats.resets);
+  console_field_int("subscribe_ms", stats.subscribe_ms);
+  for (uint8_t lane = 0; lane < MQTT_LANE_MAX; lane++) {
+    mqtt_lane_stats_t lane_stats;
+    mqtt_lane_get_stats((mqtt_lane_t)lane, &lane_stats);
+    snprintf(json, sizeof(json), "{\"open\":%u,\"inflight\":%u,\"pub\":%lu,\"ack\":%lu,\"fail\":%lu}",
+             lane_stats.open ? 1 : 0, lane_stats.inflight, (unsigned long)lane_stats.published,
+             (unsigned long)lane_stats.acked, (unsigned long)lane_stats.failed);
+    console_field_json((MQTT_LANE_CONTROL == lane) ? "mqtt_control" : "mqtt_bulk", json);
+  }
+  outbox_stats_t ob;
+  outbox_get_stats(&ob);
+  snprintf(json, sizeof(json),
+           "{\"queued\":%u,\"sent\":%lu,\"superseded\":%lu,\"dropped\":%lu,\"merged\":%lu,"
+           "\"rejected\":%lu,\"late\":%lu,\"max_ms\":%lu}",
+           ob.queued, (unsigned long)ob.sent, (unsigned long)ob.superseded, (unsigned long)ob.dropped,
+           (unsigned long)ob.merged, (unsigned long)ob.rejected, (unsigned long)ob.late,
+           (unsigned long)ob.max_latency_ms);
+  console_field_json("outbox", json);
+  power_stats_t pw;
+  power_get_stats(&pw);
+  snprintf(json, sizeof(json),
+           "{\"pm\":%u,\"sleep\":%u,\"burst\":[%lu,%lu],\"idle\":[%lu,%lu],\"wait\":[%lu,%lu],"
+           "\"command\":[%lu,%lu],\"mAs\":%lu,\"fixed_mAs\":%lu,\"saved_ms\":%lu}",
+           pw.pm ? 1 : 0, pw.light_sleep ? 1 : 0, (unsigned long)pw.entries[POWER_STATE_BURST],
+           (unsigned long)pw.ms[POWER_STATE_BURST], (unsigned long)pw.entries[POWER_STATE_IDLE],
+           (unsigned long)pw.ms[POWER_STATE_IDLE], (unsigned long)pw.entries[POWER_STATE_WAIT],
+           (unsigned long)pw.ms[POWER_STATE_WAIT], (unsigned long)pw.entries[POWER_STATE_COMMAND],
+           (unsigned long)pw.ms[POWER_STATE_COMMAND], (unsigned long)pw.charge_mas, (unsigned long)pw.fixed_mas,
+           (unsigned long)pw.saved_ms);
+  console_field_json("power", json);
+  ota_stats_t ota;
+  ota_get_stats(&ota);
+  snprintf(json, sizeof(json),
+           "{\"state\":%u,\"offset\":%lu,\"size\":%lu,\"ranges\":%lu,\"retries\":%lu,\"write_wait_ms\":%lu,"
+           "\"Bps\":%lu}",
+           (unsigned)ota.state, (unsigned long)ota.offset, (unsigned long)ota.size, (unsigned long)ota.ranges,
+           (unsigned long)ota.retries, (unsigned long)ota.write_wait_ms, (unsigned long)ota.bytes_per_s);
+  console_field_json("ota", json);
+  plmn_stats_t pl;
+  plmn_get_stats(&pl);
+  snprintf(json, sizeof(json),
+           "{\"plmn\":\"%s\",\"act\":%u,\"rssi\":%d,\"attempts\":%u,\"successes\":%u,\"attach_ms\":%lu,"
+           "\"candidates\":%u,\"scans\":%lu,\"fallbacks\":%lu}",
+           pl.current.id, pl.current.act, pl.current.rssi, pl.current.attempts, pl.current.successes,
+           (unsigned long)pl.current.attach_ms, pl.count, (unsigned long)pl.scans, (unsigned long)pl.fallbacks);
+  console_field_json("plmn", json);
+  mqtt_session_stats_t ms;
+  mqtt_session_get_stats(&ms);
+  snprintf(json, sizeof(json), "{\"subscribed\":%lu,\"resumed\":%lu,\"resubscribed\":%lu}",
+           (unsigned long)ms.subscribed, (unsigned long)ms.resumed, (unsigned long)ms.resubscribed);
+  console_field_json("session", json);
+  inbox_stats_t ib;
+  inbox_get_stats(&ib);
+  snprintf(json, sizeof(json),
+           "{\"received\":%lu,\"delivered\":%lu,\"duplicates\":%lu,\"stale\":%lu,\"reordered\":%lu,\"gaps\":%lu,\"held\":%u}",
+           (unsigned long)ib.received, (unsigned long)ib.delivered, (unsigned long)ib.duplicates,
+           (unsigned long)ib.stale, (unsigned long)ib.reordered, (unsigned long)ib.gaps, ib.held);
+  console_field_json("inbox", json);
+  tsdb_stats_t ts;
+  tsdb_get_stats(&ts);
+  snprintf(json, sizeof(json),
+           "{\"used\":%u,\"blocks\":%u,\"appended\":%lu,\"dropped\":%lu,\"bulk\":%lu,\"bulk_bytes\":%lu,\"fallbacks\":%lu}",
+           ts.used, ts.blocks, (unsigned long)ts.appended, (unsigned long)ts.dropped, (unsigned long)ts.bulk_batches,
+           (unsigned long)ts.bulk_bytes, (unsigned long)ts.bulk_fallbacks);
+  console_field_json("tsdb", json);
+  supervisor_stats_t sv;
+  supervisor_get_stats(&sv);
+  snprintf(json, sizeof(json),
+           "{\"soft\":%lu,\"modem\":%lu,\"restart\":%lu,\"wdt\":%lu,\"max_ms\":[%lu,%lu,%lu,%lu,%lu,%lu]}",
+           (unsigned long)sv.violations[SUPERVISOR_LEVEL_SOFT], (unsigned long)sv.violations[SUPERVISOR_LEVEL_MODEM_RESET],
+           (unsigned long)sv.violations[SUPERVISOR_LEVEL_RESTART], (unsigned long)sv.violations[SUPERVISOR_LEVEL_WATCHDOG],
+           (unsigned long)sv.max_ms[SUPERVISOR_STAGE_LOOP], (unsigned long)sv.max_ms[SUPERVISOR_STAGE_MODEM],
+           (unsigned long)sv.max_ms[SUPERVISOR_STAGE_PUBLISH], (unsigned long)sv.max_ms[SUPERVISOR_STAGE_HTTP],
+           (unsigned long)sv.max_ms[SUPERVISOR_STAGE_CONSOLE], (unsigned long)sv.max_ms[SUPERVISOR_STAGE_ACK]);
+  console_field_json("supervisor", json);
+  rule_stats_t rs;
+  rule_get_stats(&rs);
+  snprintf(json, sizeof(json),
+           "{\"version\":%lu,\"count\":%u,\"events\":%lu,\"fired\":%lu,\"drops\":%lu,\"max_us\":%lu,\"avg_us\":%lu}",
+           (unsigned long)rs.version, rs.count, (unsigned long)rs.events, (unsigned long)rs.fired,
+           (unsigned long)rs.drops, (unsigned long)rs.max_us,
+           (unsigned long)(rs.total_us / (rs.events ? rs.events : 1)));
+  console_field_json("rule", json);
+  diag_build_json(json, sizeof(json));
+  console_field_json("diag", json);
+  return API_STATUS_SUCCESS;
+}
+
+/**
+ * @brief lg <count> <size> <rate> <class> / lg stop / lg
+ */
+static api_status_t cmd_lg(uint8_t argc, char *argv[])
+{
+  char json[200];
+
+  if ((argc > 1) && (0 == strcmp(argv[1], "stop"))) {
+    /* 結果は loop でパブリッシュする */
+    loadgen_stop();
+  } else if (argc > 1) {
+    loadgen_config_t config = {0, 256, 0, LOADGEN_CLASS};
+    config.count = strtoul(argv[1], NULL, 10);
+    if (argc > 2) { config.size = strtoul(argv[2], NULL, 10); }
+    if (argc > 3) { config.rate = strtoul(argv[3], NULL, 10); }
+    if (argc > 4) { config.cls = (uplink_class_t)strtoul(argv[4], NULL, 10); }
+    loadgen_start(&config);
+  }
+  loadgen_build_report(json, sizeof(json));
+  console_field_json("loadgen", json);
+  return API_STATUS_SUCCESS;
+}
+
+/**
+ * @brief trace
+ */
+static api_status_t cmd_trace(uint8_t argc, char *argv[])
+{
+  trace_dump(Serial);
+  supervisor_dump(Serial);
+  return API_STATUS_SUCCESS;
+}
+
+/**
+ * @brief json on|off
+ */
+static api_status_t cmd_json(uint8_t argc, char *argv[])
+{
+  if (argc > 1) {
+    json_output = (0 == strcmp(argv[1], "on"));
+  }
+  console_field("json", json_output ? "on" : "off");
+  return API_STATUS_SUCCESS;
+}
+
+static api_status_t cmd_help(uint8_t argc, char *argv[]);
+
+/** @brief コマンド表 */
+static const console_command_t commands[] = {
+    {"help", "help", 0, cmd_help},
+    {"led", "led lan|wan red|green|off", 0, cmd_led},
+    {"sw?", "sw?", 0, cmd_sw},
+    {"pub", "pub <json>", CONSOLE_FLAG_RAW, cmd_pub},
+    {"stats", "stats", 0, cmd_stats},
+    {"lg", "lg <count> <size> <msg/min> <class> | lg stop | lg", 0, cmd_lg},
+    {"trace", "trace", 0, cmd_trace},
+    {"json", "json on|off", 0, cmd_json},
+    {"000", "000 <color>", 0, cmd_legacy_led},
+    {"001", "001 <color>", 0, cmd_legacy_led},
+    {"002", "002", 0, cmd_sw},
+};
+/** @brief コマンド数 */
+#define CONSOLE_COMMAND_COUNT  (sizeof(commands) / sizeof(commands[0]))
+
+/**
+ * @brief help
+ */
+static api_status_t cmd_help(uint8_t argc, char *argv[])
+{
+  for (uint8_t i = 0; i < CONSOLE_COMMAND_COUNT; i++) {
+    Serial.println(commands[i].help);
+  }
+  return API_STATUS_SUCCESS;
+}
+
+/**
+ * @brief 1 コマンド実行関数
+ * @param[in,out] text :コマンド（空白区切りの位置が書き換えられる）
+ */
+static void console_run(char *text)
+{
+  char *argv[CONSOLE_ARGS_MAX];
+  uint8_t argc = 0;
+  const console_command_t *command = NULL;
+  api_status_t result = API_STATUS_INVALID_PARAMS;
+
+  /* コマンド名を切り出して表を引く */
+  while (' ' == *text) {
+    ++text;
+  }
+  if ('\0' == *text) {
+    return;
+  }
+  argv[argc++] = text;
+  text += strcspn(text, " ");
+  if ('\0' != *text) {
+    *text++ = '\0';
+  }
+  for (uint8_t i = 0; i < CONSOLE_COMMAND_COUNT; i++) {
+    if (0 == strcmp(argv[0], commands[i].name)) {
+      command = &commands[i];
+      break;
+    }
+  }
+
+  reply_length = 0;
+  if (json_output) {
+    console_append("{\"cmd\":\"%s\"", argv[0]);
+  } else {
+    console_append("%s:", argv[0]);
+  }
+
+  if (NULL != command) {
+    /* 引数の切り出し */
+    while (argc < CONSOLE_ARGS_MAX) {
+      while (' ' == *text) {
+        ++text;
+      }
+      if ('\0' == *text) {
+        break;
+      }
+      argv[argc++] = text;
+      if (0 != (command->flags & CONSOLE_FLAG_RAW)) {
+        break;
+      }
+      text += strcspn(text, " ");
+      if ('\0' != *text) {
+        *text++ = '\0';
+      }
+    }
+    result = command->handler(argc, argv);
+  }
+
+  if (json_output) {
+    console_append(",\"ok\":%s,\"status\":%d}", (API_STATUS_SUCCESS == result) ? "true" : "false", result);
+  } else {
+    console_append(" %s", (NULL == command) ? "unknown command" : (API_STATUS_SUCCESS == result) ? "ok" : "error");
+  }
+  Serial.println(reply);
+
+  if (API_STATUS_FAIL == result) {
+    bg770_reset();
+  }
+}
+
+/*************************************************************************************************/
+void console_execute(char *text)
+{
+  char *next;
+  do {
+    next = strchr(text, ';');
+    if (NULL != next) {
+      *next++ = '\0';
+    }
+    console_run(text);
+    text = next;
+  } while (NULL != text);
+}
+
+/*************************************************************************************************/
+void console_task(void)
+{
+  while (Serial.available()) {
+    int c = Serial.read();
+    if (c < 0) {
+      break;
+    }
+    if (('\r' == c) || ('\n' == c)) {
+      line[line_length] = '\0';
+      if (line_overflow) {
+        Serial.println("line too long");
+      } else if (0 != line_length) {
+        uint8_t stage = supervisor_enter(SUPERVISOR_STAGE_CONSOLE, 0, line);
+        console_execute(line);
+        supervisor_leave(stage);
+      }
+      line_length = 0;
+      line_overflow = false;
+    } else if (('\b' == c) || (0x7F == c)) {
+      if (0 != line_length) {
+        --line_length;
+      }
+    } else if (line_length < (CONSOLE_LINE_SIZE - 1)) {
+      line[line_length++] = (char)c;
+    } else {
+      line_overflow = true;
+    }
+  }
+}
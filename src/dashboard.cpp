@@ -0,0 +1,181 @@
+/**
+ * @file dashboard.cpp
+ * @version 0.1
+ * @brief ダッシュボード（状態 JSON・Server-Sent Events 配信）
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <string.h>
+#include "dashboard.h"
+#include "dashboard_html.h"
+#include "bg770.h"
+#include "shadow.h"
+#include "outbox.h"
+#include "mqtt_lane.h"
+#include "diag.h"
+#include "CK_1540_01.h"
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief イベント配信のヘッダ */
+#define DASHBOARD_EVENT_HEADER  "HTTP/1.1 200 OK\r\n" \
+                                "Content-Type: text/event-stream\r\n" \
+                                "Cache-Control: no-cache\r\n" \
+                                "Connection: keep-alive\r\n\r\n"
+
+/**************************************************************************************************
+ * LOCAL VARIABLES
+ */
+/** @brief 配信先 */
+static WiFiClient clients[DASHBOARD_EVENT_CLIENTS];
+/** @brief 配信先の使用中フラグ */
+static bool client_used[DASHBOARD_EVENT_CLIENTS];
+/** @brief 前回配信した状態（diag を除く部分） */
+static char last_state[DASHBOARD_STATUS_SIZE];
+/** @brief 前回配信した状態の長さ */
+static uint16_t last_state_len = 0;
+/** @brief 前回の確認時刻 */
+static unsigned long last_check_ms = 0;
+/** @brief 前回の配信時刻 */
+static unsigned long last_sent_ms = 0;
+
+/**
+ * @brief 状態 JSON の作成関数
+ * @param[out] buf :出力先
+ * @param[in] size :出力先のサイズ
+ * @param[out] state_len :diag を除く部分の長さ（変化の判定に使う）
+ * @return 書き込んだ長さ
+ */
+static uint16_t dashboard_build(char buf[], uint16_t size, uint16_t *state_len)
+{
+  outbox_stats_t ob;
+  mqtt_lane_stats_t bulk;
+  diag_snapshot_t diag;
+  int len;
+
+  outbox_get_stats(&ob);
+  mqtt_lane_get_stats(MQTT_LANE_BULK, &bulk);
+  len = snprintf(buf, size,
+                 "{\"state\":%d,\"rssi\":%d,\"lan\":\"%s\",\"wan\":\"%s\",\"sw\":\"%s\","
+                 "\"outbox\":{\"queued\":%u,\"sent\":%lu,\"dropped\":%lu},\"bulk\":{\"open\":%u,\"inflight\":%u}",
+                 (int)bg_state, bg770_get_rssi(), shadow_color_name(shadow_get_led(SHADOW_LED_LAN)),
+                 shadow_color_name(shadow_get_led(SHADOW_LED_WAN)), (digitalRead(PORT_INP_SW) == 0) ? "ON" : "OFF",
+                 ob.queued, (unsigned long)ob.sent, (unsigned long)ob.dropped, bulk.open ? 1 : 0, bulk.inflight);
+  if ((len < 0) || (len >= size)) {
+    *state_len = 0;
+    return 0;
+  }
+  *state_len = (uint16_t)len;
+
+  diag_get_snapshot(&diag);
+  len += snprintf(&buf[len], size - len, ",\"diag\":{\"uptime\":%lu,\"heap\":%lu}}", (unsigned long)diag.uptime,
+                  (unsigned long)diag.free_heap);
+
+  return (len < size) ? (uint16_t)len : 0;
+}
+
+/*************************************************************************************************/
+uint16_t dashboard_build_status(char buf[], uint16_t size)
+{
+  uint16_t state_len;
+  return dashboard_build(buf, size, &state_len);
+}
+
+/**
+ * @brief 1 件の配信関数（書き込めなければ配信先を外す）
+ * @param[in] i :配信先
+ * @param[in] json :状態 JSON
+ * @param[in] len :状態 JSON の長さ
+ */
+static void dashboard_send(uint8_t i, const char *json, uint16_t len)
+{
+  WiFiClient &c = clients[i];
+  if (!c.connected() || (6 != c.write("data: ", 6)) || (len != c.write(json, len)) || (2 != c.write("\n\n", 2))) {
+    c.stop();
+    clients[i] = WiFiClient();
+    client_used[i] = false;
+  }
+}
+
+/*************************************************************************************************/
+bool dashboard_add_client(WiFiClient client)
+{
+  for (uint8_t i = 0; i < DASHBOARD_EVENT_CLIENTS; i++) {
+    if (client_used[i] && !clients[i].connected()) {
+      clients[i].stop();
+      client_used[i] = false;
+    }
+    if (!client_used[i]) {
+      char json[DASHBOARD_STATUS_SIZE];
+      clients[i] = client;
+      client_used[i] = true;
+      clients[i].setNoDelay(true);
+      clients[i].write(DASHBOARD_EVENT_HEADER, sizeof(DASHBOARD_EVENT_HEADER) - 1);
+      dashboard_send(i, json, dashboard_build_status(json, sizeof(json)));
+      return true;
+    }
+  }
+  return false;
+}
+
+/*************************************************************************************************/
+void dashboard_task(void)
+{
+  if ((millis() - last_check_ms) < DASHBOARD_EVENT_MS) {
+    return;
+  }
+  last_check_ms = millis();
+
+  bool any = false;
+  for (uint8_t i = 0; i < DASHBOARD_EVENT_CLIENTS; i++) {
+    any = any || client_used[i];
+  }
+  if (!any) {
+    return;
+  }
+
+  char json[DASHBOARD_STATUS_SIZE];
+  uint16_t state_len;
+  uint16_t len = dashboard_build(json, sizeof(json), &state_len);
+  /* 稼働時間・ヒープは毎回変わるので比較しない */
+  bool changed = (state_len != last_state_len) || (0 != memcmp(json, last_state, state_len));
+  if ((0 == len) || (!changed && ((millis() - last_sent_ms) < DASHBOARD_KEEPALIVE_MS))) {
+    return;
+  }
+  memcpy(last_state, json, state_len);
+  last_state_len = state_len;
+  last_sent_ms = millis();
+
+  for (uint8_t i = 0; i < DASHBOARD_EVENT_CLIENTS; i++) {
+    if (client_used[i]) {
+      dashboard_send(i, json, len);
+    }
+  }
+}
+
+/*************************************************************************************************/
+const uint8_t *dashboard_page(size_t *length)
+{
+  *length = sizeof(dashboard_html_gz);
+  return dashboard_html_gz;
+}
+
+/*************************************************************************************************/
+const char *dashboard_etag(void)
+{
+  static char etag[11] = "";
+  if ('\0' == etag[0]) {
+    /* gzip の末尾 8 byte は CRC32（リトルエンディアン）と元の長さ */
+    const uint8_t *crc = &dashboard_html_gz[sizeof(dashboard_html_gz) - 8];
+    snprintf(etag, sizeof(etag), "\"%02x%02x%02x%02x\"", pgm_read_byte(&crc[3]), pgm_read_byte(&crc[2]),
+             pgm_read_byte(&crc[1]), pgm_read_byte(&crc[0]));
+  }
+  return etag;
+}
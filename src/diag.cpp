@@ -0,0 +1,95 @@
+/**
+ * @file diag.cpp
+ * @version 0.1
+ * @brief メモリ・スタック診断
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include "diag.h"
+#include "config.h"
+
+/**************************************************************************************************
+ * LOCAL VARIABLES
+ */
+/** @brief 監視タスク */
+static TaskHandle_t tasks[DIAG_TASK_MAX];
+/** @brief 監視タスク名 */
+static const char *task_names[DIAG_TASK_MAX];
+/** @brief 監視タスク数 */
+static uint8_t task_count = 0;
+/** @brief 前回ハートビート時刻 */
+static unsigned long last_heartbeat = 0;
+
+/*************************************************************************************************/
+void diag_init(void)
+{
+  task_count = 0;
+  diag_register_task(xTaskGetCurrentTaskHandle(), "loop");
+  last_heartbeat = millis();
+}
+
+/*************************************************************************************************/
+void diag_register_task(TaskHandle_t task, const char *name)
+{
+  if ((NULL == task) || (task_count >= DIAG_TASK_MAX)) {
+    return;
+  }
+  tasks[task_count] = task;
+  task_names[task_count] = name;
+  ++task_count;
+}
+
+/*************************************************************************************************/
+void diag_get_snapshot(diag_snapshot_t *snapshot)
+{
+  snapshot->uptime = millis() / 1000;
+  snapshot->free_heap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  snapshot->largest_block = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  snapshot->min_free_heap = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+  snapshot->fragmentation = (0 == snapshot->free_heap) ? 0
+                          : (uint8_t)(100 - (uint64_t)snapshot->largest_block * 100 / snapshot->free_heap);
+
+  snapshot->task_count = task_count;
+  for (uint8_t i = 0; i < task_count; i++) {
+    snapshot->task_name[i] = task_names[i];
+    /* ESP-IDF の high water mark はバイト単位 */
+    snapshot->stack_free[i] = uxTaskGetStackHighWaterMark(tasks[i]);
+  }
+}
+
+/*************************************************************************************************/
+uint16_t diag_build_json(char *buf, uint16_t size)
+{
+  diag_snapshot_t s;
+  diag_get_snapshot(&s);
+
+  int len = snprintf(buf, size, "{\"hb\":{\"up\":%lu,\"heap\":%lu,\"max\":%lu,\"min\":%lu,\"frag\":%u,\"stk\":{",
+                     (unsigned long)s.uptime, (unsigned long)s.free_heap, (unsigned long)s.largest_block,
+                     (unsigned long)s.min_free_heap, s.fragmentation);
+  for (uint8_t i = 0; (i < s.task_count) && (len < size); i++) {
+    len += snprintf(&buf[len], size - len, "%s\"%s\":%lu", (0 == i) ? "" : ",", s.task_name[i],
+                    (unsigned long)s.stack_free[i]);
+  }
+  if (len < size) {
+    len += snprintf(&buf[len], size - len, "}}}");
+  }
+
+  return (len < size) ? (uint16_t)len : (uint16_t)(size - 1);
+}
+
+/*************************************************************************************************/
+bool diag_heartbeat_due(void)
+{
+  if ((millis() - last_heartbeat) < config_get()->heartbeat_ms) {
+    return false;
+  }
+  last_heartbeat = millis();
+  return true;
+}
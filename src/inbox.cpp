@@ -0,0 +1,336 @@
+/**
+ * @file inbox.cpp
+ * @version 0.1
+ * @brief サブスクライブ受信の重複除去・順序整列
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <stdlib.h>
+#include <string.h>
+#include "inbox.h"
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief RTC メモリの有効確認値 */
+#define INBOX_MAGIC 0x494E4258UL
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief 受信済みの msgID */
+typedef struct st_inbox_seen
+{
+  /** @brief 使用中 */
+  bool used;
+  /** @brief client idx */
+  uint8_t lane;
+  /** @brief msgID */
+  uint16_t msgid;
+  /** @brief TOPIC・ペイロードのハッシュ */
+  uint32_t hash;
+  /** @brief 受信時刻 */
+  unsigned long time_ms;
+} inbox_seen_t;
+
+/** @brief TOPIC 毎の seq */
+typedef struct st_inbox_topic
+{
+  /** @brief 使用中 */
+  bool used;
+  /** @brief seq を受けた（起動後、またはリセット前から） */
+  bool valid;
+  /** @brief TOPIC のハッシュ */
+  uint32_t hash;
+  /** @brief 最後に渡した seq */
+  uint32_t last;
+} inbox_topic_t;
+
+/** @brief TOPIC 毎の seq（RTC メモリに配置） */
+typedef struct st_inbox_rtc
+{
+  /** @brief 有効確認値 */
+  uint32_t magic;
+  /** @brief TOPIC 毎の seq */
+  inbox_topic_t topics[INBOX_TOPIC_MAX];
+} inbox_rtc_t;
+
+/** @brief 保留中のメッセージ */
+typedef struct st_inbox_hold
+{
+  /** @brief 使用中 */
+  bool used;
+  /** @brief 処理関数の実行中（再入で捨てない） */
+  bool delivering;
+  /** @brief TOPIC（topics の位置） */
+  uint8_t topic;
+  /** @brief seq */
+  uint32_t seq;
+  /** @brief 保留した時刻 */
+  unsigned long held_ms;
+  /** @brief レーンの処理関数 */
+  void (*handler)(const at_line_t *line);
+  /** @brief +QMTRECV の行 */
+  char content[INBOX_HOLD_SIZE];
+} inbox_hold_t;
+
+/**************************************************************************************************
+ * LOCAL VARIABLES
+ */
+/** @brief 受信済みの msgID（msgID の下位ビットで引く） */
+static inbox_seen_t seen[INBOX_DEDUP_SLOTS];
+/** @brief TOPIC 毎の seq（リセットで初期化されない） */
+static RTC_NOINIT_ATTR inbox_rtc_t rtc;
+/** @brief 保留中のメッセージ */
+static inbox_hold_t holds[INBOX_HOLD_SLOTS];
+/** @brief 統計 */
+static inbox_stats_t stats;
+
+/**
+ * @brief ハッシュ関数（FNV-1a）
+ * @param[in] hash :途中のハッシュ値
+ * @param[in] data :データ
+ * @param[in] length :長さ
+ * @return ハッシュ値
+ */
+static uint32_t inbox_hash(uint32_t hash, const char *data, size_t length)
+{
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ (uint8_t)data[i]) * 16777619UL;
+  }
+  return hash;
+}
+
+/**
+ * @brief TOPIC の検索・追加関数
+ * @param[in] hash :TOPIC のハッシュ
+ * @return topics の位置（-1：一杯）
+ */
+static int8_t inbox_topic(uint32_t hash)
+{
+  int8_t free_slot = -1;
+  for (uint8_t i = 0; i < INBOX_TOPIC_MAX; i++) {
+    if (rtc.topics[i].used && (rtc.topics[i].hash == hash)) {
+      return (int8_t)i;
+    }
+    if (!rtc.topics[i].used && (free_slot < 0)) {
+      free_slot = (int8_t)i;
+    }
+  }
+  if (free_slot >= 0) {
+    memset(&rtc.topics[free_slot], 0, sizeof(rtc.topics[free_slot]));
+    rtc.topics[free_slot].used = true;
+    rtc.topics[free_slot].hash = hash;
+  }
+  return free_slot;
+}
+
+/**
+ * @brief 渡し済みの seq との比較関数（一周を考慮）
+ * @param[in] seq :seq
+ * @param[in] last :最後に渡した seq
+ * @return 差（0 以下：古い）
+ */
+static int32_t inbox_seq_diff(uint32_t seq, uint32_t last) { return (int32_t)(seq - last); }
+
+/**
+ * @brief 保留中のメッセージを渡す関数
+ * @param[in,out] hold :保留中のメッセージ
+ */
+static void inbox_deliver_hold(inbox_hold_t *hold)
+{
+  at_line_t line;
+
+  hold->delivering = true;
+  rtc.topics[hold->topic].last = hold->seq;
+  at_classify(hold->content, &line);
+  ++stats.reordered;
+  ++stats.delivered;
+  hold->handler(&line);
+  hold->used = false;
+  hold->delivering = false;
+}
+
+/**
+ * @brief 続きの seq の保留を渡す関数（古くなった保留は捨てる）
+ * @param[in] topic :topics の位置
+ */
+static void inbox_release(uint8_t topic)
+{
+  bool found = true;
+  while (found) {
+    found = false;
+    for (uint8_t i = 0; i < INBOX_HOLD_SLOTS; i++) {
+      inbox_hold_t *hold = &holds[i];
+      if (!hold->used || hold->delivering || (hold->topic != topic)) {
+        continue;
+      }
+      int32_t diff = inbox_seq_diff(hold->seq, rtc.topics[topic].last);
+      if (diff <= 0) {
+        hold->used = false;
+        ++stats.stale;
+      } else if (1 == diff) {
+        inbox_deliver_hold(hold);
+        found = true;
+      }
+    }
+  }
+}
+
+/**
+ * @brief ペイロードの seq の取得関数
+ * @param[in] payload :ペイロード
+ * @param[out] seq :seq
+ * @return true：有り
+ */
+static bool inbox_parse_seq(const char *payload, uint32_t *seq)
+{
+  const char *p = strstr(payload, "\"seq\":");
+  if (NULL == p) {
+    return false;
+  }
+  p += 6;
+  while (' ' == *p) {
+    ++p;
+  }
+  if ((*p < '0') || ('9' < *p)) {
+    return false;
+  }
+  *seq = (uint32_t)strtoul(p, NULL, 10);
+  return true;
+}
+
+/*************************************************************************************************/
+void inbox_init(void)
+{
+  if (INBOX_MAGIC != rtc.magic) {
+    /* 電源投入時（RTC メモリは不定値） */
+    memset(&rtc, 0, sizeof(rtc));
+    rtc.magic = INBOX_MAGIC;
+  }
+  memset(seen, 0, sizeof(seen));
+  memset(holds, 0, sizeof(holds));
+  memset(&stats, 0, sizeof(stats));
+}
+
+/*************************************************************************************************/
+void inbox_receive(const at_line_t *line, void (*handler)(const at_line_t *line))
+{
+  ++stats.received;
+
+  /* <client_idx>,<msgID>,"<topic>","<payload>" */
+  char *p;
+  uint8_t lane = (uint8_t)strtoul(line->args, &p, 10);
+  uint16_t msgid = (',' == *p) ? (uint16_t)strtoul(p + 1, &p, 10) : 0;
+  const char *topic = (',' == *p) ? strchr(p, '"') : NULL;
+  const char *topic_end = (NULL != topic) ? strchr(topic + 1, '"') : NULL;
+  if (NULL == topic_end) {
+    /* 形式が違う行はそのまま渡す */
+    ++stats.delivered;
+    handler(line);
+    return;
+  }
+  const char *payload = topic_end + 1;
+
+  /* 再配信（同じ msgID・同じ内容） */
+  uint32_t topic_hash = inbox_hash(2166136261UL, topic + 1, topic_end - (topic + 1));
+  uint32_t hash = inbox_hash(topic_hash ^ lane, payload, strlen(payload));
+  if (0 != msgid) {
+    inbox_seen_t *s = &seen[msgid & (INBOX_DEDUP_SLOTS - 1)];
+    if (s->used && (s->lane == lane) && (s->msgid == msgid) && (s->hash == hash) &&
+        ((millis() - s->time_ms) < INBOX_DEDUP_MS)) {
+      ++stats.duplicates;
+      return;
+    }
+    s->used = true;
+    s->lane = lane;
+    s->msgid = msgid;
+    s->hash = hash;
+    s->time_ms = millis();
+  }
+
+  uint32_t seq;
+  int8_t t = inbox_parse_seq(payload, &seq) ? inbox_topic(topic_hash) : -1;
+  if (t < 0) {
+    ++stats.delivered;
+    handler(line);
+    return;
+  }
+  inbox_topic_t *state = &rtc.topics[t];
+  int32_t diff = inbox_seq_diff(seq, state->last);
+  if (state->valid && (diff <= 0)) {
+    ++stats.stale;
+    return;
+  }
+
+  if (state->valid && (diff > 1)) {
+    /* 抜けた seq を待つ（同じ seq の保留は再配信） */
+    int8_t free_slot = -1;
+    for (uint8_t i = 0; i < INBOX_HOLD_SLOTS; i++) {
+      if (holds[i].used && (holds[i].topic == (uint8_t)t) && (holds[i].seq == seq)) {
+        ++stats.duplicates;
+        return;
+      }
+      if (!holds[i].used && (free_slot < 0)) {
+        free_slot = (int8_t)i;
+      }
+    }
+    size_t length = strlen(line->content);
+    if ((free_slot >= 0) && (length < INBOX_HOLD_SIZE)) {
+      inbox_hold_t *hold = &holds[free_slot];
+      hold->used = true;
+      hold->delivering = false;
+      hold->topic = (uint8_t)t;
+      hold->seq = seq;
+      hold->held_ms = millis();
+      hold->handler = handler;
+      memcpy(hold->content, line->content, length + 1);
+      return;
+    }
+    ++stats.gaps;
+  }
+
+  state->valid = true;
+  state->last = seq;
+  ++stats.delivered;
+  handler(line);
+  inbox_release((uint8_t)t);
+}
+
+/*************************************************************************************************/
+void inbox_task(void)
+{
+  for (uint8_t i = 0; i < INBOX_HOLD_SLOTS; i++) {
+    if (!holds[i].used || holds[i].delivering || ((millis() - holds[i].held_ms) < INBOX_HOLD_MS)) {
+      continue;
+    }
+    /* 抜けた seq は届かなかったものとして、同じ TOPIC の最小の保留から渡す */
+    uint8_t topic = holds[i].topic;
+    uint32_t first = holds[i].seq;
+    for (uint8_t j = 0; j < INBOX_HOLD_SLOTS; j++) {
+      if (holds[j].used && !holds[j].delivering && (holds[j].topic == topic) &&
+          (inbox_seq_diff(holds[j].seq, first) < 0)) {
+        first = holds[j].seq;
+      }
+    }
+    ++stats.gaps;
+    rtc.topics[topic].last = first - 1;
+    inbox_release(topic);
+  }
+}
+
+/*************************************************************************************************/
+void inbox_get_stats(inbox_stats_t *p_stats)
+{
+  *p_stats = stats;
+  p_stats->held = 0;
+  for (uint8_t i = 0; i < INBOX_HOLD_SLOTS; i++) {
+    p_stats->held += holds[i].used ? 1 : 0;
+  }
+}
@@ -0,0 +1,190 @@
+/**
+ * @file loadgen.cpp
+ * @version 0.1
+ * @brief 連続パブリッシュ負荷試験
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bg770.h"
+#include "loadgen.h"
+#include "setup_define.h"
+
+/**************************************************************************************************
+ * LOCAL VARIABLES
+ */
+/** @brief 設定 */
+static loadgen_config_t config;
+/** @brief 実行中 */
+static bool running = false;
+/** @brief 送信成功数 */
+static uint32_t sent = 0;
+/** @brief 送信失敗数 */
+static uint32_t failed = 0;
+/** @brief 送信バイト数 */
+static uint32_t sent_bytes = 0;
+/** @brief 開始時の BG770 リセット数 */
+static uint32_t resets_at_start = 0;
+/** @brief 開始時刻[ms] */
+static unsigned long start_ms = 0;
+/** @brief 終了時刻[ms]（実行中は 0） */
+static unsigned long end_ms = 0;
+/** @brief 次回送信時刻[ms] */
+static unsigned long next_ms = 0;
+/** @brief 遅延[ms] */
+static uint32_t samples[LOADGEN_SAMPLES];
+
+/**
+ * @brief 合成ペイロード作成関数
+ * @param[in] seq :通番
+ * @return ペイロード長
+ */
+static uint16_t loadgen_build_payload(uint32_t seq)
+{
+  char *buf = (char *)Publish_payload;
+  int len = snprintf(buf, PUBLISH_SIZE, "{\"lg\":%lu,\"t\":%lu,\"p\":\"", (unsigned long)seq, millis());
+
+  /* 閉じ括弧 2 文字を残して埋める */
+  while (len < (config.size - 2)) {
+    buf[len++] = 'x';
+  }
+  buf[len++] = '"';
+  buf[len++] = '}';
+
+  return (uint16_t)len;
+}
+
+/**
+ * @brief 遅延の記録関数（LOADGEN_SAMPLES を超えたら置き換えサンプリング）
+ * @param[in] latency :遅延[ms]
+ */
+static void loadgen_record(uint32_t latency)
+{
+  if (sent <= LOADGEN_SAMPLES) {
+    samples[sent - 1] = latency;
+  } else {
+    uint32_t slot = random(sent);
+    if (slot < LOADGEN_SAMPLES) {
+      samples[slot] = latency;
+    }
+  }
+}
+
+/*************************************************************************************************/
+void loadgen_start(const loadgen_config_t *p_config)
+{
+  bg770_stats_t stats;
+
+  config = *p_config;
+  if (config.size < LOADGEN_MIN_SIZE) {
+    config.size = LOADGEN_MIN_SIZE;
+  } else if (config.size > PUBLISH_SIZE) {
+    config.size = PUBLISH_SIZE;
+  }
+  /* シャドウ更新の種別はシャドウの TOPIC に送ってしまうので使わない */
+  if ((UPLINK_CLASS_SHADOW == config.cls) || (config.cls >= UPLINK_CLASS_MAX)) {
+    config.cls = LOADGEN_CLASS;
+  }
+
+  bg770_get_stats(&stats);
+  resets_at_start = stats.resets;
+  sent = 0;
+  failed = 0;
+  sent_bytes = 0;
+  start_ms = millis();
+  end_ms = 0;
+  next_ms = start_ms;
+  running = true;
+}
+
+/*************************************************************************************************/
+void loadgen_stop(void)
+{
+  if (running) {
+    running = false;
+    end_ms = millis();
+  }
+}
+
+/*************************************************************************************************/
+bool loadgen_running(void) { return running; }
+
+/*************************************************************************************************/
+api_status_t loadgen_task(void)
+{
+  if (!running || ((long)(millis() - next_ms) < 0)) {
+    return API_STATUS_SUCCESS;
+  }
+  if (0 != config.rate) {
+    next_ms += 60000UL / config.rate;
+  }
+
+  Publish_length = loadgen_build_payload(sent + failed);
+  unsigned long begin = millis();
+  api_status_t result = uplink_publish(config.cls);
+  if (API_STATUS_SUCCESS == result) {
+    ++sent;
+    sent_bytes += Publish_length;
+    loadgen_record(millis() - begin);
+  } else {
+    ++failed;
+    /* リセット中の遅れを取り戻そうと連続送信しないよう送信時刻を合わせ直す */
+    next_ms = millis();
+  }
+
+  if ((0 != config.count) && ((sent + failed) >= config.count)) {
+    loadgen_stop();
+  }
+  return result;
+}
+
+/**
+ * @brief 昇順比較関数（qsort 用）
+ */
+static int loadgen_compare(const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *)a;
+  uint32_t y = *(const uint32_t *)b;
+  return (x > y) - (x < y);
+}
+
+/*************************************************************************************************/
+uint16_t loadgen_build_report(char *buf, uint16_t size)
+{
+  bg770_stats_t stats;
+  uint32_t p[3] = {0, 0, 0};
+  static const uint8_t percent[3] = {50, 95, 99};
+
+  uint32_t count = (sent < LOADGEN_SAMPLES) ? sent : LOADGEN_SAMPLES;
+  if (0 != count) {
+    static uint32_t sorted[LOADGEN_SAMPLES];
+    memcpy(sorted, samples, count * sizeof(uint32_t));
+    qsort(sorted, count, sizeof(uint32_t), loadgen_compare);
+    for (uint8_t i = 0; i < 3; i++) {
+      p[i] = sorted[(count - 1) * percent[i] / 100];
+    }
+  }
+
+  bg770_get_stats(&stats);
+  uint32_t elapsed = (running ? millis() : end_ms) - start_ms;
+  uint32_t divisor = (0 == elapsed) ? 1 : elapsed;
+
+  int len = snprintf(buf, size,
+                     "{\"lg\":{\"run\":%u,\"cls\":%u,\"sent\":%lu,\"fail\":%lu,\"resets\":%lu,\"ms\":%lu,"
+                     "\"mps\":%lu.%02lu,\"bps\":%lu,\"p50\":%lu,\"p95\":%lu,\"p99\":%lu}}",
+                     running ? 1 : 0, (unsigned int)config.cls, (unsigned long)sent, (unsigned long)failed,
+                     (unsigned long)(stats.resets - resets_at_start), (unsigned long)elapsed,
+                     (unsigned long)((uint64_t)sent * 1000 / divisor),
+                     (unsigned long)((uint64_t)sent * 100000 / divisor % 100),
+                     (unsigned long)((uint64_t)sent_bytes * 1000 / divisor), (unsigned long)p[0],
+                     (unsigned long)p[1], (unsigned long)p[2]);
+
+  return (len < size) ? (uint16_t)len : (uint16_t)(size - 1);
+}
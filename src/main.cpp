@@ -16,6 +16,28 @@
 #include "bg770.h"
 #include "CK_1540_01.h"
 #include "setup_define.h"
+#include "subghz.h"
+#include "can_bus.h"
+#include "uplink.h"
+#include "diag.h"
+#include "trace.h"
+#include "modem_capture.h"
+#include "bench.h"
+#include "loadgen.h"
+#include "console.h"
+#include "at_response.h"
+#include "mqtt_lane.h"
+#include "outbox.h"
+#include "shadow.h"
+#include "dashboard.h"
+#include "tsdb.h"
+#include "power.h"
+#include "config.h"
+#include "ota.h"
+#include "mqtt_session.h"
+#include "supervisor.h"
+#include "rule.h"
+#include "inbox.h"
 #include <WiFi.h>
 #include <WebServer.h>
 #include "ArduinoJson.h"
@@ -23,117 +45,169 @@
 /***************************************************************************************************
  * LOCAL FUNCTIONS
  */
+WebServer server(80);
 /**
- * @brief パブリッシュペイロードの作成関数
- * @param[in/out] buf:作成したペイロードを入力するバッファ
- * @return 作成したペイロード長
+ * @brief Sub-GHz 集計結果のパブリッシュ関数
  */
-
-WebServer server(80);
-uint16_t publish_payload_build(char buf[],String command);
+static void subghz_publish(void);
+/**
+ * @brief Sub-GHz 集計結果の取り出し関数（送信せず履歴にだけ保存）
+ */
+static void subghz_drain(void);
+/**
+ * @brief CAN 信号のパブリッシュ関数（設定の can_publish_ms 毎）
+ */
+void can_publish(void);
+/**
+ * @brief 診断ハートビートのパブリッシュ関数（設定の heartbeat_ms 毎）
+ */
+static void diag_publish(void);
+/**
+ * @brief 障害後のトレース送信関数（再接続直後に 1 回）
+ */
+static void trace_publish(void);
+/**
+ * @brief 負荷試験結果の表示・パブリッシュ関数
+ */
+static void loadgen_report(void);
+/**
+ * @brief Sub-GHz 集計結果の履歴保存関数（チャンネル毎の平均値）
+ * @param[in] aggregate :集計結果
+ */
+static void subghz_record(const subghz_aggregate_t *aggregate);
+/**
+ * @brief サブスクライブ受信（+QMTRECV）の処理関数
+ * @param[in] line :分類済みの行
+ */
+static void urc_qmtrecv(const at_line_t *line);
 
 /**  Main setup **/
 void setup() {
+  /* CPU クロック制御（応答待ちは最低クロック、送信データ作成は 240MHz） */
+  power_init();
+  /* 実行時設定（NVS） */
+  config_init();
+  /* 診断の初期化（loop タスクを登録） */
+  diag_init();
+  /* AT トレースの初期化（リセット前の記録を引き継ぐ） */
+  trace_init();
   /* GPIOの初期化 */
   initGPIO();
+  /* 処理時間の監視（ウォッチドッグ・段階的な復旧。BG770 リセットに GPIO を使う） */
+  supervisor_init();
   /* シリアル通信の初期化（デバッグ用） */
   Serial.begin(115200);
   while (!Serial); 
   Serial.println("Starting Serial Monitor");
+  /* 前回の障害時のトレースを表示 */
+  if (trace_failure_pending()) {
+    trace_dump(Serial);
+  }
 
+#ifdef BENCHMARK
+  /* 文字列・ペイロード処理のベンチマーク（基準値との比較はホストの env:bench_native で行う） */
+  bench_run(Serial, NULL, NULL);
+#endif
+#ifdef MODEM_CAPTURE
+  /* BG770 通信の記録開始（起動直後の RDY から記録する） */
+  modem_capture_start(MODEM_CAPTURE_SIZE);
+#endif
   bg770_init();
+  /* MQTT レーン管理（制御レーンのサブスクライブ受信を処理） */
+  mqtt_lane_init();
+  mqtt_lane_set_recv_handler(MQTT_LANE_CONTROL, urc_qmtrecv);
+  /* サブスクライブ受信の重複除去・順序整列（再配信・古いコマンドを処理前に捨てる） */
+  inbox_init();
+  /* デバイス状態（LED・スイッチ等）とシャドウの同期 */
+  shadow_init();
+  /* 時系列データの保存（tsdb パーティション） */
+  if (!tsdb_init()) {
+    Serial.println("tsdb partition not found");
+  }
+  /* ファームウェア更新（途中の更新があれば再開） */
+  ota_init();
+  /* ルールエンジン（Sub-GHz・CAN より先に起動し、受信タスクからのイベントを受ける） */
+  rule_init();
+  /* Sub-GHz ゲートウェイ（CC1310）の起動 */
+  subghz_init();
+  subghz_set_record_handler(subghz_record);
+  /* CAN(TWAI) 受信の起動 */
+  can_init();
 }
 /**  Main loop **/
 void loop() {
   static unsigned long pressedTime = 0;
   static bool isPressed = false;
-  String jsonString;
-  String command;
-  String color;
-  String SW;
-  StaticJsonDocument<200> doc;
+
+  /* loop 1 周の計時・上限超過で BG770 をリセットした後の状態の初期化 */
+  supervisor_task();
 
   if(bg_state == BG770_STATE_INIT_COMMAND_SEQUENCE){
    while(bg_state != BG770_STATE_SUBSCRIBE){
+     /* 接続の試行毎に loop 1 周の計時をやり直す（圏外でリセットを繰り返しても LOOP の上限を超えない） */
+     supervisor_task();
      if(init_command_sequence_task() == API_STATUS_FAIL){ bg770_reset(); };
+     /* 回線断の間の集計は履歴にだけ残す（クラウドから範囲要求で取得） */
+     subghz_drain();
      delay(1);
    }
    Serial.println("Subscribe Start");
+   /* 履歴の時刻（失敗しても前回の時刻で続ける） */
+   if(execute(&ntp_command) != API_STATUS_SUCCESS){ Serial.println("NTP failed"); }
+   /* バルクレーン（client idx 1）の接続 */
+   mqtt_lane_open();
+   /* 接続毎に全項目をシャドウへ報告し直す */
+   shadow_resync();
+#ifdef MODEM_CAPTURE
+   bg770_stats_t stats;
+   bg770_get_stats(&stats);
+   Serial.printf("subscribe=%lums resets=%lu lines=%lu us/line=%lu\n", (unsigned long)stats.subscribe_ms,
+                 (unsigned long)stats.resets, (unsigned long)stats.lines,
+                 (unsigned long)(stats.line_us / (stats.lines ? stats.lines : 1)));
+#endif
+   trace_publish();
   }
 
-   if (command.length() == 0) {
-    Serial.println("Please enter a command");
-    while (!Serial.available()) {
-      delay(100); // データが利用可能になるまで待機
-    }
-    command = Serial.readStringUntil('\n');
-    doc["command"] = command; // JSON形式のcommandに格納
-  }
-    if (command == "002") {
-      if(digitalRead(PORT_INP_SW) == 0){
-        doc["command"] = command;
-        doc["SW"] = "ON";
-      }
-      if(digitalRead(PORT_INP_SW) == 1){
-        doc["command"] = command;
-        doc["SW"] = "OFF";
-      }
-      serializeJson(doc,jsonString);
-      serializeJson(doc,Serial);
-      Publish_length = publish_payload_build((char *)Publish_payload,jsonString);
-      if(execute(&unsubscribe_command) == API_STATUS_FAIL){ bg770_reset(); }
-      if(execute(&publish_command) == API_STATUS_FAIL){ bg770_reset(); }
-
-      command = ""; // コマンドをリセットして、次の入力を待つ
-      return;
-    }
+  bool loadgen_active = loadgen_running();
+  /* 負荷試験（実行中のみ送信する） */
+  uint8_t stage = supervisor_enter(SUPERVISOR_STAGE_PUBLISH, 0, "loadgen");
+  api_status_t sent = loadgen_task();
+  supervisor_leave(stage);
+  if(sent == API_STATUS_FAIL){ bg770_reset(); }
+  /* Sub-GHz センサーの集計結果を送信 */
+  subghz_publish();
+  /* CAN 信号の変化分を送信 */
+  can_publish();
+  /* メモリ・スタックのハートビートを送信 */
+  diag_publish();
+  /* ルールで点灯した LED をシャドウへ反映、送信動作を送信待ちへ */
+  rule_task();
+  /* デバイス状態の変化分をシャドウへ報告 */
+  shadow_task();
+  /* 履歴の保存期間切れ消去・範囲要求の送信 */
+  tsdb_task(bg770_get_time());
+  /* ファームウェア更新（1 範囲ずつダウンロード） */
+  ota_task();
+  /* 送信待ちを期限順に 1 件送信 */
+  stage = supervisor_enter(SUPERVISOR_STAGE_PUBLISH, 0, "outbox");
+  sent = outbox_task();
+  supervisor_leave(stage);
+  if(sent == API_STATUS_FAIL){ bg770_reset(); }
+  /* 接続先の設定変更は送信待ちが空になってから再接続で反映 */
+  outbox_stats_t ob;
+  outbox_get_stats(&ob);
+  if (config_link_due(0 == ob.queued) && (API_STATUS_SUCCESS != bg770_reconnect())) { bg770_reset(); }
+  /* コマンド実行外で届いたサブスクライブ・PUBACK 等を処理 */
+  bg770_poll();
+  /* 切断したレーンの再接続 */
+  mqtt_lane_task();
+  /* 抜けた seq を待つ保留の期限切れを処理 */
+  inbox_task();
+  /* 制御レーンのセッション保持時間の起点を更新・省いたサブスクライブの確認 */
+  if (mqtt_session_task() && (API_STATUS_SUCCESS != bg770_resubscribe())) { bg770_reset(); }
+  /* コンソール（届いた分だけ読み、待たない） */
+  console_task();
 
-  if (color.length() == 0) {
-    Serial.println("Please enter a color");
-    while (!Serial.available()) {
-      delay(100); // データが利用可能になるまで待機
-    }
-    color = Serial.readStringUntil('\n');
-    doc["color"] = color; // JSON形式のcolorに格納
-  }
-  // コマンドと色が両方とも入力されたら、判別を行う
-  serializeJson(doc, jsonString);
-  serializeJson(doc,Serial);
-  if (command.length() > 0 && color.length() > 0) {
-    Publish_length = publish_payload_build((char *)Publish_payload,jsonString);
-    if(execute(&unsubscribe_command) == API_STATUS_FAIL){ bg770_reset(); }
-    if(execute(&publish_command) == API_STATUS_FAIL){ bg770_reset(); }
-
-    if (command.equals("000")) {
-      if (color.equals("RED")) {
-        LAN_RED_ON();
-        LAN_GREEN_OFF();
-      } else if (color.equals("GREEN")) {
-        LAN_GREEN_ON();
-        LAN_RED_OFF();
-      }
-      else{
-        LAN_RED_OFF();
-        LAN_GREEN_OFF();
-      }
-    }
-    else if (command.equals("001")) {
-      if (color.equals("RED")) {
-        WAN_RED_ON();
-        WAN_GREEN_OFF();
-      } else if (color.equals("GREEN")) {
-        WAN_GREEN_ON();
-        WAN_RED_OFF();
-      }
-      else{
-        WAN_RED_OFF();
-        WAN_GREEN_OFF();
-      }
-    }
-    // 判別が終わったら、コマンドと色をリセット
-    command = "";
-    color = "";
-  }
   if (digitalRead(PORT_INP_SW) == LOW) { 
         if (!isPressed) { 
             isPressed = true;
@@ -145,14 +219,159 @@ void loop() {
     } else {
         isPressed = false;
     }
+  stage = supervisor_enter(SUPERVISOR_STAGE_HTTP, 0, "http");
   server.handleClient();
+  supervisor_leave(stage);
+  /* HTTP 応答で上げたクロックを戻す */
+  power_set(POWER_STATE_IDLE);
+  /* ダッシュボードへ状態の変化を配信 */
+  dashboard_task();
+  /* 送信数到達・コンソール/HTTP/MQTT からの停止で結果を送る */
+  if (loadgen_active && !loadgen_running()) { loadgen_report(); }
+}
+
+void subghz_publish(void)
+{
+  /* 送れなかった集計は期限切れで同じ種別とまとめて送る */
+  const outbox_attr_t attr = {UPLINK_CLASS_TELEMETRY, OUTBOX_PRIO_BULK, OUTBOX_KEY_NONE, OUTBOX_EXPIRE_MERGE,
+                              config_get()->telemetry_deadline_ms};
+  if (0 == subghz_pending()) {
+    return;
+  }
+  power_state_t power = power_set(POWER_STATE_BURST);
+  char payload[PUBLISH_SIZE];
+  uint16_t len;
+  while (0 != (len = subghz_build_payload(payload, PUBLISH_SIZE))) {
+    if (!outbox_post((const uint8_t *)payload, len, &attr)) { break; }
+  }
+  power_set(power);
+}
+
+void subghz_drain(void)
+{
+  char payload[PUBLISH_SIZE];
+  while (0 != subghz_build_payload(payload, PUBLISH_SIZE)) {
+  }
+}
+
+void subghz_record(const subghz_aggregate_t *aggregate)
+{
+  uint32_t now = bg770_get_time();
+  for (uint8_t ch = 0; ch < aggregate->channels; ch++) {
+    tsdb_append(TSDB_SERIES_SUBGHZ(aggregate->node, ch), now, (int32_t)(aggregate->sum[ch] / aggregate->count));
+  }
+}
+
+void can_publish(void)
+{
+  static unsigned long last_publish = 0;
+  if ((millis() - last_publish) < config_get()->can_publish_ms) {
+    return;
+  }
+  last_publish = millis();
+
+  const outbox_attr_t attr = {UPLINK_CLASS_TELEMETRY, OUTBOX_PRIO_BULK, OUTBOX_KEY_NONE, OUTBOX_EXPIRE_MERGE,
+                              config_get()->telemetry_deadline_ms};
+  power_state_t power = power_set(POWER_STATE_BURST);
+  char payload[PUBLISH_SIZE];
+  uint16_t len = can_build_payload(payload, PUBLISH_SIZE);
+  if (0 != len) {
+    outbox_post((const uint8_t *)payload, len, &attr);
+  }
+  power_set(power);
+}
+
+void diag_publish(void)
+{
+  if (!diag_heartbeat_due()) {
+    return;
+  }
+  /* 古いハートビートは最新で置き換え、次の周期までに送れなければ捨てる */
+  const outbox_attr_t attr = {UPLINK_CLASS_CONTROL, OUTBOX_PRIO_NORMAL, OUTBOX_KEY_HEARTBEAT, OUTBOX_EXPIRE_DROP,
+                              config_get()->diag_deadline_ms};
+  power_state_t power = power_set(POWER_STATE_BURST);
+  char payload[PUBLISH_SIZE];
+  uint16_t len = diag_build_json(payload, PUBLISH_SIZE);
+  outbox_post((const uint8_t *)payload, len, &attr);
+  power_set(power);
+}
+
+void trace_publish(void)
+{
+  if (!trace_failure_pending()) {
+    return;
+  }
+  uint8_t block = 0;
+  uint16_t len;
+  while (0 != (len = trace_build_blob((char *)Publish_payload, PUBLISH_SIZE, block))) {
+    Publish_length = len;
+    if(uplink_publish(UPLINK_CLASS_CONTROL) == API_STATUS_FAIL){ return; }
+    ++block;
+  }
+  trace_clear_failure();
+}
+
+void loadgen_report(void)
+{
+  Publish_length = loadgen_build_report((char *)Publish_payload, PUBLISH_SIZE);
+  Serial.println((char *)Publish_payload);
+  if(uplink_publish(UPLINK_CLASS_CONTROL) == API_STATUS_FAIL){ bg770_reset(); }
 }
 
-uint16_t publish_payload_build(char* buf,String jsonString)
+void urc_qmtrecv(const at_line_t *line)
 {
-  uint16_t len = 0;
-  /* message */
-  len += sprintf(buf,"%s",jsonString.c_str());
-  
-  return len;
-}
\ No newline at end of file
+  /* デバイスシャドウの desired 差分 */
+  if (shadow_is_delta(line)) {
+    shadow_apply_delta(RxData_Analize(line->content).c_str());
+    return;
+  }
+  /* 設定更新（結果を返す） */
+  if (config_is_update(line)) {
+    const char *key;
+    config_result_t result = config_update(RxData_Analize(line->content).c_str(), &key);
+    const outbox_attr_t attr = {UPLINK_CLASS_CONTROL, OUTBOX_PRIO_NORMAL, OUTBOX_KEY_NONE, OUTBOX_EXPIRE_SEND,
+                                config_get()->diag_deadline_ms};
+    char payload[PUBLISH_SIZE];
+    uint16_t len = config_build_result(payload, sizeof(payload), result, key);
+    outbox_post((const uint8_t *)payload, len, &attr);
+    return;
+  }
+  String payload = RxData_Analize(line->content);
+  /* ルールの判定表（結果を返す。他のコマンドより大きいので別に解析する） */
+  if (rule_is_update(payload.c_str())) {
+    rule_result_t result = rule_update(payload.c_str());
+    const outbox_attr_t attr = {UPLINK_CLASS_CONTROL, OUTBOX_PRIO_NORMAL, OUTBOX_KEY_NONE, OUTBOX_EXPIRE_SEND,
+                                config_get()->diag_deadline_ms};
+    char buf[PUBLISH_SIZE];
+    uint16_t len = rule_build_result(buf, sizeof(buf), result);
+    outbox_post((const uint8_t *)buf, len, &attr);
+    return;
+  }
+  StaticJsonDocument<384> doc;
+  if (deserializeJson(doc, payload)) {
+    return;
+  }
+  const char *command = doc["command"] | "";
+  /* 負荷試験 {"command":"loadgen","count":n,"size":n,"rate":n,"class":n} / {"command":"loadgen_stop"} */
+  if (0 == strcmp(command, "loadgen")) {
+    loadgen_config_t config;
+    config.count = doc["count"] | 100;
+    config.size = doc["size"] | 256;
+    config.rate = doc["rate"] | 0;
+    config.cls = (uplink_class_t)(doc["class"] | (int)LOADGEN_CLASS);
+    loadgen_start(&config);
+  } else if (0 == strcmp(command, "range")) {
+    /* 履歴の範囲要求 {"command":"range","q":id,"t0":UTC秒,"t1":UTC秒} */
+    tsdb_query_start(doc["q"] | 0, doc["t0"] | 0, doc["t1"] | 0xFFFFFFFFUL);
+  } else if (0 == strcmp(command, "ota")) {
+    /* ファームウェア更新 {"command":"ota","url":"http://...","size":n,"sha256":"..."} */
+    if (API_STATUS_SUCCESS != ota_start(doc["url"] | "", doc["size"] | 0, doc["sha256"] | "")) {
+      Serial.println("OTA rejected");
+    }
+  } else if (0 == strcmp(command, "ota_cancel")) {
+    ota_cancel();
+  } else if (0 == strcmp(command, "loadgen_stop")) {
+    /* 結果は loop で送る（URC 処理中は送信しない） */
+    loadgen_stop();
+  }
+}
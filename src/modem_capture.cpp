@@ -0,0 +1,269 @@
+/**
+ * @file modem_capture.cpp
+ * @version 0.1
+ * @brief BG770 通信の記録・再生
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <string.h>
+#include "modem_capture.h"
+#include "bg770.h"
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief 形式の識別子 */
+static const uint8_t capture_magic[4] = {'M', 'C', 'A', 'P'};
+/** @brief 経過時間（LEB128）の最大長 */
+#define VARINT_MAX  5
+
+/**************************************************************************************************
+ * LOCAL VARIABLES
+ */
+/** @brief 記録ストリーム */
+static ModemCaptureStream capture;
+/** @brief 記録先 */
+static uint8_t *capture_buffer = NULL;
+/** @brief 記録先サイズ */
+static uint32_t capture_size = 0;
+
+/*************************************************************************************************/
+void ModemCaptureStream::begin(Stream *stream, uint8_t *buffer, uint32_t size)
+{
+  base = stream;
+  buf = buffer;
+  capacity = size;
+  overflow = 0;
+  open = 0;
+  last_ms = millis();
+  last_byte_ms = last_ms;
+
+  memcpy(buf, capture_magic, sizeof(capture_magic));
+  buf[4] = MODEM_CAPTURE_VERSION;
+  buf[5] = buf[6] = buf[7] = 0;
+  used = MODEM_CAPTURE_HEADER_SIZE;
+}
+
+/*************************************************************************************************/
+void ModemCaptureStream::append(uint8_t dir, uint8_t c)
+{
+  unsigned long now = millis();
+
+  /* 同じ方向で間を置かずに続くバイトは同じレコードに追記 */
+  if ((0 != open) && (open_dir == dir) && ((buf[open] & 0x7F) < (MODEM_CAPTURE_RECORD_MAX - 1))
+      && ((now - last_byte_ms) < MODEM_CAPTURE_MERGE_MS) && (used < capacity)) {
+    buf[used++] = c;
+    ++buf[open];
+    last_byte_ms = now;
+    return;
+  }
+
+  if ((used + 1 + VARINT_MAX + 1) > capacity) {
+    open = 0;
+    ++overflow;
+    return;
+  }
+
+  uint32_t delta = now - last_ms;
+  open = used;
+  open_dir = dir;
+  buf[used++] = dir;
+  do {
+    buf[used++] = (uint8_t)((delta & 0x7F) | ((delta > 0x7F) ? 0x80 : 0));
+    delta >>= 7;
+  } while (0 != delta);
+  buf[used++] = c;
+  last_ms = now;
+  last_byte_ms = now;
+}
+
+/*************************************************************************************************/
+int ModemCaptureStream::available(void) { return base->available(); }
+
+/*************************************************************************************************/
+int ModemCaptureStream::read(void)
+{
+  int c = base->read();
+  if (c >= 0) {
+    append(0, (uint8_t)c);
+  }
+  return c;
+}
+
+/*************************************************************************************************/
+int ModemCaptureStream::peek(void) { return base->peek(); }
+
+/*************************************************************************************************/
+size_t ModemCaptureStream::write(uint8_t c)
+{
+  append(MODEM_CAPTURE_DIR_TX, c);
+  return base->write(c);
+}
+
+/*************************************************************************************************/
+size_t ModemCaptureStream::write(const uint8_t *buffer, size_t size)
+{
+  for (size_t i = 0; i < size; i++) {
+    append(MODEM_CAPTURE_DIR_TX, buffer[i]);
+  }
+  return base->write(buffer, size);
+}
+
+/*************************************************************************************************/
+void ModemCaptureStream::flush(void) { base->flush(); }
+
+/*************************************************************************************************/
+bool ModemReplayStream::begin(const uint8_t *capture_data, uint32_t capture_length, uint16_t replay_speed)
+{
+  data = capture_data;
+  size = capture_length;
+  speed = replay_speed;
+  record = NULL;
+  mismatch = 0;
+  since_tx_ms = 0;
+  anchor_ms = millis();
+
+  if ((size < MODEM_CAPTURE_HEADER_SIZE) || (0 != memcmp(data, capture_magic, sizeof(capture_magic)))
+      || (MODEM_CAPTURE_VERSION != data[4])) {
+    pos = size;
+    return false;
+  }
+  pos = MODEM_CAPTURE_HEADER_SIZE;
+  next();
+  return true;
+}
+
+/**
+ * @brief 次のレコードを読み込む関数（壊れたレコードで再生を終える）
+ */
+void ModemReplayStream::next(void)
+{
+  record = NULL;
+  if (pos >= size) {
+    return;
+  }
+
+  uint8_t flags = data[pos++];
+  uint32_t delta = 0;
+  uint8_t shift = 0;
+  while ((pos < size) && (shift < 7 * VARINT_MAX)) {
+    uint8_t b = data[pos++];
+    delta |= (uint32_t)(b & 0x7F) << shift;
+    shift += 7;
+    if (0 == (b & 0x80)) {
+      break;
+    }
+  }
+
+  record_length = (flags & 0x7F) + 1;
+  if ((pos + record_length) > size) {
+    pos = size;
+    return;
+  }
+  dir = flags & MODEM_CAPTURE_DIR_TX;
+  record = &data[pos];
+  record_index = 0;
+  pos += record_length;
+
+  /* 受信は直前の送信からの経過時間で再生する */
+  since_tx_ms = (0 != dir) ? 0 : (since_tx_ms + delta);
+}
+
+/**
+ * @brief 現在の受信レコードの再生時刻到達確認関数
+ * @return true：読み出せる
+ */
+bool ModemReplayStream::rx_ready(void)
+{
+  if ((NULL == record) || (0 != dir)) {
+    return false;
+  }
+  return (0 == speed) || ((uint32_t)(millis() - anchor_ms) * speed >= since_tx_ms);
+}
+
+/*************************************************************************************************/
+int ModemReplayStream::available(void) { return rx_ready() ? (record_length - record_index) : 0; }
+
+/*************************************************************************************************/
+int ModemReplayStream::read(void)
+{
+  if (!rx_ready()) {
+    return -1;
+  }
+  uint8_t c = record[record_index++];
+  if (record_index >= record_length) {
+    next();
+  }
+  return c;
+}
+
+/*************************************************************************************************/
+int ModemReplayStream::peek(void) { return rx_ready() ? record[record_index] : -1; }
+
+/*************************************************************************************************/
+size_t ModemReplayStream::write(uint8_t c)
+{
+  anchor_ms = millis();
+  if ((NULL == record) || (0 == dir)) {
+    /* 記録に無い送信（ファームウェアの変更で送信順が変わった） */
+    ++mismatch;
+    return 1;
+  }
+  if (record[record_index] != c) {
+    ++mismatch;
+  }
+  if (++record_index >= record_length) {
+    next();
+  }
+  return 1;
+}
+
+/*************************************************************************************************/
+size_t ModemReplayStream::write(const uint8_t *buffer, size_t length)
+{
+  for (size_t i = 0; i < length; i++) {
+    write(buffer[i]);
+  }
+  return length;
+}
+
+/*************************************************************************************************/
+bool modem_capture_start(uint32_t size)
+{
+  if ((NULL == capture_buffer) || (capture_size < size)) {
+    free(capture_buffer);
+    capture_buffer = (uint8_t *)malloc(size);
+    capture_size = (NULL != capture_buffer) ? size : 0;
+  }
+  if ((NULL == capture_buffer) || (size < MODEM_CAPTURE_HEADER_SIZE)) {
+    return false;
+  }
+  capture.begin(&Serial1, capture_buffer, size);
+  bg770_set_stream(&capture);
+  return true;
+}
+
+/*************************************************************************************************/
+void modem_capture_stop(void)
+{
+  if (bg770_get_stream() == &capture) {
+    bg770_set_stream(NULL);
+  }
+}
+
+/*************************************************************************************************/
+const uint8_t *modem_capture_data(uint32_t *length)
+{
+  if (NULL == capture_buffer) {
+    *length = 0;
+    return NULL;
+  }
+  *length = capture.length();
+  return capture_buffer;
+}
@@ -0,0 +1,244 @@
+/**
+ * @file mqtt_lane.cpp
+ * @version 0.1
+ * @brief MQTT クライアント（レーン）管理
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mqtt_lane.h"
+#include "power.h"
+#include "mqtt_session.h"
+#include "supervisor.h"
+#include "inbox.h"
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief レーンの状態 */
+typedef struct st_mqtt_lane
+{
+  /** @brief 統計 */
+  mqtt_lane_stats_t stats;
+  /** @brief 次の msgID */
+  uint16_t next_msgid;
+  /** @brief PUBACK 待ちの送信時刻[ms]（古い順） */
+  unsigned long sent_ms[MQTT_BULK_WINDOW];
+  /** @brief サブスクライブ受信の処理関数 */
+  void (*recv_handler)(const at_line_t *line);
+} mqtt_lane_state_t;
+
+/**************************************************************************************************
+ * LOCAL VARIABLES
+ */
+/** @brief レーン */
+static mqtt_lane_state_t lanes[MQTT_LANE_MAX];
+/** @brief 前回の再接続時刻 */
+static unsigned long last_open_ms = 0;
+
+/**
+ * @brief サブスクライブ受信（+QMTRECV: <client_idx>,...）をレーン毎に振り分ける関数
+ * @param[in] line :分類済みの行
+ */
+static void urc_qmtrecv(const at_line_t *line)
+{
+  uint8_t lane = (uint8_t)strtoul(line->args, NULL, 10);
+  if (MQTT_LANE_CONTROL == lane) {
+    mqtt_session_received();
+  }
+  if ((lane < MQTT_LANE_MAX) && (NULL != lanes[lane].recv_handler)) {
+    inbox_receive(line, lanes[lane].recv_handler);
+  }
+}
+
+/**
+ * @brief PUBACK（+QMTPUB: <client_idx>,<msgID>,<result>）の処理関数
+ * @param[in] line :分類済みの行
+ */
+static void urc_qmtpub(const at_line_t *line)
+{
+  char *p;
+  uint8_t lane = (uint8_t)strtoul(line->args, &p, 10);
+  if ((lane >= MQTT_LANE_MAX) || (',' != *p)) {
+    return;
+  }
+  strtoul(p + 1, &p, 10);
+  uint8_t result = (',' == *p) ? (uint8_t)strtoul(p + 1, NULL, 10) : 2;
+
+  mqtt_lane_state_t *l = &lanes[lane];
+  if ((1 == result) || (0 == l->stats.inflight)) {
+    /* 再送中の通知・待っていない PUBACK */
+    return;
+  }
+  if (0 == result) {
+    ++l->stats.acked;
+  } else {
+    ++l->stats.failed;
+  }
+  /* PUBACK は送信順に届くので最古の送信を外す */
+  --l->stats.inflight;
+  memmove(&l->sent_ms[0], &l->sent_ms[1], l->stats.inflight * sizeof(l->sent_ms[0]));
+}
+
+/**
+ * @brief MQTT 切断（+QMTSTAT: <client_idx>,<err_code>）の処理関数
+ * @param[in] line :分類済みの行
+ */
+static void urc_qmtstat(const at_line_t *line)
+{
+  uint8_t lane = (uint8_t)strtoul(line->args, NULL, 10);
+  if (MQTT_LANE_CONTROL == lane) {
+    /* 制御レーンは送信の失敗で BG770 をリセットする。セッションの保持時間はここから数える */
+    mqtt_session_closed();
+    return;
+  }
+  if (lane >= MQTT_LANE_MAX) {
+    return;
+  }
+  /* 再接続までは制御レーンで送る */
+  lanes[lane].stats.open = false;
+  lanes[lane].stats.failed += lanes[lane].stats.inflight;
+  lanes[lane].stats.inflight = 0;
+}
+
+/**
+ * @brief PUBACK タイムアウトの処理関数
+ * @param[in] l :レーン
+ */
+static void mqtt_lane_expire(mqtt_lane_state_t *l)
+{
+  if ((0 != l->stats.inflight) && ((millis() - l->sent_ms[0]) >= MQTT_ACK_TIMEOUT_MS)) {
+    l->stats.failed += l->stats.inflight;
+    l->stats.inflight = 0;
+  }
+}
+
+/**
+ * @brief 1 レーンの接続関数
+ * @param[in] lane :レーン
+ */
+static void mqtt_lane_connect(uint8_t lane)
+{
+  mqtt_lane_state_t *l = &lanes[lane];
+
+  bg770_set_mqtt_client(lane, 1);
+  api_status_t result = bg770_mqtt_configure();
+  if (API_STATUS_SUCCESS == result) {
+    result = execute(&qmtopen_command);
+  }
+  if (API_STATUS_SUCCESS == result) {
+    result = execute(&qmtconn_command);
+  }
+  bg770_set_mqtt_client(MQTT_LANE_CONTROL, 1);
+
+  l->stats.open = (API_STATUS_SUCCESS == result);
+  l->stats.inflight = 0;
+}
+
+/*************************************************************************************************/
+void mqtt_lane_init(void)
+{
+  for (uint8_t i = 0; i < MQTT_LANE_MAX; i++) {
+    memset(&lanes[i].stats, 0, sizeof(lanes[i].stats));
+    lanes[i].next_msgid = 1;
+  }
+  at_set_urc_handler(AT_TOKEN_QMTRECV, urc_qmtrecv);
+  at_set_urc_handler(AT_TOKEN_QMTPUB, urc_qmtpub);
+  at_set_urc_handler(AT_TOKEN_QMTSTAT, urc_qmtstat);
+}
+
+/*************************************************************************************************/
+void mqtt_lane_set_recv_handler(mqtt_lane_t lane, void (*handler)(const at_line_t *line))
+{
+  if (lane < MQTT_LANE_MAX) {
+    lanes[lane].recv_handler = handler;
+  }
+}
+
+/*************************************************************************************************/
+void mqtt_lane_open(void)
+{
+  /* 制御レーンは初期化シーケンスで接続済み */
+  lanes[MQTT_LANE_CONTROL].stats.open = true;
+  for (uint8_t lane = MQTT_LANE_CONTROL + 1; lane < MQTT_LANE_MAX; lane++) {
+    mqtt_lane_connect(lane);
+  }
+  last_open_ms = millis();
+}
+
+/*************************************************************************************************/
+void mqtt_lane_task(void)
+{
+  if ((BG770_STATE_SUBSCRIBE != bg_state) || ((millis() - last_open_ms) < MQTT_REOPEN_MS)) {
+    return;
+  }
+  last_open_ms = millis();
+  for (uint8_t lane = MQTT_LANE_CONTROL + 1; lane < MQTT_LANE_MAX; lane++) {
+    if (!lanes[lane].stats.open) {
+      mqtt_lane_connect(lane);
+    }
+  }
+}
+
+/*************************************************************************************************/
+api_status_t mqtt_lane_publish(mqtt_lane_t lane)
+{
+  api_status_t result;
+
+  if ((lane >= MQTT_LANE_MAX) || !lanes[lane].stats.open) {
+    lane = MQTT_LANE_CONTROL;
+  }
+  mqtt_lane_state_t *l = &lanes[lane];
+
+  if (MQTT_LANE_CONTROL == lane) {
+    /* client idx 0, msgID 1 で PUBACK まで待つ */
+    result = execute(&publish_command);
+  } else {
+    /* PUBACK 待ちが上限なら空くまで URC を処理する（MQTT_ACK_TIMEOUT_MS で期限切れになる） */
+    mqtt_lane_expire(l);
+    uint8_t stage = supervisor_enter(SUPERVISOR_STAGE_ACK, MQTT_ACK_TIMEOUT_MS + SUPERVISOR_ACK_MARGIN_MS, "puback");
+    power_state_t power = power_set(POWER_STATE_WAIT);
+    while ((l->stats.inflight >= MQTT_BULK_WINDOW) && !supervisor_aborted()) {
+      bg770_poll();
+      mqtt_lane_expire(l);
+      supervisor_feed();
+      delay(1);
+    }
+    power_set(power);
+    supervisor_leave(stage);
+    if (!l->stats.open || (l->stats.inflight >= MQTT_BULK_WINDOW)) {
+      return mqtt_lane_publish(MQTT_LANE_CONTROL);
+    }
+
+    uint16_t msgid = l->next_msgid;
+    l->next_msgid = (65535 == msgid) ? 1 : (msgid + 1);
+    bg770_set_mqtt_client(lane, msgid);
+    result = execute(&publish_async_command);
+    bg770_set_mqtt_client(MQTT_LANE_CONTROL, 1);
+    if (API_STATUS_SUCCESS == result) {
+      l->sent_ms[l->stats.inflight++] = millis();
+    }
+  }
+
+  if (API_STATUS_SUCCESS == result) {
+    ++l->stats.published;
+  } else {
+    ++l->stats.failed;
+  }
+  return result;
+}
+
+/*************************************************************************************************/
+void mqtt_lane_get_stats(mqtt_lane_t lane, mqtt_lane_stats_t *stats)
+{
+  if (lane < MQTT_LANE_MAX) {
+    *stats = lanes[lane].stats;
+  }
+}
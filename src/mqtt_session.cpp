@@ -0,0 +1,166 @@
+/**
+ * @file mqtt_session.cpp
+ * @version 0.1
+ * @brief MQTT セッション設定（AT+QMTCFG）・永続セッションの管理
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <string.h>
+#include "mqtt_session.h"
+#include "mqtt_lane.h"
+#include "config.h"
+#include "bg770.h"
+#include "setup_define.h"
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief レーン毎の設定（mqtt_lane_t 順） */
+static const mqtt_profile_t profiles[MQTT_LANE_MAX] = {
+    /* 制御レーン：サブスクライブを保持する */
+    {MQTT_KEEPALIVE_S, false, MQTT_PKT_TIMEOUT_S, MQTT_PKT_RETRIES, true},
+    /* バルクレーン：送信のみ */
+    {MQTT_KEEPALIVE_S, true, MQTT_PKT_TIMEOUT_S, MQTT_PKT_RETRIES, false},
+};
+
+/**************************************************************************************************
+ * LOCAL VARIABLES
+ */
+/** @brief 制御レーンの接続中 */
+static bool connected = false;
+/** @brief 前回のセッションが有る */
+static bool session_valid = false;
+/** @brief 前回のセッションの接続先（client id・ブローカー・サブスクライブTOPIC のハッシュ） */
+static uint32_t session_signature = 0;
+/** @brief 制御レーンの接続が最後に生きていた時刻 */
+static unsigned long alive_ms = 0;
+/** @brief サブスクライブが残っていることを確認済み（サブスクライブした・省いた後に受信した） */
+static bool session_proven = false;
+/** @brief サブスクライブを省いて接続した時刻（受信の確認待ち） */
+static unsigned long probe_ms = 0;
+/** @brief 統計 */
+static mqtt_session_stats_t stats;
+
+/**
+ * @brief 文字列のハッシュ関数（FNV-1a）
+ * @param[in] hash :途中のハッシュ値
+ * @param[in] s :文字列
+ * @return ハッシュ値
+ */
+static uint32_t mqtt_session_hash(uint32_t hash, const char *s)
+{
+  do {
+    hash = (hash ^ (uint8_t)*s) * 16777619UL;
+  } while ('\0' != *s++);
+  return hash;
+}
+
+/**
+ * @brief 接続先の署名関数
+ * @return 使用中の接続先のハッシュ
+ */
+static uint32_t mqtt_session_signature(void)
+{
+  const config_link_t *link = config_link();
+  char client_id[MQTT_CLIENT_ID_SIZE];
+  char port[12];
+
+  mqtt_session_client_id(MQTT_LANE_CONTROL, client_id);
+  snprintf(port, sizeof(port), "%lu", (unsigned long)link->port);
+  uint32_t hash = mqtt_session_hash(2166136261UL, client_id);
+  hash = mqtt_session_hash(hash, link->broker);
+  hash = mqtt_session_hash(hash, port);
+  return mqtt_session_hash(hash, link->sub_topic);
+}
+
+/*************************************************************************************************/
+const mqtt_profile_t *mqtt_session_profile(uint8_t client)
+{
+  return &profiles[(client < MQTT_LANE_MAX) ? client : MQTT_LANE_BULK];
+}
+
+/*************************************************************************************************/
+void mqtt_session_client_id(uint8_t client, char buf[MQTT_CLIENT_ID_SIZE])
+{
+  /* client id は接続毎に異なる必要がある（同じ id の接続はブローカーに切断される） */
+  if (MQTT_LANE_CONTROL == client) {
+    snprintf(buf, MQTT_CLIENT_ID_SIZE, MQTT_CLIENT_PREFIX "%s", imsi);
+  } else {
+    snprintf(buf, MQTT_CLIENT_ID_SIZE, MQTT_CLIENT_PREFIX "%s-%u", imsi, client);
+  }
+}
+
+/*************************************************************************************************/
+void mqtt_session_will_topic(char buf[MQTT_WILL_TOPIC_SIZE])
+{
+  snprintf(buf, MQTT_WILL_TOPIC_SIZE, MQTT_WILL_TOPIC "%s", imsi);
+}
+
+/*************************************************************************************************/
+void mqtt_session_shadow_topic(const char *suffix, char buf[MQTT_SHADOW_TOPIC_SIZE])
+{
+  /* モノの名前も client id と同じく端末毎に変える（同じ名前だと全台で 1 つのシャドウを共有する） */
+  snprintf(buf, MQTT_SHADOW_TOPIC_SIZE, SHADOW_TOPIC_ROOT SHADOW_THING_PREFIX "%s%s", imsi, suffix);
+}
+
+/*************************************************************************************************/
+bool mqtt_session_resumable(void)
+{
+  return session_valid && session_proven && !profiles[MQTT_LANE_CONTROL].clean_session &&
+         ((millis() - alive_ms) < MQTT_SESSION_RESUME_MS) && (session_signature == mqtt_session_signature());
+}
+
+/*************************************************************************************************/
+void mqtt_session_connected(bool resumed)
+{
+  connected = true;
+  session_valid = true;
+  session_signature = mqtt_session_signature();
+  alive_ms = millis();
+  probe_ms = alive_ms;
+  /* 省いた場合は受信で確認できるまで、次の接続でも省かない */
+  session_proven = !resumed;
+  if (resumed) {
+    ++stats.resumed;
+  } else {
+    ++stats.subscribed;
+  }
+}
+
+/*************************************************************************************************/
+void mqtt_session_closed(void)
+{
+  connected = false;
+}
+
+/*************************************************************************************************/
+void mqtt_session_received(void)
+{
+  session_proven = true;
+}
+
+/*************************************************************************************************/
+void mqtt_session_resubscribed(void)
+{
+  session_proven = true;
+  ++stats.resubscribed;
+}
+
+/*************************************************************************************************/
+bool mqtt_session_task(void)
+{
+  if (!connected) {
+    return false;
+  }
+  alive_ms = millis();
+  return !session_proven && ((alive_ms - probe_ms) >= MQTT_SESSION_PROBE_MS);
+}
+
+/*************************************************************************************************/
+void mqtt_session_get_stats(mqtt_session_stats_t *p_stats) { *p_stats = stats; }
@@ -0,0 +1,503 @@
+/**
+ * @file ota.cpp
+ * @version 0.1
+ * @brief ファームウェア更新（LTE 経由・中断再開可能）
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <mbedtls/sha256.h>
+#include <rom/crc.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <string.h>
+#include "ota.h"
+#include "outbox.h"
+#include "power.h"
+#include "diag.h"
+#include "supervisor.h"
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief 書き込みタスクのスタックサイズ */
+#define OTA_TASK_STACK  3072
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief 更新内容（NVS に保存する blob） */
+typedef struct st_ota_job
+{
+  /** @brief イメージの URL */
+  char url[OTA_URL_SIZE];
+  /** @brief イメージ長 */
+  uint32_t size;
+  /** @brief イメージの SHA-256 */
+  uint8_t sha256[32];
+  /** @brief 照合済みの位置 */
+  uint32_t offset;
+  /** @brief 書き込み先のパーティション名 */
+  char label[17];
+} ota_job_t;
+
+/** @brief 書き込み要求（受信側→書き込みタスク） */
+typedef struct st_ota_block
+{
+  /** @brief バッファ */
+  uint8_t index;
+  /** @brief 書き込み位置 */
+  uint32_t offset;
+  /** @brief 長さ */
+  uint32_t length;
+} ota_block_t;
+
+/**************************************************************************************************
+ * LOCAL VARIABLES
+ */
+/** @brief 更新内容 */
+static ota_job_t job;
+/** @brief 書き込み先 */
+static const esp_partition_t *partition = NULL;
+/** @brief 統計 */
+static ota_stats_t stats;
+/** @brief 連続失敗数 */
+static uint8_t failures = 0;
+/** @brief 最後に失敗した時刻 */
+static unsigned long failed_ms = 0;
+/** @brief 切り替えた時刻 */
+static unsigned long done_ms = 0;
+/** @brief 更新内容の世代（ota_start で別の更新・ota_cancel の度に進める） */
+static uint32_t generation = 0;
+
+/** @brief 書き込みバッファ（2 面） */
+static uint8_t buffers[2][OTA_BUFFER_SIZE];
+/** @brief 空きバッファ数 */
+static SemaphoreHandle_t free_buffers = NULL;
+/** @brief 書き込み待ちのバッファ */
+static QueueHandle_t filled = NULL;
+/** @brief 書き込みタスク */
+static TaskHandle_t writer_task = NULL;
+/** @brief 書き込み失敗フラグ（書き込みタスクが立てる） */
+static volatile bool write_error = false;
+/** @brief 受信中の範囲の開始位置 */
+static uint32_t range_offset = 0;
+/** @brief 受信中の範囲の CRC32 */
+static uint32_t range_crc = 0;
+
+/**
+ * @brief 書き込みタスク（受信済みのバッファをフラッシュへ書き、空きに戻す）
+ * @param[in] arg :未使用
+ */
+static void ota_writer(void *arg)
+{
+  ota_block_t block;
+  for (;;) {
+    if (pdTRUE == xQueueReceive(filled, &block, portMAX_DELAY)) {
+      if (ESP_OK != esp_partition_write(partition, block.offset, buffers[block.index], block.length)) {
+        write_error = true;
+      }
+      xSemaphoreGive(free_buffers);
+    }
+  }
+}
+
+/**
+ * @brief 書き込みタスクの起動関数（初回のみ）
+ */
+static void ota_writer_start(void)
+{
+  if (NULL != writer_task) {
+    return;
+  }
+  free_buffers = xSemaphoreCreateCounting(2, 2);
+  filled = xQueueCreate(2, sizeof(ota_block_t));
+  xTaskCreatePinnedToCore(ota_writer, "ota", OTA_TASK_STACK, NULL, 2, &writer_task, 0);
+  diag_register_task(writer_task, "ota");
+}
+
+/**
+ * @brief 更新内容の保存関数
+ * @param[in] active :true：保存 false：削除
+ */
+static void ota_save(bool active)
+{
+  Preferences prefs;
+  prefs.begin(OTA_NVS_NAMESPACE, false);
+  if (active) {
+    prefs.putBytes("job", &job, sizeof(job));
+  } else {
+    prefs.remove("job");
+  }
+  prefs.end();
+}
+
+/**
+ * @brief 進捗・結果の送信関数
+ * @param[in] state :状態名
+ * @param[in] reason :中止理由（NULL 可）
+ */
+static void ota_report(const char *state, const char *reason)
+{
+  const outbox_attr_t attr = {UPLINK_CLASS_CONTROL, OUTBOX_PRIO_NORMAL, OUTBOX_KEY_OTA, OUTBOX_EXPIRE_SEND,
+                              OTA_DEADLINE_MS};
+  char payload[160];
+  int len = snprintf(payload, sizeof(payload), "{\"ota\":{\"state\":\"%s\",\"offset\":%lu,\"size\":%lu", state,
+                     (unsigned long)job.offset, (unsigned long)job.size);
+  if (NULL != reason) {
+    len += snprintf(&payload[len], sizeof(payload) - len, ",\"reason\":\"%s\"", reason);
+  }
+  len += snprintf(&payload[len], sizeof(payload) - len, "}}");
+  if (len < (int)sizeof(payload)) {
+    outbox_post((const uint8_t *)payload, (uint16_t)len, &attr);
+  }
+}
+
+/**
+ * @brief 中止関数
+ * @param[in] reason :中止理由
+ */
+static void ota_fail(const char *reason)
+{
+  stats.state = OTA_STATE_FAILED;
+  ota_save(false);
+  ota_report("failed", reason);
+  Serial.printf("OTA failed: %s\n", reason);
+}
+
+/**
+ * @brief 指定長の受信関数（OTA_READ_TIMEOUT_MS 途切れたら失敗）
+ * @param[in] stream :通信ストリーム
+ * @param[out] buf :格納先
+ * @param[in] length :長さ
+ * @return true：受信完了
+ */
+static bool ota_read_exact(Stream *stream, uint8_t *buf, uint32_t length)
+{
+  uint32_t got = 0;
+  unsigned long last = millis();
+  while (got < length) {
+    size_t n = stream->readBytes(&buf[got], length - got);
+    if (0 != n) {
+      got += n;
+      last = millis();
+    } else if (((millis() - last) >= OTA_READ_TIMEOUT_MS) || supervisor_aborted()) {
+      return false;
+    }
+    supervisor_feed();
+  }
+  return true;
+}
+
+/**
+ * @brief 本文の読み出し関数（AT+QHTTPREAD の CONNECT 後に呼ばれる）
+ *
+ * 空いたバッファに受信し、書き込みタスクへ渡して次のバッファに受信する。
+ * @param[in] stream :通信ストリーム
+ * @param[in] length :本文長
+ * @return true：受信・書き込み完了
+ */
+static bool ota_read_body(Stream *stream, uint32_t length)
+{
+  /* 応答待ち（WAIT）のままだとライトスリープで受信を取りこぼす */
+  power_state_t power = power_set(POWER_STATE_BURST);
+  uint32_t done = 0;
+  uint8_t index = 0;
+  bool ok = true;
+
+  while (ok && (done < length)) {
+    unsigned long wait_start = millis();
+    if (pdTRUE != xSemaphoreTake(free_buffers, pdMS_TO_TICKS(OTA_READ_TIMEOUT_MS))) {
+      ok = false;
+      break;
+    }
+    stats.write_wait_ms += millis() - wait_start;
+
+    uint32_t n = ((length - done) < OTA_BUFFER_SIZE) ? (length - done) : OTA_BUFFER_SIZE;
+    if (!ota_read_exact(stream, buffers[index], n)) {
+      xSemaphoreGive(free_buffers);
+      ok = false;
+      break;
+    }
+    range_crc = crc32_le(range_crc, buffers[index], n);
+    ota_block_t block = {index, range_offset + done, n};
+    xQueueSend(filled, &block, portMAX_DELAY);
+    done += n;
+    index ^= 1;
+  }
+
+  /* 書き込み中のバッファを待つ */
+  xSemaphoreTake(free_buffers, portMAX_DELAY);
+  xSemaphoreTake(free_buffers, portMAX_DELAY);
+  xSemaphoreGive(free_buffers);
+  xSemaphoreGive(free_buffers);
+  power_set(power);
+
+  return ok && !write_error;
+}
+
+/**
+ * @brief 書き込み内容の照合関数（フラッシュから読み出して CRC32 を比べる）
+ * @param[in] offset :開始位置
+ * @param[in] length :長さ
+ * @param[in] crc :受信データの CRC32
+ * @return true：一致
+ */
+static bool ota_verify(uint32_t offset, uint32_t length, uint32_t crc)
+{
+  uint32_t actual = 0;
+  for (uint32_t done = 0; done < length; done += OTA_BUFFER_SIZE) {
+    uint32_t n = ((length - done) < OTA_BUFFER_SIZE) ? (length - done) : OTA_BUFFER_SIZE;
+    if (ESP_OK != esp_partition_read(partition, offset + done, buffers[0], n)) {
+      return false;
+    }
+    actual = crc32_le(actual, buffers[0], n);
+  }
+  return (actual == crc);
+}
+
+/**
+ * @brief 更新内容が変わっていないかの確認関数（AT コマンドの実行中に URC で ota_start・ota_cancel が呼ばれる）
+ * @param[in] gen :開始時の世代
+ * @return true：同じ更新のダウンロード中
+ */
+static bool ota_job_current(uint32_t gen)
+{
+  return (OTA_STATE_DOWNLOAD == stats.state) && (gen == generation);
+}
+
+/**
+ * @brief 1 範囲のダウンロード関数（消去→範囲要求→受信・書き込み→照合）
+ * @return true：照合済み
+ */
+static bool ota_download_range(void)
+{
+  uint32_t gen = generation;
+  uint32_t length = ((job.size - job.offset) < OTA_RANGE_SIZE) ? (job.size - job.offset) : OTA_RANGE_SIZE;
+  uint32_t erase = (length + OTA_BUFFER_SIZE - 1) & ~(uint32_t)(OTA_BUFFER_SIZE - 1);
+
+  /* 受信中にセクタ消去で止まらないよう、要求前に消去しておく */
+  if (ESP_OK != esp_partition_erase_range(partition, job.offset, erase)) {
+    return false;
+  }
+
+  uint16_t status;
+  uint32_t content_length;
+  if (API_STATUS_SUCCESS != bg770_http_get(job.url, job.offset, length, &status, &content_length)) {
+    return false;
+  }
+  /* 範囲指定を無視するサーバーは 1 回で全体を返す場合だけ受け付ける */
+  bool whole = (200 == status) && (0 == job.offset) && (length == job.size);
+  if ((206 != status) && !whole) {
+    if ((400 <= status) && (status < 500) && ota_job_current(gen)) {
+      ota_fail("http");
+    }
+    return false;
+  }
+  if (content_length != length) {
+    return false;
+  }
+
+  range_offset = job.offset;
+  range_crc = 0;
+  write_error = false;
+  unsigned long start = millis();
+  if (API_STATUS_SUCCESS != bg770_http_read(ota_read_body)) {
+    return false;
+  }
+  unsigned long elapsed = millis() - start;
+  stats.bytes_per_s = (uint32_t)(((uint64_t)length * 1000) / (elapsed ? elapsed : 1));
+
+  power_state_t power = power_set(POWER_STATE_BURST);
+  bool verified = ota_verify(range_offset, length, range_crc);
+  power_set(power);
+
+  return verified;
+}
+
+/**
+ * @brief 完了処理関数（全体の SHA-256 を確認して起動パーティションを切り替える）
+ */
+static void ota_finish(void)
+{
+  power_state_t power = power_set(POWER_STATE_BURST);
+  mbedtls_sha256_context ctx;
+  uint8_t digest[32];
+  bool read_ok = true;
+
+  mbedtls_sha256_init(&ctx);
+  mbedtls_sha256_starts_ret(&ctx, 0);
+  for (uint32_t done = 0; read_ok && (done < job.size); done += OTA_BUFFER_SIZE) {
+    uint32_t n = ((job.size - done) < OTA_BUFFER_SIZE) ? (job.size - done) : OTA_BUFFER_SIZE;
+    read_ok = (ESP_OK == esp_partition_read(partition, done, buffers[0], n));
+    mbedtls_sha256_update_ret(&ctx, buffers[0], n);
+  }
+  mbedtls_sha256_finish_ret(&ctx, digest);
+  mbedtls_sha256_free(&ctx);
+  power_set(power);
+
+  if (!read_ok || (0 != memcmp(digest, job.sha256, sizeof(digest)))) {
+    ota_fail("sha256");
+    return;
+  }
+  /* イメージのヘッダ・チェックサムも確認される */
+  if (ESP_OK != esp_ota_set_boot_partition(partition)) {
+    ota_fail("image");
+    return;
+  }
+  stats.state = OTA_STATE_DONE;
+  done_ms = millis();
+  ota_save(false);
+  ota_report("done", NULL);
+  Serial.printf("OTA done: %s\n", partition->label);
+}
+
+/**
+ * @brief 16 進文字列の変換関数
+ * @param[in] hex :16 進文字列
+ * @param[out] out :変換結果
+ * @param[in] length :変換結果の長さ
+ * @return true：成功
+ */
+static bool ota_parse_hex(const char *hex, uint8_t *out, uint8_t length)
+{
+  if (strlen(hex) != (size_t)(length * 2)) {
+    return false;
+  }
+  for (uint8_t i = 0; i < (length * 2); i++) {
+    char c = hex[i];
+    uint8_t v;
+    if (('0' <= c) && (c <= '9')) {
+      v = c - '0';
+    } else if (('a' <= (c | 0x20)) && ((c | 0x20) <= 'f')) {
+      v = (c | 0x20) - 'a' + 10;
+    } else {
+      return false;
+    }
+    out[i / 2] = (i & 1) ? (out[i / 2] | v) : (uint8_t)(v << 4);
+  }
+  return true;
+}
+
+/*************************************************************************************************/
+void ota_init(void)
+{
+  Preferences prefs;
+
+  memset(&stats, 0, sizeof(stats));
+  memset(&job, 0, sizeof(job));
+  partition = esp_ota_get_next_update_partition(NULL);
+
+  prefs.begin(OTA_NVS_NAMESPACE, true);
+  bool saved = (sizeof(job) == prefs.getBytes("job", &job, sizeof(job)));
+  prefs.end();
+  /* 書き込み先が変わっていなければ照合済みの位置から再開 */
+  if (saved && (NULL != partition) && (0 == strcmp(job.label, partition->label)) && (job.offset <= job.size)) {
+    stats.state = OTA_STATE_DOWNLOAD;
+    ota_writer_start();
+    Serial.printf("OTA resume: %lu/%lu\n", (unsigned long)job.offset, (unsigned long)job.size);
+  } else if (saved) {
+    ota_save(false);
+  }
+}
+
+/*************************************************************************************************/
+api_status_t ota_start(const char *url, uint32_t size, const char *sha256)
+{
+  uint8_t digest[32];
+  if ((NULL == partition) || (NULL == url) || (NULL == sha256) || (0 != strncmp(url, "http://", 7)) ||
+      (strlen(url) >= OTA_URL_SIZE) || (0 == size) || (size > partition->size) ||
+      !ota_parse_hex(sha256, digest, sizeof(digest))) {
+    return API_STATUS_FAIL;
+  }
+
+  /* 同じイメージの更新中なら続きから */
+  bool same = (OTA_STATE_DOWNLOAD == stats.state) && (0 == strcmp(job.url, url)) && (job.size == size) &&
+              (0 == memcmp(job.sha256, digest, sizeof(digest)));
+  if (!same) {
+    ++generation;
+    memset(&job, 0, sizeof(job));
+    strncpy(job.url, url, sizeof(job.url) - 1);
+    job.size = size;
+    memcpy(job.sha256, digest, sizeof(digest));
+    strncpy(job.label, partition->label, sizeof(job.label) - 1);
+    ota_save(true);
+  }
+  stats.state = OTA_STATE_DOWNLOAD;
+  failures = 0;
+  ota_writer_start();
+  ota_report("download", NULL);
+
+  return API_STATUS_SUCCESS;
+}
+
+/*************************************************************************************************/
+void ota_cancel(void)
+{
+  if (OTA_STATE_DOWNLOAD == stats.state) {
+    ++generation;
+    stats.state = OTA_STATE_IDLE;
+    ota_save(false);
+    ota_report("cancelled", NULL);
+  }
+}
+
+/*************************************************************************************************/
+void ota_task(void)
+{
+  if (OTA_STATE_DONE == stats.state) {
+    if ((millis() - done_ms) >= OTA_RESTART_MS) {
+      ESP.restart();
+    }
+    return;
+  }
+  if ((OTA_STATE_DOWNLOAD != stats.state) || (BG770_STATE_SUBSCRIBE != bg_state)) {
+    return;
+  }
+  if ((0 != failures) && ((millis() - failed_ms) < OTA_RETRY_MS)) {
+    return;
+  }
+
+  if (job.offset >= job.size) {
+    ota_finish();
+    return;
+  }
+  uint32_t gen = generation;
+  bool downloaded = ota_download_range();
+  if (!ota_job_current(gen)) {
+    /* ダウンロード中に中止・別の更新になった（古い範囲の結果は使わない） */
+    return;
+  }
+  if (downloaded) {
+    failures = 0;
+    ++stats.ranges;
+    job.offset = range_offset + (((job.size - range_offset) < OTA_RANGE_SIZE) ? (job.size - range_offset)
+                                                                                : OTA_RANGE_SIZE);
+    ota_save(true);
+    ota_report("download", NULL);
+    return;
+  }
+  ++stats.retries;
+  failed_ms = millis();
+  if (++failures > OTA_RETRY_MAX) {
+    ota_fail("retry");
+  }
+}
+
+/*************************************************************************************************/
+void ota_get_stats(ota_stats_t *p_stats)
+{
+  *p_stats = stats;
+  p_stats->offset = job.offset;
+  p_stats->size = job.size;
+}
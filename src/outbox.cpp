@@ -0,0 +1,298 @@
+/**
+ * @file outbox.cpp
+ * @version 0.1
+ * @brief 送信スケジューラ（優先度・期限付きの送信待ち行列）
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <string.h>
+#include "outbox.h"
+#include "power.h"
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief まとめたメッセージの前後（{"batch":[ と ]}） */
+#define OUTBOX_BATCH_HEAD  "{\"batch\":["
+#define OUTBOX_BATCH_TAIL  "]}"
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief 送信待ち */
+typedef struct st_outbox_slot
+{
+  /** @brief 使用中 */
+  bool used;
+  /** @brief 送信中（uplink_publish 中の URC からの投入で置き換え・押し出さない） */
+  bool inflight;
+  /** @brief 送信属性 */
+  outbox_attr_t attr;
+  /** @brief 投入時刻[ms] */
+  unsigned long posted_ms;
+  /** @brief 期限時刻[ms] */
+  unsigned long due_ms;
+  /** @brief 送信失敗回数 */
+  uint8_t attempts;
+  /** @brief データ長 */
+  uint16_t length;
+  /** @brief データ */
+  uint8_t data[PUBLISH_SIZE];
+} outbox_slot_t;
+
+/**************************************************************************************************
+ * LOCAL VARIABLES
+ */
+/** @brief 送信待ちのプール */
+static outbox_slot_t slots[OUTBOX_SLOTS];
+/** @brief 置き換えキー毎の送信結果 */
+static outbox_result_t results[OUTBOX_KEY_MAX];
+/** @brief 統計 */
+static outbox_stats_t stats;
+
+/**
+ * @brief 期限切れ確認関数
+ * @param[in] slot :送信待ち
+ * @param[in] now :現在時刻[ms]
+ * @return true：期限切れ
+ */
+static bool outbox_expired(const outbox_slot_t *slot, unsigned long now)
+{
+  return (long)(now - slot->due_ms) >= 0;
+}
+
+/**
+ * @brief 送信待ちの解放関数
+ * @param[in] slot :送信待ち
+ * @param[in] result :送信結果（OUTBOX_RESULT_NONE：置き換え・まとめで結果は後のものに任せる）
+ */
+static void outbox_free(outbox_slot_t *slot, outbox_result_t result)
+{
+  if ((OUTBOX_RESULT_NONE != result) && (slot->attr.key < OUTBOX_KEY_MAX)) {
+    results[slot->attr.key] = result;
+  }
+  slot->used = false;
+  --stats.queued;
+}
+
+/**
+ * @brief 受付先の取得関数（空きが無ければ最も優先度の低い送信待ちを押し出す）
+ * @param[in] priority :投入する優先度
+ * @return 受付先（NULL：受付不可）
+ */
+static outbox_slot_t *outbox_acquire(uint8_t priority)
+{
+  outbox_slot_t *victim = NULL;
+
+  for (uint8_t i = 0; i < OUTBOX_SLOTS; i++) {
+    outbox_slot_t *s = &slots[i];
+    if (!s->used) {
+      return s;
+    }
+    if (s->inflight) {
+      continue;
+    }
+    /* 優先度が低いもの、同じなら期限の遅いもの（新しいもの）を押し出す */
+    if ((s->attr.priority > priority) &&
+        ((NULL == victim) || (s->attr.priority > victim->attr.priority) ||
+         ((s->attr.priority == victim->attr.priority) && ((long)(s->due_ms - victim->due_ms) > 0)))) {
+      victim = s;
+    }
+  }
+  if (NULL != victim) {
+    outbox_free(victim, OUTBOX_RESULT_DROPPED);
+    ++stats.dropped;
+  }
+  return victim;
+}
+
+/*************************************************************************************************/
+bool outbox_post(const uint8_t *data, uint16_t length, const outbox_attr_t *attr)
+{
+  outbox_slot_t *slot = NULL;
+  unsigned long now = millis();
+
+  if (length > PUBLISH_SIZE) {
+    ++stats.rejected;
+    return false;
+  }
+
+  /* 同じキーの送信待ちは内容を置き換える（期限は早い方を残す。送信中のものは別に積む） */
+  if (OUTBOX_KEY_NONE != attr->key) {
+    for (uint8_t i = 0; i < OUTBOX_SLOTS; i++) {
+      if (slots[i].used && !slots[i].inflight && (slots[i].attr.key == attr->key)) {
+        slot = &slots[i];
+        ++stats.superseded;
+        break;
+      }
+    }
+  }
+
+  if (NULL == slot) {
+    slot = outbox_acquire(attr->priority);
+    if (NULL == slot) {
+      ++stats.rejected;
+      return false;
+    }
+    slot->used = true;
+    slot->inflight = false;
+    slot->posted_ms = now;
+    slot->due_ms = now + attr->deadline_ms;
+    ++stats.queued;
+  } else if ((long)((now + attr->deadline_ms) - slot->due_ms) < 0) {
+    slot->due_ms = now + attr->deadline_ms;
+  }
+
+  slot->attr = *attr;
+  slot->attempts = 0;
+  if (attr->key < OUTBOX_KEY_MAX) {
+    results[attr->key] = OUTBOX_RESULT_NONE;
+  }
+  slot->length = length;
+  memcpy(slot->data, data, length);
+  ++stats.posted;
+
+  return true;
+}
+
+/*************************************************************************************************/
+bool outbox_pending(uint8_t key)
+{
+  for (uint8_t i = 0; i < OUTBOX_SLOTS; i++) {
+    if (slots[i].used && !slots[i].inflight && (slots[i].attr.key == key)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/*************************************************************************************************/
+outbox_result_t outbox_result(uint8_t key)
+{
+  if (key >= OUTBOX_KEY_MAX) {
+    return OUTBOX_RESULT_NONE;
+  }
+  for (uint8_t i = 0; i < OUTBOX_SLOTS; i++) {
+    if (slots[i].used && (slots[i].attr.key == key)) {
+      return OUTBOX_RESULT_NONE;
+    }
+  }
+  return results[key];
+}
+
+/**
+ * @brief 期限切れの処理関数（破棄・まとめ）
+ * @param[in] now :現在時刻[ms]
+ */
+static void outbox_expire(unsigned long now)
+{
+  for (uint8_t i = 0; i < OUTBOX_SLOTS; i++) {
+    outbox_slot_t *base = &slots[i];
+    if (!base->used || !outbox_expired(base, now)) {
+      continue;
+    }
+
+    if (OUTBOX_EXPIRE_DROP == base->attr.expire) {
+      outbox_free(base, OUTBOX_RESULT_DROPPED);
+      ++stats.dropped;
+    } else if (OUTBOX_EXPIRE_MERGE == base->attr.expire) {
+      /* 同じ種別の期限切れを Publish_payload 上で {"batch":[a,b,...]} に組み立てる */
+      char *buf = (char *)Publish_payload;
+      uint16_t len = sizeof(OUTBOX_BATCH_HEAD) - 1;
+      uint8_t count = 1;
+      bool fits = ((len + base->length + sizeof(OUTBOX_BATCH_TAIL) - 1) <= PUBLISH_SIZE);
+      if (fits) {
+        memcpy(buf, OUTBOX_BATCH_HEAD, len);
+        memcpy(&buf[len], base->data, base->length);
+        len += base->length;
+      }
+
+      for (uint8_t j = i + 1; fits && (j < OUTBOX_SLOTS); j++) {
+        outbox_slot_t *s = &slots[j];
+        if (!s->used || (OUTBOX_EXPIRE_MERGE != s->attr.expire) || (s->attr.cls != base->attr.cls) ||
+            !outbox_expired(s, now) || ((len + 1 + s->length + sizeof(OUTBOX_BATCH_TAIL) - 1) > PUBLISH_SIZE)) {
+          continue;
+        }
+        buf[len++] = ',';
+        memcpy(&buf[len], s->data, s->length);
+        len += s->length;
+        outbox_free(s, OUTBOX_RESULT_NONE);
+        ++count;
+      }
+
+      if (1 < count) {
+        memcpy(&buf[len], OUTBOX_BATCH_TAIL, sizeof(OUTBOX_BATCH_TAIL) - 1);
+        len += sizeof(OUTBOX_BATCH_TAIL) - 1;
+        memcpy(base->data, buf, len);
+        base->length = len;
+        stats.merged += count;
+      }
+      /* まとめた後は 1 回だけ期限を延ばし、それでも送れなければ捨てる */
+      base->attr.expire = OUTBOX_EXPIRE_DROP;
+      base->due_ms = now + base->attr.deadline_ms;
+    }
+  }
+}
+
+/*************************************************************************************************/
+api_status_t outbox_task(void)
+{
+  unsigned long now = millis();
+  outbox_slot_t *next = NULL;
+
+  outbox_expire(now);
+
+  /* 優先度順、同じ優先度なら期限の早い順（バルクの期限が近くても警報を待たせない） */
+  for (uint8_t i = 0; i < OUTBOX_SLOTS; i++) {
+    outbox_slot_t *s = &slots[i];
+    if (!s->used) {
+      continue;
+    }
+    if ((NULL == next) || (s->attr.priority < next->attr.priority) ||
+        ((s->attr.priority == next->attr.priority) && ((long)(s->due_ms - next->due_ms) < 0))) {
+      next = s;
+    }
+  }
+  if (NULL == next) {
+    return API_STATUS_SUCCESS;
+  }
+
+  power_state_t power = power_set(POWER_STATE_BURST);
+  memcpy(Publish_payload, next->data, next->length);
+  Publish_length = next->length;
+  next->inflight = true;
+  api_status_t result = uplink_publish(next->attr.cls);
+  /* 送信中に同じキーの新しい内容が積まれていれば、古い方は再送しない */
+  bool superseded = (OUTBOX_KEY_NONE != next->attr.key) && outbox_pending(next->attr.key);
+  next->inflight = false;
+
+  if (API_STATUS_SUCCESS == result) {
+    uint32_t latency = millis() - next->posted_ms;
+    if (latency > stats.max_latency_ms) {
+      stats.max_latency_ms = latency;
+    }
+    if (outbox_expired(next, millis())) {
+      ++stats.late;
+    }
+    ++stats.sent;
+    outbox_free(next, OUTBOX_RESULT_SENT);
+  } else if (superseded) {
+    ++stats.superseded;
+    outbox_free(next, OUTBOX_RESULT_NONE);
+  } else if (++next->attempts > OUTBOX_RETRY) {
+    ++stats.dropped;
+    outbox_free(next, OUTBOX_RESULT_DROPPED);
+  }
+  power_set(power);
+
+  return result;
+}
+
+/*************************************************************************************************/
+void outbox_get_stats(outbox_stats_t *p_stats) { *p_stats = stats; }
@@ -0,0 +1,265 @@
+/**
+ * @file plmn.cpp
+ * @version 0.1
+ * @brief 基地局オペレータ（PLMN）の選択
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <Preferences.h>
+#include <string.h>
+#include "plmn.h"
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief 接続結果（NVS に保存する blob） */
+typedef struct st_plmn_cache
+{
+  /** @brief 保存形式の番号 */
+  uint16_t schema;
+  /** @brief 候補数 */
+  uint8_t count;
+  /** @brief 候補 */
+  plmn_entry_t entries[PLMN_MAX];
+} plmn_cache_t;
+
+/**************************************************************************************************
+ * LOCAL VARIABLES
+ */
+/** @brief 接続結果 */
+static plmn_cache_t cache;
+/** @brief 最後の検索結果の状態（PLMN_STAT_*。起動後は保存しない） */
+static uint8_t scan_stat[PLMN_MAX];
+/** @brief 検索結果が有る */
+static bool scanned = false;
+/** @brief 検索結果の受信中 */
+static bool scan_open = false;
+/** @brief 今回の接続で試した候補 */
+static bool tried[PLMN_MAX];
+/** @brief 今回の接続で試した候補数 */
+static uint8_t tries = 0;
+/** @brief 今回の接続で検索した */
+static bool cycle_scanned = false;
+/** @brief 選択中の候補（-1：未選択） */
+static int8_t current = -1;
+/** @brief 統計 */
+static plmn_stats_t stats;
+
+/**
+ * @brief 順位の計算関数
+ * @param[in] i :候補
+ * @return score（plmn.h 参照）
+ */
+static int16_t plmn_score(uint8_t i)
+{
+  const plmn_entry_t *e = &cache.entries[i];
+  int16_t score = (int16_t)((200 * (e->successes + 1)) / (e->attempts + 2));
+
+  if (PLMN_RSSI_UNKNOWN != e->rssi) {
+    score += (e->rssi + 113) / 2;
+  }
+  if (scanned) {
+    if (PLMN_STAT_UNKNOWN == scan_stat[i]) {
+      score -= 100;
+    } else if (PLMN_STAT_CURRENT == scan_stat[i]) {
+      score += 10;
+    }
+  }
+  return score;
+}
+
+/**
+ * @brief 候補の検索・追加関数（一杯なら順位が最も低い候補と入れ替える）
+ * @param[in] id :PLMN
+ * @param[in] act :アクセス技術
+ * @return 候補の位置
+ */
+static uint8_t plmn_add(const char *id, uint8_t act)
+{
+  for (uint8_t i = 0; i < cache.count; i++) {
+    if (0 == strcmp(cache.entries[i].id, id)) {
+      return i;
+    }
+  }
+
+  uint8_t i = cache.count;
+  if (PLMN_MAX == cache.count) {
+    i = 0;
+    for (uint8_t j = 1; j < cache.count; j++) {
+      if (plmn_score(j) < plmn_score(i)) {
+        i = j;
+      }
+    }
+  } else {
+    ++cache.count;
+  }
+  memset(&cache.entries[i], 0, sizeof(cache.entries[i]));
+  strncpy(cache.entries[i].id, id, PLMN_ID_SIZE - 1);
+  cache.entries[i].act = act;
+  cache.entries[i].rssi = PLMN_RSSI_UNKNOWN;
+  scan_stat[i] = PLMN_STAT_UNKNOWN;
+  tried[i] = false;
+  if (current == (int8_t)i) {
+    current = -1;
+  }
+  return i;
+}
+
+/**
+ * @brief 接続結果の保存関数
+ */
+static void plmn_save(void)
+{
+  Preferences prefs;
+  prefs.begin(PLMN_NVS_NAMESPACE, false);
+  prefs.putBytes("cache", &cache, sizeof(cache));
+  prefs.end();
+}
+
+/*************************************************************************************************/
+void plmn_init(void)
+{
+  Preferences prefs;
+
+  memset(&cache, 0, sizeof(cache));
+  memset(&stats, 0, sizeof(stats));
+  prefs.begin(PLMN_NVS_NAMESPACE, true);
+  plmn_cache_t saved;
+  if ((sizeof(saved) == prefs.getBytes("cache", &saved, sizeof(saved))) && (PLMN_SCHEMA == saved.schema) &&
+      (saved.count <= PLMN_MAX)) {
+    cache = saved;
+  }
+  prefs.end();
+  cache.schema = PLMN_SCHEMA;
+  current = -1;
+}
+
+/*************************************************************************************************/
+void plmn_begin(const char *const seeds[], uint8_t count)
+{
+  for (uint8_t i = 0; i < count; i++) {
+    plmn_add(seeds[i], PLMN_ACT_DEFAULT);
+  }
+  memset(tried, 0, sizeof(tried));
+  tries = 0;
+  cycle_scanned = false;
+  current = -1;
+}
+
+/*************************************************************************************************/
+bool plmn_scan_due(void)
+{
+  if (cycle_scanned) {
+    return false;
+  }
+  bool attached_before = false;
+  bool untried = false;
+  for (uint8_t i = 0; i < cache.count; i++) {
+    attached_before |= (0 != cache.entries[i].successes);
+    untried |= (!tried[i] && (PLMN_STAT_FORBIDDEN != scan_stat[i]));
+  }
+  return !attached_before || !untried;
+}
+
+/*************************************************************************************************/
+void plmn_scan_add(const char *id, uint8_t stat, uint8_t act)
+{
+  if (!scan_open) {
+    memset(scan_stat, PLMN_STAT_UNKNOWN, sizeof(scan_stat));
+    scan_open = true;
+  }
+  uint8_t i = plmn_add(id, act);
+  /* 同じ PLMN が AcT 毎に並ぶ場合は接続中・禁止を優先 */
+  if ((PLMN_STAT_UNKNOWN == scan_stat[i]) || (PLMN_STAT_AVAILABLE != stat)) {
+    scan_stat[i] = stat;
+  }
+}
+
+/*************************************************************************************************/
+void plmn_scan_done(bool ok)
+{
+  /* 打ち切った場合も今回の接続では再検索しない */
+  cycle_scanned = true;
+  ++stats.scans;
+  scanned |= (ok && scan_open);
+  scan_open = false;
+}
+
+/*************************************************************************************************/
+bool plmn_select(void)
+{
+  int8_t best = -1;
+  int16_t best_score = 0;
+
+  for (uint8_t i = 0; i < cache.count; i++) {
+    if (tried[i] || (PLMN_STAT_FORBIDDEN == scan_stat[i])) {
+      continue;
+    }
+    int16_t score = plmn_score(i);
+    if ((best < 0) || (score > best_score)) {
+      best = (int8_t)i;
+      best_score = score;
+    }
+  }
+  current = best;
+  if (best < 0) {
+    return false;
+  }
+  tried[best] = true;
+  ++tries;
+  Serial.printf("PLMN %s (score %d)\n", cache.entries[best].id, best_score);
+  return true;
+}
+
+/*************************************************************************************************/
+const plmn_entry_t *plmn_current(void)
+{
+  static const plmn_entry_t none = {"00000", PLMN_ACT_DEFAULT, PLMN_RSSI_UNKNOWN, 0, 0, 0};
+  return (current < 0) ? &none : &cache.entries[current];
+}
+
+/*************************************************************************************************/
+void plmn_result(bool attached, uint32_t elapsed_ms)
+{
+  if (current < 0) {
+    return;
+  }
+  plmn_entry_t *e = &cache.entries[current];
+  if (e->attempts >= PLMN_HISTORY_MAX) {
+    e->attempts /= 2;
+    e->successes /= 2;
+  }
+  ++e->attempts;
+  if (attached) {
+    ++e->successes;
+    e->attach_ms = elapsed_ms;
+    if (1 < tries) {
+      ++stats.fallbacks;
+    }
+  }
+  plmn_save();
+}
+
+/*************************************************************************************************/
+void plmn_signal(int16_t rssi)
+{
+  if (current < 0) {
+    return;
+  }
+  cache.entries[current].rssi = (99 == rssi) ? PLMN_RSSI_UNKNOWN : (int8_t)rssi;
+  plmn_save();
+}
+
+/*************************************************************************************************/
+void plmn_get_stats(plmn_stats_t *p_stats)
+{
+  *p_stats = stats;
+  p_stats->count = cache.count;
+  p_stats->current = *plmn_current();
+}
@@ -0,0 +1,144 @@
+/**
+ * @file power.cpp
+ * @version 0.1
+ * @brief CPU クロック制御（電力・処理速度の切り替え）
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <esp_pm.h>
+#include <esp_sleep.h>
+#include <driver/uart.h>
+#include "power.h"
+
+/**************************************************************************************************
+ * LOCAL VARIABLES
+ */
+/** @brief 現在の状態 */
+static power_state_t current = POWER_STATE_IDLE;
+/** @brief 現在の状態になった時刻[us] */
+static unsigned long entered_us = 0;
+/** @brief 状態毎の累計時間[us] */
+static uint64_t total_us[POWER_STATE_MAX];
+/** @brief 状態毎の切り替え回数 */
+static uint32_t entries[POWER_STATE_MAX];
+/** @brief 電力管理ロックを使用中 */
+static bool pm_enabled = false;
+/** @brief 自動ライトスリープを使用中 */
+static bool sleep_enabled = false;
+/** @brief BURST のロック（CPU 最高クロック） */
+static esp_pm_lock_handle_t burst_lock = NULL;
+/** @brief IDLE のロック（APB 最高クロック、ライトスリープ禁止） */
+static esp_pm_lock_handle_t idle_lock = NULL;
+/** @brief COMMAND のロック（ライトスリープ禁止） */
+static esp_pm_lock_handle_t command_lock = NULL;
+
+/**
+ * @brief 電力管理の設定関数（ライトスリープ有り、無しの順に試す）
+ * @return true：電力管理を使用
+ */
+static bool power_configure(void)
+{
+  esp_pm_config_esp32_t config = {POWER_MAX_MHZ, POWER_MIN_MHZ, true};
+  if (ESP_OK == esp_pm_configure(&config)) {
+    /* URC の受信で起床する（起床までの数文字は失われる） */
+    uart_set_wakeup_threshold(UART_NUM_1, POWER_WAKEUP_EDGES);
+    esp_sleep_enable_uart_wakeup(UART_NUM_1);
+    sleep_enabled = true;
+  } else {
+    /* CONFIG_FREERTOS_USE_TICKLESS_IDLE 無しのビルドはクロックの切り替えのみ */
+    config.light_sleep_enable = false;
+    if (ESP_OK != esp_pm_configure(&config)) {
+      return false;
+    }
+  }
+  return (ESP_OK == esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "burst", &burst_lock)) &&
+         (ESP_OK == esp_pm_lock_create(ESP_PM_APB_FREQ_MAX, 0, "idle", &idle_lock)) &&
+         (ESP_OK == esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "command", &command_lock));
+}
+
+/**
+ * @brief クロックの切り替え関数
+ * @param[in] from :切り替え前の状態
+ * @param[in] to :切り替え後の状態
+ */
+static void power_apply(power_state_t from, power_state_t to)
+{
+  if (!pm_enabled) {
+    if ((POWER_STATE_BURST == from) != (POWER_STATE_BURST == to)) {
+      setCpuFrequencyMhz((POWER_STATE_BURST == to) ? POWER_MAX_MHZ : POWER_IDLE_MHZ);
+    }
+    return;
+  }
+  /* 先に取ってから離す（一時的にも最低クロックへ落とさない） */
+  if (POWER_STATE_BURST == to) { esp_pm_lock_acquire(burst_lock); }
+  if (POWER_STATE_IDLE == to) { esp_pm_lock_acquire(idle_lock); }
+  if (POWER_STATE_COMMAND == to) { esp_pm_lock_acquire(command_lock); }
+  if (POWER_STATE_BURST == from) { esp_pm_lock_release(burst_lock); }
+  if (POWER_STATE_IDLE == from) { esp_pm_lock_release(idle_lock); }
+  if (POWER_STATE_COMMAND == from) { esp_pm_lock_release(command_lock); }
+}
+
+/*************************************************************************************************/
+void power_init(void)
+{
+  power_set(POWER_STATE_IDLE);
+  pm_enabled = power_configure();
+  if (pm_enabled) {
+    esp_pm_lock_acquire(idle_lock);
+  } else {
+    setCpuFrequencyMhz(POWER_IDLE_MHZ);
+  }
+}
+
+/*************************************************************************************************/
+power_state_t power_set(power_state_t state)
+{
+  power_state_t previous = current;
+  if ((state >= POWER_STATE_MAX) || (state == current)) {
+    return previous;
+  }
+
+  unsigned long now = micros();
+  total_us[current] += now - entered_us;
+  entered_us = now;
+  ++entries[state];
+
+  power_apply(current, state);
+  current = state;
+
+  return previous;
+}
+
+/*************************************************************************************************/
+void power_get_stats(power_stats_t *stats)
+{
+  static const uint8_t wait_ma[2] = {POWER_MA_WAIT, POWER_MA_SLEEP};
+  uint64_t us[POWER_STATE_MAX];
+  uint64_t all = 0;
+
+  for (uint8_t i = 0; i < POWER_STATE_MAX; i++) {
+    us[i] = total_us[i];
+  }
+  us[current] += micros() - entered_us;
+  for (uint8_t i = 0; i < POWER_STATE_MAX; i++) {
+    stats->entries[i] = entries[i];
+    stats->ms[i] = (uint32_t)(us[i] / 1000);
+    all += us[i];
+  }
+
+  stats->pm = pm_enabled;
+  stats->light_sleep = sleep_enabled;
+  /* 電力管理が無ければ WAIT・COMMAND も 80MHz のまま */
+  uint8_t ma_wait = pm_enabled ? wait_ma[sleep_enabled ? 1 : 0] : POWER_MA_IDLE;
+  uint8_t ma_command = pm_enabled ? POWER_MA_WAIT : POWER_MA_IDLE;
+  stats->charge_mas = (uint32_t)((us[POWER_STATE_BURST] * POWER_MA_BURST + us[POWER_STATE_IDLE] * POWER_MA_IDLE +
+                                  us[POWER_STATE_WAIT] * ma_wait + us[POWER_STATE_COMMAND] * ma_command) / 1000000);
+  stats->fixed_mas = (uint32_t)((all * POWER_MA_IDLE) / 1000000);
+  stats->saved_ms = (uint32_t)((us[POWER_STATE_BURST] * (POWER_MAX_MHZ / POWER_IDLE_MHZ - 1)) / 1000);
+}
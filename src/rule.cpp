@@ -0,0 +1,522 @@
+/**
+ * @file rule.cpp
+ * @version 0.1
+ * @brief ルールエンジン（ローカルの状態・イベントから LED・ブザー・送信を直接駆動）
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include <string.h>
+#include "rule.h"
+#include "CK_1540_01.h"
+#include "config.h"
+#include "diag.h"
+#include "outbox.h"
+#include "shadow.h"
+#include "spsc_queue.h"
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief 1 ルールの要素数 */
+#define RULE_FIELDS       9
+/** @brief スイッチの変化（割り込みから投入。レベルはデバウンス後に読む） */
+#define RULE_SWITCH_EDGE  (-1)
+/** @brief 判定表の入れ替え（rule_update から投入） */
+#define RULE_SOURCE_RELOAD RULE_SOURCE_MAX
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief イベント */
+typedef struct st_rule_event
+{
+  /** @brief 発生元（rule_source_t・RULE_SOURCE_RELOAD） */
+  uint8_t source;
+  /** @brief 信号 */
+  uint32_t key;
+  /** @brief 値 */
+  int32_t value;
+} rule_event_t;
+
+/** @brief loop へ渡す動作 */
+typedef struct st_rule_output
+{
+  /** @brief ルールの番号 */
+  uint8_t id;
+  /** @brief 動作（RULE_ACTION_LED・RULE_ACTION_PUBLISH） */
+  uint8_t action;
+  /** @brief 発生元 */
+  uint8_t source;
+  /** @brief true：成立 false：不成立に戻った */
+  bool on;
+  /** @brief 動作の引数 */
+  uint16_t arg;
+  /** @brief 信号 */
+  uint32_t key;
+  /** @brief 値 */
+  int32_t value;
+} rule_output_t;
+
+/** @brief 判定表（NVS に保存する blob） */
+typedef struct st_rule_store
+{
+  /** @brief 保存形式の番号 */
+  uint16_t schema;
+  /** @brief ルール数 */
+  uint8_t count;
+  /** @brief 判定表の version */
+  uint32_t version;
+  /** @brief ルール（source・key 順） */
+  rule_t rules[RULE_MAX];
+} rule_store_t;
+
+/**************************************************************************************************
+ * LOCAL VARIABLES
+ */
+/** @brief 判定表（使用中と次の 2 面。使用中はルールタスクだけが切り替える） */
+static rule_store_t tables[2];
+/** @brief 使用中の面 */
+static volatile uint8_t active = 0;
+/** @brief 次の面が書き込み済み（ルールタスクの切り替え待ち） */
+static volatile bool staged = false;
+/** @brief ルール毎の成立状態（使用中の面の行順） */
+static bool state[RULE_MAX];
+/** @brief 発生元毎の判定対象の key（bit (key & 31)） */
+static volatile uint32_t watch[RULE_SOURCE_MAX];
+/** @brief イベントキュー */
+static QueueHandle_t events = NULL;
+/** @brief loop へ渡す動作のキュー */
+static spsc_queue_t outputs;
+/** @brief 動作のキューの格納領域 */
+static rule_output_t output_buffer[RULE_OUTPUT_QUEUE_SIZE];
+/** @brief ルールタスク */
+static TaskHandle_t rule_task_handle = NULL;
+/** @brief スイッチの状態（デバウンス後、1：押下） */
+static int32_t switch_level = 0;
+/** @brief デバウンス中 */
+static bool debounce = false;
+/** @brief デバウンスの終了時刻 */
+static uint32_t debounce_until = 0;
+/** @brief ブザーの時間指定中 */
+static bool buzzer_timed = false;
+/** @brief ブザーの停止時刻 */
+static uint32_t buzzer_until = 0;
+/** @brief 統計 */
+static rule_stats_t stats;
+/** @brief 更新結果の名前（rule_result_t 順） */
+static const char *const result_names[] = {"ok", "stale", "invalid", "nvs", "busy"};
+
+/**
+ * @brief 判定表の並べ替え関数（source・key 順。同じ信号は受信した順）
+ * @param[in,out] table :判定表
+ */
+static void rule_sort(rule_store_t *table)
+{
+  for (uint8_t i = 1; i < table->count; i++) {
+    rule_t r = table->rules[i];
+    uint8_t j = i;
+    while ((j > 0) && ((table->rules[j - 1].source > r.source) ||
+                       ((table->rules[j - 1].source == r.source) && (table->rules[j - 1].key > r.key)))) {
+      table->rules[j] = table->rules[j - 1];
+      --j;
+    }
+    table->rules[j] = r;
+  }
+}
+
+/**
+ * @brief 判定対象の作成関数
+ * @param[in] table :判定表
+ */
+static void rule_build_watch(const rule_store_t *table)
+{
+  uint32_t masks[RULE_SOURCE_MAX] = {0};
+  for (uint8_t i = 0; i < table->count; i++) {
+    masks[table->rules[i].source] |= (1UL << (table->rules[i].key & 31));
+  }
+  for (uint8_t s = 0; s < RULE_SOURCE_MAX; s++) {
+    watch[s] = masks[s];
+  }
+}
+
+/**
+ * @brief 条件の評価関数
+ * @param[in] r :ルール
+ * @param[in] value :値
+ * @param[in] on :現在成立中
+ * @return true：成立
+ */
+static bool rule_compare(const rule_t *r, int32_t value, bool on)
+{
+  int32_t threshold = r->threshold;
+  if (on) {
+    /* 成立中は不成立側へヒステリシスだけずらす */
+    if ((RULE_OP_GT == r->op) || (RULE_OP_GE == r->op)) {
+      threshold -= r->hysteresis;
+    } else if ((RULE_OP_LT == r->op) || (RULE_OP_LE == r->op)) {
+      threshold += r->hysteresis;
+    }
+  }
+  switch (r->op) {
+  case RULE_OP_EQ: return value == threshold;
+  case RULE_OP_NE: return value != threshold;
+  case RULE_OP_GT: return value > threshold;
+  case RULE_OP_GE: return value >= threshold;
+  case RULE_OP_LT: return value < threshold;
+  default:         return value <= threshold;
+  }
+}
+
+/**
+ * @brief ブザー駆動関数
+ * @param[in] arg :鳴らす時間[ms]（0：停止 RULE_BUZZER_CONTINUOUS：連続）
+ */
+static void rule_buzzer(uint16_t arg)
+{
+  digitalWrite(PORT_OUT_BUZZ, (0 != arg) ? HIGH : LOW);
+  buzzer_timed = (0 != arg) && (RULE_BUZZER_CONTINUOUS != arg);
+  buzzer_until = millis() + arg;
+}
+
+/**
+ * @brief 動作の実行関数（ルールタスク）
+ * @param[in] r :ルール
+ * @param[in] on :true：成立 false：不成立に戻った
+ * @param[in] value :値
+ */
+static void rule_execute(const rule_t *r, bool on, int32_t value)
+{
+  uint8_t action = on ? r->on_action : r->off_action;
+  uint16_t arg = on ? r->on_arg : r->off_arg;
+
+  if (RULE_ACTION_NONE == action) {
+    return;
+  }
+  ++stats.fired;
+  if (RULE_ACTION_BUZZER == action) {
+    rule_buzzer(arg);
+    return;
+  }
+  if (RULE_ACTION_LED == action) {
+    /* 点灯はその場で行い、シャドウへの反映は loop で */
+    shadow_write_led((shadow_led_t)(arg >> 8), (shadow_color_t)(arg & 0xFF));
+  }
+  rule_output_t output = {r->id, action, r->source, on, arg, r->key, value};
+  if (!spsc_push(&outputs, &output)) {
+    ++stats.drops;
+  }
+}
+
+/**
+ * @brief イベントの判定関数（ルールタスク）
+ * @param[in] source :発生元
+ * @param[in] key :信号
+ * @param[in] value :値
+ */
+static void rule_evaluate(uint8_t source, uint32_t key, int32_t value)
+{
+  unsigned long start = micros();
+  const rule_store_t *table = &tables[active];
+
+  /* source・key が一致する最初の行 */
+  uint8_t lo = 0;
+  uint8_t hi = table->count;
+  while (lo < hi) {
+    uint8_t mid = (uint8_t)((lo + hi) / 2);
+    const rule_t *r = &table->rules[mid];
+    if ((r->source < source) || ((r->source == source) && (r->key < key))) {
+      lo = (uint8_t)(mid + 1);
+    } else {
+      hi = mid;
+    }
+  }
+  for (uint8_t i = lo; (i < table->count) && (table->rules[i].source == source) && (table->rules[i].key == key); i++) {
+    bool on = rule_compare(&table->rules[i], value, state[i]);
+    if (on != state[i]) {
+      state[i] = on;
+      rule_execute(&table->rules[i], on, value);
+    }
+  }
+
+  uint32_t elapsed = (uint32_t)(micros() - start);
+  ++stats.events;
+  stats.total_us += elapsed;
+  if (elapsed > stats.max_us) {
+    stats.max_us = elapsed;
+  }
+}
+
+/**
+ * @brief ルールタスク（イベントの判定・デバウンス・ブザーの停止）
+ * @param[in] arg :未使用
+ */
+static void rule_run(void *arg)
+{
+  rule_event_t event;
+
+  for (;;) {
+    TickType_t wait = portMAX_DELAY;
+    uint32_t now = millis();
+    if (debounce) {
+      wait = ((int32_t)(debounce_until - now) > 0) ? pdMS_TO_TICKS(debounce_until - now) : 0;
+    }
+    if (buzzer_timed) {
+      TickType_t buzzer_wait = ((int32_t)(buzzer_until - now) > 0) ? pdMS_TO_TICKS(buzzer_until - now) : 0;
+      wait = (buzzer_wait < wait) ? buzzer_wait : wait;
+    }
+    bool received = (pdTRUE == xQueueReceive(events, &event, wait));
+
+    now = millis();
+    if (debounce && ((int32_t)(now - debounce_until) >= 0)) {
+      debounce = false;
+      int32_t level = (digitalRead(PORT_INP_SW) == LOW) ? 1 : 0;
+      if (level != switch_level) {
+        switch_level = level;
+        rule_evaluate(RULE_SOURCE_SWITCH, 0, level);
+      }
+    }
+    if (buzzer_timed && ((int32_t)(now - buzzer_until) >= 0)) {
+      rule_buzzer(0);
+    }
+    if (!received) {
+      continue;
+    }
+
+    if (RULE_SOURCE_RELOAD == event.source) {
+      if (staged) {
+        active ^= 1;
+        memset(state, 0, sizeof(state));
+        rule_build_watch(&tables[active]);
+        staged = false;
+        /* 押下中に入れ替えた場合も押下中のルールを成立させる */
+        rule_evaluate(RULE_SOURCE_SWITCH, 0, switch_level);
+      }
+    } else if ((RULE_SOURCE_SWITCH == event.source) && (RULE_SWITCH_EDGE == event.value)) {
+      debounce = true;
+      debounce_until = now + RULE_DEBOUNCE_MS;
+    } else {
+      rule_evaluate(event.source, event.key, event.value);
+    }
+  }
+}
+
+/**
+ * @brief スイッチ割り込み：ルールタスクへ変化を渡す
+ */
+static void IRAM_ATTR rule_switch_isr(void)
+{
+  rule_event_t event = {RULE_SOURCE_SWITCH, 0, RULE_SWITCH_EDGE};
+  BaseType_t woken = pdFALSE;
+  if (pdTRUE != xQueueSendFromISR(events, &event, &woken)) {
+    ++stats.drops;
+  }
+  portYIELD_FROM_ISR(woken);
+}
+
+/**
+ * @brief 1 ルールの解析関数
+ * @param[in] fields :[source,key,op,threshold,hysteresis,on,on_arg,off,off_arg]
+ * @param[in] id :受信した順の番号
+ * @param[out] r :ルール
+ * @return true：正常
+ */
+static bool rule_parse(JsonArrayConst fields, uint8_t id, rule_t *r)
+{
+  if (RULE_FIELDS != fields.size()) {
+    return false;
+  }
+  for (uint8_t i = 0; i < RULE_FIELDS; i++) {
+    if (!fields[i].is<long>()) {
+      return false;
+    }
+  }
+  long source = fields[0];
+  long op = fields[2];
+  long hysteresis = fields[4];
+  long on_action = fields[5];
+  long on_arg = fields[6];
+  long off_action = fields[7];
+  long off_arg = fields[8];
+  if ((source < 0) || (source >= RULE_SOURCE_MAX) || (op < 0) || (op >= RULE_OP_MAX) || (hysteresis < 0) ||
+      (on_action < 0) || (on_action >= RULE_ACTION_MAX) || (off_action < 0) || (off_action >= RULE_ACTION_MAX) ||
+      (on_arg < 0) || (on_arg > 0xFFFF) || (off_arg < 0) || (off_arg > 0xFFFF)) {
+    return false;
+  }
+  if (((RULE_ACTION_LED == on_action) && (((on_arg >> 8) >= SHADOW_LED_MAX) || ((on_arg & 0xFF) > SHADOW_COLOR_GREEN))) ||
+      ((RULE_ACTION_LED == off_action) && (((off_arg >> 8) >= SHADOW_LED_MAX) || ((off_arg & 0xFF) > SHADOW_COLOR_GREEN)))) {
+    return false;
+  }
+  r->source = (uint8_t)source;
+  r->op = (uint8_t)op;
+  r->id = id;
+  r->on_action = (uint8_t)on_action;
+  r->off_action = (uint8_t)off_action;
+  r->on_arg = (uint16_t)on_arg;
+  r->off_arg = (uint16_t)off_arg;
+  r->key = fields[1].as<uint32_t>();
+  r->threshold = fields[3].as<int32_t>();
+  r->hysteresis = (int32_t)hysteresis;
+  /* スイッチの key は 0 のみ */
+  return (RULE_SOURCE_SWITCH != r->source) || (0 == r->key);
+}
+
+/*************************************************************************************************/
+void rule_init(void)
+{
+  Preferences prefs;
+
+  memset(tables, 0, sizeof(tables));
+  memset(state, 0, sizeof(state));
+  memset(&stats, 0, sizeof(stats));
+  prefs.begin(RULE_NVS_NAMESPACE, true);
+  rule_store_t saved;
+  if ((sizeof(saved) == prefs.getBytes("table", &saved, sizeof(saved))) && (RULE_SCHEMA == saved.schema) &&
+      (saved.count <= RULE_MAX)) {
+    tables[0] = saved;
+  }
+  prefs.end();
+  tables[0].schema = RULE_SCHEMA;
+  active = 0;
+  staged = false;
+  rule_build_watch(&tables[0]);
+
+  digitalWrite(PORT_OUT_BUZZ, LOW);
+  switch_level = 0;
+  spsc_init(&outputs, output_buffer, sizeof(rule_output_t), RULE_OUTPUT_QUEUE_SIZE);
+  events = xQueueCreate(RULE_EVENT_QUEUE_SIZE, sizeof(rule_event_t));
+  /* loop(コア1) がモデムの応答待ちで止まっていても判定できるようにコア0 で動かす */
+  xTaskCreatePinnedToCore(rule_run, "rule", RULE_TASK_STACK, NULL, 3, &rule_task_handle, 0);
+  diag_register_task(rule_task_handle, "rule");
+  attachInterrupt(digitalPinToInterrupt(PORT_INP_SW), rule_switch_isr, CHANGE);
+  /* 起動時に押下中なら成立させる */
+  rule_post(RULE_SOURCE_SWITCH, 0, RULE_SWITCH_EDGE);
+}
+
+/*************************************************************************************************/
+bool rule_watch(rule_source_t source, uint32_t key)
+{
+  return (source < RULE_SOURCE_MAX) && (0 != (watch[source] & (1UL << (key & 31))));
+}
+
+/*************************************************************************************************/
+void rule_post(rule_source_t source, uint32_t key, int32_t value)
+{
+  rule_event_t event = {(uint8_t)source, key, value};
+  if ((NULL == events) || (pdTRUE != xQueueSend(events, &event, 0))) {
+    ++stats.drops;
+  }
+}
+
+/*************************************************************************************************/
+bool rule_is_update(const char *json)
+{
+  StaticJsonDocument<32> filter;
+  filter["command"] = true;
+  StaticJsonDocument<64> doc;
+  if (deserializeJson(doc, json, DeserializationOption::Filter(filter))) {
+    return false;
+  }
+  return 0 == strcmp(doc["command"] | "", "rules");
+}
+
+/*************************************************************************************************/
+rule_result_t rule_update(const char *json)
+{
+  /* 32 ルールで 5KB 程になるので loop のスタックには置かない */
+  DynamicJsonDocument doc(RULE_DOC_SIZE);
+
+  if (deserializeJson(doc, json) || !doc["version"].is<uint32_t>() || !doc["rules"].is<JsonArray>()) {
+    return RULE_RESULT_INVALID;
+  }
+  uint32_t version = doc["version"];
+  if (version <= tables[active].version) {
+    return RULE_RESULT_STALE;
+  }
+  if (staged) {
+    return RULE_RESULT_BUSY;
+  }
+
+  /* 全ルールを検証してから次の面に書く */
+  JsonArrayConst rules = doc["rules"].as<JsonArrayConst>();
+  if (rules.size() > RULE_MAX) {
+    return RULE_RESULT_INVALID;
+  }
+  rule_store_t parsed;
+  memset(&parsed, 0, sizeof(parsed));
+  parsed.schema = RULE_SCHEMA;
+  parsed.version = version;
+  for (JsonVariantConst item : rules) {
+    JsonArrayConst fields = item.as<JsonArrayConst>();
+    if (fields.isNull() || !rule_parse(fields, parsed.count, &parsed.rules[parsed.count])) {
+      return RULE_RESULT_INVALID;
+    }
+    ++parsed.count;
+  }
+  rule_sort(&parsed);
+
+  Preferences prefs;
+  prefs.begin(RULE_NVS_NAMESPACE, false);
+  bool saved = (sizeof(parsed) == prefs.putBytes("table", &parsed, sizeof(parsed)));
+  prefs.end();
+  if (!saved) {
+    return RULE_RESULT_NVS_ERROR;
+  }
+
+  tables[active ^ 1] = parsed;
+  staged = true;
+  rule_event_t event = {RULE_SOURCE_RELOAD, 0, 0};
+  xQueueSend(events, &event, portMAX_DELAY);
+  return RULE_RESULT_OK;
+}
+
+/*************************************************************************************************/
+uint16_t rule_build_result(char buf[], uint16_t size, rule_result_t result)
+{
+  /* 反映前でも受け付けた version を返す */
+  const rule_store_t *table = &tables[staged ? (active ^ 1) : active];
+  int len = snprintf(buf, size, "{\"rules\":{\"version\":%lu,\"count\":%u,\"result\":\"%s\"}}",
+                     (unsigned long)table->version, table->count, result_names[result]);
+  return ((len >= 0) && (len < size)) ? (uint16_t)len : 0;
+}
+
+/*************************************************************************************************/
+void rule_task(void)
+{
+  const outbox_attr_t attr = {UPLINK_CLASS_CONTROL, OUTBOX_PRIO_CRITICAL, OUTBOX_KEY_NONE, OUTBOX_EXPIRE_SEND,
+                              config_get()->diag_deadline_ms};
+  rule_output_t output;
+
+  while (spsc_pop(&outputs, &output)) {
+    if (RULE_ACTION_LED == output.action) {
+      shadow_set_led((shadow_led_t)(output.arg >> 8), (shadow_color_t)(output.arg & 0xFF));
+      continue;
+    }
+    char payload[160];
+    int len = snprintf(payload, sizeof(payload),
+                       "{\"rule\":{\"id\":%u,\"tag\":%u,\"state\":%u,\"source\":%u,\"key\":%lu,\"value\":%ld}}",
+                       output.id, output.arg, output.on ? 1 : 0, output.source, (unsigned long)output.key,
+                       (long)output.value);
+    if ((len > 0) && (len < (int)sizeof(payload))) {
+      outbox_post((const uint8_t *)payload, (uint16_t)len, &attr);
+    }
+  }
+}
+
+/*************************************************************************************************/
+void rule_get_stats(rule_stats_t *p_stats)
+{
+  *p_stats = stats;
+  p_stats->version = tables[active].version;
+  p_stats->count = tables[active].count;
+}
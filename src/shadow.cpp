@@ -0,0 +1,280 @@
+/**
+ * @file shadow.cpp
+ * @version 0.1
+ * @brief デバイス状態（AWS IoT デバイスシャドウ同期）
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include "shadow.h"
+#include "bg770.h"
+#include "CK_1540_01.h"
+#include "mqtt_session.h"
+#include "outbox.h"
+#include "power.h"
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief RSSI 未取得（AT+CSQ の 99） */
+#define SHADOW_RSSI_UNKNOWN  99
+
+/**************************************************************************************************
+ * LOCAL VARIABLES
+ */
+/** @brief 現在の状態 */
+static shadow_state_t current;
+/** @brief 報告済み（送信できた）の状態 */
+static shadow_state_t reported;
+/** @brief 送信待ちに積んだ状態（送信待ちが無ければ reported と同じ） */
+static shadow_state_t pending;
+/** @brief 変化に依らず報告する項目（再同期・捨てられた更新） */
+static uint8_t forced = 0;
+/** @brief 送信待ちの reported 更新に含めた項目（送信を確認するまで残す） */
+static uint8_t posted = 0;
+/** @brief 反映済みの差分の version */
+static uint32_t delta_version = 0;
+/** @brief LED 名（shadow_led_t 順） */
+static const char *const led_names[SHADOW_LED_MAX] = {"lan", "wan"};
+/** @brief 色の名前（shadow_color_t 順） */
+static const char *const color_names[] = {"OFF", "RED", "GREEN"};
+
+/*************************************************************************************************/
+void shadow_write_led(shadow_led_t led, shadow_color_t color)
+{
+  if (SHADOW_LED_WAN == led) {
+    if (SHADOW_COLOR_RED == color) { WAN_RED_ON(); } else { WAN_RED_OFF(); }
+    if (SHADOW_COLOR_GREEN == color) { WAN_GREEN_ON(); } else { WAN_GREEN_OFF(); }
+  } else {
+    if (SHADOW_COLOR_RED == color) { LAN_RED_ON(); } else { LAN_RED_OFF(); }
+    if (SHADOW_COLOR_GREEN == color) { LAN_GREEN_ON(); } else { LAN_GREEN_OFF(); }
+  }
+}
+
+/*************************************************************************************************/
+void shadow_init(void)
+{
+  current.led[SHADOW_LED_LAN] = SHADOW_COLOR_RED;
+  current.led[SHADOW_LED_WAN] = SHADOW_COLOR_OFF;
+  current.sw = (digitalRead(PORT_INP_SW) == 0);
+  current.rssi = SHADOW_RSSI_UNKNOWN;
+  reported = current;
+  pending = current;
+  forced = SHADOW_FIELD_ALL;
+  posted = 0;
+  delta_version = 0;
+}
+
+/*************************************************************************************************/
+void shadow_resync(void)
+{
+  /* BG770 の起動・リセット表示で変わった LED を戻す */
+  for (uint8_t led = 0; led < SHADOW_LED_MAX; led++) {
+    shadow_write_led((shadow_led_t)led, current.led[led]);
+  }
+  forced = SHADOW_FIELD_ALL;
+  delta_version = 0;
+}
+
+/*************************************************************************************************/
+void shadow_set_led(shadow_led_t led, shadow_color_t color)
+{
+  if ((led < SHADOW_LED_MAX) && (current.led[led] != color)) {
+    current.led[led] = color;
+    shadow_write_led(led, color);
+  }
+}
+
+/*************************************************************************************************/
+shadow_color_t shadow_get_led(shadow_led_t led)
+{
+  return (led < SHADOW_LED_MAX) ? current.led[led] : SHADOW_COLOR_OFF;
+}
+
+/*************************************************************************************************/
+bool shadow_parse_color(const char *name, shadow_color_t *color)
+{
+  for (uint8_t i = 0; i < (sizeof(color_names) / sizeof(color_names[0])); i++) {
+    if (0 == strcasecmp(name, color_names[i])) {
+      *color = (shadow_color_t)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+/*************************************************************************************************/
+const char *shadow_color_name(shadow_color_t color)
+{
+  return (color <= SHADOW_COLOR_GREEN) ? color_names[color] : color_names[SHADOW_COLOR_OFF];
+}
+
+/**
+ * @brief 出力先への追記関数
+ * @param[in,out] buf :出力先
+ * @param[in] size :出力先のサイズ
+ * @param[in,out] len :書き込み済みの長さ（入りきらない場合は size）
+ * @param[in] format :書式
+ */
+static void shadow_append(char buf[], uint16_t size, uint16_t *len, const char *format, ...)
+{
+  if (*len >= size) {
+    return;
+  }
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(&buf[*len], size - *len, format, args);
+  va_end(args);
+  *len = ((n < 0) || ((*len + n) >= size)) ? size : (uint16_t)(*len + n);
+}
+
+/*************************************************************************************************/
+uint16_t shadow_build_reported(char buf[], uint16_t size, uint8_t fields)
+{
+  uint16_t len = 0;
+  const char *sep = "";
+
+  shadow_append(buf, size, &len, "{\"state\":{\"reported\":{");
+  for (uint8_t led = 0; led < SHADOW_LED_MAX; led++) {
+    if (fields & (SHADOW_FIELD_LAN << led)) {
+      shadow_append(buf, size, &len, "%s\"%s\":\"%s\"", sep, led_names[led], shadow_color_name(current.led[led]));
+      sep = ",";
+    }
+  }
+  if (fields & SHADOW_FIELD_SW) {
+    shadow_append(buf, size, &len, "%s\"sw\":\"%s\"", sep, current.sw ? "ON" : "OFF");
+    sep = ",";
+  }
+  if ((fields & SHADOW_FIELD_RSSI) && (SHADOW_RSSI_UNKNOWN != current.rssi)) {
+    shadow_append(buf, size, &len, "%s\"rssi\":%d", sep, current.rssi);
+    sep = ",";
+  }
+  if (fields & SHADOW_FIELD_FW) {
+    shadow_append(buf, size, &len, "%s\"fw\":{\"ver\":\"%s\",\"build\":\"%s %s\"}", sep, FIRMWARE_VERSION,
+                  __DATE__, __TIME__);
+  }
+  shadow_append(buf, size, &len, "}}}");
+
+  return (len < size) ? len : 0;
+}
+
+/**
+ * @brief 前回送信待ちに積んだ状態から変化した項目の取得関数
+ * @return 項目（SHADOW_FIELD_*）
+ */
+static uint8_t shadow_changes(void)
+{
+  uint8_t fields = forced;
+
+  for (uint8_t led = 0; led < SHADOW_LED_MAX; led++) {
+    if (current.led[led] != pending.led[led]) {
+      fields |= (SHADOW_FIELD_LAN << led);
+    }
+  }
+  if (current.sw != pending.sw) {
+    fields |= SHADOW_FIELD_SW;
+  }
+  /* RSSI は揺らぎで送り続けないよう SHADOW_RSSI_STEP 以上の変化のみ */
+  if ((SHADOW_RSSI_UNKNOWN != current.rssi) &&
+      ((SHADOW_RSSI_UNKNOWN == pending.rssi) || (abs(current.rssi - pending.rssi) >= SHADOW_RSSI_STEP))) {
+    fields |= SHADOW_FIELD_RSSI;
+  }
+
+  return fields;
+}
+
+/*************************************************************************************************/
+void shadow_task(void)
+{
+  current.sw = (digitalRead(PORT_INP_SW) == 0);
+  current.rssi = bg770_get_rssi();
+
+  /* 送信待ちの更新が片付いた：送れたら報告済みとし、捨てられたら積んだ項目を報告し直す */
+  if (0 != posted) {
+    outbox_result_t result = outbox_result(OUTBOX_KEY_SHADOW);
+    if (OUTBOX_RESULT_SENT == result) {
+      reported = pending;
+      posted = 0;
+    } else if (OUTBOX_RESULT_DROPPED == result) {
+      pending = reported;
+      forced |= posted;
+      posted = 0;
+    }
+  }
+
+  if (BG770_STATE_SUBSCRIBE != bg_state) {
+    return;
+  }
+  uint8_t fields = shadow_changes();
+  if (0 == fields) {
+    return;
+  }
+
+  /* 未確認の更新は置き換わる（送信中なら失敗で捨てられる）ので、その項目も含める */
+  fields |= posted;
+  power_state_t power = power_set(POWER_STATE_BURST);
+  char payload[PUBLISH_SIZE];
+  uint16_t len = shadow_build_reported(payload, sizeof(payload), fields);
+  const outbox_attr_t attr = {UPLINK_CLASS_SHADOW, OUTBOX_PRIO_CRITICAL, OUTBOX_KEY_SHADOW, OUTBOX_EXPIRE_SEND,
+                              SHADOW_DEADLINE_MS};
+  bool queued = (0 != len) && outbox_post((const uint8_t *)payload, len, &attr);
+  power_set(power);
+  if (!queued) {
+    return;
+  }
+
+  posted = fields;
+  forced = 0;
+  pending.led[SHADOW_LED_LAN] = current.led[SHADOW_LED_LAN];
+  pending.led[SHADOW_LED_WAN] = current.led[SHADOW_LED_WAN];
+  pending.sw = current.sw;
+  if (fields & SHADOW_FIELD_RSSI) {
+    pending.rssi = current.rssi;
+  }
+}
+
+/*************************************************************************************************/
+bool shadow_is_delta(const at_line_t *line)
+{
+  /* +QMTRECV: <client_idx>,<msgID>,"<topic>","<payload>" */
+  const char *topic = strchr(line->args, '"');
+  char delta[MQTT_SHADOW_TOPIC_SIZE];
+  mqtt_session_shadow_topic(SHADOW_DELTA_SUFFIX, delta);
+  size_t len = strlen(delta);
+  return (NULL != topic) && (0 == strncmp(topic + 1, delta, len)) && ('"' == topic[1 + len]);
+}
+
+/*************************************************************************************************/
+void shadow_apply_delta(const char *json)
+{
+  StaticJsonDocument<SHADOW_DELTA_DOC_SIZE> doc;
+  if (deserializeJson(doc, json)) {
+    return;
+  }
+
+  /* 順序が入れ替わった古い差分は捨てる */
+  uint32_t version = doc["version"] | 0;
+  if ((0 != version) && (version <= delta_version)) {
+    return;
+  }
+  delta_version = version;
+
+  for (uint8_t led = 0; led < SHADOW_LED_MAX; led++) {
+    const char *name = doc["state"][led_names[led]] | (const char *)NULL;
+    shadow_color_t color;
+    if ((NULL != name) && shadow_parse_color(name, &color)) {
+      shadow_set_led((shadow_led_t)led, color);
+      /* 既に同じ色でも報告し直して desired との差分を解消する */
+      forced |= (SHADOW_FIELD_LAN << led);
+    }
+  }
+}
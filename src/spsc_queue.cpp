@@ -0,0 +1,64 @@
+/**
+ * @file spsc_queue.cpp
+ * @version 0.1
+ * @brief 単一生産者・単一消費者のロックフリーキュー
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <string.h>
+#include "spsc_queue.h"
+
+/*************************************************************************************************/
+void spsc_init(spsc_queue_t *q, void *buffer, uint16_t elem_size, uint16_t capacity)
+{
+  q->buffer = (uint8_t *)buffer;
+  q->elem_size = elem_size;
+  q->capacity = capacity;
+  q->head = 0;
+  q->tail = 0;
+  q->dropped = 0;
+}
+
+/*************************************************************************************************/
+bool IRAM_ATTR spsc_push(spsc_queue_t *q, const void *elem)
+{
+  uint32_t head = q->head;
+  uint32_t tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+
+  if ((head - tail) >= q->capacity) {
+    ++q->dropped;
+    return false;
+  }
+  memcpy(&q->buffer[(head & (q->capacity - 1)) * q->elem_size], elem, q->elem_size);
+  /* データ書き込み完了後に位置を公開する */
+  __atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+
+  return true;
+}
+
+/*************************************************************************************************/
+bool spsc_pop(spsc_queue_t *q, void *elem)
+{
+  uint32_t tail = q->tail;
+  uint32_t head = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+
+  if (head == tail) {
+    return false;
+  }
+  memcpy(elem, &q->buffer[(tail & (q->capacity - 1)) * q->elem_size], q->elem_size);
+  __atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+
+  return true;
+}
+
+/*************************************************************************************************/
+uint16_t spsc_count(const spsc_queue_t *q)
+{
+  return (uint16_t)(__atomic_load_n(&q->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE));
+}
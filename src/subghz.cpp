@@ -0,0 +1,537 @@
+/**
+ * @file subghz.cpp
+ * @version 0.1
+ * @brief Sub-GHz(CC1310) センサーゲートウェイ
+ *
+ * 受信タスク（コア0）：UART2 受信 → フレーム分解 → CRC 確認 → デコード → 重複除去 → 集計
+ * loop（コア1）      ：キューから集計結果を取り出してパブリッシュ
+ * モデムのコマンド実行で loop が止まっていても受信タスクは UART を読み続ける。
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "CK_1540_01.h"
+#include "spsc_queue.h"
+#include "rule.h"
+#include "subghz.h"
+#include "diag.h"
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief UART2 受信バッファサイズ（モデム待ち中の取りこぼし防止） */
+#define SUBGHZ_UART_BUFFER      4096
+/** @brief 集計結果キューの容量（2 のべき乗） */
+#define SUBGHZ_QUEUE_SIZE       64
+/** @brief 受信タスクのポーリング周期[ms]（INT2 が来なくても読みに行く） */
+#define SUBGHZ_POLL_MS          10
+/** @brief 受信タスクのスタックサイズ */
+#define SUBGHZ_TASK_STACK       4096
+/** @brief 重複判定ウィンドウ（直近のシーケンス番号数） */
+#define SUBGHZ_DEDUP_WINDOW     32
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief フレーム分解の状態 */
+typedef enum e_subghz_rx_state
+{
+  /** @brief SOF 待ち */
+  SUBGHZ_RX_SOF = 0,
+  /** @brief LEN 待ち */
+  SUBGHZ_RX_LEN,
+  /** @brief 本体と CRC の受信中 */
+  SUBGHZ_RX_BODY,
+} subghz_rx_state_t;
+
+/** @brief デコード済みサンプル */
+typedef struct st_subghz_sample
+{
+  /** @brief チャンネル数 */
+  uint8_t channels;
+  /** @brief 値 */
+  int32_t value[SUBGHZ_CHANNEL_MAX];
+} subghz_sample_t;
+
+/** @brief 種別毎のデコーダ */
+typedef struct st_subghz_decoder
+{
+  /** @brief フレーム種別 */
+  uint8_t type;
+  /** @brief データ長 */
+  uint8_t length;
+  /** @brief デコード関数 */
+  void (*decode)(const uint8_t *data, subghz_sample_t *sample);
+} subghz_decoder_t;
+
+/** @brief ノード情報 */
+typedef struct st_subghz_node
+{
+  /** @brief 使用中フラグ */
+  bool used;
+  /** @brief 最新シーケンス番号 */
+  uint8_t last_seq;
+  /** @brief 直近の受信済みシーケンス番号（bit n = last_seq - n） */
+  uint32_t seq_window;
+  /** @brief 集計中のデータ */
+  subghz_aggregate_t aggregate;
+} subghz_node_t;
+
+/**************************************************************************************************
+ * LOCAL FUNCTIONS
+ */
+static void decode_temp_humi(const uint8_t *data, subghz_sample_t *sample);
+static void decode_counter(const uint8_t *data, subghz_sample_t *sample);
+static void decode_analog(const uint8_t *data, subghz_sample_t *sample);
+
+/**************************************************************************************************
+ * LOCAL VARIABLES
+ */
+/** @brief デコーダ表 */
+static const subghz_decoder_t decoders[] = {
+    {SUBGHZ_TYPE_TEMP_HUMI, 4, decode_temp_humi},
+    {SUBGHZ_TYPE_COUNTER,   4, decode_counter},
+    {SUBGHZ_TYPE_ANALOG,    2, decode_analog},
+};
+/** @brief ノード表（ノードID のハッシュで引く） */
+static subghz_node_t nodes[SUBGHZ_NODE_MAX];
+/** @brief 受信中フレーム */
+static uint8_t rx_frame[SUBGHZ_FRAME_MAX];
+/** @brief 受信中フレームの位置 */
+static uint16_t rx_pos;
+/** @brief 受信中フレームの全長 */
+static uint16_t rx_need;
+/** @brief フレーム分解の状態 */
+static subghz_rx_state_t rx_state = SUBGHZ_RX_SOF;
+/** @brief 再同期の再帰段数 */
+static uint8_t resync_depth = 0;
+/** @brief 集計周期の開始時刻 */
+static uint32_t window_start;
+/** @brief 集計結果キューの格納領域 */
+static subghz_aggregate_t queue_buffer[SUBGHZ_QUEUE_SIZE];
+/** @brief 集計結果キュー */
+static spsc_queue_t queue;
+/** @brief ペイロードに入りきらず持ち越した集計結果 */
+static subghz_aggregate_t carry;
+/** @brief 持ち越し有無 */
+static bool has_carry = false;
+/** @brief 集計結果の記録先（履歴保存） */
+static void (*record_handler)(const subghz_aggregate_t *aggregate) = NULL;
+/** @brief 受信統計 */
+static subghz_stats_t stats;
+/** @brief 受信タスク */
+static TaskHandle_t rx_task = NULL;
+
+/*************************************************************************************************/
+static uint16_t read_u16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+/*************************************************************************************************/
+static void decode_temp_humi(const uint8_t *data, subghz_sample_t *sample)
+{
+  sample->channels = 2;
+  sample->value[0] = (int16_t)read_u16(&data[0]);
+  sample->value[1] = read_u16(&data[2]);
+}
+
+/*************************************************************************************************/
+static void decode_counter(const uint8_t *data, subghz_sample_t *sample)
+{
+  sample->channels = 1;
+  sample->value[0] = (int32_t)(read_u16(&data[0]) | ((uint32_t)read_u16(&data[2]) << 16));
+}
+
+/*************************************************************************************************/
+static void decode_analog(const uint8_t *data, subghz_sample_t *sample)
+{
+  sample->channels = 1;
+  sample->value[0] = (int16_t)read_u16(&data[0]);
+}
+
+/*************************************************************************************************/
+uint16_t subghz_crc16(const uint8_t *data, size_t length)
+{
+  /* 4bit テーブル版 CRC16-CCITT（多項式 0x1021） */
+  static const uint16_t table[16] = {
+      0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+      0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+  };
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < length; i++) {
+    crc = (uint16_t)((crc << 4) ^ table[(crc >> 12) ^ (data[i] >> 4)]);
+    crc = (uint16_t)((crc << 4) ^ table[(crc >> 12) ^ (data[i] & 0x0F)]);
+  }
+  return crc;
+}
+
+/**
+ * @brief ノード検索関数（未登録なら登録する）
+ * @param[in] node :ノードID
+ * @return ノード情報（表が満杯の場合 NULL）
+ */
+static subghz_node_t *node_lookup(uint16_t node)
+{
+  uint16_t slot = (uint16_t)((node * 40503u) >> 11) & (SUBGHZ_NODE_MAX - 1);
+
+  for (uint16_t probe = 0; probe < SUBGHZ_NODE_MAX; probe++) {
+    subghz_node_t *p = &nodes[slot];
+    if (!p->used) {
+      memset(p, 0, sizeof(*p));
+      p->used = true;
+      p->aggregate.node = node;
+      return p;
+    }
+    if (p->aggregate.node == node) {
+      return p;
+    }
+    slot = (slot + 1) & (SUBGHZ_NODE_MAX - 1);
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief 重複判定関数
+ * @param[in/out] p :ノード情報
+ * @param[in] seq :シーケンス番号
+ * @return true：重複
+ */
+static bool is_duplicate(subghz_node_t *p, uint8_t seq)
+{
+  int8_t diff = (int8_t)(seq - p->last_seq);
+
+  if ((0 == p->seq_window) || (diff > 0)) {
+    /* 新しい番号（初回含む） */
+    p->seq_window = ((0 == p->seq_window) || (diff >= SUBGHZ_DEDUP_WINDOW)) ? 1 : ((p->seq_window << diff) | 1);
+    p->last_seq = seq;
+    return false;
+  }
+
+  uint8_t age = (uint8_t)(-diff);
+  if (age >= SUBGHZ_DEDUP_WINDOW) {
+    /* ウィンドウより古い番号はノード再起動とみなして受け入れる */
+    p->seq_window = 1;
+    p->last_seq = seq;
+    return false;
+  }
+  if (0 != (p->seq_window & (1UL << age))) {
+    return true;
+  }
+  /* 順序入れ替わりで届いた未受信の番号 */
+  p->seq_window |= (1UL << age);
+  return false;
+}
+
+/**
+ * @brief 集計結果のキュー出力関数
+ * @param[in/out] p :ノード情報
+ */
+static void aggregate_emit(subghz_node_t *p)
+{
+  if (0 == p->aggregate.count) {
+    return;
+  }
+  if (!spsc_push(&queue, &p->aggregate)) {
+    ++stats.queue_drops;
+  }
+  p->aggregate.count = 0;
+}
+
+/**
+ * @brief サンプル集計関数
+ * @param[in/out] p :ノード情報
+ * @param[in] type :フレーム種別
+ * @param[in] sample :サンプル
+ */
+static void aggregate_add(subghz_node_t *p, uint8_t type, const subghz_sample_t *sample)
+{
+  subghz_aggregate_t *a = &p->aggregate;
+
+  if ((0 != a->count) && (a->type != type)) {
+    /* 周期途中で種別が変わった場合はそこまでを出力 */
+    aggregate_emit(p);
+  }
+  if (0 == a->count) {
+    a->type = type;
+    a->channels = sample->channels;
+    for (uint8_t ch = 0; ch < sample->channels; ch++) {
+      a->min[ch] = sample->value[ch];
+      a->max[ch] = sample->value[ch];
+      a->sum[ch] = 0;
+    }
+  }
+  for (uint8_t ch = 0; ch < sample->channels; ch++) {
+    int32_t v = sample->value[ch];
+    if (v < a->min[ch]) { a->min[ch] = v; }
+    if (v > a->max[ch]) { a->max[ch] = v; }
+    a->sum[ch] += v;
+    a->last[ch] = v;
+  }
+  ++a->count;
+}
+
+/**
+ * @brief 受信完了フレームの処理関数
+ * @param[in] frame :SOF から CRC までのフレーム
+ * @return true：CRC 一致
+ */
+static bool frame_process(const uint8_t *frame)
+{
+  uint8_t len = frame[1];
+  if (subghz_crc16(&frame[1], len + 1) != read_u16(&frame[2 + len])) {
+    ++stats.crc_errors;
+    return false;
+  }
+
+  uint16_t node = read_u16(&frame[2]);
+  uint8_t seq = frame[4];
+  uint8_t type = frame[5];
+  uint8_t data_length = len - 4;
+
+  const subghz_decoder_t *decoder = NULL;
+  for (uint8_t i = 0; i < sizeof(decoders) / sizeof(decoders[0]); i++) {
+    if (decoders[i].type == type) {
+      decoder = &decoders[i];
+      break;
+    }
+  }
+  if ((NULL == decoder) || (data_length < decoder->length)) {
+    ++stats.bad_frames;
+    return true;
+  }
+
+  subghz_node_t *p = node_lookup(node);
+  if (NULL == p) {
+    ++stats.node_overflows;
+    return true;
+  }
+  if (is_duplicate(p, seq)) {
+    ++stats.duplicates;
+    return true;
+  }
+
+  subghz_sample_t sample;
+  decoder->decode(&frame[6], &sample);
+  for (uint8_t ch = 0; ch < sample.channels; ch++) {
+    if (rule_watch(RULE_SOURCE_SUBGHZ, RULE_KEY_SUBGHZ(node, ch))) {
+      rule_post(RULE_SOURCE_SUBGHZ, RULE_KEY_SUBGHZ(node, ch), sample.value[ch]);
+    }
+  }
+  aggregate_add(p, type, &sample);
+  ++stats.frames;
+
+  return true;
+}
+
+/*************************************************************************************************/
+void subghz_feed(const uint8_t *data, size_t length)
+{
+  for (size_t i = 0; i < length; i++) {
+    uint8_t c = data[i];
+
+    switch (rx_state) {
+    case SUBGHZ_RX_SOF:
+      if (SUBGHZ_SOF == c) {
+        rx_frame[0] = c;
+        rx_pos = 1;
+        rx_state = SUBGHZ_RX_LEN;
+      }
+      break;
+    case SUBGHZ_RX_LEN:
+      if ((c < 4) || (SUBGHZ_MAX_LEN < c)) {
+        ++stats.bad_frames;
+        rx_state = SUBGHZ_RX_SOF;
+        if (SUBGHZ_SOF == c) {
+          rx_frame[0] = c;
+          rx_pos = 1;
+          rx_state = SUBGHZ_RX_LEN;
+        }
+        break;
+      }
+      rx_frame[rx_pos++] = c;
+      rx_need = (uint16_t)(c + 4);
+      rx_state = SUBGHZ_RX_BODY;
+      break;
+    case SUBGHZ_RX_BODY:
+      rx_frame[rx_pos++] = c;
+      if (rx_pos >= rx_need) {
+        rx_state = SUBGHZ_RX_SOF;
+        if (!frame_process(rx_frame) && (0 == resync_depth)) {
+          /* CRC 不一致：SOF の次のバイトから再同期する（再帰は 1 段まで） */
+          uint8_t resync[SUBGHZ_FRAME_MAX];
+          uint16_t resync_length = rx_pos - 1;
+          memcpy(resync, &rx_frame[1], resync_length);
+          ++resync_depth;
+          subghz_feed(resync, resync_length);
+          --resync_depth;
+        }
+      }
+      break;
+    }
+  }
+}
+
+/*************************************************************************************************/
+void subghz_flush(uint32_t now)
+{
+  if ((uint32_t)(now - window_start) < SUBGHZ_AGGREGATE_MS) {
+    return;
+  }
+  window_start = now;
+  for (uint16_t i = 0; i < SUBGHZ_NODE_MAX; i++) {
+    if (nodes[i].used) {
+      aggregate_emit(&nodes[i]);
+    }
+  }
+}
+
+/*************************************************************************************************/
+bool subghz_pop(subghz_aggregate_t *aggregate) { return spsc_pop(&queue, aggregate); }
+
+/*************************************************************************************************/
+uint16_t subghz_pending(void) { return spsc_count(&queue); }
+
+/*************************************************************************************************/
+void subghz_set_record_handler(void (*handler)(const subghz_aggregate_t *aggregate)) { record_handler = handler; }
+
+/**
+ * @brief 送信する集計結果の取り出し関数（記録先があれば渡す）
+ * @param[out] aggregate :集計結果
+ * @return true：取り出し成功
+ */
+static bool subghz_take(subghz_aggregate_t *aggregate)
+{
+  if (!subghz_pop(aggregate)) {
+    return false;
+  }
+  if (NULL != record_handler) {
+    record_handler(aggregate);
+  }
+  return true;
+}
+
+/*************************************************************************************************/
+uint16_t subghz_build_payload(char *buf, uint16_t size)
+{
+  uint16_t len = 0;
+  uint16_t entries = 0;
+  /* 1 エントリの最大長（「]}」の 2 バイトを残す） */
+  const uint16_t entry_max = 160;
+
+  if (!has_carry) {
+    has_carry = subghz_take(&carry);
+  }
+  if (!has_carry) {
+    return 0;
+  }
+
+  len += snprintf(&buf[len], size - len, "{\"subghz\":[");
+  while (has_carry && ((uint16_t)(len + entry_max) < size)) {
+    const subghz_aggregate_t *a = &carry;
+    len += snprintf(&buf[len], size - len, "%s{\"n\":%u,\"t\":%u,\"c\":%u", (0 == entries) ? "" : ",",
+                    a->node, a->type, a->count);
+    static const char *const keys[] = {"min", "max", "avg", "last"};
+    for (uint8_t k = 0; k < 4; k++) {
+      len += snprintf(&buf[len], size - len, ",\"%s\":[", keys[k]);
+      for (uint8_t ch = 0; ch < a->channels; ch++) {
+        long v = (0 == k) ? a->min[ch] : (1 == k) ? a->max[ch] : (2 == k) ? (long)(a->sum[ch] / a->count) : a->last[ch];
+        len += snprintf(&buf[len], size - len, "%s%ld", (0 == ch) ? "" : ",", v);
+      }
+      len += snprintf(&buf[len], size - len, "]");
+    }
+    len += snprintf(&buf[len], size - len, "}");
+    ++entries;
+    has_carry = subghz_take(&carry);
+  }
+  len += snprintf(&buf[len], size - len, "]}");
+
+  return len;
+}
+
+/*************************************************************************************************/
+uint16_t subghz_frame_encode(uint8_t *buf, uint16_t node, uint8_t seq, uint8_t type, const uint8_t *data, uint8_t length)
+{
+  if ((length + 4) > SUBGHZ_MAX_LEN) {
+    return 0;
+  }
+  uint8_t len = (uint8_t)(length + 4);
+
+  buf[0] = SUBGHZ_SOF;
+  buf[1] = len;
+  buf[2] = (uint8_t)(node & 0xFF);
+  buf[3] = (uint8_t)(node >> 8);
+  buf[4] = seq;
+  buf[5] = type;
+  memcpy(&buf[6], data, length);
+  uint16_t crc = subghz_crc16(&buf[1], len + 1);
+  buf[2 + len] = (uint8_t)(crc & 0xFF);
+  buf[3 + len] = (uint8_t)(crc >> 8);
+
+  return (uint16_t)(len + 4);
+}
+
+/*************************************************************************************************/
+void subghz_get_stats(subghz_stats_t *p_stats)
+{
+  *p_stats = stats;
+}
+
+/**
+ * @brief INT2(CC1310) 割り込み：受信タスクを起こす
+ */
+static void IRAM_ATTR subghz_isr(void)
+{
+  BaseType_t woken = pdFALSE;
+  if (NULL != rx_task) {
+    vTaskNotifyGiveFromISR(rx_task, &woken);
+  }
+  portYIELD_FROM_ISR(woken);
+}
+
+/**
+ * @brief 受信タスク
+ * @param[in] arg :未使用
+ */
+static void subghz_task(void *arg)
+{
+  uint8_t buf[128];
+
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SUBGHZ_POLL_MS));
+    int n;
+    while ((n = Serial2.available()) > 0) {
+      if (n > (int)sizeof(buf)) { n = sizeof(buf); }
+      n = Serial2.readBytes(buf, n);
+      subghz_feed(buf, n);
+    }
+    subghz_flush(millis());
+  }
+}
+
+/*************************************************************************************************/
+void subghz_init(void)
+{
+  memset(nodes, 0, sizeof(nodes));
+  memset(&stats, 0, sizeof(stats));
+  spsc_init(&queue, queue_buffer, sizeof(subghz_aggregate_t), SUBGHZ_QUEUE_SIZE);
+  rx_state = SUBGHZ_RX_SOF;
+  window_start = millis();
+
+  /* シリアル設定（受信バッファは begin より前に設定する） */
+  Serial2.setRxBufferSize(SUBGHZ_UART_BUFFER);
+  Serial2.begin(SUBGHZ_BAUDRATE, SERIAL_8N1, PORT_SUBGUART_RXD, PORT_SUBGUART_TXD);
+
+  /* 受信タスクは loop(コア1) と別のコア0 で動かす */
+  xTaskCreatePinnedToCore(subghz_task, "subghz", SUBGHZ_TASK_STACK, NULL, 2, &rx_task, 0);
+  diag_register_task(rx_task, "subghz");
+  attachInterrupt(digitalPinToInterrupt(PORT_INP_INT2), subghz_isr, FALLING);
+
+  Serial.println("SubGHz gateway start");
+}
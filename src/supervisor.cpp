@@ -0,0 +1,331 @@
+/**
+ * @file supervisor.cpp
+ * @version 0.1
+ * @brief 処理時間の監視（段階毎の上限・ウォッチドッグ・段階的な復旧）
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <string.h>
+#include <esp_system.h>
+#include <esp_task_wdt.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "supervisor.h"
+#include "CK_1540_01.h"
+#include "bg770.h"
+#include "trace.h"
+#include "diag.h"
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief 有効な記録を示す値 */
+#define SUPERVISOR_MAGIC  0x53555031UL
+
+/** @brief 段階毎の既定の上限[ms]（MODEM・ACK は呼び出し側が指定する） */
+static const uint32_t default_budget_ms[SUPERVISOR_STAGE_MAX] = {
+    SUPERVISOR_LOOP_MS,    SUPERVISOR_MODEM_MARGIN_MS, SUPERVISOR_PUBLISH_MS,
+    SUPERVISOR_HTTP_MS,    SUPERVISOR_CONSOLE_MS,      SUPERVISOR_ACK_MARGIN_MS,
+};
+/** @brief 段階名 */
+static const char *const stage_names[SUPERVISOR_STAGE_MAX] = {"LOOP", "MODEM", "PUBLISH", "HTTP", "CONSOLE", "ACK"};
+/** @brief 復旧の段階名 */
+static const char *const level_names[SUPERVISOR_LEVEL_MAX] = {"-", "SOFT", "MODEM", "RESTART", "WDT"};
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief 実行中の段階 */
+typedef struct st_supervisor_frame
+{
+  /** @brief 段階 */
+  uint8_t stage;
+  /** @brief 復旧の段階（監視タスクが書く） */
+  uint8_t level;
+  /** @brief 開始時刻[ms] */
+  uint32_t start_ms;
+  /** @brief 上限[ms] */
+  uint32_t budget_ms;
+  /** @brief 入れ子の内側の段階の時間[ms] */
+  uint32_t nested_ms;
+  /** @brief 内容 */
+  char detail[SUPERVISOR_DETAIL_SIZE];
+} supervisor_frame_t;
+
+/** @brief 上限超過の記録（RTC メモリに配置） */
+typedef struct st_supervisor_log
+{
+  /** @brief 有効確認値 */
+  uint32_t magic;
+  /** @brief 起動回数 */
+  uint32_t boots;
+  /** @brief 累計記録数（次の書き込み位置） */
+  uint32_t head;
+  /** @brief 実行中の段階（ウォッチドッグ・例外によるリセット後に記録する） */
+  supervisor_violation_t crumb;
+  /** @brief 記録 */
+  supervisor_violation_t records[SUPERVISOR_LOG_RECORDS];
+} supervisor_log_t;
+
+/**************************************************************************************************
+ * LOCAL VARIABLES
+ */
+/** @brief 上限超過の記録（リセットで初期化されない） */
+static RTC_NOINIT_ATTR supervisor_log_t rtc_log;
+/** @brief 実行中の段階（[0] は LOOP） */
+static supervisor_frame_t frames[SUPERVISOR_DEPTH];
+/** @brief 入れ子の数 */
+static volatile uint8_t depth = 0;
+/** @brief 中断要求 */
+static volatile bool aborted = false;
+/** @brief BG770 リセット済み（loop で状態を戻す） */
+static volatile bool modem_reset_pending = false;
+/** @brief frames の排他 */
+static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+/** @brief 統計 */
+static supervisor_stats_t stats;
+
+/**
+ * @brief 記録の作成関数
+ * @param[out] v :記録
+ * @param[in] index :段階の位置
+ * @param[in] level :復旧の段階
+ * @param[in] elapsed_ms :経過時間[ms]
+ */
+static void supervisor_fill(supervisor_violation_t *v, uint8_t index, supervisor_level_t level, uint32_t elapsed_ms)
+{
+  const supervisor_frame_t *f = &frames[index];
+  v->boot = rtc_log.boots;
+  v->uptime_ms = millis();
+  v->elapsed_ms = elapsed_ms;
+  v->budget_ms = f->budget_ms;
+  v->stage = f->stage;
+  v->outer = (0 != index) ? frames[index - 1].stage : f->stage;
+  v->level = (uint8_t)level;
+  memcpy(v->detail, f->detail, sizeof(v->detail));
+}
+
+/**
+ * @brief RTC メモリへの記録関数
+ * @param[in] v :記録
+ */
+static void supervisor_log(const supervisor_violation_t *v)
+{
+  rtc_log.records[rtc_log.head % SUPERVISOR_LOG_RECORDS] = *v;
+  ++rtc_log.head;
+  ++stats.logged;
+  if (v->level < SUPERVISOR_LEVEL_MAX) {
+    ++stats.violations[v->level];
+  }
+}
+
+/**
+ * @brief 最も内側の段階の確認関数（監視タスクから呼ぶ）
+ */
+static void supervisor_check(void)
+{
+  portENTER_CRITICAL(&mux);
+  uint8_t index = depth - 1;
+  supervisor_frame_t *f = &frames[index];
+  uint32_t elapsed = millis() - f->start_ms - f->nested_ms;
+  supervisor_level_t level = SUPERVISOR_LEVEL_NONE;
+  if (elapsed > f->budget_ms) {
+    uint32_t over = elapsed - f->budget_ms;
+    level = (over >= SUPERVISOR_RESTART_MS)       ? SUPERVISOR_LEVEL_RESTART
+            : (over >= SUPERVISOR_MODEM_RESET_MS) ? SUPERVISOR_LEVEL_MODEM_RESET
+                                                  : SUPERVISOR_LEVEL_SOFT;
+  }
+  bool escalate = (level > f->level);
+  supervisor_violation_t v;
+  if (escalate) {
+    f->level = (uint8_t)level;
+    aborted = true;
+    supervisor_fill(&v, index, level, elapsed);
+  }
+  portEXIT_CRITICAL(&mux);
+
+  if (!escalate) {
+    return;
+  }
+  supervisor_log(&v);
+  Serial.printf("supervisor: %s %s %lu/%lums [%s]\n", level_names[level], stage_names[v.stage],
+                (unsigned long)v.elapsed_ms, (unsigned long)v.budget_ms, v.detail);
+
+  if (SUPERVISOR_LEVEL_MODEM_RESET == level) {
+    /* UART の応答待ちを終わらせる。状態は loop に戻ってから bg770_reset で初期化する */
+    trace_mark_failure();
+    BG770_RESET_ON();
+    vTaskDelay(pdMS_TO_TICKS(1000));
+    BG770_RESET_OFF();
+    modem_reset_pending = true;
+  } else if (SUPERVISOR_LEVEL_RESTART == level) {
+    trace_mark_failure();
+    esp_restart();
+  }
+}
+
+/**
+ * @brief 監視タスク
+ * @param[in] arg :未使用
+ */
+static void supervisor_monitor(void *arg)
+{
+  esp_task_wdt_add(NULL);
+  for (;;) {
+    vTaskDelay(pdMS_TO_TICKS(SUPERVISOR_PERIOD_MS));
+    esp_task_wdt_reset();
+    supervisor_check();
+  }
+}
+
+/**
+ * @brief 実行中の段階の RTC メモリへの保存関数（frames の排他中に呼ぶ）
+ */
+static void supervisor_crumb(void)
+{
+  supervisor_fill(&rtc_log.crumb, depth - 1, SUPERVISOR_LEVEL_WATCHDOG, 0);
+}
+
+/*************************************************************************************************/
+void supervisor_init(void)
+{
+  if (SUPERVISOR_MAGIC != rtc_log.magic) {
+    /* 電源投入時（RTC メモリは不定値） */
+    memset(&rtc_log, 0, sizeof(rtc_log));
+    rtc_log.magic = SUPERVISOR_MAGIC;
+  }
+  esp_reset_reason_t reason = esp_reset_reason();
+  if ((ESP_RST_TASK_WDT == reason) || (ESP_RST_INT_WDT == reason) || (ESP_RST_WDT == reason) ||
+      (ESP_RST_PANIC == reason)) {
+    /* 直前の段階を記録（経過時間は不明） */
+    supervisor_log(&rtc_log.crumb);
+  }
+  ++rtc_log.boots;
+
+  /* setup の間は SUPERVISOR_SETUP_MS */
+  memset(frames, 0, sizeof(frames));
+  frames[0].stage = SUPERVISOR_STAGE_LOOP;
+  frames[0].start_ms = millis();
+  frames[0].budget_ms = SUPERVISOR_SETUP_MS;
+  strncpy(frames[0].detail, "setup", sizeof(frames[0].detail) - 1);
+  depth = 1;
+  supervisor_crumb();
+
+  esp_task_wdt_init(SUPERVISOR_WDT_S, true);
+  esp_task_wdt_add(NULL);
+  TaskHandle_t task = NULL;
+  xTaskCreatePinnedToCore(supervisor_monitor, "supervisor", SUPERVISOR_TASK_STACK, NULL, 3, &task, 0);
+  diag_register_task(task, "supervisor");
+}
+
+/*************************************************************************************************/
+uint8_t supervisor_enter(supervisor_stage_t stage, uint32_t budget_ms, const char *detail)
+{
+  portENTER_CRITICAL(&mux);
+  uint8_t token = depth;
+  if (depth < SUPERVISOR_DEPTH) {
+    supervisor_frame_t *f = &frames[depth];
+    f->stage = (uint8_t)stage;
+    f->level = SUPERVISOR_LEVEL_NONE;
+    f->start_ms = millis();
+    f->budget_ms = (0 != budget_ms) ? budget_ms : default_budget_ms[stage];
+    f->nested_ms = 0;
+    memset(f->detail, 0, sizeof(f->detail));
+    if (NULL != detail) {
+      /* AT コマンドの終端（\r）は残さない */
+      for (uint8_t i = 0; (i < sizeof(f->detail) - 1) && (' ' <= detail[i]); i++) {
+        f->detail[i] = detail[i];
+      }
+    }
+    ++depth;
+    /* 新しい段階は自段階の上限で中断する（外側の上限超過は supervisor_leave で戻す） */
+    aborted = false;
+    supervisor_crumb();
+  }
+  portEXIT_CRITICAL(&mux);
+
+  return token;
+}
+
+/*************************************************************************************************/
+void supervisor_leave(uint8_t token)
+{
+  portENTER_CRITICAL(&mux);
+  if ((0 != token) && (token < depth)) {
+    const supervisor_frame_t *f = &frames[token];
+    uint32_t elapsed = millis() - f->start_ms;
+    uint32_t own = elapsed - f->nested_ms;
+    if (own > stats.max_ms[f->stage]) {
+      stats.max_ms[f->stage] = own;
+    }
+    /* 外側の段階の上限からは除く */
+    frames[token - 1].nested_ms += elapsed;
+    depth = token;
+    bool over = false;
+    for (uint8_t i = 0; i < depth; i++) {
+      over |= (SUPERVISOR_LEVEL_NONE != frames[i].level);
+    }
+    aborted = over;
+    supervisor_crumb();
+  }
+  portEXIT_CRITICAL(&mux);
+}
+
+/*************************************************************************************************/
+void supervisor_feed(void) { esp_task_wdt_reset(); }
+
+/*************************************************************************************************/
+bool supervisor_aborted(void) { return aborted; }
+
+/*************************************************************************************************/
+void supervisor_task(void)
+{
+  esp_task_wdt_reset();
+  if (modem_reset_pending) {
+    modem_reset_pending = false;
+    bg770_reset();
+  }
+
+  /* loop 1 周の計時をやり直す（抜け忘れた段階も閉じる） */
+  portENTER_CRITICAL(&mux);
+  supervisor_frame_t *f = &frames[0];
+  uint32_t own = millis() - f->start_ms - f->nested_ms;
+  if (own > stats.max_ms[SUPERVISOR_STAGE_LOOP]) {
+    stats.max_ms[SUPERVISOR_STAGE_LOOP] = own;
+  }
+  depth = 1;
+  f->level = SUPERVISOR_LEVEL_NONE;
+  f->start_ms = millis();
+  f->budget_ms = SUPERVISOR_LOOP_MS;
+  f->nested_ms = 0;
+  memset(f->detail, 0, sizeof(f->detail));
+  aborted = false;
+  supervisor_crumb();
+  portEXIT_CRITICAL(&mux);
+}
+
+/*************************************************************************************************/
+void supervisor_get_stats(supervisor_stats_t *p_stats) { *p_stats = stats; }
+
+/*************************************************************************************************/
+void supervisor_dump(Print &out)
+{
+  uint32_t first = (rtc_log.head > SUPERVISOR_LOG_RECORDS) ? (rtc_log.head - SUPERVISOR_LOG_RECORDS) : 0;
+
+  out.printf("supervisor boots=%lu violations=%lu\n", (unsigned long)rtc_log.boots, (unsigned long)rtc_log.head);
+  for (uint32_t n = first; n < rtc_log.head; n++) {
+    const supervisor_violation_t *v = &rtc_log.records[n % SUPERVISOR_LOG_RECORDS];
+    const char *stage = (v->stage < SUPERVISOR_STAGE_MAX) ? stage_names[v->stage] : "?";
+    const char *outer = (v->outer < SUPERVISOR_STAGE_MAX) ? stage_names[v->outer] : "?";
+    const char *level = (v->level < SUPERVISOR_LEVEL_MAX) ? level_names[v->level] : "?";
+    out.printf("boot=%lu %10lums %-7s %-7s in %-7s %lu/%lums %.*s\n", (unsigned long)v->boot,
+               (unsigned long)v->uptime_ms, level, stage, outer, (unsigned long)v->elapsed_ms,
+               (unsigned long)v->budget_ms, (int)sizeof(v->detail), v->detail);
+  }
+}
@@ -0,0 +1,176 @@
+/**
+ * @file trace.cpp
+ * @version 0.1
+ * @brief AT 通信のバイナリトレース
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <string.h>
+#include <esp_system.h>
+#include "trace.h"
+#include "setup_define.h"
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief 有効な記録を示す値 */
+#define TRACE_MAGIC  0x54524331UL
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief トレースリング（RTC メモリに配置） */
+typedef struct st_trace_ring
+{
+  /** @brief 有効確認値 */
+  uint32_t magic;
+  /** @brief 累計レコード数（次の書き込み位置） */
+  uint32_t head;
+  /** @brief 起動回数 */
+  uint32_t boots;
+  /** @brief 障害後の送信待ち */
+  uint32_t failure;
+  /** @brief レコード */
+  trace_record_t records[TRACE_RECORDS];
+} trace_ring_t;
+
+/**************************************************************************************************
+ * LOCAL VARIABLES
+ */
+/** @brief トレースリング（リセットで初期化されない） */
+static RTC_NOINIT_ATTR trace_ring_t ring;
+/** @brief 種別名 */
+static const char *const type_names[TRACE_TYPE_MAX] = {
+    "BOOT", "TX", "RX", "URC", "STEP", "RESULT", "RESET", "STATE",
+};
+/** @brief Base64 文字 */
+static const char base64_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/*************************************************************************************************/
+void trace_init(void)
+{
+  if ((TRACE_MAGIC != ring.magic) || (1 < ring.failure)) {
+    /* 電源投入時（RTC メモリは不定値） */
+    memset(&ring, 0, sizeof(ring));
+    ring.magic = TRACE_MAGIC;
+  }
+  ++ring.boots;
+  trace_record(TRACE_BOOT, (uint8_t)esp_reset_reason(), NULL);
+}
+
+/*************************************************************************************************/
+void trace_record(trace_type_t type, uint8_t code, const char *text)
+{
+  trace_record_t *r = &ring.records[ring.head % TRACE_RECORDS];
+
+  r->time = micros();
+  r->type = (uint8_t)type;
+  r->code = code;
+  r->length = 0;
+  if (NULL != text) {
+    size_t length = strlen(text);
+    r->length = (length > 0xFFFF) ? 0xFFFF : (uint16_t)length;
+    memcpy(r->text, text, (length < TRACE_TEXT_SIZE) ? length : TRACE_TEXT_SIZE);
+  }
+  ++ring.head;
+
+#ifdef DEBUG_PRINT
+  /* 確保を伴わない即時出力 */
+  Serial.print(type_names[type]);
+  Serial.print(':');
+  if (NULL != text) {
+    Serial.print(text);
+  } else {
+    Serial.print(code);
+  }
+  Serial.println();
+#endif
+}
+
+/*************************************************************************************************/
+void trace_mark_failure(void) { ring.failure = 1; }
+
+/*************************************************************************************************/
+bool trace_failure_pending(void) { return (0 != ring.failure); }
+
+/*************************************************************************************************/
+void trace_clear_failure(void) { ring.failure = 0; }
+
+/**
+ * @brief 最古のレコードの通番取得関数
+ * @return 通番
+ */
+static uint32_t trace_oldest(void)
+{
+  return (ring.head > TRACE_RECORDS) ? (ring.head - TRACE_RECORDS) : 0;
+}
+
+/*************************************************************************************************/
+void trace_dump(Print &out)
+{
+  out.printf("trace boots=%lu records=%lu\n", (unsigned long)ring.boots, (unsigned long)ring.head);
+
+  for (uint32_t n = trace_oldest(); n < ring.head; n++) {
+    const trace_record_t *r = &ring.records[n % TRACE_RECORDS];
+    size_t length = (r->length < TRACE_TEXT_SIZE) ? r->length : TRACE_TEXT_SIZE;
+    const char *name = (r->type < TRACE_TYPE_MAX) ? type_names[r->type] : "?";
+
+    out.printf("%10lu %-6s %3u ", (unsigned long)r->time, name, r->code);
+    out.write((const uint8_t *)r->text, length);
+    if (r->length > TRACE_TEXT_SIZE) {
+      out.print("...");
+    }
+    out.print('\n');
+  }
+}
+
+/*************************************************************************************************/
+uint16_t trace_build_blob(char *buf, uint16_t size, uint8_t block)
+{
+  uint32_t first = trace_oldest() + (uint32_t)block * TRACE_BLOB_RECORDS;
+  if (first >= ring.head) {
+    return 0;
+  }
+  uint32_t last = first + TRACE_BLOB_RECORDS;
+  if (last > ring.head) {
+    last = ring.head;
+  }
+
+  int len = snprintf(buf, size, "{\"trace\":%u,\"boot\":%lu,\"b\":\"", block, (unsigned long)ring.boots);
+
+  /* レコードを 3 バイト単位で Base64 化（リングの折り返しを考慮して 1 バイトずつ取り出す） */
+  uint32_t total = (last - first) * sizeof(trace_record_t);
+  uint8_t chunk[3];
+  uint8_t fill = 0;
+  for (uint32_t i = 0; i <= total; i++) {
+    if (i < total) {
+      uint32_t n = first + i / sizeof(trace_record_t);
+      chunk[fill++] = ((const uint8_t *)&ring.records[n % TRACE_RECORDS])[i % sizeof(trace_record_t)];
+      if (fill < 3) {
+        continue;
+      }
+    } else if (0 == fill) {
+      break;
+    }
+    if ((len + 4 + 3) > size) {
+      return 0;
+    }
+    uint32_t v = ((uint32_t)chunk[0] << 16) | ((fill > 1 ? chunk[1] : 0) << 8) | (fill > 2 ? chunk[2] : 0);
+    buf[len++] = base64_chars[(v >> 18) & 0x3F];
+    buf[len++] = base64_chars[(v >> 12) & 0x3F];
+    buf[len++] = (fill > 1) ? base64_chars[(v >> 6) & 0x3F] : '=';
+    buf[len++] = (fill > 2) ? base64_chars[v & 0x3F] : '=';
+    fill = 0;
+  }
+  buf[len++] = '"';
+  buf[len++] = '}';
+  buf[len] = '\0';
+
+  return (uint16_t)len;
+}
@@ -0,0 +1,815 @@
+/**
+ * @file tsdb.cpp
+ * @version 0.1
+ * @brief 時系列データの保存（フラッシュ上の追記専用ストア）
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <esp_partition.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tsdb.h"
+#include "outbox.h"
+#include "power.h"
+#include "config.h"
+#include "ota.h"
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief ヘッダの magic（"TSDB"） */
+#define TSDB_MAGIC            0x42445354UL
+/** @brief レコード長の上限（LEN + varint 5 byte x 3） */
+#define TSDB_RECORD_MAX       16
+/** @brief データ領域の終わり（フッタの先頭） */
+#define TSDB_DATA_END         (TSDB_BLOCK_SIZE - TSDB_FOOTER_SIZE)
+/** @brief 消去状態 */
+#define TSDB_ERASED32         0xFFFFFFFFUL
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief ブロックヘッダ */
+typedef struct st_tsdb_header
+{
+  /** @brief TSDB_MAGIC */
+  uint32_t magic;
+  /** @brief 書き込み順の通し番号（1〜） */
+  uint32_t seq;
+  /** @brief 先頭レコードの時刻 */
+  uint32_t t_first;
+  /** @brief TSDB_VERSION */
+  uint8_t version;
+  /** @brief 予約（0xFF） */
+  uint8_t reserved[3];
+} tsdb_header_t;
+
+/** @brief ブロックフッタ */
+typedef struct st_tsdb_footer
+{
+  /** @brief 最終レコードの時刻 */
+  uint32_t t_last;
+  /** @brief 使用長（ヘッダを含む） */
+  uint16_t length;
+  /** @brief 予約（0xFFFF） */
+  uint16_t reserved;
+} tsdb_footer_t;
+
+/** @brief ブロックの索引 */
+typedef struct st_tsdb_index
+{
+  /** @brief 通し番号（0：空き） */
+  uint32_t seq;
+  /** @brief 先頭レコードの時刻 */
+  uint32_t t_first;
+  /** @brief 最終レコードの時刻 */
+  uint32_t t_last;
+  /** @brief 使用長（ヘッダを含む） */
+  uint16_t length;
+} tsdb_index_t;
+
+/** @brief series 毎の直前値 */
+typedef struct st_tsdb_last
+{
+  /** @brief 系列 */
+  uint32_t series;
+  /** @brief 直前値 */
+  int32_t value;
+} tsdb_last_t;
+
+/** @brief 範囲要求の送信状態 */
+typedef struct st_tsdb_query
+{
+  /** @brief 送信中 */
+  bool active;
+  /** @brief 要求 ID */
+  uint32_t id;
+  /** @brief 開始時刻 */
+  uint32_t t0;
+  /** @brief 終了時刻 */
+  uint32_t t1;
+  /** @brief 開始時の最も古いブロック */
+  uint16_t first;
+  /** @brief 確認したブロック数（first から） */
+  uint16_t visited;
+  /** @brief 送信中のブロックの通し番号（0：未選択） */
+  uint32_t seq;
+  /** @brief 送信中のブロックの使用長 */
+  uint16_t length;
+  /** @brief 送信済みの長さ */
+  uint16_t offset;
+  /** @brief 送信したブロック数 */
+  uint16_t blocks;
+  /** @brief 開始した順の番号（HTTP 一括送信中の打ち切りの判定） */
+  uint32_t number;
+  /** @brief HTTP 一括送信で送る */
+  bool bulk;
+} tsdb_query_t;
+
+/** @brief HTTP 一括送信の状態 */
+typedef enum e_tsdb_bulk_state
+{
+  /** @brief 次のブロックを選ぶ */
+  TSDB_BULK_IDLE = 0,
+  /** @brief ファイルに書き込み中 */
+  TSDB_BULK_STAGE,
+  /** @brief POST の結果待ち */
+  TSDB_BULK_POST,
+} tsdb_bulk_state_t;
+
+/** @brief HTTP 一括送信（1 回の POST） */
+typedef struct st_tsdb_bulk
+{
+  /** @brief 状態 */
+  tsdb_bulk_state_t state;
+  /** @brief 範囲要求の番号 */
+  uint32_t number;
+  /** @brief ブロック数 */
+  uint8_t count;
+  /** @brief ブロックの位置 */
+  uint16_t index[TSDB_BULK_BLOCKS];
+  /** @brief ブロックの通し番号（書き込み中の消去・再利用の確認） */
+  uint32_t seq[TSDB_BULK_BLOCKS];
+  /** @brief ブロックの使用長 */
+  uint16_t length[TSDB_BULK_BLOCKS];
+  /** @brief POST が成功した時の query.visited */
+  uint16_t visited;
+  /** @brief 本文長 */
+  uint32_t body;
+  /** @brief リクエストヘッダを書いた */
+  bool header;
+  /** @brief 書き込み中のブロック */
+  uint8_t part;
+  /** @brief 書き込み中のブロックの書き込み済み長（length(2) を含む） */
+  uint16_t offset;
+  /** @brief POST した時刻 */
+  unsigned long post_ms;
+  /** @brief POST の結果を受けた */
+  bool done;
+  /** @brief HTTP 応答コード（0：エラー） */
+  uint16_t status;
+  /** @brief この範囲要求で POST した数 */
+  uint16_t batches;
+} tsdb_bulk_t;
+
+/**************************************************************************************************
+ * LOCAL VARIABLES
+ */
+/** @brief パーティション */
+static const esp_partition_t *partition = NULL;
+/** @brief ブロックの索引 */
+static tsdb_index_t *blocks = NULL;
+/** @brief ブロック数 */
+static uint16_t block_count = 0;
+/** @brief 書き込み中（または最後に書いた）ブロック */
+static uint16_t active = 0;
+/** @brief 書き込み中のブロックがある */
+static bool active_open = false;
+/** @brief 次の通し番号 */
+static uint32_t next_seq = 1;
+/** @brief 直前のレコードの時刻 */
+static uint32_t last_time = 0;
+/** @brief series 毎の直前値（書き込み中のブロック内） */
+static tsdb_last_t last_values[TSDB_SERIES_MAX];
+/** @brief last_values の使用数 */
+static uint8_t series_count = 0;
+/** @brief 範囲要求 */
+static tsdb_query_t query;
+/** @brief 範囲要求を開始した数 */
+static uint32_t query_count = 0;
+/** @brief HTTP 一括送信 */
+static tsdb_bulk_t bulk;
+/** @brief 統計 */
+static tsdb_stats_t stats;
+
+/**
+ * @brief varint 書き込み関数
+ * @param[out] buf :出力先
+ * @param[in] value :値
+ * @return 書き込んだ長さ
+ */
+static uint8_t tsdb_put_varint(uint8_t *buf, uint32_t value)
+{
+  uint8_t len = 0;
+  while (value >= 0x80) {
+    buf[len++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  buf[len++] = (uint8_t)value;
+  return len;
+}
+
+/**
+ * @brief varint 読み出し関数
+ * @param[in] buf :入力
+ * @param[in,out] pos :読み出し位置
+ * @param[in] end :入力の終わり
+ * @param[out] value :値
+ * @return true：成功
+ */
+static bool tsdb_get_varint(const uint8_t *buf, uint16_t *pos, uint16_t end, uint32_t *value)
+{
+  *value = 0;
+  for (uint8_t shift = 0; (*pos < end) && (shift < 35); shift += 7) {
+    uint8_t b = buf[(*pos)++];
+    *value |= (uint32_t)(b & 0x7F) << shift;
+    if (0 == (b & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief ブロックのフラッシュ上の位置取得関数
+ * @param[in] block :ブロック
+ * @return パーティション先頭からの位置
+ */
+static size_t tsdb_address(uint16_t block) { return (size_t)block * TSDB_BLOCK_SIZE; }
+
+/**
+ * @brief series の直前値の取得関数（無ければ 0 で登録）
+ * @param[in] series :系列
+ * @return 直前値（NULL：ブロック内の series 数が上限）
+ */
+static tsdb_last_t *tsdb_last_value(uint32_t series)
+{
+  for (uint8_t i = 0; i < series_count; i++) {
+    if (last_values[i].series == series) {
+      return &last_values[i];
+    }
+  }
+  if (series_count >= TSDB_SERIES_MAX) {
+    return NULL;
+  }
+  last_values[series_count].series = series;
+  last_values[series_count].value = 0;
+  return &last_values[series_count++];
+}
+
+/**
+ * @brief ブロックのレコード走査関数（使用長・最終時刻を求め、必要なら直前値を復元）
+ * @param[in] data :ブロック全体
+ * @param[in] t_first :先頭レコードの時刻
+ * @param[out] t_last :最終レコードの時刻
+ * @param[in] restore :true：last_values を復元する
+ * @return 使用長（ヘッダを含む）
+ */
+static uint16_t tsdb_scan(const uint8_t *data, uint32_t t_first, uint32_t *t_last, bool restore)
+{
+  uint16_t pos = TSDB_HEADER_SIZE;
+  uint32_t time = t_first;
+
+  if (restore) {
+    series_count = 0;
+  }
+  while ((pos < TSDB_DATA_END) && (0xFF != data[pos]) && (0 != data[pos])) {
+    uint16_t end = pos + 1 + data[pos];
+    uint16_t p = pos + 1;
+    uint32_t series, dt, dv;
+    if ((end > TSDB_DATA_END) || !tsdb_get_varint(data, &p, end, &series) || !tsdb_get_varint(data, &p, end, &dt) ||
+        !tsdb_get_varint(data, &p, end, &dv)) {
+      /* 書き込み途中の電源断：ここまでを有効とする */
+      break;
+    }
+    time += dt;
+    if (restore) {
+      tsdb_last_t *last = tsdb_last_value(series);
+      if (NULL != last) {
+        last->value += (int32_t)((dv >> 1) ^ (~(dv & 1) + 1));
+      }
+    }
+    pos = end;
+  }
+  *t_last = time;
+  return pos;
+}
+
+/**
+ * @brief フッタ書き込み関数
+ * @param[in] block :ブロック
+ */
+static void tsdb_write_footer(uint16_t block)
+{
+  tsdb_footer_t footer = {blocks[block].t_last, blocks[block].length, 0xFFFF};
+  esp_partition_write(partition, tsdb_address(block) + TSDB_DATA_END, &footer, sizeof(footer));
+}
+
+/**
+ * @brief 書き込み中のブロックを閉じる関数
+ */
+static void tsdb_seal(void)
+{
+  if (active_open) {
+    tsdb_write_footer(active);
+    active_open = false;
+  }
+}
+
+/**
+ * @brief ブロックの消去関数
+ * @param[in] block :ブロック
+ */
+static void tsdb_erase(uint16_t block)
+{
+  esp_partition_erase_range(partition, tsdb_address(block), TSDB_BLOCK_SIZE);
+  if (0 != blocks[block].seq) {
+    ++stats.erased;
+  }
+  memset(&blocks[block], 0, sizeof(blocks[block]));
+}
+
+/**
+ * @brief 次のブロックを開く関数（最も古いブロックを消去して使う）
+ * @param[in] time :先頭レコードの時刻
+ */
+static void tsdb_open(uint32_t time)
+{
+  tsdb_seal();
+  active = (uint16_t)((active + 1) % block_count);
+  tsdb_erase(active);
+
+  tsdb_header_t header = {TSDB_MAGIC, next_seq, time, TSDB_VERSION, {0xFF, 0xFF, 0xFF}};
+  esp_partition_write(partition, tsdb_address(active), &header, sizeof(header));
+  blocks[active].seq = next_seq++;
+  blocks[active].t_first = time;
+  blocks[active].t_last = time;
+  blocks[active].length = TSDB_HEADER_SIZE;
+  active_open = true;
+  last_time = time;
+  series_count = 0;
+}
+
+/**
+ * @brief HTTP 一括送信の結果（+QHTTPPOSTFILE: <err>[,<httprspcode>[,<content_length>]]）の処理関数
+ * @param[in] line :分類済みの行
+ */
+static void urc_qhttppostfile(const at_line_t *line)
+{
+  char *p;
+  bool ok = (0 == strtoul(line->args, &p, 10)) && (',' == *p);
+  bulk.status = ok ? (uint16_t)strtoul(p + 1, NULL, 10) : 0;
+  bulk.done = true;
+}
+
+/*************************************************************************************************/
+bool tsdb_init(void)
+{
+  at_set_urc_handler(AT_TOKEN_QHTTPPOSTFILE, urc_qhttppostfile);
+  partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, TSDB_PARTITION_LABEL);
+  if (NULL == partition) {
+    return false;
+  }
+  block_count = (uint16_t)(partition->size / TSDB_BLOCK_SIZE);
+  blocks = (tsdb_index_t *)calloc(block_count, sizeof(tsdb_index_t));
+  uint8_t *data = (uint8_t *)malloc(TSDB_BLOCK_SIZE);
+  if ((NULL == blocks) || (NULL == data) || (0 == block_count)) {
+    free(blocks);
+    free(data);
+    blocks = NULL;
+    partition = NULL;
+    block_count = 0;
+    return false;
+  }
+
+  /* ヘッダ・フッタから索引を作り、最も新しいブロックを書き込み先とする */
+  uint32_t newest = 0;
+  active = block_count - 1;
+  for (uint16_t i = 0; i < block_count; i++) {
+    tsdb_header_t header;
+    tsdb_footer_t footer;
+    esp_partition_read(partition, tsdb_address(i), &header, sizeof(header));
+    if ((TSDB_MAGIC != header.magic) || (TSDB_VERSION != header.version) || (0 == header.seq)) {
+      continue;
+    }
+    esp_partition_read(partition, tsdb_address(i) + TSDB_DATA_END, &footer, sizeof(footer));
+    blocks[i].seq = header.seq;
+    blocks[i].t_first = header.t_first;
+    blocks[i].t_last = footer.t_last;
+    blocks[i].length = footer.length;
+    if (header.seq > newest) {
+      newest = header.seq;
+      active = i;
+    }
+  }
+  next_seq = newest + 1;
+
+  /* フッタの無いブロック（電源断）：最新は続きから書き、それ以外は閉じる */
+  for (uint16_t i = 0; i < block_count; i++) {
+    if ((0 == blocks[i].seq) || (TSDB_ERASED32 != blocks[i].t_last)) {
+      continue;
+    }
+    esp_partition_read(partition, tsdb_address(i), data, TSDB_BLOCK_SIZE);
+    blocks[i].length = tsdb_scan(data, blocks[i].t_first, &blocks[i].t_last, (i == active));
+    if (i == active) {
+      active_open = true;
+      last_time = blocks[i].t_last;
+    } else {
+      tsdb_write_footer(i);
+    }
+  }
+  free(data);
+
+  stats.blocks = block_count;
+  return true;
+}
+
+/*************************************************************************************************/
+bool tsdb_append(uint32_t series, uint32_t time, int32_t value)
+{
+  if ((NULL == partition) || (0 == time)) {
+    ++stats.dropped;
+    return false;
+  }
+
+  /* 時刻が戻った（NTP 補正）場合は新しいブロックから */
+  if (!active_open || (time < last_time)) {
+    tsdb_open(time);
+  }
+  tsdb_last_t *last = tsdb_last_value(series);
+  if (NULL == last) {
+    tsdb_open(time);
+    last = tsdb_last_value(series);
+  }
+
+  uint8_t record[TSDB_RECORD_MAX];
+  int32_t dv = value - last->value;
+  uint8_t len = 1;
+  len += tsdb_put_varint(&record[len], series);
+  len += tsdb_put_varint(&record[len], time - last_time);
+  len += tsdb_put_varint(&record[len], ((uint32_t)dv << 1) ^ (uint32_t)(dv >> 31));
+  record[0] = (uint8_t)(len - 1);
+
+  if ((blocks[active].length + len) > TSDB_DATA_END) {
+    tsdb_open(time);
+    /* 新しいブロックでは直前値 0 からの差分 */
+    return tsdb_append(series, time, value);
+  }
+
+  esp_partition_write(partition, tsdb_address(active) + blocks[active].length, record, len);
+  blocks[active].length += len;
+  blocks[active].t_last = time;
+  last->value = value;
+  last_time = time;
+  ++stats.appended;
+
+  return true;
+}
+
+/*************************************************************************************************/
+void tsdb_query_start(uint32_t id, uint32_t t0, uint32_t t1)
+{
+  memset(&query, 0, sizeof(query));
+  query.active = (NULL != partition);
+  query.id = id;
+  query.t0 = t0;
+  query.t1 = t1;
+  /* 書き込み先の次のブロックが最も古い */
+  query.first = (uint16_t)((active + 1) % (block_count ? block_count : 1));
+  query.number = ++query_count;
+
+  /* 範囲に掛かるデータ量が多ければ HTTP 一括送信（モデムの操作は tsdb_task で行う） */
+  const config_t *config = config_get();
+  uint32_t bytes = 0;
+  for (uint16_t i = 0; i < block_count; i++) {
+    if ((0 != blocks[i].seq) && (blocks[i].t_first <= t1) && (blocks[i].t_last >= t0)) {
+      bytes += blocks[i].length;
+    }
+  }
+  query.bulk = ('\0' != config->bulk_url[0]) && (bytes >= config->bulk_min_bytes);
+}
+
+/**
+ * @brief Base64 変換関数
+ * @param[out] dst :出力先（(length + 2) / 3 * 4 + 1 byte 以上）
+ * @param[in] src :入力
+ * @param[in] length :入力長
+ * @return 出力長
+ */
+static uint16_t tsdb_base64(char *dst, const uint8_t *src, uint16_t length)
+{
+  static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  uint16_t len = 0;
+  for (uint16_t i = 0; i < length; i += 3) {
+    uint32_t v = (uint32_t)src[i] << 16;
+    if ((i + 1) < length) { v |= (uint32_t)src[i + 1] << 8; }
+    if ((i + 2) < length) { v |= src[i + 2]; }
+    dst[len++] = table[(v >> 18) & 0x3F];
+    dst[len++] = table[(v >> 12) & 0x3F];
+    dst[len++] = ((i + 1) < length) ? table[(v >> 6) & 0x3F] : '=';
+    dst[len++] = ((i + 2) < length) ? table[v & 0x3F] : '=';
+  }
+  dst[len] = '\0';
+  return len;
+}
+
+/**
+ * @brief 範囲要求の次の送信ブロック選択関数
+ * @return true：選択した false：該当ブロックが残っていない
+ */
+static bool tsdb_query_next_block(void)
+{
+  while (query.visited < block_count) {
+    const tsdb_index_t *b = &blocks[(query.first + query.visited) % block_count];
+    if (0 != query.seq) {
+      if (b->seq == query.seq) {
+        return true;
+      }
+      /* 送信中に消去・再利用されたブロックは打ち切る */
+      query.seq = 0;
+    } else if ((0 != b->seq) && (b->t_first <= query.t1) && (b->t_last >= query.t0)) {
+      query.seq = b->seq;
+      query.length = b->length;
+      query.offset = 0;
+      return true;
+    }
+    ++query.visited;
+  }
+  return false;
+}
+
+/**
+ * @brief 範囲要求の 1 メッセージ送信関数
+ */
+static void tsdb_query_send(void)
+{
+  char payload[PUBLISH_SIZE];
+  const outbox_attr_t attr = {UPLINK_CLASS_IMPORTANT, OUTBOX_PRIO_BULK, OUTBOX_KEY_NONE, OUTBOX_EXPIRE_SEND,
+                              TSDB_QUERY_DEADLINE_MS};
+  uint16_t len;
+
+  if (!tsdb_query_next_block()) {
+    len = (uint16_t)snprintf(payload, sizeof(payload), "{\"ts\":{\"q\":%lu,\"end\":%u", (unsigned long)query.id,
+                             query.blocks);
+    if ((0 != bulk.batches) && (bulk.number == query.number)) {
+      len += (uint16_t)snprintf(&payload[len], sizeof(payload) - len, ",\"bulk\":%u", bulk.batches);
+    }
+    len += (uint16_t)snprintf(&payload[len], sizeof(payload) - len, "}}");
+    if (outbox_post((const uint8_t *)payload, len, &attr)) {
+      query.active = false;
+    }
+    return;
+  }
+
+  uint8_t chunk[TSDB_CHUNK_SIZE];
+  uint16_t size = query.length - query.offset;
+  if (size > TSDB_CHUNK_SIZE) {
+    size = TSDB_CHUNK_SIZE;
+  }
+  uint16_t block = (uint16_t)((query.first + query.visited) % block_count);
+  esp_partition_read(partition, tsdb_address(block) + query.offset, chunk, size);
+  len = (uint16_t)snprintf(payload, sizeof(payload), "{\"ts\":{\"q\":%lu,\"b\":%lu,\"o\":%u,\"n\":%u,\"d\":\"",
+                           (unsigned long)query.id, (unsigned long)query.seq, query.offset, query.length);
+  len += tsdb_base64(&payload[len], chunk, size);
+  len += (uint16_t)snprintf(&payload[len], sizeof(payload) - len, "\"}}");
+  if (!outbox_post((const uint8_t *)payload, len, &attr)) {
+    return;
+  }
+
+  query.offset += size;
+  if (query.offset >= query.length) {
+    ++query.blocks;
+    ++query.visited;
+    query.seq = 0;
+  }
+}
+
+/**
+ * @brief HTTP 一括送信の中止関数（ファイルを閉じ、残りは MQTT で送る）
+ * @param[in] fallback :true：範囲要求の残りを MQTT で送る
+ */
+static void tsdb_bulk_abort(bool fallback)
+{
+  if (TSDB_BULK_STAGE == bulk.state) {
+    bg770_file_close();
+  }
+  bulk.state = TSDB_BULK_IDLE;
+  if (fallback && (bulk.number == query.number)) {
+    query.bulk = false;
+    ++stats.bulk_fallbacks;
+  }
+}
+
+/**
+ * @brief HTTP 一括送信の次の POST のブロック選択関数
+ * @return true：選択した false：該当ブロックが残っていない
+ */
+static bool tsdb_bulk_select(void)
+{
+  if (bulk.number != query.number) {
+    bulk.number = query.number;
+    bulk.batches = 0;
+  }
+  bulk.count = 0;
+  bulk.body = 0;
+  bulk.visited = query.visited;
+  while ((bulk.visited < block_count) && (bulk.count < TSDB_BULK_BLOCKS)) {
+    uint16_t i = (uint16_t)((query.first + bulk.visited) % block_count);
+    const tsdb_index_t *b = &blocks[i];
+    if ((0 != b->seq) && (b->t_first <= query.t1) && (b->t_last >= query.t0)) {
+      bulk.index[bulk.count] = i;
+      bulk.seq[bulk.count] = b->seq;
+      bulk.length[bulk.count] = b->length;
+      bulk.body += 2 + b->length;
+      ++bulk.count;
+    }
+    ++bulk.visited;
+  }
+  bulk.header = false;
+  bulk.part = 0;
+  bulk.offset = 0;
+  return (0 != bulk.count);
+}
+
+/**
+ * @brief HTTP 一括送信のリクエストヘッダ作成関数
+ * @param[out] buf :出力先
+ * @param[in] size :出力先のサイズ
+ * @return 書き込んだ長さ（入りきらない・URL が不正な場合 0）
+ */
+static uint16_t tsdb_bulk_header(char *buf, uint16_t size)
+{
+  /* http://<host>[:<port>]/<path> */
+  const char *host = strstr(config_get()->bulk_url, "://");
+  if (NULL == host) {
+    return 0;
+  }
+  host += 3;
+  const char *path = strchr(host, '/');
+  int host_length = (NULL != path) ? (int)(path - host) : (int)strlen(host);
+  char device[16];
+  bg770_get_imsi(device);
+  int len = snprintf(buf, size,
+                     "POST %s HTTP/1.1\r\nHost: %.*s\r\nContent-Type: application/octet-stream\r\n"
+                     "Content-Length: %lu\r\nX-Tsdb-Query: %lu\r\nX-Tsdb-Device: %.15s\r\n"
+                     "Connection: close\r\n\r\n",
+                     (NULL != path) ? path : "/", host_length, host, (unsigned long)bulk.body,
+                     (unsigned long)query.id, device);
+  return ((len > 0) && (len < size)) ? (uint16_t)len : 0;
+}
+
+/**
+ * @brief HTTP 一括送信の 1 ステップ（選択・ファイル書き込み 1 回・POST・結果確認のどれか 1 つ）
+ */
+static void tsdb_bulk_step(void)
+{
+  switch (bulk.state) {
+  case TSDB_BULK_IDLE:
+    /* 残りが無ければ終了通知は MQTT で送る */
+    if (!tsdb_bulk_select()) {
+      bg770_file_delete(TSDB_BULK_FILE);
+      query.bulk = false;
+    } else if (API_STATUS_SUCCESS != bg770_file_open(TSDB_BULK_FILE)) {
+      tsdb_bulk_abort(true);
+    } else {
+      bulk.state = TSDB_BULK_STAGE;
+    }
+    break;
+
+  case TSDB_BULK_STAGE: {
+    uint8_t buf[TSDB_BULK_WRITE_SIZE];
+    uint16_t len = 0;
+    if (!bulk.header) {
+      len = tsdb_bulk_header((char *)buf, sizeof(buf));
+      if (0 == len) {
+        tsdb_bulk_abort(true);
+        return;
+      }
+      bulk.header = true;
+    }
+    /* length(2) | 生データ を詰める */
+    while ((len < sizeof(buf)) && (bulk.part < bulk.count)) {
+      uint16_t length = bulk.length[bulk.part];
+      if (blocks[bulk.index[bulk.part]].seq != bulk.seq[bulk.part]) {
+        /* 書き込み中に消去・再利用されたブロックは MQTT の方で飛ばす */
+        tsdb_bulk_abort(true);
+        return;
+      }
+      if (bulk.offset < 2) {
+        buf[len++] = (uint8_t)(length >> (8 * bulk.offset));
+        ++bulk.offset;
+        continue;
+      }
+      uint16_t n = (uint16_t)(length + 2 - bulk.offset);
+      if (n > (sizeof(buf) - len)) {
+        n = (uint16_t)(sizeof(buf) - len);
+      }
+      esp_partition_read(partition, tsdb_address(bulk.index[bulk.part]) + bulk.offset - 2, &buf[len], n);
+      len += n;
+      bulk.offset += n;
+      if (bulk.offset >= (length + 2)) {
+        ++bulk.part;
+        bulk.offset = 0;
+      }
+    }
+    if (API_STATUS_SUCCESS != bg770_file_write(buf, len)) {
+      tsdb_bulk_abort(true);
+      return;
+    }
+    if (bulk.part < bulk.count) {
+      return;
+    }
+    bg770_file_close();
+    bulk.done = false;
+    bulk.status = 0;
+    bulk.post_ms = millis();
+    bulk.state = TSDB_BULK_POST;
+    if (API_STATUS_SUCCESS != bg770_http_post_file(config_get()->bulk_url, TSDB_BULK_FILE)) {
+      tsdb_bulk_abort(true);
+    }
+    break;
+  }
+
+  case TSDB_BULK_POST:
+    if (!bulk.done) {
+      if ((millis() - bulk.post_ms) >= TSDB_BULK_TIMEOUT_MS) {
+        tsdb_bulk_abort(true);
+      }
+    } else if ((bulk.status < 200) || (bulk.status >= 300)) {
+      tsdb_bulk_abort(true);
+    } else {
+      query.visited = bulk.visited;
+      query.blocks += bulk.count;
+      ++bulk.batches;
+      ++stats.bulk_batches;
+      stats.bulk_bytes += bulk.body;
+      bulk.state = TSDB_BULK_IDLE;
+    }
+    break;
+  }
+}
+
+/*************************************************************************************************/
+void tsdb_task(uint32_t now)
+{
+  if (NULL == partition) {
+    return;
+  }
+
+  /* 保存期間を過ぎた最も古いブロックを 1 つ消去 */
+  if ((0 != now) && (now > TSDB_RETENTION_S)) {
+    for (uint16_t n = 1; n < block_count; n++) {
+      uint16_t i = (uint16_t)((active + n) % block_count);
+      if (0 == blocks[i].seq) {
+        continue;
+      }
+      if (blocks[i].t_last < (now - TSDB_RETENTION_S)) {
+        tsdb_erase(i);
+      }
+      break;
+    }
+  }
+
+  /* 打ち切られた範囲要求の HTTP 一括送信は止める（POST 中なら結果は捨てる） */
+  if ((TSDB_BULK_IDLE != bulk.state) && (!query.active || (bulk.number != query.number))) {
+    tsdb_bulk_abort(false);
+  }
+
+  /* HTTP 一括送信は接続中で、HTTP をファームウェア更新が使っていない時に 1 ステップ進める */
+  if (query.active && query.bulk) {
+    ota_stats_t ota;
+    ota_get_stats(&ota);
+    if ((BG770_STATE_SUBSCRIBE == bg_state) && (OTA_STATE_DOWNLOAD != ota.state)) {
+      power_state_t power = power_set(POWER_STATE_BURST);
+      tsdb_bulk_step();
+      power_set(power);
+    }
+    return;
+  }
+
+  /* 範囲要求は送信待ちに余裕がある時だけ積む */
+  outbox_stats_t ob;
+  outbox_get_stats(&ob);
+  if (query.active && ((ob.queued + TSDB_QUERY_BACKLOG) <= OUTBOX_SLOTS)) {
+    power_state_t power = power_set(POWER_STATE_BURST);
+    tsdb_query_send();
+    power_set(power);
+  }
+}
+
+/*************************************************************************************************/
+void tsdb_get_stats(tsdb_stats_t *p_stats)
+{
+  stats.used = 0;
+  stats.oldest = 0;
+  stats.newest = 0;
+  for (uint16_t i = 0; i < block_count; i++) {
+    if (0 == blocks[i].seq) {
+      continue;
+    }
+    ++stats.used;
+    if ((0 == stats.oldest) || (blocks[i].t_first < stats.oldest)) {
+      stats.oldest = blocks[i].t_first;
+    }
+    if (blocks[i].t_last > stats.newest) {
+      stats.newest = blocks[i].t_last;
+    }
+  }
+  *p_stats = stats;
+}
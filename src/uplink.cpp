@@ -0,0 +1,172 @@
+/**
+ * @file uplink.cpp
+ * @version 0.1
+ * @brief 送信経路の選択（MQTT / UDP / 確認応答付き UDP）
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <string.h>
+#include "bg770.h"
+#include "uplink.h"
+#include "mqtt_lane.h"
+#include "mqtt_session.h"
+#include "power.h"
+#include "supervisor.h"
+#include "setup_define.h"
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief 確認応答付き UDP のヘッダ最大長（{"seq":4294967295,"d":） */
+#define UPLINK_ACK_HEADER_MAX  24
+
+/**************************************************************************************************
+ * LOCAL VARIABLES
+ */
+/** @brief メッセージ種別毎の送信経路 */
+static uplink_transport_t transports[UPLINK_CLASS_MAX] = {
+    UPLINK_TRANSPORT_MQTT,     /* UPLINK_CLASS_CONTROL */
+    UPLINK_TRANSPORT_UDP,      /* UPLINK_CLASS_TELEMETRY */
+    UPLINK_TRANSPORT_UDP_ACK,  /* UPLINK_CLASS_IMPORTANT */
+    UPLINK_TRANSPORT_MQTT,     /* UPLINK_CLASS_SHADOW */
+};
+/** @brief メッセージ種別毎の MQTT レーン */
+static const mqtt_lane_t lanes[UPLINK_CLASS_MAX] = {
+    MQTT_LANE_CONTROL,  /* UPLINK_CLASS_CONTROL */
+    MQTT_LANE_BULK,     /* UPLINK_CLASS_TELEMETRY */
+    MQTT_LANE_CONTROL,  /* UPLINK_CLASS_IMPORTANT */
+    MQTT_LANE_CONTROL,  /* UPLINK_CLASS_SHADOW */
+};
+/** @brief 確認応答付き UDP のシーケンス番号 */
+static uint32_t ack_seq = 0;
+
+/*************************************************************************************************/
+void uplink_set_transport(uplink_class_t cls, uplink_transport_t transport)
+{
+  if (cls < UPLINK_CLASS_MAX) {
+    transports[cls] = transport;
+  }
+}
+
+/*************************************************************************************************/
+uplink_transport_t uplink_get_transport(uplink_class_t cls)
+{
+  return (cls < UPLINK_CLASS_MAX) ? transports[cls] : UPLINK_TRANSPORT_MQTT;
+}
+
+/**
+ * @brief 確認応答の待ち受け関数
+ * @param[in] seq :待つシーケンス番号
+ * @return true：確認応答を受信
+ */
+static bool uplink_wait_ack(uint32_t seq)
+{
+  char expect[24];
+  char rx[128];
+  unsigned long start = millis();
+
+  snprintf(expect, sizeof(expect), "\"ack\":%lu", (unsigned long)seq);
+  /* 待ちは送信の上限に数えない（確認応答が無いだけで送信を中断させない） */
+  uint8_t stage = supervisor_enter(SUPERVISOR_STAGE_ACK, UPLINK_ACK_TIMEOUT_MS + SUPERVISOR_ACK_MARGIN_MS, "udp ack");
+  power_state_t power = power_set(POWER_STATE_WAIT);
+  bool acked = false;
+  while (!acked && ((millis() - start) < UPLINK_ACK_TIMEOUT_MS) && !supervisor_aborted()) {
+    bg770_poll();
+    acked = (0 != bg770_udp_receive(rx, sizeof(rx))) && (NULL != strstr(rx, expect));
+    if (!acked) {
+      supervisor_feed();
+      delay(1);
+    }
+  }
+  power_set(power);
+  supervisor_leave(stage);
+
+  return acked;
+}
+
+/**
+ * @brief 確認応答付き UDP 送信関数
+ * @return API_STATUS_SUCCESS / API_STATUS_TIMEOUT / API_STATUS_FAIL
+ */
+static api_status_t uplink_send_udp_ack(void)
+{
+  char header[UPLINK_ACK_HEADER_MAX + 1];
+  uint32_t seq = ++ack_seq;
+  uint16_t header_length = (uint16_t)snprintf(header, sizeof(header), "{\"seq\":%lu,\"d\":", (unsigned long)seq);
+  uint16_t length = Publish_length;
+
+  /* ペイロードを {"seq":<n>,"d":<payload>} で包む */
+  memmove(&Publish_payload[header_length], Publish_payload, length);
+  memcpy(Publish_payload, header, header_length);
+  Publish_payload[header_length + length] = '}';
+  Publish_length = header_length + length + 1;
+
+  api_status_t result = API_STATUS_TIMEOUT;
+  for (uint8_t retry = 0; retry <= UPLINK_ACK_RETRY; retry++) {
+    if (API_STATUS_SUCCESS != execute(&udp_send_command)) {
+      result = API_STATUS_FAIL;
+      break;
+    }
+    if (uplink_wait_ack(seq)) {
+      result = API_STATUS_SUCCESS;
+      break;
+    }
+  }
+
+  /* 呼び出し元のペイロードに戻す */
+  memmove(Publish_payload, &Publish_payload[header_length], length);
+  Publish_length = length;
+
+  return result;
+}
+
+/*************************************************************************************************/
+api_status_t uplink_publish(uplink_class_t cls)
+{
+  uplink_transport_t transport = uplink_get_transport(cls);
+  mqtt_lane_t lane = (cls < UPLINK_CLASS_MAX) ? lanes[cls] : MQTT_LANE_CONTROL;
+
+  if (UPLINK_CLASS_SHADOW == cls) {
+    /* シャドウ更新は経路設定に依らず MQTT でシャドウトピックに送る */
+    char topic[MQTT_SHADOW_TOPIC_SIZE];
+    mqtt_session_shadow_topic(SHADOW_UPDATE_SUFFIX, topic);
+    bg770_set_publish_topic(topic);
+    api_status_t result = mqtt_lane_publish(lane);
+    bg770_set_publish_topic(NULL);
+    return result;
+  }
+
+  /* ソケットが閉じている・AT+QISEND の上限（包んだ後）を超える場合は MQTT(QoS1) で送る */
+  if ((UPLINK_TRANSPORT_MQTT != transport) && !bg770_udp_is_open()) {
+    transport = UPLINK_TRANSPORT_MQTT;
+  }
+  if ((UPLINK_TRANSPORT_UDP == transport) && (Publish_length > UDP_SEND_SIZE)) {
+    transport = UPLINK_TRANSPORT_MQTT;
+  }
+  if ((UPLINK_TRANSPORT_UDP_ACK == transport) && ((Publish_length + UPLINK_ACK_HEADER_MAX + 1) > UDP_SEND_SIZE)) {
+    transport = UPLINK_TRANSPORT_MQTT;
+  }
+
+  switch (transport) {
+  case UPLINK_TRANSPORT_UDP:
+    return execute(&udp_send_command);
+  case UPLINK_TRANSPORT_UDP_ACK: {
+    api_status_t result = uplink_send_udp_ack();
+    if (API_STATUS_TIMEOUT == result) {
+      /* 確認応答が無い場合は MQTT(QoS1) で届ける */
+      result = mqtt_lane_publish(lane);
+    }
+    return result;
+  }
+  case UPLINK_TRANSPORT_MQTT:
+  default:
+    /* 応答文法が +QMTRECV の割り込みを許容するので、サブスクライブ中のまま送信する */
+    return mqtt_lane_publish(lane);
+  }
+}
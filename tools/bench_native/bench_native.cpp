@@ -0,0 +1,153 @@
+/**
+ * @file bench_native.cpp
+ * @version 0.1
+ * @brief 文字列・ペイロード処理のベンチマーク（ホスト）
+ *
+ * 変更していない bench.cpp の bench_run() を tools/modem_replay の Arduino 互換層で動かし、
+ * リポジトリの基準値ファイルと比較する。悪化した項目があれば終了コード 1 を返す。
+ * 基準値ファイルは 1 行 1 項目で「項目名 ns/op B/op alloc/op(x100)」（# 以降は注釈）。
+ * 項目名で対応させ、ファイルに無い項目は比較しない。
+ * 確保回数は malloc/realloc のリンク時ラップで数える（operator new も malloc を通す）。
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+
+/*************************************************************************************************/
+/* String（std::string）等の確保も bench.cpp の __wrap_malloc で数える */
+void *operator new(size_t size)
+{
+  void *p = malloc((0 != size) ? size : 1);
+  if (NULL == p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t size) noexcept { free(p); }
+void operator delete[](void *p, size_t size) noexcept { free(p); }
+
+/**
+ * @brief 使い方の表示関数
+ * @param[in] name :プログラム名
+ */
+static void usage(const char *name)
+{
+  fprintf(stderr,
+          "usage: %s <baseline.txt> [--save]\n"
+          "  --save  計測結果で基準値ファイルを書き換える（比較はしない）\n",
+          name);
+}
+
+/**
+ * @brief 基準値ファイルの読み込み関数
+ * @param[in] path :パス
+ * @param[out] baseline :基準値（項目順。ファイルに無い項目は 0）
+ * @return true：成功
+ */
+static bool load(const char *path, bench_result_t baseline[])
+{
+  FILE *fp = fopen(path, "r");
+  if (NULL == fp) {
+    return false;
+  }
+  memset(baseline, 0, sizeof(bench_result_t) * BENCH_CASE_MAX);
+  char line[128];
+  while (NULL != fgets(line, sizeof(line), fp)) {
+    char *comment = strchr(line, '#');
+    if (NULL != comment) {
+      *comment = '\0';
+    }
+    char name[32];
+    unsigned long ns, bytes, allocs;
+    if (4 != sscanf(line, "%31s %lu %lu %lu", name, &ns, &bytes, &allocs)) {
+      continue;
+    }
+    for (uint8_t i = 0; i < bench_case_count(); i++) {
+      if (0 == strcmp(name, bench_case_name(i))) {
+        baseline[i].ns_per_op = (uint32_t)ns;
+        baseline[i].bytes_per_op = (uint32_t)bytes;
+        baseline[i].allocs_per_op_x100 = (uint32_t)allocs;
+      }
+    }
+  }
+  fclose(fp);
+  return true;
+}
+
+/**
+ * @brief 基準値ファイルの書き込み関数
+ * @param[in] path :パス
+ * @param[in] results :計測結果（項目順）
+ * @return true：成功
+ */
+static bool save(const char *path, const bench_result_t results[])
+{
+  FILE *fp = fopen(path, "w");
+  if (NULL == fp) {
+    return false;
+  }
+  fprintf(fp, "# bench_native の基準値（項目名 ns/op B/op alloc/op(x100)）。\n"
+              "# 計測したホストでの値。更新は tools/bench_native/README.md を参照\n");
+  for (uint8_t i = 0; i < bench_case_count(); i++) {
+    fprintf(fp, "%-16s %10lu %8lu %8lu\n", bench_case_name(i), (unsigned long)results[i].ns_per_op,
+            (unsigned long)results[i].bytes_per_op, (unsigned long)results[i].allocs_per_op_x100);
+  }
+  fclose(fp);
+  return true;
+}
+
+/*************************************************************************************************/
+int main(int argc, char **argv)
+{
+  const char *path = NULL;
+  bool update = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (0 == strcmp(argv[i], "--save")) {
+      update = true;
+    } else if (('-' != argv[i][0]) && (NULL == path)) {
+      path = argv[i];
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (NULL == path) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  bench_result_t baseline[BENCH_CASE_MAX];
+  bench_result_t results[BENCH_CASE_MAX];
+  if (!update && !load(path, baseline)) {
+    fprintf(stderr, "%s: no baseline (run with --save)\n", path);
+    return 2;
+  }
+
+  /* 結果の表は Serial（標準出力）へ */
+  host_set_verbose(true);
+  uint8_t failures = bench_run(Serial, update ? NULL : baseline, results);
+
+  if (update) {
+    if (!save(path, results)) {
+      fprintf(stderr, "%s: cannot write\n", path);
+      return 2;
+    }
+    printf("bench: baseline saved to %s\n", path);
+    return 0;
+  }
+  return (0 == failures) ? 0 : 1;
+}
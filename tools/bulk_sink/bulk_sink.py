@@ -0,0 +1,220 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+@file bulk_sink.py
+@version 0.1
+@brief 範囲要求の HTTP 一括送信の受信サーバー（ローカル確認用）
+
+tsdb.cpp が AT+QHTTPPOSTFILE で送る POST を受け、本文のブロックを展開してサンプルを CSV に追記する。
+  ・本文       ：( length(2) | ブロックの生データ[length] ) x ブロック数（リトルエンディアン）
+  ・ブロック   ：tsdb.h のブロック形式（ヘッダ 16 byte + レコード。フッタは含まない）
+  ・ヘッダ     ：X-Tsdb-Query（要求 ID）・X-Tsdb-Device（IMSI）
+形式が違う本文は 400 を返す（端末は残りを MQTT で送る）。--fail-rate・--delay で失敗・遅延を起こせる。
+
+@author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+@date 2026-10-19
+@copyright Copyright (c) 2026 旭光電機株式会社
+"""
+import argparse
+import csv
+import http.server
+import json
+import random
+import struct
+import sys
+import threading
+import time
+
+###################################################################################################
+# CONSTANTS
+###################################################################################################
+# tsdb.h / tsdb.cpp
+TSDB_MAGIC = 0x42445354
+TSDB_HEADER_SIZE = 16
+TSDB_VERSION = 1
+TSDB_BLOCK_SIZE = 4096
+TSDB_FOOTER_SIZE = 8
+
+
+###################################################################################################
+# DECODE
+###################################################################################################
+class FormatError(Exception):
+    """本文・ブロックの形式エラー"""
+
+
+def get_varint(data, pos, end):
+    """varint を読み、(値, 次の位置) を返す"""
+    value = 0
+    shift = 0
+    while True:
+        if pos >= end or shift > 28:
+            raise FormatError("varint")
+        b = data[pos]
+        pos += 1
+        value |= (b & 0x7F) << shift
+        if not b & 0x80:
+            return value, pos
+        shift += 7
+
+
+def decode_block(block):
+    """ブロックを展開し、(seq, [(series, time, value), ...]) を返す"""
+    if len(block) < TSDB_HEADER_SIZE or len(block) > TSDB_BLOCK_SIZE - TSDB_FOOTER_SIZE:
+        raise FormatError("block length %d" % len(block))
+    magic, seq, t_first, version = struct.unpack_from("<IIIB", block, 0)
+    if magic != TSDB_MAGIC or version != TSDB_VERSION:
+        raise FormatError("block header")
+
+    samples = []
+    last = {}
+    time_s = t_first
+    pos = TSDB_HEADER_SIZE
+    while pos < len(block):
+        length = block[pos]
+        if length == 0xFF:
+            break
+        end = pos + 1 + length
+        if end > len(block):
+            raise FormatError("record length")
+        series, p = get_varint(block, pos + 1, end)
+        dt, p = get_varint(block, p, end)
+        zz, p = get_varint(block, p, end)
+        dv = (zz >> 1) ^ -(zz & 1)
+        time_s += dt
+        value = last.get(series, 0) + dv
+        last[series] = value
+        samples.append((series, time_s, value))
+        pos = end
+    return seq, samples
+
+
+def decode_body(body):
+    """本文を展開し、[(seq, samples), ...] を返す"""
+    blocks = []
+    pos = 0
+    while pos < len(body):
+        if pos + 2 > len(body):
+            raise FormatError("frame length")
+        (length,) = struct.unpack_from("<H", body, pos)
+        pos += 2
+        if pos + length > len(body):
+            raise FormatError("frame truncated")
+        blocks.append(decode_block(body[pos:pos + length]))
+        pos += length
+    if not blocks:
+        raise FormatError("empty")
+    return blocks
+
+
+###################################################################################################
+# SERVER
+###################################################################################################
+class Sink:
+    """受信結果の保存・集計"""
+
+    def __init__(self, out, fail_rate, delay):
+        self.lock = threading.Lock()
+        self.fail_rate = fail_rate
+        self.delay = delay
+        self.posts = 0
+        self.blocks = 0
+        self.samples = 0
+        self.bytes = 0
+        self.rejected = 0
+        self.seen = set()
+        self.out = open(out, "a", newline="") if out else None
+        self.writer = csv.writer(self.out) if self.out else None
+
+    def store(self, query, device, blocks, size):
+        """展開したブロックを保存し、重複（再送）したブロック数を返す"""
+        duplicates = 0
+        with self.lock:
+            self.posts += 1
+            self.bytes += size
+            for seq, samples in blocks:
+                key = (device, seq)
+                if key in self.seen:
+                    duplicates += 1
+                    continue
+                self.seen.add(key)
+                self.blocks += 1
+                self.samples += len(samples)
+                if self.writer:
+                    for series, time_s, value in samples:
+                        self.writer.writerow([device, query, seq, series, time_s, value])
+            if self.out:
+                self.out.flush()
+        return duplicates
+
+
+def make_handler(sink):
+    """リクエストハンドラを作る"""
+
+    class Handler(http.server.BaseHTTPRequestHandler):
+        protocol_version = "HTTP/1.1"
+
+        def reply(self, code, obj):
+            data = json.dumps(obj).encode()
+            self.send_response(code)
+            self.send_header("Content-Type", "application/json")
+            self.send_header("Content-Length", str(len(data)))
+            self.send_header("Connection", "close")
+            self.end_headers()
+            self.wfile.write(data)
+
+        def do_POST(self):
+            length = int(self.headers.get("Content-Length", "0"))
+            body = self.rfile.read(length)
+            query = self.headers.get("X-Tsdb-Query", "")
+            device = self.headers.get("X-Tsdb-Device", self.client_address[0])
+            if sink.delay:
+                time.sleep(sink.delay)
+            if random.random() < sink.fail_rate:
+                self.reply(500, {"error": "injected"})
+                return
+            try:
+                blocks = decode_body(body)
+            except FormatError as e:
+                with sink.lock:
+                    sink.rejected += 1
+                self.reply(400, {"error": str(e)})
+                return
+            duplicates = sink.store(query, device, blocks, len(body))
+            samples = sum(len(s) for _, s in blocks)
+            print("q=%s device=%s blocks=%d samples=%d bytes=%d duplicates=%d"
+                  % (query, device, len(blocks), samples, len(body), duplicates), flush=True)
+            self.reply(200, {"blocks": len(blocks), "samples": samples, "duplicates": duplicates})
+
+        def log_message(self, fmt, *args):
+            pass
+
+    return Handler
+
+
+###################################################################################################
+# MAIN
+###################################################################################################
+def main():
+    parser = argparse.ArgumentParser(description="tsdb bulk backfill HTTP sink")
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--out", default="", help="サンプルを追記する CSV（device,q,block,series,time,value）")
+    parser.add_argument("--fail-rate", type=float, default=0.0, help="500 を返す確率")
+    parser.add_argument("--delay", type=float, default=0.0, help="応答までの遅延[s]")
+    args = parser.parse_args()
+
+    sink = Sink(args.out, args.fail_rate, args.delay)
+    server = http.server.ThreadingHTTPServer((args.host, args.port), make_handler(sink))
+    print("listening on %s:%d" % (args.host, args.port), flush=True)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    print(json.dumps({"posts": sink.posts, "blocks": sink.blocks, "samples": sink.samples,
+                      "bytes": sink.bytes, "rejected": sink.rejected}))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
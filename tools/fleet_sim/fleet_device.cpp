@@ -0,0 +1,314 @@
+/**
+ * @file fleet_device.cpp
+ * @version 0.1
+ * @brief フリートシミュレータの 1 台分（ホスト）
+ *
+ * 変更していない bg770.cpp・mqtt_lane.cpp・uplink.cpp・loadgen.cpp 等を tools/modem_replay の
+ * Arduino 互換層でビルドし、main.cpp の loop と同じ手順で動かす。BG770 の UART は標準入出力で、
+ * fleet_sim.py の模擬 BG770 につながる（1 台 = 1 プロセス。ファームウェアの状態は 1 台分の static 変数）。
+ *   ・標準入力  ：BG770 からの受信（応答・URC）
+ *   ・標準出力  ：BG770 への送信（AT コマンド・ペイロード）
+ *   ・標準エラー：fleet_sim.py への通知（1 行 1 件の JSON）
+ *       {"event":"reset"}                                      ：bg770_reset の前（BG770 のリセット端子）
+ *       {"event":"subscribed","ms":<n>,"resets":<n>,"resumed":<0|1>} ：サブスクライブ完了
+ * 時計は実時間（delay() で実際に待つ）。
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "bg770.h"
+#include "inbox.h"
+#include "loadgen.h"
+#include "mqtt_lane.h"
+#include "mqtt_session.h"
+#include "setup_define.h"
+#include "uplink.h"
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief 既定のハートビート周期[s] */
+#define DEVICE_HEARTBEAT_S       60
+/** @brief 既定のテレメトリ周期[s]（0：送らない） */
+#define DEVICE_TELEMETRY_S       10
+/** @brief 既定のテレメトリ長[byte] */
+#define DEVICE_TELEMETRY_SIZE    300
+/** @brief 標準入力の読み込みバッファ[byte] */
+#define DEVICE_RX_BUFFER         4096
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief BG770 の UART（標準入出力） */
+class StdioStream : public Stream
+{
+public:
+  StdioStream()
+  {
+    fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) | O_NONBLOCK);
+  }
+
+  int available(void)
+  {
+    fill();
+    return (int)(length - pos);
+  }
+  int read(void)
+  {
+    fill();
+    return (pos < length) ? buf[pos++] : -1;
+  }
+  int peek(void)
+  {
+    fill();
+    return (pos < length) ? buf[pos] : -1;
+  }
+  size_t write(uint8_t c) { return write(&c, 1); }
+  size_t write(const uint8_t *buffer, size_t size)
+  {
+    size_t n = 0;
+    while (n < size) {
+      ssize_t w = ::write(STDOUT_FILENO, &buffer[n], size - n);
+      if (w <= 0) {
+        /* fleet_sim.py が終了した */
+        exit(0);
+      }
+      n += (size_t)w;
+    }
+    return n;
+  }
+
+private:
+  /**
+   * @brief 届いている分の読み込み関数（待たない）
+   */
+  void fill(void)
+  {
+    if (pos < length) {
+      return;
+    }
+    pos = 0;
+    length = 0;
+    ssize_t n = ::read(STDIN_FILENO, buf, sizeof(buf));
+    if (n > 0) {
+      length = (size_t)n;
+    } else if ((0 == n) || ((EAGAIN != errno) && (EWOULDBLOCK != errno))) {
+      /* fleet_sim.py が終了した */
+      exit(0);
+    }
+  }
+
+  /** @brief 受信バッファ */
+  uint8_t buf[DEVICE_RX_BUFFER];
+  /** @brief 読み出し位置 */
+  size_t pos = 0;
+  /** @brief 受信バッファの長さ */
+  size_t length = 0;
+};
+
+/**************************************************************************************************
+ * LOCAL VARIABLES
+ */
+/** @brief BG770 の UART */
+static StdioStream uart;
+/** @brief ハートビート周期[ms] */
+static unsigned long heartbeat_ms = DEVICE_HEARTBEAT_S * 1000UL;
+/** @brief テレメトリ周期[ms]（0：送らない） */
+static unsigned long telemetry_ms = DEVICE_TELEMETRY_S * 1000UL;
+/** @brief テレメトリ長[byte] */
+static uint16_t telemetry_size = DEVICE_TELEMETRY_SIZE;
+/** @brief 送信の通番 */
+static uint32_t device_seq = 0;
+
+/**
+ * @brief 使い方の表示関数
+ * @param[in] name :プログラム名
+ */
+static void usage(const char *name)
+{
+  fprintf(stderr,
+          "usage: %s [--heartbeat S] [--telemetry S] [--telemetry-size N] [--info]\n"
+          "  --heartbeat S       ハートビートの周期[s]（既定 %d、制御レーン）\n"
+          "  --telemetry S       テレメトリの周期[s]（既定 %d、0：送らない。UPLINK_CLASS_TELEMETRY の経路）\n"
+          "  --telemetry-size N  テレメトリの長さ[byte]（既定 %d）\n"
+          "  --info              TOPIC を JSON で表示して終わる\n",
+          name, DEVICE_HEARTBEAT_S, DEVICE_TELEMETRY_S, DEVICE_TELEMETRY_SIZE);
+}
+
+/**
+ * @brief fleet_sim.py への通知関数
+ * @param[in] format :書式（1 行の JSON）
+ */
+static void device_event(const char *format, ...) __attribute__((format(printf, 1, 2)));
+static void device_event(const char *format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  vfprintf(stderr, format, args);
+  va_end(args);
+  fputc('\n', stderr);
+  fflush(stderr);
+}
+
+/**
+ * @brief BG770 のリセット関数（リセット端子の代わりに fleet_sim.py へ通知してから bg770_reset）
+ */
+static void device_reset(void)
+{
+  device_event("{\"event\":\"reset\"}");
+  bg770_reset();
+}
+
+/**
+ * @brief 送信データ作成関数（受信側で遅延を測る時刻を入れる）
+ * @param[in] kind :種類
+ * @param[in] size :長さ[byte]
+ */
+static void device_build(const char *kind, uint16_t size)
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  char *buf = (char *)Publish_payload;
+  int len = snprintf(buf, PUBLISH_SIZE, "{\"imsi\":\"%s\",\"kind\":\"%s\",\"n\":%lu,\"ts\":%ld.%03ld,\"p\":\"", imsi,
+                     kind, (unsigned long)++device_seq, (long)tv.tv_sec, (long)(tv.tv_usec / 1000));
+  if (size > PUBLISH_SIZE) {
+    size = PUBLISH_SIZE;
+  }
+  /* 閉じ括弧 2 文字を残して埋める */
+  while (len < (size - 2)) {
+    buf[len++] = 'x';
+  }
+  buf[len++] = '"';
+  buf[len++] = '}';
+  Publish_length = (uint16_t)len;
+}
+
+/**
+ * @brief サブスクライブ受信（+QMTRECV）の処理関数（main.cpp の urc_qmtrecv の負荷試験部分）
+ * @param[in] line :分類済みの行
+ */
+static void device_recv(const at_line_t *line)
+{
+  String payload = RxData_Analize(line->content);
+  StaticJsonDocument<384> doc;
+  if (deserializeJson(doc, payload.c_str())) {
+    return;
+  }
+  const char *command = doc["command"] | "";
+  if (0 == strcmp(command, "loadgen")) {
+    loadgen_config_t config;
+    config.count = doc["count"] | 100;
+    config.size = doc["size"] | 256;
+    config.rate = doc["rate"] | 0;
+    config.cls = (uplink_class_t)(doc["class"] | (int)LOADGEN_CLASS);
+    loadgen_start(&config);
+  } else if (0 == strcmp(command, "loadgen_stop")) {
+    loadgen_stop();
+  }
+}
+
+/**
+ * @brief 接続待ち関数（main.cpp の loop の先頭と同じ。サブスクライブ完了まで）
+ */
+static void device_attach(void)
+{
+  mqtt_session_stats_t before;
+  mqtt_session_get_stats(&before);
+  while (BG770_STATE_SUBSCRIBE != bg_state) {
+    if (API_STATUS_FAIL == init_command_sequence_task()) {
+      device_reset();
+    }
+    delay(1);
+  }
+  bg770_stats_t stats;
+  mqtt_session_stats_t after;
+  bg770_get_stats(&stats);
+  mqtt_session_get_stats(&after);
+  device_event("{\"event\":\"subscribed\",\"ms\":%lu,\"resets\":%lu,\"resumed\":%u}",
+               (unsigned long)stats.subscribe_ms, (unsigned long)stats.resets,
+               (after.resumed != before.resumed) ? 1 : 0);
+
+  if (API_STATUS_SUCCESS != execute(&ntp_command)) {
+    Serial.println("NTP failed");
+  }
+  mqtt_lane_open();
+  /* 接続毎に全項目をシャドウへ報告し直す（shadow_resync の代わりに同じ大きさの報告） */
+  device_build("shadow", 160);
+  if (API_STATUS_SUCCESS != uplink_publish(UPLINK_CLASS_SHADOW)) {
+    device_reset();
+  }
+}
+
+/*************************************************************************************************/
+int main(int argc, char **argv)
+{
+  for (int i = 1; i < argc; i++) {
+    if ((0 == strcmp(argv[i], "--heartbeat")) && ((i + 1) < argc)) {
+      heartbeat_ms = (unsigned long)(atof(argv[++i]) * 1000);
+    } else if ((0 == strcmp(argv[i], "--telemetry")) && ((i + 1) < argc)) {
+      telemetry_ms = (unsigned long)(atof(argv[++i]) * 1000);
+    } else if ((0 == strcmp(argv[i], "--telemetry-size")) && ((i + 1) < argc)) {
+      telemetry_size = (uint16_t)atoi(argv[++i]);
+    } else if (0 == strcmp(argv[i], "--info")) {
+      printf("{\"sub_topic\":\"%s\",\"pub_topic\":\"%s\"}\n", SUBSCRIBE_TOPIC, PUBLISH_TOPIC);
+      return 0;
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  /* setup と同じ（BG770・レーン・受信の重複除去）。送信の位相は台毎にずらす */
+  srandom((unsigned)getpid());
+  host_set_realtime(true);
+  bg770_init();
+  bg770_set_stream(&uart);
+  mqtt_lane_init();
+  mqtt_lane_set_recv_handler(MQTT_LANE_CONTROL, device_recv);
+  inbox_init();
+
+  unsigned long next_heartbeat = millis() + random(heartbeat_ms ? heartbeat_ms : 1);
+  unsigned long next_telemetry = millis() + random(telemetry_ms ? telemetry_ms : 1);
+  for (;;) {
+    if (BG770_STATE_INIT_COMMAND_SEQUENCE == bg_state) {
+      device_attach();
+      continue;
+    }
+    api_status_t sent = loadgen_task();
+    if ((API_STATUS_SUCCESS == sent) && (0 != heartbeat_ms) && ((long)(millis() - next_heartbeat) >= 0)) {
+      next_heartbeat += heartbeat_ms;
+      device_build("heartbeat", 200);
+      sent = uplink_publish(UPLINK_CLASS_CONTROL);
+    }
+    if ((API_STATUS_SUCCESS == sent) && (0 != telemetry_ms) && ((long)(millis() - next_telemetry) >= 0)) {
+      next_telemetry += telemetry_ms;
+      device_build("telemetry", telemetry_size);
+      sent = uplink_publish(UPLINK_CLASS_TELEMETRY);
+    }
+    if (API_STATUS_FAIL == sent) {
+      device_reset();
+      continue;
+    }
+    /* コマンド実行外で届いたサブスクライブ・PUBACK 等を処理 */
+    bg770_poll();
+    mqtt_lane_task();
+    inbox_task();
+    if (mqtt_session_task() && (API_STATUS_SUCCESS != bg770_resubscribe())) {
+      device_reset();
+    }
+    delay(1);
+  }
+}
@@ -0,0 +1,924 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+@file fleet_sim.py
+@version 0.1
+@brief フリートシミュレータ（多数の Pico3 をホスト上で動かし、ローカルの MQTT ブローカーへ接続する）
+
+1 台 = 1 プロセスの fleet_device（変更していない bg770.cpp・mqtt_lane.cpp・uplink.cpp 等を
+tools/modem_replay の Arduino 互換層でビルドしたもの）を起動し、その UART の相手となる BG770 を模擬する。
+接続手順・タイムアウト・再試行・セッションの判定・TOPIC はファームウェアのものがそのまま動く。
+  ・模擬 BG770         ：AT コマンドに V0/V1 で応答する。モデム内で完結するコマンドは応答時間の分布で待ち、
+                         AT+QMTOPEN/QMTCONN/QMTSUB/QMTPUB はブローカーへ実際に TCP 接続・CONNECT・
+                         SUBSCRIBE・PUBLISH する（client idx 毎に 1 接続）。受信は +QMTRECV、切断は +QMTSTAT
+  ・リセット           ：fleet_device の {"event":"reset"}（リセット端子の代わり）で全接続を切り、RDY から
+  ・基地局             ：--outage は全台の接続を切り、復旧まで AT+COPS/QIACT/QIOPEN を待たせる。
+                         --attach-rate で基地局が受け付けるアタッチ数を絞ると、復旧直後の再接続の集中を再現できる
+台数分のプロセスを --workers 個のイベントループ（プロセス）で受け持つ。
+
+@author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+@date 2026-10-19
+@copyright Copyright (c) 2026 旭光電機株式会社
+"""
+import argparse
+import asyncio
+import csv
+import json
+import math
+import multiprocessing
+import os
+import queue
+import random
+import re
+import struct
+import subprocess
+import sys
+import time
+
+###################################################################################################
+# CONSTANTS
+###################################################################################################
+# fleet_device（pio run -e fleet の出力）
+FIRMWARE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", ".pio", "build", "fleet", "program")
+
+# 模擬 BG770 の応答時間[s]（一様分布）
+MODEM_S = (0.02, 0.05)
+BOOT_S = (3.0, 6.0)
+SCAN_S = (10.0, 25.0)
+ATTACH_S = (2.0, 15.0)
+PDP_S = (0.5, 3.0)
+SOCKET_S = (0.2, 1.0)
+# ブローカーとの通信を諦めるまでの時間[s]（ファームウェアが先にタイムアウトしてリセットする）
+BROKER_TIMEOUT_S = 300
+# AT+COPS=? の応答（検索で見える基地局オペレータ）
+COPS_SCAN = '+COPS: (1,"NTT DOCOMO","NTT DOCOMO","44010",7),(1,"SoftBank","SoftBank","44020",7),,(0-4),(0-2)'
+# モデム内で完結しないため ERROR を返すコマンド（HTTP・ファイル）
+UNSUPPORTED = re.compile(r"AT\+(QHTTP|QF)")
+
+# MQTT 3.1.1 の制御パケット
+CONNECT = 0x10
+CONNACK = 0x20
+PUBLISH = 0x30
+PUBACK = 0x40
+SUBSCRIBE = 0x82
+SUBACK = 0x90
+UNSUBSCRIBE = 0xA2
+UNSUBACK = 0xB0
+PINGREQ = 0xC0
+PINGRESP = 0xD0
+DISCONNECT = 0xE0
+
+# ヒストグラムの階級の比（値の 5% 刻み）
+HIST_RATIO = 1.05
+# 集計する時間[ms]の種類
+METRICS = ("sequence", "connack", "suback", "puback", "fanout", "e2e")
+# 集計するカウンタの種類
+COUNTERS = ("resets", "attempts", "connects", "subscribed", "resumed", "resume_lost", "publishes", "publish_fail",
+            "bytes", "udp", "commands", "step_fail", "bulk_open")
+
+
+###################################################################################################
+# 集計
+###################################################################################################
+class Histogram:
+    """対数階級のヒストグラム（プロセス間で足し合わせる）"""
+
+    def __init__(self):
+        self.buckets = {}
+        self.count = 0
+        self.max = 0.0
+
+    def add(self, value):
+        index = int(math.log(max(value, 0.001)) / math.log(HIST_RATIO))
+        self.buckets[index] = self.buckets.get(index, 0) + 1
+        self.count += 1
+        self.max = max(self.max, value)
+
+    def merge(self, other):
+        for index, n in other["buckets"].items():
+            self.buckets[int(index)] = self.buckets.get(int(index), 0) + n
+        self.count += other["count"]
+        self.max = max(self.max, other["max"])
+
+    def percentile(self, p):
+        if 0 == self.count:
+            return 0.0
+        target = math.ceil(self.count * p / 100.0)
+        seen = 0
+        for index in sorted(self.buckets):
+            seen += self.buckets[index]
+            if seen >= target:
+                return min(HIST_RATIO ** (index + 0.5), self.max)
+        return self.max
+
+    def to_dict(self):
+        return {"buckets": self.buckets, "count": self.count, "max": self.max}
+
+
+class Stats:
+    """ワーカー毎の集計（報告周期毎に差分を送る）"""
+
+    def __init__(self):
+        self.online = 0
+        self.clear()
+
+    def clear(self):
+        self.counters = dict.fromkeys(COUNTERS, 0)
+        self.hists = {name: Histogram() for name in METRICS}
+        self.steps = {}
+
+    def step_fail(self, name):
+        self.counters["step_fail"] += 1
+        self.steps[name] = self.steps.get(name, 0) + 1
+
+    def snapshot(self):
+        snap = {"online": self.online, "counters": self.counters, "steps": self.steps,
+                "hists": {name: h.to_dict() for name, h in self.hists.items()}}
+        self.clear()
+        return snap
+
+
+###################################################################################################
+# MQTT 3.1.1 クライアント（模擬 BG770 の client idx 1 つ分）
+###################################################################################################
+def encode_length(n):
+    out = bytearray()
+    while True:
+        byte = n % 128
+        n //= 128
+        out.append(byte | (0x80 if n else 0))
+        if not n:
+            return bytes(out)
+
+
+def encode_string(s):
+    data = s.encode() if isinstance(s, str) else s
+    return struct.pack("!H", len(data)) + data
+
+
+def packet(header, body):
+    return bytes([header]) + encode_length(len(body)) + body
+
+
+class MqttConnection:
+    """1 接続（client idx 1 つ分）。送信は呼び出し側が応答を待つ"""
+
+    def __init__(self, on_message=None):
+        self.reader = None
+        self.writer = None
+        self.on_message = on_message
+        self.waiters = {}
+        self.next_id = 1
+        self.closed = asyncio.Event()
+        self.task = None
+
+    async def open(self, host, port, timeout):
+        self.reader, self.writer = await asyncio.wait_for(asyncio.open_connection(host, port), timeout)
+        self.task = asyncio.ensure_future(self._read_loop())
+
+    def _packet_id(self):
+        packet_id = self.next_id
+        self.next_id = 1 if 0xFFFF == self.next_id else self.next_id + 1
+        return packet_id
+
+    async def _request(self, data, key, timeout):
+        if self.closed.is_set():
+            raise ConnectionError("closed")
+        future = asyncio.get_running_loop().create_future()
+        self.waiters[key] = future
+        self.writer.write(data)
+        try:
+            return await asyncio.wait_for(future, timeout)
+        finally:
+            self.waiters.pop(key, None)
+
+    async def connect(self, client_id, clean, keepalive, will_topic, will_message, timeout):
+        flags = 0x02 if clean else 0x00
+        payload = encode_string(client_id)
+        if will_topic:
+            # will_qos = 1、will_retain = 0（AT+QMTCFG="will",<idx>,1,1,0）
+            flags |= 0x04 | (1 << 3)
+            payload += encode_string(will_topic) + encode_string(will_message)
+        body = encode_string("MQTT") + bytes([4, flags]) + struct.pack("!H", keepalive) + payload
+        session_present, rc = await self._request(packet(CONNECT, body), "connack", timeout)
+        if 0 != rc:
+            raise ConnectionError("CONNACK rc=%d" % rc)
+        return session_present
+
+    async def subscribe(self, topic, qos, timeout):
+        packet_id = self._packet_id()
+        body = struct.pack("!H", packet_id) + encode_string(topic) + bytes([qos])
+        codes = await self._request(packet(SUBSCRIBE, body), ("suback", packet_id), timeout)
+        if 0x80 in codes:
+            raise ConnectionError("SUBACK failure")
+
+    async def unsubscribe(self, topic, timeout):
+        packet_id = self._packet_id()
+        body = struct.pack("!H", packet_id) + encode_string(topic)
+        await self._request(packet(UNSUBSCRIBE, body), ("unsuback", packet_id), timeout)
+
+    async def publish(self, topic, payload, qos, timeout):
+        if 0 == qos:
+            self.writer.write(packet(PUBLISH, encode_string(topic) + payload))
+            return
+        packet_id = self._packet_id()
+        body = encode_string(topic) + struct.pack("!H", packet_id) + payload
+        await self._request(packet(PUBLISH | (qos << 1), body), ("puback", packet_id), timeout)
+
+    def ping(self):
+        if not self.closed.is_set():
+            self.writer.write(packet(PINGREQ, b""))
+
+    def disconnect(self):
+        if self.writer and not self.closed.is_set():
+            self.writer.write(packet(DISCONNECT, b""))
+            self.writer.close()
+
+    def abort(self):
+        """電波断（ブローカーには RST で伝わる。DISCONNECT は送らないので遺言が配信される）"""
+        if self.writer:
+            self.writer.transport.abort()
+
+    async def _read_loop(self):
+        try:
+            while True:
+                header = (await self.reader.readexactly(1))[0]
+                length, shift = 0, 0
+                while True:
+                    byte = (await self.reader.readexactly(1))[0]
+                    length += (byte & 0x7F) << shift
+                    shift += 7
+                    if not byte & 0x80:
+                        break
+                body = await self.reader.readexactly(length) if length else b""
+                self._dispatch(header, body)
+        except (asyncio.IncompleteReadError, ConnectionError, OSError):
+            pass
+        finally:
+            self.closed.set()
+            for future in self.waiters.values():
+                if not future.done():
+                    future.set_exception(ConnectionError("closed"))
+
+    def _resolve(self, key, value):
+        future = self.waiters.get(key)
+        if future and not future.done():
+            future.set_result(value)
+
+    def _dispatch(self, header, body):
+        kind = header & 0xF0
+        if CONNACK == kind:
+            self._resolve("connack", (bool(body[0] & 0x01), body[1]))
+        elif PUBACK == kind:
+            self._resolve(("puback", struct.unpack("!H", body[:2])[0]), None)
+        elif SUBACK == kind:
+            self._resolve(("suback", struct.unpack("!H", body[:2])[0]), body[2:])
+        elif UNSUBACK == kind:
+            self._resolve(("unsuback", struct.unpack("!H", body[:2])[0]), None)
+        elif PUBLISH == kind:
+            qos = (header >> 1) & 0x03
+            (topic_len,) = struct.unpack("!H", body[:2])
+            topic = body[2:2 + topic_len].decode(errors="replace")
+            offset = 2 + topic_len
+            packet_id = 0
+            if qos:
+                (packet_id,) = struct.unpack("!H", body[offset:offset + 2])
+                offset += 2
+                self.writer.write(packet(PUBACK, body[offset - 2:offset]))
+            if self.on_message:
+                self.on_message(topic, body[offset:], packet_id)
+
+
+###################################################################################################
+# 基地局
+###################################################################################################
+class Cell:
+    """基地局（障害・アタッチの受付数）"""
+
+    def __init__(self, attach_rate):
+        self.up = asyncio.Event()
+        self.up.set()
+        self.attach_rate = attach_rate
+        self.next_slot = 0.0
+
+    async def attach(self):
+        """アタッチの順番待ち（--attach-rate 台/秒まで受け付ける）"""
+        if 0 >= self.attach_rate:
+            return
+        now = time.monotonic()
+        slot = max(now, self.next_slot)
+        self.next_slot = slot + 1.0 / self.attach_rate
+        await asyncio.sleep(slot - now)
+
+
+###################################################################################################
+# 模擬 BG770
+###################################################################################################
+def split_args(text):
+    """AT コマンドの引数（"..." の中のカンマは区切らない）"""
+    return next(csv.reader([text])) if text else []
+
+
+class Modem:
+    """1 台分の模擬 BG770（fleet_device のプロセス 1 つの UART の相手）"""
+
+    def __init__(self, index, args, cell, stats):
+        self.args = args
+        self.cell = cell
+        self.stats = stats
+        self.rng = random.Random(args.seed * 1000003 + index)
+        self.imsi = "%015d" % (args.imsi_base + index)
+        self.proc = None
+        self.serve_task = None
+        self.tasks = set()
+        self.conns = {}
+        self.cfg = {}
+        self.echo = True
+        self.verbose = True
+        self.online = False
+        self.session_present = False
+        self.last_command = None
+
+    async def run(self):
+        await asyncio.sleep(self.rng.uniform(0, self.args.ramp))
+        argv = [self.args.firmware]
+        for name in ("heartbeat", "telemetry", "telemetry_size"):
+            if getattr(self.args, name) is not None:
+                argv += ["--" + name.replace("_", "-"), str(getattr(self.args, name))]
+        self.proc = await asyncio.create_subprocess_exec(*argv, stdin=asyncio.subprocess.PIPE,
+                                                         stdout=asyncio.subprocess.PIPE,
+                                                         stderr=asyncio.subprocess.PIPE)
+        self.boot()
+        await self.events()
+        await self.proc.wait()
+
+    def stop(self):
+        """標準入力を閉じる（fleet_device は終了する）"""
+        self.power_off()
+        if self.proc and self.proc.returncode is None:
+            self.proc.stdin.close()
+
+    def power_off(self):
+        """全接続を切る（DISCONNECT は送らないので遺言が配信される）"""
+        for task in list(self.tasks) + [self.serve_task]:
+            if task:
+                task.cancel()
+        self.tasks.clear()
+        conns, self.conns = self.conns, {}
+        for conn in conns.values():
+            conn.abort()
+
+    def boot(self):
+        """電源投入・リセット（RDY から）"""
+        self.power_off()
+        self.cfg = {}
+        self.echo = True
+        self.verbose = True
+        self.last_command = None
+        self.stats.counters["attempts"] += 1
+        self.serve_task = asyncio.ensure_future(self.serve())
+
+    async def events(self):
+        """fleet_device からの通知（標準エラー）"""
+        while True:
+            line = await self.proc.stderr.readline()
+            if not line:
+                return
+            try:
+                event = json.loads(line)
+            except ValueError:
+                continue
+            if "reset" == event.get("event"):
+                if self.online:
+                    self.online = False
+                    self.stats.online -= 1
+                elif self.last_command:
+                    self.stats.step_fail(self.last_command)
+                self.stats.counters["resets"] += 1
+                self.boot()
+            elif "subscribed" == event.get("event"):
+                self.online = True
+                self.stats.online += 1
+                self.stats.hists["sequence"].add(event["ms"])
+                if event.get("resumed"):
+                    self.stats.counters["resumed"] += 1
+                    if not self.session_present:
+                        # ブローカーにセッションが無いのにサブスクライブを省いた（コマンドが届かない）
+                        self.stats.counters["resume_lost"] += 1
+                else:
+                    self.stats.counters["subscribed"] += 1
+
+    def write(self, data):
+        if self.proc.stdin.is_closing():
+            return
+        self.proc.stdin.write(data.encode() if isinstance(data, str) else data)
+
+    def ok(self):
+        self.write("0\r" if not self.verbose else "\r\nOK\r\n")
+
+    def error(self):
+        self.write("4\r" if not self.verbose else "\r\nERROR\r\n")
+
+    def urc(self, text):
+        self.write("\r\n" + text + "\r\n")
+
+    def spawn(self, coro):
+        task = asyncio.ensure_future(coro)
+        self.tasks.add(task)
+        task.add_done_callback(self.tasks.discard)
+
+    async def wait(self, span):
+        await asyncio.sleep(self.rng.uniform(*span))
+
+    async def radio(self, op):
+        """ブローカーとの通信（無線区間の遅延を足す）"""
+        try:
+            await asyncio.sleep(self.args.rtt / 2)
+        except asyncio.CancelledError:
+            op.close()
+            raise
+        result = await asyncio.wait_for(op, BROKER_TIMEOUT_S)
+        await asyncio.sleep(self.args.rtt / 2)
+        return result
+
+    async def serve(self):
+        """UART（AT コマンドを 1 つずつ受けて応答する）"""
+        await self.wait(BOOT_S)
+        self.write("\r\nRDY\r\n\r\nAPP RDY\r\n")
+        reader = self.proc.stdout
+        while True:
+            try:
+                line = await reader.readuntil(b"\r")
+            except asyncio.IncompleteReadError:
+                return
+            text = line[:-1].decode(errors="replace")
+            if "AT" not in text:
+                continue
+            text = text[text.index("AT"):]
+            if self.echo:
+                self.write(line)
+            name = re.split(r"[=?;]", text)[0]
+            self.last_command = name + ("=?" if text.endswith("=?") else "")
+            head, _, rest = text.partition("=")
+            await self.command(head, split_args(rest) if "?" != rest else ["?"], reader)
+
+    async def command(self, head, a, reader):
+        """AT コマンド 1 つの処理"""
+        if head.startswith("ATE0"):
+            await self.wait(MODEM_S)
+            self.echo = False
+            self.verbose = ";V0" not in head
+            self.ok()
+        elif "AT+CPIN?" == head:
+            await self.wait(MODEM_S)
+            self.urc("+CPIN: READY")
+            self.ok()
+        elif "AT+CIMI" == head:
+            await self.wait(MODEM_S)
+            self.urc(self.imsi)
+            self.ok()
+        elif "AT+COPS" == head and ["?"] == a:
+            await self.cell.up.wait()
+            await self.wait(SCAN_S)
+            self.urc(COPS_SCAN)
+            self.ok()
+        elif "AT+COPS" == head:
+            await self.cell.up.wait()
+            await self.cell.attach()
+            await self.wait(ATTACH_S)
+            if self.rng.random() < self.args.attach_fail:
+                self.error()
+            else:
+                self.ok()
+        elif "AT+CSQ" == head:
+            await self.wait(MODEM_S)
+            self.urc("+CSQ: %d,99" % (self.rng.randint(10, 25) if self.cell.up.is_set() else 99))
+            self.ok()
+        elif "AT+QIACT" == head:
+            await self.cell.up.wait()
+            await self.wait(PDP_S)
+            self.ok()
+        elif "AT+QIOPEN" == head:
+            await self.cell.up.wait()
+            await self.wait(MODEM_S)
+            self.ok()
+            await self.wait(SOCKET_S)
+            self.urc("+QIOPEN: %s,0" % a[1])
+        elif "AT+QISEND" == head:
+            self.write("\r\n> ")
+            data = await reader.readexactly(int(a[1]))
+            await asyncio.sleep(self.args.rtt / 2)
+            if self.cell.up.is_set():
+                self.stats.counters["udp"] += 1
+                self.stats.counters["bytes"] += len(data)
+                self.urc("SEND OK")
+            else:
+                self.urc("SEND FAIL")
+        elif "AT+QIRD" == head:
+            await self.wait(MODEM_S)
+            self.urc("+QIRD: 0")
+            self.ok()
+        elif "AT+QNTP" == head:
+            await self.wait(MODEM_S)
+            self.ok()
+            await asyncio.sleep(self.args.rtt)
+            self.urc('+QNTP: 0,"%s+00"' % time.strftime("%Y/%m/%d,%H:%M:%S", time.gmtime()))
+        elif "AT+QMTCFG" == head:
+            await self.wait(MODEM_S)
+            self.cfg.setdefault(int(a[1]), {})[a[0]] = a[2:]
+            self.ok()
+        elif "AT+QMTOPEN" == head:
+            self.ok()
+            await self.mqtt_open(int(a[0]))
+        elif "AT+QMTCONN" == head:
+            self.ok()
+            await self.mqtt_connect(int(a[0]), a[1])
+        elif "AT+QMTSUB" == head:
+            self.ok()
+            await self.mqtt_subscribe(int(a[0]), a[1], a[2], int(a[3]))
+        elif "AT+QMTUNS" == head:
+            self.ok()
+            await self.mqtt_unsubscribe(int(a[0]), a[1], a[2])
+        elif "AT+QMTPUB" == head:
+            self.write("\r\n> ")
+            payload = (await reader.readuntil(b"\x1a"))[:-1]
+            self.ok()
+            # PUBACK は URC で返す（他のコマンドと並行する）
+            self.spawn(self.mqtt_publish(int(a[0]), a[1], int(a[2]), a[4], payload))
+        elif head in ("AT+QMTDISC", "AT+QMTCLOSE"):
+            idx = int(a[0])
+            conn = self.conns.pop(idx, None)
+            if conn:
+                if "AT+QMTDISC" == head:
+                    conn.disconnect()
+                else:
+                    conn.abort()
+            self.ok()
+            self.urc("+%s: %d,0" % (head[3:], idx))
+        elif UNSUPPORTED.match(head):
+            self.error()
+        else:
+            await self.wait(MODEM_S)
+            self.ok()
+
+    async def mqtt_open(self, idx):
+        if idx in self.conns:
+            self.urc("+QMTOPEN: %d,2" % idx)
+            return
+        if not self.cell.up.is_set():
+            self.urc("+QMTOPEN: %d,3" % idx)
+            return
+        conn = MqttConnection(lambda topic, payload, packet_id: self.on_message(idx, topic, payload, packet_id))
+        try:
+            await self.radio(conn.open(self.args.host, self.args.port, BROKER_TIMEOUT_S))
+        except (asyncio.TimeoutError, ConnectionError, OSError):
+            self.urc("+QMTOPEN: %d,5" % idx)
+            return
+        self.conns[idx] = conn
+        self.spawn(self.mqtt_watch(idx, conn))
+        self.urc("+QMTOPEN: %d,0" % idx)
+
+    async def mqtt_connect(self, idx, client_id):
+        conn = self.conns.get(idx)
+        cfg = self.cfg.get(idx, {})
+        will = cfg.get("will", ["0"])
+        clean = "0" != cfg.get("session", ["1"])[0]
+        keepalive = int(cfg.get("keepalive", ["120"])[0])
+        t0 = time.monotonic()
+        try:
+            if not conn:
+                raise ConnectionError("not open")
+            present = await self.radio(
+                conn.connect(client_id, clean, keepalive, will[3] if "1" == will[0] else None,
+                             will[4].encode() if "1" == will[0] else None, BROKER_TIMEOUT_S))
+        except (asyncio.TimeoutError, ConnectionError, OSError):
+            self.urc("+QMTCONN: %d,2" % idx)
+            return
+        self.stats.hists["connack"].add((time.monotonic() - t0) * 1000)
+        self.stats.counters["connects"] += 1
+        if 0 == idx:
+            self.session_present = present
+        else:
+            self.stats.counters["bulk_open"] += 1
+        if keepalive:
+            self.spawn(self.mqtt_ping(conn, keepalive))
+        self.urc("+QMTCONN: %d,0,0" % idx)
+
+    async def mqtt_subscribe(self, idx, msgid, topic, qos):
+        t0 = time.monotonic()
+        try:
+            if idx not in self.conns:
+                raise ConnectionError("not open")
+            await self.radio(self.conns[idx].subscribe(topic, qos, BROKER_TIMEOUT_S))
+        except (asyncio.TimeoutError, ConnectionError, OSError):
+            self.urc("+QMTSUB: %d,%s,2" % (idx, msgid))
+            return
+        self.stats.hists["suback"].add((time.monotonic() - t0) * 1000)
+        self.urc("+QMTSUB: %d,%s,0,%d" % (idx, msgid, qos))
+
+    async def mqtt_unsubscribe(self, idx, msgid, topic):
+        try:
+            if idx not in self.conns:
+                raise ConnectionError("not open")
+            await self.radio(self.conns[idx].unsubscribe(topic, BROKER_TIMEOUT_S))
+        except (asyncio.TimeoutError, ConnectionError, OSError):
+            self.urc("+QMTUNS: %d,%s,2" % (idx, msgid))
+            return
+        self.urc("+QMTUNS: %d,%s,0" % (idx, msgid))
+
+    async def mqtt_publish(self, idx, msgid, qos, topic, payload):
+        t0 = time.monotonic()
+        try:
+            if idx not in self.conns:
+                raise ConnectionError("not open")
+            await self.radio(self.conns[idx].publish(topic, payload, qos, BROKER_TIMEOUT_S))
+        except (asyncio.TimeoutError, ConnectionError, OSError):
+            self.stats.counters["publish_fail"] += 1
+            self.urc("+QMTPUB: %d,%s,2" % (idx, msgid))
+            return
+        self.stats.hists["puback"].add((time.monotonic() - t0) * 1000)
+        self.stats.counters["publishes"] += 1
+        self.stats.counters["bytes"] += len(payload)
+        self.urc("+QMTPUB: %d,%s,0" % (idx, msgid))
+
+    async def mqtt_ping(self, conn, keepalive):
+        """キープアライブ（BG770 が自分で送る PINGREQ）"""
+        while not conn.closed.is_set():
+            await asyncio.sleep(keepalive / 2)
+            conn.ping()
+
+    async def mqtt_watch(self, idx, conn):
+        """ブローカー・基地局による切断は +QMTSTAT で知らせる"""
+        await conn.closed.wait()
+        if self.conns.get(idx) is conn:
+            del self.conns[idx]
+            self.urc("+QMTSTAT: %d,1" % idx)
+
+    def on_message(self, idx, topic, payload, packet_id):
+        """ブローカーからの PUBLISH（+QMTRECV）"""
+        try:
+            doc = json.loads(payload)
+        except ValueError:
+            doc = {}
+        if isinstance(doc, dict):
+            if "t" in doc:
+                self.stats.hists["fanout"].add(max(0.0, time.time() - doc["t"]) * 1000)
+            if "loadgen" == doc.get("command"):
+                self.stats.counters["commands"] += 1
+        self.urc('+QMTRECV: %d,%d,"%s","%s"' % (idx, packet_id, topic, payload.decode(errors="replace")))
+
+    def drop(self):
+        """基地局の障害（全接続が切れる）"""
+        for conn in list(self.conns.values()):
+            conn.abort()
+
+
+###################################################################################################
+# ワーカー（1 プロセス = 1 イベントループ）
+###################################################################################################
+async def worker_main(args, first, count, t0, out):
+    stats = Stats()
+    cell = Cell(args.attach_rate / args.workers)
+    modems = []
+    tasks = []
+    await asyncio.sleep(max(0.0, t0 - time.time()))
+    for i in range(first, first + count):
+        modem = Modem(i, args, cell, stats)
+        modems.append(modem)
+        tasks.append(asyncio.ensure_future(modem.run()))
+
+    async def outages():
+        for start, length in args.outage:
+            await asyncio.sleep(max(0.0, t0 + start - time.time()))
+            cell.up.clear()
+            for modem in modems:
+                modem.drop()
+            await asyncio.sleep(length)
+            cell.up.set()
+            cell.next_slot = time.monotonic()
+
+    tasks.append(asyncio.ensure_future(outages()))
+    end = t0 + args.duration
+    while time.time() < end:
+        await asyncio.sleep(min(args.interval, max(0.0, end - time.time())))
+        out.put(stats.snapshot())
+    for modem in modems:
+        modem.stop()
+    await asyncio.wait(tasks, timeout=5)
+    for modem in modems:
+        if modem.proc and modem.proc.returncode is None:
+            modem.proc.kill()
+    for task in tasks:
+        task.cancel()
+    out.put(None)
+
+
+def worker_entry(args, first, count, t0, out):
+    try:
+        asyncio.run(worker_main(args, first, count, t0, out))
+    except KeyboardInterrupt:
+        out.put(None)
+
+
+###################################################################################################
+# ハーネス（コマンド送信・受信側の計測・集計）
+###################################################################################################
+async def harness(args, t0, totals, topics):
+    """コマンドのファンアウトと、パブリッシュTOPIC の受信遅延（ブローカー経由）を計測する"""
+    if not args.command_every and not args.observe:
+        return
+
+    def on_message(topic, payload, packet_id):
+        try:
+            doc = json.loads(payload)
+        except ValueError:
+            return
+        if "ts" in doc:
+            totals.hists["e2e"].add(max(0.0, time.time() - doc["ts"]) * 1000)
+
+    conn = MqttConnection(on_message)
+    await conn.open(args.host, args.port, 10)
+    await conn.connect("fleet-sim-harness", True, 60, None, None, 10)
+    if args.observe:
+        await conn.subscribe(topics["pub_topic"], 0, 10)
+    await asyncio.sleep(max(0.0, t0 - time.time()))
+    last_ping = time.monotonic()
+    while time.time() < t0 + args.duration:
+        if args.command_every:
+            await asyncio.sleep(args.command_every)
+            doc = {"command": "loadgen", "count": 1, "size": 64, "t": time.time()}
+            await conn.publish(topics["sub_topic"], json.dumps(doc).encode(), 1, 30)
+        else:
+            await asyncio.sleep(1)
+        if (time.monotonic() - last_ping) >= 30:
+            last_ping = time.monotonic()
+            conn.ping()
+    conn.disconnect()
+
+
+class Totals:
+    """全ワーカーの合計"""
+
+    def __init__(self):
+        self.counters = dict.fromkeys(COUNTERS, 0)
+        self.hists = {name: Histogram() for name in METRICS}
+        self.steps = {}
+        self.timeline = []
+
+    def merge(self, snap):
+        for key, value in snap["counters"].items():
+            self.counters[key] += value
+        for key, value in snap["steps"].items():
+            self.steps[key] = self.steps.get(key, 0) + value
+        for name, hist in snap["hists"].items():
+            self.hists[name].merge(hist)
+
+
+def recovery(timeline, outages, devices):
+    """障害の復旧からオンライン台数が 50/90/99/100% に戻るまでの時間[s]"""
+    results = []
+    for start, length in outages:
+        restore = start + length
+        after = [(t, online, conns) for t, online, conns in timeline if t >= restore]
+        marks = {}
+        for ratio in (50, 90, 99, 100):
+            hit = next((t for t, online, _ in after if online * 100 >= devices * ratio), None)
+            marks["t%d" % ratio] = None if hit is None else round(hit - restore, 1)
+        marks["peak_conn_per_s"] = max((conns for _, _, conns in after), default=0)
+        results.append(dict(start=start, length=length, **marks))
+    return results
+
+
+def report(args, totals):
+    result = {"devices": args.devices, "duration": args.duration, "counters": totals.counters,
+              "step_fail": totals.steps, "recovery": recovery(totals.timeline, args.outage, args.devices), "latency_ms": {}}
+    print("\n%-10s %8s %10s %10s %10s %10s %10s" % ("ms", "count", "p50", "p90", "p99", "p99.9", "max"))
+    for name in METRICS:
+        h = totals.hists[name]
+        row = {"count": h.count, "p50": h.percentile(50), "p90": h.percentile(90), "p99": h.percentile(99),
+               "p99.9": h.percentile(99.9), "max": h.max}
+        result["latency_ms"][name] = row
+        print("%-10s %8d %10.1f %10.1f %10.1f %10.1f %10.1f" % (name, h.count, row["p50"], row["p90"], row["p99"],
+                                                                 row["p99.9"], row["max"]))
+    print("\ncounters  " + " ".join("%s=%d" % kv for kv in totals.counters.items()))
+    if totals.steps:
+        print("step_fail " + " ".join("%s=%d" % kv for kv in sorted(totals.steps.items())))
+    for r in result["recovery"]:
+        print("outage at %ds for %ds: t50=%s t90=%s t99=%s t100=%s peak %d conn/s" %
+              (r["start"], r["length"], r["t50"], r["t90"], r["t99"], r["t100"], r["peak_conn_per_s"]))
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(result, f, indent=2)
+
+
+async def collect(args, t0, out, totals):
+    """ワーカーの報告を周期毎にまとめて表示する"""
+    loop = asyncio.get_running_loop()
+    running = args.workers
+    seq = [0] * args.workers
+    pending = {}
+    while running:
+        try:
+            worker, snap = await loop.run_in_executor(None, out.get, True, 0.5)
+        except queue.Empty:
+            continue
+        if snap is None:
+            running -= 1
+            continue
+        totals.merge(snap)
+        interval = pending.setdefault(seq[worker], {"n": 0, "online": [0] * args.workers, "connects": 0,
+                                                    "publishes": 0, "bytes": 0})
+        seq[worker] += 1
+        interval["n"] += 1
+        interval["online"][worker] = snap["online"]
+        for key in ("connects", "publishes", "bytes"):
+            interval[key] += snap["counters"][key]
+        if interval["n"] < args.workers:
+            continue
+        pending.pop(seq[worker] - 1)
+        t = time.time() - t0
+        online = sum(interval["online"])
+        conns = interval["connects"] / args.interval
+        totals.timeline.append((t, online, conns))
+        print("t=%6.1fs online %5d/%d  conn/s %7.1f  pub/s %8.1f  kB/s %8.1f  puback p99 %7.1fms  connack p99 %7.1fms" %
+              (t, online, args.devices, conns, interval["publishes"] / args.interval,
+               interval["bytes"] / args.interval / 1024, totals.hists["puback"].percentile(99),
+               totals.hists["connack"].percentile(99)), flush=True)
+
+
+class Tagged:
+    """ワーカー番号を付けて送るキュー"""
+
+    def __init__(self, worker, out):
+        self.worker = worker
+        self.out = out
+
+    def put(self, snap):
+        self.out.put((self.worker, snap))
+
+
+def tagged_entry(args, worker, first, count, t0, out):
+    worker_entry(args, first, count, t0, Tagged(worker, out))
+
+
+def parse_outage(text):
+    start, length = text.split(":")
+    return float(start), float(length)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Pico3 fleet simulator (local MQTT broker)")
+    parser.add_argument("--firmware", default=FIRMWARE, help="fleet_device executable (pio run -e fleet)")
+    parser.add_argument("--host", default="127.0.0.1", help="broker host")
+    parser.add_argument("--port", type=int, default=1883, help="broker port")
+    parser.add_argument("--devices", type=int, default=100, help="number of emulated devices")
+    parser.add_argument("--workers", type=int, default=1, help="processes (one event loop each)")
+    parser.add_argument("--duration", type=float, default=300, help="run time [s]")
+    parser.add_argument("--ramp", type=float, default=30, help="boot spread [s]")
+    parser.add_argument("--outage", type=parse_outage, action="append", default=[],
+                        help="cell outage START:LENGTH [s] (repeatable)")
+    parser.add_argument("--attach-rate", type=float, default=0, help="attaches the cell accepts per second (0: no limit)")
+    parser.add_argument("--attach-fail", type=float, default=0.0, help="probability one AT+COPS candidate fails")
+    parser.add_argument("--rtt", type=float, default=0.15, help="radio round trip added to MQTT operations [s]")
+    parser.add_argument("--heartbeat", type=float, help="heartbeat period [s] (fleet_device default)")
+    parser.add_argument("--telemetry", type=float, help="telemetry period [s] (0: off, fleet_device default)")
+    parser.add_argument("--telemetry-size", type=int, help="telemetry payload size [byte] (fleet_device default)")
+    parser.add_argument("--command-every", type=float, default=0, help="publish a loadgen command every N s (0: off)")
+    parser.add_argument("--observe", action="store_true", help="subscribe to the publish topic and measure e2e latency")
+    parser.add_argument("--interval", type=float, default=1.0, help="report interval [s]")
+    parser.add_argument("--imsi-base", type=int, default=440103000000000, help="IMSI of device 0")
+    parser.add_argument("--seed", type=int, default=1, help="random seed")
+    parser.add_argument("--json", help="write the summary to this file")
+    args = parser.parse_args()
+    args.workers = max(1, min(args.workers, args.devices))
+    # TOPIC はファームウェアの setup_define.h のものを使う
+    topics = json.loads(subprocess.run([args.firmware, "--info"], check=True, capture_output=True).stdout)
+
+    t0 = time.time() + 1.0
+    out = multiprocessing.Queue()
+    procs = []
+    per = args.devices // args.workers
+    for worker in range(args.workers):
+        first = worker * per
+        count = per if worker < args.workers - 1 else args.devices - first
+        proc = multiprocessing.Process(target=tagged_entry, args=(args, worker, first, count, t0, out), daemon=True)
+        proc.start()
+        procs.append(proc)
+
+    totals = Totals()
+
+    async def run():
+        await asyncio.gather(collect(args, t0, out, totals), harness(args, t0, totals, topics))
+
+    try:
+        asyncio.run(run())
+    except KeyboardInterrupt:
+        pass
+    for proc in procs:
+        proc.join(timeout=5)
+    report(args, totals)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
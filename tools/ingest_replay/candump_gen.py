@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+@file candump_gen.py
+@version 0.1
+@brief 混雑した CAN バスの candump 記録（candump -l 形式）の作成
+
+can_bus.cpp の信号表の ID を周期送信し、信号表に無い ID（ハードウェアフィルタを抜けてくる分）を
+--background の割合で混ぜた記録を作る。ingest_replay can で can_parse_candump・can_process_frame に流す。
+実機の記録（candump -l can0）はそのまま再生できるので、このスクリプトは記録が無い負荷を試す用。
+  (1700000000.000000) can0 100#B80B2C01
+  (1700000000.000412) can0 18FF1234#0102030405060708
+
+@author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+@date 2026-10-19
+@copyright Copyright (c) 2026 旭光電機株式会社
+"""
+import argparse
+import random
+import struct
+import sys
+
+###################################################################################################
+# CONSTANTS
+###################################################################################################
+# can_bus.cpp の信号表（ID 毎のデータの作り方）
+SIGNAL_IDS = (0x100, 0x200, 0x300)
+# 記録の開始時刻[s]
+EPOCH = 1700000000
+
+
+###################################################################################################
+# BUS
+###################################################################################################
+class Machine:
+    """信号表の値（ランダムウォーク）"""
+
+    def __init__(self, rng):
+        self.rng = rng
+        self.rpm = 800
+        self.speed = 0
+        self.coolant = 20
+        self.fault = 0
+
+    def data(self, can_id):
+        """ID 毎のデータ（インテル形式）"""
+        if 0x100 == can_id:
+            self.rpm = max(600, min(6500, self.rpm + self.rng.randint(-30, 30)))
+            self.speed = max(0, min(300, self.speed + self.rng.randint(-1, 1)))
+            return struct.pack("<HH", self.rpm, self.speed) + bytes(4)
+        if 0x200 == can_id:
+            if self.rng.random() < 0.01:
+                self.coolant = max(-40, min(127, self.coolant + self.rng.choice((-1, 1))))
+            return struct.pack("<b", self.coolant)
+        if self.rng.random() < 0.001:
+            self.fault = self.rng.randrange(256)
+        return bytes([self.fault])
+
+
+def background_ids(rng, count, extended):
+    """信号表に無い ID"""
+    ids = set()
+    while len(ids) < count:
+        if extended and rng.random() < 0.5:
+            ids.add((rng.randrange(1 << 29), True))
+        else:
+            can_id = rng.randrange(0x800)
+            if can_id not in SIGNAL_IDS:
+                ids.add((can_id, False))
+    return sorted(ids)
+
+
+###################################################################################################
+# MAIN
+###################################################################################################
+def main():
+    parser = argparse.ArgumentParser(description="synthetic candump -l log for a busy CAN bus")
+    parser.add_argument("-o", "--output", required=True, help="出力ファイル（ingest_replay can の入力）")
+    parser.add_argument("--fps", type=float, default=4000, help="バス全体のフレーム数[frame/s]")
+    parser.add_argument("--seconds", type=float, default=60, help="時間[s]")
+    parser.add_argument("--background", type=float, default=0.7, help="信号表に無い ID の割合")
+    parser.add_argument("--ids", type=int, default=40, help="信号表に無い ID の種類")
+    parser.add_argument("--extended", action="store_true", help="信号表に無い ID に拡張フレームを混ぜる")
+    parser.add_argument("--interface", default="can0")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+    if args.fps <= 0:
+        parser.error("--fps は正の値")
+
+    rng = random.Random(args.seed)
+    machine = Machine(rng)
+    others = background_ids(rng, args.ids, args.extended)
+    total = int(args.fps * args.seconds)
+    with open(args.output, "w", encoding="ascii") as f:
+        for i in range(total):
+            at_us = EPOCH * 1000000 + int(i * 1000000 / args.fps)
+            if rng.random() < args.background:
+                can_id, ext = rng.choice(others)
+                data = bytes(rng.randrange(256) for _ in range(rng.randint(0, 8)))
+            else:
+                can_id, ext = rng.choice(SIGNAL_IDS), False
+                data = machine.data(can_id)
+            text = ("%08X" if ext else "%03X") % can_id
+            f.write("(%d.%06d) %s %s#%s\n" % (at_us // 1000000, at_us % 1000000, args.interface, text,
+                                              data.hex().upper()))
+    print("%d frames" % total, file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,28 @@
+/**
+ * @file host_stubs.cpp
+ * @version 0.1
+ * @brief 取り込み再生ハーネスでリンクしないモジュールの代わり（ホスト）
+ *
+ * subghz.cpp・can_bus.cpp が呼ぶルール判定・診断を置き換える。
+ *   ・rule ：判定対象無し（rule_post は呼ばれない。間引き前の値の判定時間は含まない）
+ *   ・diag ：タスクを登録しない（ホストは受信タスクを起動しない）
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include "diag.h"
+#include "rule.h"
+
+/*************************************************************************************************/
+bool rule_watch(rule_source_t source, uint32_t key) { return false; }
+
+/*************************************************************************************************/
+void rule_post(rule_source_t source, uint32_t key, int32_t value) {}
+
+/*************************************************************************************************/
+void diag_register_task(TaskHandle_t task, const char *name) {}
@@ -0,0 +1,244 @@
+/**
+ * @file ingest_replay.cpp
+ * @version 0.1
+ * @brief Sub-GHz・CAN 取り込みの再生ハーネス（ホスト）
+ *
+ * 変更していない subghz.cpp・can_bus.cpp に記録・生成したデータを流し、取り込み側の処理時間と
+ * 絞り込みの結果を 1 行の JSON で出力する。
+ *   ・subghz ：CC1310 の UART バイト列（subghz_gen.py の出力）を受信タスクと同じ 128 byte ずつ
+ *              subghz_feed に渡す。時計は UART の速度（SUBGHZ_BAUDRATE）で進め、集計周期毎に
+ *              subghz_flush・subghz_build_payload を呼ぶ
+ *   ・can    ：candump -l の記録（candump_gen.py の出力）を 1 行ずつ can_parse_candump で解析し、
+ *              記録の時刻で can_process_frame に渡す。CAN_PUBLISH_MS 毎に can_build_payload を呼ぶ
+ * 時計は加速（delay() で進めるだけ）なので、数分の記録も一瞬で終わる。
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "can_bus.h"
+#include "setup_define.h"
+#include "subghz.h"
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief 1 回に subghz_feed へ渡すバイト数（subghz.cpp の受信タスクと同じ） */
+#define REPLAY_CHUNK       128
+/** @brief UART 1 バイトのビット数（スタート・ストップビットを含む） */
+#define REPLAY_BYTE_BITS   10
+/** @brief candump 1 行の最大長 */
+#define REPLAY_LINE_SIZE   256
+
+/**************************************************************************************************
+ * LOCAL VARIABLES
+ */
+/** @brief ペイロード */
+static char payload[PUBLISH_SIZE];
+/** @brief 作成したペイロード数 */
+static uint32_t payloads = 0;
+/** @brief 作成したペイロードの合計長 */
+static uint32_t payload_bytes = 0;
+
+/**
+ * @brief 使い方の表示関数
+ * @param[in] name :プログラム名
+ */
+static void usage(const char *name)
+{
+  fprintf(stderr,
+          "usage: %s subghz <stream.bin> [--verbose]\n"
+          "       %s can <candump.log> [--verbose]\n"
+          "  --verbose  作成したペイロードを表示する\n",
+          name, name);
+}
+
+/**
+ * @brief ペイロードの集計関数
+ * @param[in] len :長さ（0：作成無し）
+ * @param[in] verbose :表示する
+ */
+static void replay_payload(uint16_t len, bool verbose)
+{
+  if (0 == len) {
+    return;
+  }
+  ++payloads;
+  payload_bytes += len;
+  if (verbose) {
+    printf("%.*s\n", (int)len, payload);
+  }
+}
+
+/**
+ * @brief Sub-GHz の再生関数
+ * @param[in] path :UART バイト列のファイル
+ * @param[in] verbose :ペイロードを表示する
+ * @return 終了コード
+ */
+static int replay_subghz(const char *path, bool verbose)
+{
+  FILE *fp = fopen(path, "rb");
+  if (NULL == fp) {
+    fprintf(stderr, "%s: cannot open\n", path);
+    return 2;
+  }
+
+  subghz_init();
+  uint8_t buf[REPLAY_CHUNK];
+  uint64_t bytes = 0;
+  uint64_t elapsed_ms = 0;
+  uint64_t feed_us = 0;
+  uint64_t cpu_start = host_cpu_us();
+  size_t n;
+  while (0 != (n = fread(buf, 1, sizeof(buf), fp))) {
+    uint64_t t0 = host_cpu_us();
+    subghz_feed(buf, n);
+    feed_us += host_cpu_us() - t0;
+    bytes += n;
+    /* 受信に掛かった時間だけ時計を進める */
+    uint64_t uart_ms = bytes * REPLAY_BYTE_BITS * 1000 / SUBGHZ_BAUDRATE;
+    delay((unsigned long)(uart_ms - elapsed_ms));
+    elapsed_ms = uart_ms;
+    subghz_flush(millis());
+    replay_payload(subghz_build_payload(payload, sizeof(payload)), verbose);
+  }
+  fclose(fp);
+  /* 最後の集計周期を出し切る */
+  delay(SUBGHZ_AGGREGATE_MS);
+  subghz_flush(millis());
+  while (0 != subghz_pending()) {
+    replay_payload(subghz_build_payload(payload, sizeof(payload)), verbose);
+  }
+  uint64_t cpu_us = host_cpu_us() - cpu_start;
+
+  subghz_stats_t stats;
+  subghz_get_stats(&stats);
+  uint32_t frames = stats.frames ? stats.frames : 1;
+  printf("{\"input\":\"%s\",\"bytes\":%llu,\"frames\":%lu,\"crc_errors\":%lu,\"bad_frames\":%lu,"
+         "\"duplicates\":%lu,\"node_overflows\":%lu,\"queue_drops\":%lu,\"payloads\":%lu,\"payload_bytes\":%lu,"
+         "\"feed_us\":%.3f,\"cpu_us\":%.3f,\"uart_us\":%lu}\n",
+         path, (unsigned long long)bytes, (unsigned long)stats.frames, (unsigned long)stats.crc_errors,
+         (unsigned long)stats.bad_frames, (unsigned long)stats.duplicates, (unsigned long)stats.node_overflows,
+         (unsigned long)stats.queue_drops, (unsigned long)payloads, (unsigned long)payload_bytes,
+         (double)feed_us / frames, (double)cpu_us / frames,
+         (unsigned long)(bytes * REPLAY_BYTE_BITS * 1000000 / SUBGHZ_BAUDRATE / frames));
+
+  return ((0 != stats.frames) && (0 == stats.queue_drops)) ? 0 : 1;
+}
+
+/**
+ * @brief CAN の再生関数
+ * @param[in] path :candump の記録
+ * @param[in] verbose :ペイロードを表示する
+ * @return 終了コード
+ */
+static int replay_can(const char *path, bool verbose)
+{
+  FILE *fp = fopen(path, "r");
+  if (NULL == fp) {
+    fprintf(stderr, "%s: cannot open\n", path);
+    return 2;
+  }
+
+  can_init();
+  char line[REPLAY_LINE_SIZE];
+  uint32_t lines = 0;
+  uint32_t rejected = 0;
+  uint64_t parse_us = 0;
+  uint64_t process_us = 0;
+  uint64_t origin_us = 0;
+  uint32_t now = 0;
+  uint32_t publish_ms = CAN_PUBLISH_MS;
+  uint64_t cpu_start = host_cpu_us();
+  while (NULL != fgets(line, sizeof(line), fp)) {
+    uint32_t id;
+    bool extended;
+    uint8_t data[8];
+    uint8_t dlc;
+    uint64_t time_us;
+
+    ++lines;
+    uint64_t t0 = host_cpu_us();
+    bool parsed = can_parse_candump(line, &id, &extended, data, &dlc, &time_us);
+    parse_us += host_cpu_us() - t0;
+    if (!parsed) {
+      ++rejected;
+      continue;
+    }
+    /* 記録の時刻（無ければ前の行と同じ時刻） */
+    if (0 != time_us) {
+      if (0 == origin_us) {
+        origin_us = time_us;
+      }
+      now = (uint32_t)((time_us - origin_us) / 1000);
+    }
+    /* 送信周期を過ぎていればパブリッシュする（loop の can_publish と同じ） */
+    while ((int32_t)(now - publish_ms) >= 0) {
+      replay_payload(can_build_payload(payload, sizeof(payload)), verbose);
+      publish_ms += CAN_PUBLISH_MS;
+    }
+    t0 = host_cpu_us();
+    can_process_frame(id, extended, data, dlc, now);
+    process_us += host_cpu_us() - t0;
+  }
+  fclose(fp);
+  replay_payload(can_build_payload(payload, sizeof(payload)), verbose);
+  uint64_t cpu_us = host_cpu_us() - cpu_start;
+
+  can_stats_t stats;
+  can_get_stats(&stats);
+  uint32_t frames = stats.frames ? stats.frames : 1;
+  uint32_t elapsed = now ? now : 1;
+  printf("{\"input\":\"%s\",\"lines\":%lu,\"rejected\":%lu,\"frames\":%lu,\"fps\":%lu,\"unmatched\":%lu,"
+         "\"suppressed\":%lu,\"events\":%lu,\"queue_drops\":%lu,\"payloads\":%lu,\"payload_bytes\":%lu,"
+         "\"parse_us\":%.3f,\"process_us\":%.3f,\"cpu_us\":%.3f}\n",
+         path, (unsigned long)lines, (unsigned long)rejected, (unsigned long)stats.frames,
+         (unsigned long)((uint64_t)stats.frames * 1000 / elapsed), (unsigned long)stats.unmatched, (unsigned long)stats.suppressed,
+         (unsigned long)stats.events, (unsigned long)stats.queue_drops, (unsigned long)payloads,
+         (unsigned long)payload_bytes, (double)parse_us / frames, (double)process_us / frames,
+         (double)cpu_us / frames);
+
+  return ((0 != stats.frames) && (0 == stats.queue_drops)) ? 0 : 1;
+}
+
+/*************************************************************************************************/
+int main(int argc, char **argv)
+{
+  bool verbose = false;
+  const char *mode = NULL;
+  const char *path = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (0 == strcmp(argv[i], "--verbose")) {
+      verbose = true;
+    } else if (('-' != argv[i][0]) && (NULL == mode)) {
+      mode = argv[i];
+    } else if (('-' != argv[i][0]) && (NULL == path)) {
+      path = argv[i];
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if ((NULL == mode) || (NULL == path)) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  if (0 == strcmp(mode, "subghz")) {
+    return replay_subghz(path, verbose);
+  }
+  if (0 == strcmp(mode, "can")) {
+    return replay_can(path, verbose);
+  }
+  usage(argv[0]);
+  return 2;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file twai.h
+ * @version 0.1
+ * @brief 取り込み再生ハーネス用の TWAI ドライバ互換部分（ホスト）
+ *
+ * can_init が使う型・設定マクロのみ。ドライバの導入は失敗を返すので受信タスクは起動せず、
+ * ハーネスが candump の行を can_process_frame に直接渡す。
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef TWAI_SHIM_H
+#define TWAI_SHIM_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <freertos/FreeRTOS.h>
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define TWAI_GENERAL_CONFIG_DEFAULT(tx, rx, mode) {mode, tx, rx, 5, 5}
+#define TWAI_TIMING_CONFIG_250KBITS() {250}
+#define TWAI_TIMING_CONFIG_500KBITS() {500}
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+typedef int esp_err_t;
+typedef int gpio_num_t;
+
+/** @brief 動作モード */
+typedef enum
+{
+  TWAI_MODE_NORMAL,
+  TWAI_MODE_NO_ACK,
+  TWAI_MODE_LISTEN_ONLY,
+} twai_mode_t;
+
+/** @brief ドライバの状態 */
+typedef enum
+{
+  TWAI_STATE_STOPPED,
+  TWAI_STATE_RUNNING,
+  TWAI_STATE_BUS_OFF,
+  TWAI_STATE_RECOVERING,
+} twai_state_t;
+
+/** @brief 全体設定（can_init が使う項目） */
+typedef struct
+{
+  twai_mode_t mode;
+  gpio_num_t tx_io;
+  gpio_num_t rx_io;
+  uint32_t tx_queue_len;
+  uint32_t rx_queue_len;
+} twai_general_config_t;
+
+/** @brief ビットタイミング */
+typedef struct
+{
+  uint32_t kbps;
+} twai_timing_config_t;
+
+/** @brief 受信フィルタ */
+typedef struct
+{
+  uint32_t acceptance_code;
+  uint32_t acceptance_mask;
+  bool single_filter;
+} twai_filter_config_t;
+
+/** @brief 受信メッセージ */
+typedef struct
+{
+  bool extd;
+  bool rtr;
+  uint32_t identifier;
+  uint8_t data_length_code;
+  uint8_t data[8];
+} twai_message_t;
+
+/** @brief 状態 */
+typedef struct
+{
+  twai_state_t state;
+  uint32_t rx_missed_count;
+  uint32_t rx_overrun_count;
+  uint32_t bus_error_count;
+} twai_status_info_t;
+
+/**************************************************************************************************
+ * GLOBAL FUNCTIONS
+ */
+/** @brief ドライバ導入（ホストは失敗を返す） */
+inline esp_err_t twai_driver_install(const twai_general_config_t *g, const twai_timing_config_t *t,
+                                     const twai_filter_config_t *f)
+{
+  return ESP_FAIL;
+}
+inline esp_err_t twai_start(void) { return ESP_FAIL; }
+inline esp_err_t twai_receive(twai_message_t *message, TickType_t ticks) { return ESP_FAIL; }
+inline esp_err_t twai_get_status_info(twai_status_info_t *info) { return ESP_FAIL; }
+inline esp_err_t twai_initiate_recovery(void) { return ESP_FAIL; }
+
+#endif
@@ -0,0 +1,36 @@
+/**
+ * @file FreeRTOS.h
+ * @version 0.1
+ * @brief 取り込み再生ハーネス用の FreeRTOS 互換部分（ホスト）
+ *
+ * 受信タスクは起動しない（ハーネスが subghz_feed・can_process_frame を直接呼ぶ）ので、型と定数のみ。
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef FREERTOS_SHIM_H
+#define FREERTOS_SHIM_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <stdint.h>
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portYIELD_FROM_ISR(woken) ((void)(woken))
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#endif
@@ -0,0 +1,41 @@
+/**
+ * @file task.h
+ * @version 0.1
+ * @brief 取り込み再生ハーネス用の FreeRTOS タスク互換部分（ホスト）
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef FREERTOS_TASK_SHIM_H
+#define FREERTOS_TASK_SHIM_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <stddef.h>
+#include "FreeRTOS.h"
+
+/**************************************************************************************************
+ * GLOBAL FUNCTIONS
+ */
+/**
+ * @brief タスク作成関数（ホストは作成しない。ハンドルは NULL）
+ */
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char *name, uint32_t stack, void *arg,
+                                          UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+  if (NULL != handle) {
+    *handle = NULL;
+  }
+  return pdTRUE;
+}
+/**
+ * @brief 通知関数（ISR。ホストは何もしない）
+ */
+inline void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken) {}
+/**
+ * @brief 通知待ち関数（ホストは待たない）
+ */
+inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) { return 0; }
+
+#endif
@@ -0,0 +1,168 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+@file subghz_gen.py
+@version 0.1
+@brief Sub-GHz(CC1310) フレームジェネレータ
+
+subghz.h のフレーム（subghz_frame_encode と同じ形式・CRC16-CCITT）をノード毎の通番で作り、出力する。
+  ・ファイル   ：ingest_replay subghz で subghz_feed に流す。フレーム間の空き時間は 0x00 で埋める
+                 （SOF 待ちで読み捨てられる）ので、UART の速度で進む再生時計が --rate と一致する
+  ・シリアル   ：USB-UART を SUBG UART(PORT_SUBGUART_RXD) につなぎ、実機へ --rate で送る（pyserial）
+--dup で再送（同じ通番）、--crc で CRC 不一致、--noise でフレーム間のゴミ（SOF を含む）を混ぜる。
+
+@author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+@date 2026-10-19
+@copyright Copyright (c) 2026 旭光電機株式会社
+"""
+import argparse
+import random
+import struct
+import sys
+import time
+
+###################################################################################################
+# CONSTANTS
+###################################################################################################
+# subghz.h
+SUBGHZ_BAUDRATE = 115200
+SUBGHZ_SOF = 0xA5
+SUBGHZ_MAX_LEN = 64
+SUBGHZ_TYPE_TEMP_HUMI = 0x01
+SUBGHZ_TYPE_COUNTER = 0x02
+SUBGHZ_TYPE_ANALOG = 0x03
+# UART 1 バイトのビット数（スタート・ストップビットを含む）
+BYTE_BITS = 10
+
+
+###################################################################################################
+# FRAME
+###################################################################################################
+def crc16(data):
+    """subghz_crc16（CRC16-CCITT、初期値 0xFFFF）"""
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def encode(node, seq, kind, data):
+    """subghz_frame_encode"""
+    length = len(data) + 4
+    if length > SUBGHZ_MAX_LEN:
+        raise ValueError("data too long")
+    body = struct.pack("<BHBB", length, node, seq & 0xFF, kind) + data
+    return bytes([SUBGHZ_SOF]) + body + struct.pack("<H", crc16(body))
+
+
+class Node:
+    """センサーノード（値はランダムウォーク）"""
+
+    def __init__(self, node, kind, rng):
+        self.node = node
+        self.kind = kind
+        self.rng = rng
+        self.seq = rng.randrange(256)
+        self.temp = rng.randint(1500, 3000)
+        self.humi = rng.randint(3000, 7000)
+        self.count = rng.randrange(1 << 20)
+        self.analog = rng.randint(-1000, 1000)
+
+    def data(self):
+        """次のサンプルのデータ部"""
+        if SUBGHZ_TYPE_TEMP_HUMI == self.kind:
+            self.temp = max(-4000, min(8500, self.temp + self.rng.randint(-5, 5)))
+            self.humi = max(0, min(10000, self.humi + self.rng.randint(-10, 10)))
+            return struct.pack("<hH", self.temp, self.humi)
+        if SUBGHZ_TYPE_COUNTER == self.kind:
+            self.count = (self.count + self.rng.randint(0, 3)) & 0xFFFFFFFF
+            return struct.pack("<I", self.count)
+        self.analog = max(-32768, min(32767, self.analog + self.rng.randint(-20, 20)))
+        return struct.pack("<h", self.analog)
+
+    def frame(self):
+        """次のフレーム"""
+        self.seq = (self.seq + 1) & 0xFF
+        return encode(self.node, self.seq, self.kind, self.data())
+
+
+###################################################################################################
+# MAIN
+###################################################################################################
+def generate(args):
+    """(送信時刻[s], バイト列) を順に返す"""
+    rng = random.Random(args.seed)
+    kinds = [SUBGHZ_TYPE_TEMP_HUMI, SUBGHZ_TYPE_COUNTER, SUBGHZ_TYPE_ANALOG]
+    nodes = [Node(args.first_node + i, kinds[i % len(kinds)], rng) for i in range(args.nodes)]
+    previous = {}
+    for i in range(int(args.rate * args.seconds)):
+        at = i / args.rate
+        n = rng.choice(nodes)
+        if args.noise and rng.random() < args.noise:
+            # SOF と異常な LEN を含むゴミ
+            yield at, bytes([SUBGHZ_SOF, rng.choice([0, 2, 0xFF])]) + bytes(rng.randrange(256) for _ in range(3))
+        if previous.get(n.node) and rng.random() < args.dup:
+            frame = previous[n.node]
+        else:
+            frame = n.frame()
+            previous[n.node] = frame
+        if rng.random() < args.crc:
+            frame = frame[:-1] + bytes([frame[-1] ^ 0x5A])
+        yield at, frame
+
+
+def main():
+    parser = argparse.ArgumentParser(description="CC1310 Sub-GHz frame generator")
+    parser.add_argument("-o", "--output", help="出力ファイル（ingest_replay subghz の入力）")
+    parser.add_argument("--port", help="シリアルポート（実機の SUBG UART へ送る。pyserial が必要）")
+    parser.add_argument("--nodes", type=int, default=16, help="ノード数（SUBGHZ_NODE_MAX=32 を超えると node_overflows）")
+    parser.add_argument("--first-node", type=int, default=1, help="先頭のノードID")
+    parser.add_argument("--rate", type=float, default=200, help="全ノード合計のフレーム数[frame/s]")
+    parser.add_argument("--seconds", type=float, default=60, help="時間[s]")
+    parser.add_argument("--dup", type=float, default=0.0, help="再送（同じ通番）の割合")
+    parser.add_argument("--crc", type=float, default=0.0, help="CRC 不一致の割合")
+    parser.add_argument("--noise", type=float, default=0.0, help="フレーム間にゴミを入れる割合")
+    parser.add_argument("--no-fill", action="store_true", help="ファイル出力で空き時間を埋めない（詰めて出力する）")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+    if (args.output is None) == (args.port is None):
+        parser.error("-o か --port のどちらかを指定する")
+    if args.rate <= 0:
+        parser.error("--rate は正の値")
+
+    frames = 0
+    if args.port:
+        import serial  # pylint: disable=import-outside-toplevel
+        with serial.Serial(args.port, SUBGHZ_BAUDRATE) as port:
+            start = time.monotonic()
+            for at, data in generate(args):
+                wait = start + at - time.monotonic()
+                if wait > 0:
+                    time.sleep(wait)
+                port.write(data)
+                frames += 1
+    else:
+        written = 0
+        with open(args.output, "wb") as f:
+            for at, data in generate(args):
+                # 再生時計（UART の速度で進む）が送信時刻になるまで空き時間を埋める
+                idle = int(at * SUBGHZ_BAUDRATE / BYTE_BITS) - written
+                if not args.no_fill and idle > 0:
+                    f.write(bytes(idle))
+                    written += idle
+                f.write(data)
+                written += len(data)
+                frames += 1
+        line_s = written * BYTE_BITS / SUBGHZ_BAUDRATE
+        if line_s > args.seconds * 1.01:
+            print("warning: %.0f frame/s exceeds the UART (%.1f s of line time for %.1f s)" %
+                  (args.rate, line_s, args.seconds), file=sys.stderr)
+    print("%d frames" % frames, file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,103 @@
+/**
+ * @file host_stubs.cpp
+ * @version 0.1
+ * @brief 再生ハーネスでリンクしないモジュールの代わり（ホスト）
+ *
+ * bg770.cpp が呼ぶ GPIO・電源管理・監視・実行時設定を置き換える。
+ *   ・GPIO（LED・BG770 リセット） ：何もしない
+ *   ・power_set                    ：状態を覚えるだけ（クロック・スリープは変えない）
+ *   ・supervisor                   ：中断しない（応答待ちは execute() のタイムアウトで終わる）
+ *   ・config                       ：既定値（NVS の設定は使わない。記録時に設定を変えていた場合は
+ *                                   送信バイトが記録と一致しない）
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <string.h>
+#include "CK_1540_01.h"
+#include "config.h"
+#include "power.h"
+#include "setup_define.h"
+#include "supervisor.h"
+
+/**************************************************************************************************
+ * LOCAL VARIABLES
+ */
+/** @brief 現在の電源状態 */
+static power_state_t power_state = POWER_STATE_IDLE;
+/** @brief 設定（全て既定値） */
+static config_t config;
+/** @brief 設定の作成済み */
+static bool config_ready = false;
+
+/**
+ * @brief 既定値の設定関数（config.cpp の config_defaults のうち bg770.cpp が読む項目）
+ */
+static void host_config_defaults(void)
+{
+  if (config_ready) {
+    return;
+  }
+  memset(&config, 0, sizeof(config));
+  config.schema = CONFIG_SCHEMA;
+  strncpy(config.link.apn, APN_NAME, sizeof(config.link.apn) - 1);
+  strncpy(config.link.apn_user, APN_USER, sizeof(config.link.apn_user) - 1);
+  strncpy(config.link.apn_pass, APN_PASS, sizeof(config.link.apn_pass) - 1);
+  strncpy(config.link.broker, BROKER_HOST, sizeof(config.link.broker) - 1);
+  config.link.port = BROKER_PORT;
+  strncpy(config.link.sub_topic, SUBSCRIBE_TOPIC, sizeof(config.link.sub_topic) - 1);
+  strncpy(config.link.pub_topic, PUBLISH_TOPIC, sizeof(config.link.pub_topic) - 1);
+  config_ready = true;
+}
+
+/*************************************************************************************************/
+void BG770_RESET_ON() {}
+void BG770_RESET_OFF() {}
+void LAN_RED_ON() {}
+void LAN_RED_OFF() {}
+void LAN_RED_FLA(uint16_t time, uint16_t msec) { delay((unsigned long)time * msec); }
+
+/*************************************************************************************************/
+power_state_t power_set(power_state_t state)
+{
+  power_state_t previous = power_state;
+  power_state = state;
+  return previous;
+}
+
+/*************************************************************************************************/
+uint8_t supervisor_enter(supervisor_stage_t stage, uint32_t budget_ms, const char *detail) { return 0; }
+
+/*************************************************************************************************/
+void supervisor_leave(uint8_t token) {}
+
+/*************************************************************************************************/
+void supervisor_feed(void) {}
+
+/*************************************************************************************************/
+bool supervisor_aborted(void) { return false; }
+
+/*************************************************************************************************/
+const config_t *config_get(void)
+{
+  host_config_defaults();
+  return &config;
+}
+
+/*************************************************************************************************/
+const config_link_t *config_link(void)
+{
+  host_config_defaults();
+  return &config.link;
+}
+
+/*************************************************************************************************/
+void config_link_apply(void) {}
+
+/*************************************************************************************************/
+uint32_t config_timeout(config_timeout_t id, uint32_t fallback) { return fallback; }
@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+@file mcap.py
+@version 0.1
+@brief BG770 通信記録（modem_capture.h の形式）の表示・作成
+
+  dump  ：記録を 1 レコード 1 行の文字列で表示する（> 送信 / < 受信、先頭は前レコードからの経過時間[ms]）
+  build ：同じ形式の文字列から記録を作る（実機の記録が無いシーケンス・障害を試す）
+
+文字列の形式（dump の出力と同じ。# 以降は注釈）
+  +<ms> > AT+CPIN?\\r
+  +<ms> < \\r\\n+CPIN: READY\\r\\n
+\\r \\n \\x1a \\\\ のエスケープを使える。受信の経過時間は直前の送信からの時間として再生される。
+
+@author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+@date 2026-10-19
+@copyright Copyright (c) 2026 旭光電機株式会社
+"""
+import argparse
+import re
+import sys
+
+###################################################################################################
+# CONSTANTS
+###################################################################################################
+# modem_capture.h
+MAGIC = b"MCAP"
+VERSION = 1
+HEADER_SIZE = 8
+RECORD_MAX = 128
+DIR_TX = 0x80
+
+
+###################################################################################################
+# FORMAT
+###################################################################################################
+def escape(data):
+    """バイト列を表示用の文字列にする"""
+    out = []
+    for b in data:
+        if b == 0x0D:
+            out.append("\\r")
+        elif b == 0x0A:
+            out.append("\\n")
+        elif b == 0x5C:
+            out.append("\\\\")
+        elif 0x20 <= b < 0x7F:
+            out.append(chr(b))
+        else:
+            out.append("\\x%02x" % b)
+    return "".join(out)
+
+
+def unescape(text):
+    """表示用の文字列をバイト列に戻す"""
+    out = bytearray()
+    i = 0
+    while i < len(text):
+        c = text[i]
+        if c != "\\":
+            out += c.encode()
+            i += 1
+            continue
+        n = text[i + 1:i + 2]
+        if n == "r":
+            out.append(0x0D)
+            i += 2
+        elif n == "n":
+            out.append(0x0A)
+            i += 2
+        elif n == "\\":
+            out.append(0x5C)
+            i += 2
+        elif n == "x":
+            out.append(int(text[i + 2:i + 4], 16))
+            i += 4
+        else:
+            raise ValueError("bad escape at %d" % i)
+    return bytes(out)
+
+
+def parse(data):
+    """記録を [(経過時間[ms], 送信なら True, データ), ...] にする"""
+    if len(data) < HEADER_SIZE or data[:4] != MAGIC or data[4] != VERSION:
+        raise ValueError("not a capture")
+    records = []
+    pos = HEADER_SIZE
+    while pos < len(data):
+        flags = data[pos]
+        pos += 1
+        delta = 0
+        shift = 0
+        while pos < len(data):
+            b = data[pos]
+            pos += 1
+            delta |= (b & 0x7F) << shift
+            shift += 7
+            if not b & 0x80:
+                break
+        length = (flags & 0x7F) + 1
+        if pos + length > len(data):
+            break
+        records.append((delta, bool(flags & DIR_TX), data[pos:pos + length]))
+        pos += length
+    return records
+
+
+def encode(records):
+    """[(経過時間[ms], 送信なら True, データ), ...] を記録にする（長いデータは分割する）"""
+    out = bytearray(MAGIC + bytes([VERSION, 0, 0, 0]))
+    for delta, tx, data in records:
+        for i in range(0, len(data), RECORD_MAX):
+            chunk = data[i:i + RECORD_MAX]
+            out.append((DIR_TX if tx else 0) | (len(chunk) - 1))
+            d = delta if i == 0 else 0
+            while True:
+                b = d & 0x7F
+                d >>= 7
+                out.append(b | (0x80 if d else 0))
+                if not d:
+                    break
+            out += chunk
+    return bytes(out)
+
+
+###################################################################################################
+# MAIN
+###################################################################################################
+LINE = re.compile(r"^\+(\d+)\s+([<>])\s(.*)$")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="BG770 modem capture dump/build")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+    p = sub.add_parser("dump", help="記録を文字列で表示する")
+    p.add_argument("capture")
+    p = sub.add_parser("build", help="文字列から記録を作る")
+    p.add_argument("text")
+    p.add_argument("capture")
+    args = parser.parse_args()
+
+    if args.cmd == "dump":
+        with open(args.capture, "rb") as f:
+            for delta, tx, data in parse(f.read()):
+                print("+%d %s %s" % (delta, ">" if tx else "<", escape(data)))
+        return 0
+
+    records = []
+    with open(args.text, encoding="utf-8") as f:
+        for number, line in enumerate(f, 1):
+            line = line.rstrip("\n")
+            if not line.strip() or line.lstrip().startswith("#"):
+                continue
+            m = LINE.match(line)
+            if not m:
+                print("%s:%d: bad line" % (args.text, number), file=sys.stderr)
+                return 1
+            records.append((int(m.group(1)), m.group(2) == ">", unescape(m.group(3))))
+    with open(args.capture, "wb") as f:
+        f.write(encode(records))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,151 @@
+/**
+ * @file modem_replay.cpp
+ * @version 0.1
+ * @brief BG770 通信記録の再生ハーネス（ホスト）
+ *
+ * /capture で取り出した記録を ModemReplayStream で bg770_set_stream() に差し込み、
+ * 変更していない init_command_sequence_task()/execute() を main.cpp の setup と同じ手順で回す。
+ * サブスクライブ完了の後も記録が残っていれば、REPLAY_PUBLISH_PAYLOAD を publish_command で 1 回送る。
+ * サブスクライブ完了（または記録の終わり）で、次を 1 行の JSON で出力する。
+ *   ・subscribe_ms ：初期化シーケンス開始からサブスクライブ完了まで（bg770_get_stats。再生時計での値）
+ *   ・resets       ：bg770_reset の回数
+ *   ・lines        ：照合した受信行数
+ *   ・parse_us     ：受信行 1 行あたりの照合時間（at_response_match）[us]
+ *   ・cpu_us       ：受信行 1 行あたりのプロセス CPU 時間（待ち時間を除く全体）[us]
+ *   ・mismatches   ：記録と異なる送信バイト数（コマンドの順序・内容が記録時から変わった）
+ *   ・publish      ：サブスクライブ後のパブリッシュの結果（none：記録に無い / ok / fail）
+ *
+ * 時計は既定で加速（delay() と受信待ちを待たずに進める）で、記録の間隔は再生時計で再現する。
+ * --realtime で実際に待つ。--speed は記録の間隔の倍率（0：間隔無し）。
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "bg770.h"
+#include "modem_capture.h"
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+/** @brief 既定のリセット上限（超えたら諦める） */
+#define REPLAY_MAX_RESETS  3
+/** @brief サブスクライブ後にパブリッシュするペイロード（記録の送信と一致させる） */
+#define REPLAY_PUBLISH_PAYLOAD "{\"replay\":1}"
+
+/**
+ * @brief 使い方の表示関数
+ * @param[in] name :プログラム名
+ */
+static void usage(const char *name)
+{
+  fprintf(stderr,
+          "usage: %s <capture.mcap> [--speed N] [--realtime] [--max-resets N] [--verbose]\n"
+          "  --speed N       記録の間隔の倍率（既定 1、0：間隔無し）\n"
+          "  --realtime      delay()・受信待ちで実際に待つ（既定は再生時計だけ進める）\n"
+          "  --max-resets N  bg770_reset がこの回数を超えたら諦める（既定 %d）\n"
+          "  --verbose       ファームウェアの Serial 出力を表示する\n",
+          name, REPLAY_MAX_RESETS);
+}
+
+/**
+ * @brief ファイルの読み込み関数
+ * @param[in] path :パス
+ * @param[out] data :内容
+ * @return true：成功
+ */
+static bool load(const char *path, std::vector<uint8_t> *data)
+{
+  FILE *fp = fopen(path, "rb");
+  if (NULL == fp) {
+    return false;
+  }
+  uint8_t buf[4096];
+  size_t n;
+  while (0 != (n = fread(buf, 1, sizeof(buf), fp))) {
+    data->insert(data->end(), buf, buf + n);
+  }
+  fclose(fp);
+  return true;
+}
+
+/*************************************************************************************************/
+int main(int argc, char **argv)
+{
+  const char *path = NULL;
+  uint16_t speed = 1;
+  uint32_t max_resets = REPLAY_MAX_RESETS;
+
+  for (int i = 1; i < argc; i++) {
+    if ((0 == strcmp(argv[i], "--speed")) && ((i + 1) < argc)) {
+      speed = (uint16_t)atoi(argv[++i]);
+    } else if ((0 == strcmp(argv[i], "--max-resets")) && ((i + 1) < argc)) {
+      max_resets = (uint32_t)atoi(argv[++i]);
+    } else if (0 == strcmp(argv[i], "--realtime")) {
+      host_set_realtime(true);
+    } else if (0 == strcmp(argv[i], "--verbose")) {
+      host_set_verbose(true);
+    } else if (('-' != argv[i][0]) && (NULL == path)) {
+      path = argv[i];
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (NULL == path) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  std::vector<uint8_t> capture;
+  ModemReplayStream replay;
+  if (!load(path, &capture) || !replay.begin(capture.data(), (uint32_t)capture.size(), speed)) {
+    fprintf(stderr, "%s: not a capture\n", path);
+    return 2;
+  }
+
+  /* main.cpp の setup と同じ（失敗したらリセットして初期化シーケンスをやり直す） */
+  uint64_t cpu_start = host_cpu_us();
+  bg770_init();
+  bg770_set_stream(&replay);
+  bg770_stats_t stats;
+  bg770_get_stats(&stats);
+  while (BG770_STATE_SUBSCRIBE != bg_state) {
+    if (API_STATUS_FAIL == init_command_sequence_task()) {
+      bg770_reset();
+      bg770_get_stats(&stats);
+      /* 記録の終わりで失敗したらそれ以上の応答は来ない */
+      if (replay.finished() || (stats.resets > max_resets)) {
+        break;
+      }
+    }
+  }
+  bool subscribed = (BG770_STATE_SUBSCRIBE == bg_state);
+  /* 記録が続いていればパブリッシュ（プロンプト「> 」→ペイロード→PUBACK）も再生する */
+  const char *publish = "none";
+  if (subscribed && !replay.finished()) {
+    Publish_length = (uint16_t)strlen(REPLAY_PUBLISH_PAYLOAD);
+    memcpy(Publish_payload, REPLAY_PUBLISH_PAYLOAD, Publish_length);
+    publish = (API_STATUS_SUCCESS == execute(&publish_command)) ? "ok" : "fail";
+  }
+  uint64_t cpu_us = host_cpu_us() - cpu_start;
+  bg770_get_stats(&stats);
+
+  uint32_t lines = stats.lines ? stats.lines : 1;
+  printf("{\"capture\":\"%s\",\"subscribed\":%s,\"subscribe_ms\":%lu,\"resets\":%lu,\"commands\":%lu,"
+         "\"lines\":%lu,\"parse_us\":%.2f,\"cpu_us\":%.2f,\"mismatches\":%lu,\"publish\":\"%s\",\"finished\":%s}\n",
+         path, subscribed ? "true" : "false", subscribed ? (unsigned long)stats.subscribe_ms : 0UL,
+         (unsigned long)stats.resets, (unsigned long)stats.commands, (unsigned long)stats.lines,
+         (double)stats.line_us / lines, (double)cpu_us / lines, (unsigned long)replay.mismatches(),
+         publish, replay.finished() ? "true" : "false");
+
+  return (subscribed && (0 != strcmp(publish, "fail"))) ? 0 : 1;
+}
@@ -0,0 +1,225 @@
+/**
+ * @file Arduino.h
+ * @version 0.1
+ * @brief 再生ハーネス用の Arduino 互換層（ホスト）
+ *
+ * bg770.cpp・at_response.cpp 等が使う分だけを std::string・ホストの時計で実装する。
+ * tools/ingest_replay（subghz.cpp・can_bus.cpp）も使う。
+ *   ・millis()/micros() ：実時間 + delay() で飛ばした時間（加速再生では delay() は待たない）
+ *   ・Serial            ：標準出力（host_set_verbose() で有効にした場合のみ）
+ *   ・Serial1           ：何も届かない（再生時は bg770_set_stream() で差し替える）
+ *   ・Serial2           ：何も届かない（再生時は subghz_feed() に直接渡す）
+ *   ・attachInterrupt   ：何もしない
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef ARDUINO_SHIM_H
+#define ARDUINO_SHIM_H
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+/**************************************************************************************************
+ * CONSTANTS
+ */
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define FALLING 2
+#define SERIAL_8N1 0x800001c
+#define IRAM_ATTR
+#define RTC_NOINIT_ATTR
+#define RTC_DATA_ATTR
+#define PROGMEM
+
+/**************************************************************************************************
+ * TYPEDEFS
+ */
+/** @brief 文字列（Arduino String の互換部分） */
+class String
+{
+public:
+  String() {}
+  String(const char *c) : s((NULL != c) ? c : "") {}
+  String(const std::string &c) : s(c) {}
+  String(char c) : s(1, c) {}
+  String(int v) : s(std::to_string(v)) {}
+  String(unsigned int v) : s(std::to_string(v)) {}
+  String(long v) : s(std::to_string(v)) {}
+  String(unsigned long v) : s(std::to_string(v)) {}
+
+  unsigned int length(void) const { return (unsigned int)s.size(); }
+  const char *c_str(void) const { return s.c_str(); }
+  char charAt(unsigned int i) const { return (i < s.size()) ? s[i] : '\0'; }
+  char operator[](unsigned int i) const { return charAt(i); }
+  String substring(unsigned int from) const { return (from < s.size()) ? s.substr(from) : std::string(); }
+  String substring(unsigned int from, unsigned int to) const
+  {
+    return ((from < to) && (from < s.size())) ? s.substr(from, to - from) : std::string();
+  }
+  int indexOf(char c, unsigned int from = 0) const { return pos(s.find(c, from)); }
+  int indexOf(const char *c, unsigned int from = 0) const { return pos(s.find(c, from)); }
+  void replace(const String &find, const String &with);
+  bool startsWith(const char *prefix) const { return 0 == s.compare(0, strlen(prefix), prefix); }
+  long toInt(void) const { return atol(s.c_str()); }
+  bool reserve(unsigned int size)
+  {
+    s.reserve(size);
+    return true;
+  }
+  bool concat(char c)
+  {
+    s += c;
+    return true;
+  }
+
+  String &operator+=(const String &o)
+  {
+    s += o.s;
+    return *this;
+  }
+  String &operator+=(const char *o)
+  {
+    s += o;
+    return *this;
+  }
+  String &operator+=(char o)
+  {
+    s += o;
+    return *this;
+  }
+  bool operator==(const String &o) const { return s == o.s; }
+  bool operator==(const char *o) const { return s == o; }
+  bool operator!=(const String &o) const { return s != o.s; }
+  bool operator!=(const char *o) const { return s != o; }
+  friend String operator+(const String &a, const String &b) { return a.s + b.s; }
+  friend String operator+(const String &a, const char *b) { return a.s + b; }
+  friend String operator+(const char *a, const String &b) { return a + b.s; }
+
+private:
+  static int pos(size_t p) { return (std::string::npos == p) ? -1 : (int)p; }
+
+  std::string s;
+};
+
+/** @brief 出力（Arduino Print の互換部分） */
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  virtual void flush(void) {}
+
+  size_t write(const char *str) { return write((const uint8_t *)str, strlen(str)); }
+  size_t print(const char *str) { return write(str); }
+  size_t print(const String &str) { return write(str.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v) { return printf("%d", v); }
+  size_t print(unsigned int v) { return printf("%u", v); }
+  size_t print(long v) { return printf("%ld", v); }
+  size_t print(unsigned long v) { return printf("%lu", v); }
+  size_t println(void) { return write("\r\n"); }
+  template <class T> size_t println(const T &v) { return print(v) + println(); }
+  size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+/** @brief 入出力（Arduino Stream の互換部分） */
+class Stream : public Print
+{
+public:
+  virtual int available(void) = 0;
+  virtual int read(void) = 0;
+  virtual int peek(void) = 0;
+
+  void setTimeout(unsigned long ms) { timeout = ms; }
+  unsigned long getTimeout(void) const { return timeout; }
+  size_t readBytes(uint8_t *buffer, size_t length);
+  size_t readBytes(char *buffer, size_t length) { return readBytes((uint8_t *)buffer, length); }
+  String readStringUntil(char terminator);
+
+protected:
+  int timedRead(void);
+
+  /** @brief 受信待ちの上限[ms] */
+  unsigned long timeout = 1000;
+};
+
+/** @brief シリアル（Serial：標準出力 Serial1：何も届かない） */
+class HardwareSerial : public Stream
+{
+public:
+  explicit HardwareSerial(bool console) : console(console) {}
+
+  void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rx = -1, int8_t tx = -1) {}
+  size_t setRxBufferSize(size_t size) { return size; }
+  operator bool() const { return true; }
+
+  int available(void) { return 0; }
+  int read(void) { return -1; }
+  int peek(void) { return -1; }
+  size_t write(uint8_t c);
+  size_t write(const uint8_t *buffer, size_t size);
+
+private:
+  /** @brief 標準出力へ出す */
+  bool console;
+};
+
+/** @brief ESP クラス（互換部分。サイクルはスレッドの CPU 時間[ns]で、CPU 1000MHz とする） */
+class EspClass
+{
+public:
+  void restart(void);
+  uint32_t getCycleCount(void);
+  uint32_t getCpuFreqMHz(void) { return 1000; }
+};
+
+/**************************************************************************************************
+ * GLOBAL VARIABLES
+ */
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+extern EspClass ESP;
+
+/**************************************************************************************************
+ * GLOBAL FUNCTIONS
+ */
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int digitalPinToInterrupt(uint8_t pin);
+void attachInterrupt(int interrupt, void (*handler)(void), int mode);
+long random(long max);
+
+/**
+ * @brief 時計の設定関数
+ * @param[in] realtime :true：delay() で実際に待つ false：待たずに時計を進める（加速再生）
+ */
+void host_set_realtime(bool realtime);
+/**
+ * @brief Serial の出力設定関数
+ * @param[in] verbose :true：標準出力へ出す
+ */
+void host_set_verbose(bool verbose);
+/**
+ * @brief プロセスの CPU 時間取得関数
+ * @return CPU 時間[us]
+ */
+uint64_t host_cpu_us(void);
+
+#endif
@@ -0,0 +1,55 @@
+/**
+ * @file Preferences.h
+ * @version 0.1
+ * @brief 再生ハーネス用の NVS（ホスト。プロセス内のメモリに保存し、起動毎に空）
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef PREFERENCES_SHIM_H
+#define PREFERENCES_SHIM_H
+
+#include <Arduino.h>
+#include <map>
+#include <string>
+#include <vector>
+
+/** @brief NVS（blob のみ） */
+class Preferences
+{
+public:
+  bool begin(const char *name, bool read_only = false)
+  {
+    space = name;
+    return true;
+  }
+  void end(void) {}
+  bool remove(const char *key) { return 0 != store().erase(space + "/" + key); }
+  size_t getBytes(const char *key, void *buf, size_t length)
+  {
+    std::vector<uint8_t> &v = store()[space + "/" + key];
+    if (v.size() > length) {
+      return 0;
+    }
+    memcpy(buf, v.data(), v.size());
+    return v.size();
+  }
+  size_t putBytes(const char *key, const void *buf, size_t length)
+  {
+    store()[space + "/" + key].assign((const uint8_t *)buf, (const uint8_t *)buf + length);
+    return length;
+  }
+
+private:
+  static std::map<std::string, std::vector<uint8_t>> &store(void)
+  {
+    static std::map<std::string, std::vector<uint8_t>> s;
+    return s;
+  }
+
+  /** @brief 名前空間 */
+  std::string space;
+};
+
+#endif
@@ -0,0 +1,17 @@
+/**
+ * @file WebServer.h
+ * @version 0.1
+ * @brief 再生ハーネス用の WebServer 宣言（ホスト。CK_1540_01.h の extern のみ）
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef WEBSERVER_SHIM_H
+#define WEBSERVER_SHIM_H
+
+#include <Arduino.h>
+
+class WebServer;
+
+#endif
@@ -0,0 +1,213 @@
+/**
+ * @file arduino_shim.cpp
+ * @version 0.1
+ * @brief 再生ハーネス用の Arduino 互換層（ホスト）
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+/**************************************************************************************************
+ * INCLUDES
+ */
+#include <Arduino.h>
+#include <time.h>
+#include <unistd.h>
+
+/**************************************************************************************************
+ * LOCAL VARIABLES
+ */
+/** @brief delay() で実際に待つ */
+static bool realtime = false;
+/** @brief Serial を標準出力へ出す */
+static bool verbose = false;
+/** @brief delay() で飛ばした時間[us] */
+static uint64_t skipped_us = 0;
+/** @brief 起動時刻[us] */
+static uint64_t origin_us = 0;
+
+/**************************************************************************************************
+ * GLOBAL VARIABLES
+ */
+HardwareSerial Serial(true);
+HardwareSerial Serial1(false);
+HardwareSerial Serial2(false);
+EspClass ESP;
+
+/**
+ * @brief 時計の読み出し関数
+ * @param[in] id :時計
+ * @return 時刻[us]
+ */
+static uint64_t host_clock_us(clockid_t id)
+{
+  struct timespec ts;
+  clock_gettime(id, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+/**
+ * @brief 現在時刻の取得関数（実時間 + 飛ばした時間）
+ * @return 時刻[us]
+ */
+static uint64_t host_now_us(void)
+{
+  uint64_t now = host_clock_us(CLOCK_MONOTONIC);
+  if (0 == origin_us) {
+    origin_us = now;
+  }
+  return (now - origin_us) + skipped_us;
+}
+
+/*************************************************************************************************/
+void String::replace(const String &find, const String &with)
+{
+  if (0 == find.s.size()) {
+    return;
+  }
+  for (size_t p = s.find(find.s); std::string::npos != p; p = s.find(find.s, p + with.s.size())) {
+    s.replace(p, find.s.size(), with.s);
+  }
+}
+
+/*************************************************************************************************/
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+  size_t n = 0;
+  while (n < size) {
+    write(buffer[n++]);
+  }
+  return n;
+}
+
+/*************************************************************************************************/
+size_t Print::printf(const char *format, ...)
+{
+  char buf[256];
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+  if (n < 0) {
+    return 0;
+  }
+  return write((const uint8_t *)buf, ((size_t)n < sizeof(buf)) ? (size_t)n : sizeof(buf) - 1);
+}
+
+/*************************************************************************************************/
+int Stream::timedRead(void)
+{
+  unsigned long start = millis();
+  do {
+    int c = read();
+    if (c >= 0) {
+      return c;
+    }
+    /* 受信待ち（加速再生では時計だけ進める） */
+    delay(1);
+  } while ((millis() - start) < timeout);
+  return -1;
+}
+
+/*************************************************************************************************/
+size_t Stream::readBytes(uint8_t *buffer, size_t length)
+{
+  size_t n = 0;
+  while (n < length) {
+    int c = timedRead();
+    if (c < 0) {
+      break;
+    }
+    buffer[n++] = (uint8_t)c;
+  }
+  return n;
+}
+
+/*************************************************************************************************/
+String Stream::readStringUntil(char terminator)
+{
+  std::string s;
+  int c = timedRead();
+  while ((c >= 0) && (c != terminator)) {
+    s += (char)c;
+    c = timedRead();
+  }
+  return s;
+}
+
+/*************************************************************************************************/
+size_t HardwareSerial::write(uint8_t c)
+{
+  if (console && verbose) {
+    fputc(c, stdout);
+  }
+  return 1;
+}
+
+/*************************************************************************************************/
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+  if (console && verbose) {
+    fwrite(buffer, 1, size, stdout);
+  }
+  return size;
+}
+
+/*************************************************************************************************/
+void EspClass::restart(void)
+{
+  fprintf(stderr, "ESP.restart()\n");
+  exit(2);
+}
+
+/*************************************************************************************************/
+uint32_t EspClass::getCycleCount(void)
+{
+  /* 他のプロセスに CPU を取られた時間を含めないようスレッドの CPU 時間で数える */
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (uint32_t)((uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec);
+}
+
+/*************************************************************************************************/
+unsigned long millis(void) { return (unsigned long)(host_now_us() / 1000); }
+
+/*************************************************************************************************/
+unsigned long micros(void) { return (unsigned long)host_now_us(); }
+
+/*************************************************************************************************/
+void delay(unsigned long ms)
+{
+  if (realtime) {
+    usleep(ms * 1000);
+  } else {
+    skipped_us += (uint64_t)ms * 1000;
+  }
+}
+
+/*************************************************************************************************/
+long random(long max) { return (max > 0) ? (::random() % max) : 0; }
+
+/*************************************************************************************************/
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+/*************************************************************************************************/
+void digitalWrite(uint8_t pin, uint8_t value) {}
+
+/*************************************************************************************************/
+int digitalRead(uint8_t pin) { return HIGH; }
+
+/*************************************************************************************************/
+int digitalPinToInterrupt(uint8_t pin) { return pin; }
+
+/*************************************************************************************************/
+void attachInterrupt(int interrupt, void (*handler)(void), int mode) {}
+
+/*************************************************************************************************/
+void host_set_realtime(bool enable) { realtime = enable; }
+
+/*************************************************************************************************/
+void host_set_verbose(bool enable) { verbose = enable; }
+
+/*************************************************************************************************/
+uint64_t host_cpu_us(void) { return host_clock_us(CLOCK_PROCESS_CPUTIME_ID); }
@@ -0,0 +1,26 @@
+/**
+ * @file esp_system.h
+ * @version 0.1
+ * @brief 再生ハーネス用の esp_system 互換部分（ホスト）
+ *
+ * @author Iefuji Kohei (iefuji.kohei@kyokko.co.jp)
+ * @date 2026-10-19
+ * @copyright Copyright (c) 2026 旭光電機株式会社
+ */
+#ifndef ESP_SYSTEM_SHIM_H
+#define ESP_SYSTEM_SHIM_H
+
+/** @brief リセット要因 */
+typedef enum
+{
+  ESP_RST_UNKNOWN,
+  ESP_RST_POWERON,
+} esp_reset_reason_t;
+
+/**
+ * @brief リセット要因取得関数（ホストは常に電源投入）
+ * @return リセット要因
+ */
+inline esp_reset_reason_t esp_reset_reason(void) { return ESP_RST_POWERON; }
+
+#endif